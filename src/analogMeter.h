@@ -38,6 +38,8 @@ Variable meter size and tremendous speed optimisation by cm 4/2024
 #include "guiObject.h" // Common GUI object for all widgets
 #include "Free_Fonts.h" // Include large fonts
 #include "meterScaleDefaults.h"
+#include "textFormat.h"
+#include "tftDma.h"
 
 // Scale is 100% long, 0% start.
 #define SCALE_MAX 100
@@ -47,6 +49,37 @@ Variable meter size and tremendous speed optimisation by cm 4/2024
 // constant for sin/cos/tan offsets, mid scale is 50%
 #define DEFL_CONST (90.0 + (SCALE_MAX / 2.0))  // 90 + (SCALE_MAX / 2) deg
 
+// Compile time sin/cos by Taylor series, C++11 constexpr (single return).
+// Accurate to float precision for |x| < pi, used for table generation only.
+constexpr double meterSinSeries(double x2, double term, double sum, int n) {
+  return (n > 12) ? sum : meterSinSeries(x2, -term * x2 / ((2 * n) * (2 * n + 1)), sum + term, n + 1);
+}
+constexpr double meterCosSeries(double x2, double term, double sum, int n) {
+  return (n > 12) ? sum : meterCosSeries(x2, -term * x2 / ((2 * n + 1) * (2 * n + 2)), sum + term, n + 1);
+}
+constexpr double meterSin(double x) { return meterSinSeries(x * x, x, 0.0, 1); }
+constexpr double meterCos(double x) { return meterCosSeries(x * x, 1.0, 0.0, 0); }
+// angle of tick i in radians, -140° for 0%, -40° for 100%
+constexpr double meterTickRad(int i) { return (i * TICK_STEP - DEFL_CONST) * 0.0174532925; }
+
+struct meterTickDir_t {
+  float x, y;
+};
+
+// Unit vectors of the scale ticks from needle pivot, generated at compile time
+#define METER_TICK_DIR(i) { (float)meterCos(meterTickRad(i)), (float)meterSin(meterTickRad(i)) }
+constexpr meterTickDir_t meterTickDirs[] = {
+  METER_TICK_DIR(0),  METER_TICK_DIR(1),  METER_TICK_DIR(2),  METER_TICK_DIR(3),
+  METER_TICK_DIR(4),  METER_TICK_DIR(5),  METER_TICK_DIR(6),  METER_TICK_DIR(7),
+  METER_TICK_DIR(8),  METER_TICK_DIR(9),  METER_TICK_DIR(10), METER_TICK_DIR(11),
+  METER_TICK_DIR(12), METER_TICK_DIR(13), METER_TICK_DIR(14), METER_TICK_DIR(15),
+  METER_TICK_DIR(16), METER_TICK_DIR(17), METER_TICK_DIR(18), METER_TICK_DIR(19),
+  METER_TICK_DIR(20)
+};
+#undef METER_TICK_DIR
+
+static_assert(sizeof(meterTickDirs) / sizeof(meterTickDirs[0]) == TICK_ARRSIZE, "meterTickDirs: one entry per tick");
+
 class AnalogMeter {
 public:
   AnalogMeter(TFT_eSPI *tft) { _tft = tft; }
@@ -87,11 +120,11 @@ public:
       meter.needle.y1 = posY + height - 14;
       meter.needle.width = 2;
 
-      // create tick and label position arrays for faster redraw
+      // create tick and label position arrays for faster redraw,
+      // unit vectors from meterTickDirs[] are only scaled by radius
       for (int i= 0; i < TICK_ARRSIZE; i++) {
-          float deg = float(i * TICK_STEP);
-          float sx_t = cos((deg - DEFL_CONST) * 0.0174532925); // -140°, -90-50 to -90+50
-          float sy_t = sin((deg - DEFL_CONST) * 0.0174532925);
+          float sx_t = meterTickDirs[i].x;
+          float sy_t = meterTickDirs[i].y;
           scale_X[i] = (int)(sx_t * meter.scale_radius + meter.needle.midX);
           scale_Y[i] = (int)(sy_t * meter.scale_radius + meter.needle.midY);
           scale_short_X[i] = (int)(sx_t * meter.tick_short_radius + meter.needle.midX);
@@ -124,14 +157,24 @@ public:
   // The range index determines the maximum value and the number of decimals for the display
   // Redraws the meter with the new settings
   void setRangeIdxColor(int range_idx, uint16_t color = TFT_RED) {
+    const meterRange_t &range = meterRanges[range_idx];
     meter.needleColor = color;
-    meter.maxVal = meterScaleMaxVal[range_idx];
-    meter.valDecimals = meterValDecimals[range_idx];
-    meter.scaleDecimals = meterScaleDecimals[range_idx];
+    meter.maxVal = range.maxVal;
+    meter.valDecimals = range.valDecimals;
+    meter.scaleDecimals = range.scaleDecimals;
     meter.range_idx = range_idx;
-    setZones(greenRangeStart[range_idx], greenRangeEnd[range_idx],
-             orangeRangeStart[range_idx], orangeRangeEnd[range_idx],
-             redRangeStart[range_idx], redRangeEnd[range_idx]);
+    setZones(range.greenStart, range.greenEnd, range.orangeStart, range.orangeEnd, range.redStart, range.redEnd);
+  }
+
+  // Rescale level integrator on range change, factor = old full scale / new full scale,
+  // so the needle goes to the right position at once. Call before setRangeIdxColor().
+  void rescaleLevel(float factor) {
+    meter.levelIntegrator *= factor;
+  }
+
+  // Clear level integrator without drawing, for reproducible screen captures
+  void resetLevel() {
+    meter.levelIntegrator = 0.0f;
   }
 
   // ##############################################################################
@@ -194,10 +237,10 @@ public:
         y_temp = scale_label_Y[idx];
            switch (i / 25) {
           case 0: _tft->drawCentreString("0", x_temp, y_temp - 12, 2); break;
-          case 1: _tft->drawCentreString(String(meter.maxVal * 0.25, meter.scaleDecimals), x_temp, y_temp - 9, 2); break;
-          case 2: _tft->drawCentreString(String(meter.maxVal * 0.5, meter.scaleDecimals), x_temp, y_temp - 7, 2); break;
-          case 3: _tft->drawCentreString(String(meter.maxVal * 0.75, meter.scaleDecimals), x_temp, y_temp - 9, 2); break;
-          case 4: _tft->drawCentreString(String(meter.maxVal, meter.scaleDecimals), x_temp, y_temp - 12, 2); break;
+          case 1: _tft->drawCentreString(LabelBuf().fixed(meter.maxVal * 0.25, meter.scaleDecimals), x_temp, y_temp - 9, 2); break;
+          case 2: _tft->drawCentreString(LabelBuf().fixed(meter.maxVal * 0.5, meter.scaleDecimals), x_temp, y_temp - 7, 2); break;
+          case 3: _tft->drawCentreString(LabelBuf().fixed(meter.maxVal * 0.75, meter.scaleDecimals), x_temp, y_temp - 9, 2); break;
+          case 4: _tft->drawCentreString(LabelBuf().fixed(meter.maxVal, meter.scaleDecimals), x_temp, y_temp - 12, 2); break;
         }
       }
       idx++;
@@ -225,8 +268,9 @@ public:
   // as needle may have moved and erased the scale.
   // Level ranges from 0 to 1.0 (float) with 1.0 = full deflection.
   void setLevel(float level, bool full_redraw = false) {
+      PROF_SCOPE(prof_meter);
       if (full_redraw) {
-        _tft->fillRect(meter.posX + 4, meter.posY + 4, meter.width - 7, meter.height - 17, TFT_WHITE);
+        tftDma.fillRect(meter.posX + 4, meter.posY + 4, meter.width - 7, meter.height - 17, TFT_WHITE); // meter face
         meter.deflection = -1;
         meter.levelIntegrator = level;
       }
@@ -260,7 +304,7 @@ public:
       _tft->setTextColor(TFT_BLACK, TFT_WHITE);
       _tft->setFreeFont(FF22);
       _tft->setTextDatum(TC_DATUM);
-      _tft->drawString(meterScaleUnits[meter.range_idx], meter.posX + meter.width / 2, meter.posY + meter.height / 2);
+      _tft->drawString(meterRanges[meter.range_idx].unit, meter.posX + meter.width / 2, meter.posY + meter.height / 2);
 
       // erase needle with old position (erase to white).
       // int nw = meter.needle.width; // needle base width for triangular needle
@@ -0,0 +1,149 @@
+#ifndef AUTORANGE_H
+#define AUTORANGE_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Auto-ranging over a block of consecutive ranges of meterRanges[], e.g. the
+// current ranges 30 mA..3 A or the voltage ranges 1 V..100 V.
+//
+// update() is called with every new value in base unit (A or V):
+//  - Up: on ADC overload, or if the value or its trend extrapolated by
+//    AUTORANGE_PREDICT_MS exceeds AUTORANGE_UP_PCT of full scale. Switches
+//    directly to the smallest range that holds the value below
+//    AUTORANGE_FIT_PCT, so a fast rise does not step through every range.
+//  - Down: only if the value fits below AUTORANGE_DOWN_PCT of a lower range
+//    for AUTORANGE_SETTLE_MS without interruption. The gap between
+//    AUTORANGE_DOWN_PCT of the lower and AUTORANGE_UP_PCT of the upper range
+//    is the hysteresis.
+//  - Down-ranging waits AUTORANGE_HOLDOFF_MS after any switch, until the input
+//    and display integrators have settled. Up-ranging never waits, clipping
+//    is worse than an early switch.
+//
+// Pure logic without hardware access, time is passed by the caller.
+// See tools/autorange_sim for a host simulation.
+
+#include <math.h>
+#include <stdint.h>
+#include "meterScaleDefaults.h"
+
+#define AUTORANGE_UP_PCT      100   // up-ranging above this deflection
+#define AUTORANGE_FIT_PCT      90   // target deflection limit when up-ranging
+#define AUTORANGE_DOWN_PCT     80   // down-ranging if value fits below this in lower range
+#define AUTORANGE_SETTLE_MS   800   // value must fit lower range this long
+#define AUTORANGE_HOLDOFF_MS  300   // no down-ranging after a switch
+#define AUTORANGE_PREDICT_MS  150   // trend extrapolation for up-ranging
+#define AUTORANGE_SLOPE_IIR  0.3f   // smoothing of trend
+
+// Full scale of a range in base unit (A or V)
+constexpr float meterRangeFullScale(int range_idx) {
+  return meterRanges[range_idx].maxVal * ((meterRanges[range_idx].unit[0] == 'm') ? 0.001f : 1.0f);
+}
+
+class AutoRanger {
+public:
+  // first_idx, last_idx: block of ranges in meterRanges[], ascending full scale
+  AutoRanger(int first_idx, int last_idx) : _first(first_idx), _last(last_idx), _idx(first_idx) { }
+
+  void setEnabled(bool enabled) { _enabled = enabled; _reset(); }
+  bool isEnabled() const { return _enabled; }
+
+  // Set range, e.g. on manual change or on start
+  void setRangeIdx(int range_idx) {
+    _idx = (range_idx < _first) ? _first : ((range_idx > _last) ? _last : range_idx);
+    _reset();
+  }
+  int getRangeIdx() const { return _idx; }
+
+  // Range the ranger is heading for: pending down-range target, up-range target
+  // if the trend points beyond full scale, otherwise current range
+  int predictedIdx() const { return _predicted; }
+
+  // New value in base unit. overload: ADC clipped, the value is not valid.
+  // Returns true if range changed, get new one with getRangeIdx().
+  bool update(float value, bool overload, uint32_t now_ms) {
+    float a = fabsf(value);
+    float dt = (float)(now_ms - _lastMs);
+    if (_hasLast && (dt > 0)) {
+      float slope = (a - _lastValue) / dt; // per ms
+      _slope += (slope - _slope) * AUTORANGE_SLOPE_IIR;
+    }
+    _hasLast = true;
+    _lastValue = a;
+    _lastMs = now_ms;
+    float predicted = (_slope > 0) ? a + _slope * AUTORANGE_PREDICT_MS : a;
+    _predicted = _idx;
+    if (!_enabled) return false;
+
+    bool holdoff = (now_ms - _switchMs) < AUTORANGE_HOLDOFF_MS;
+    float up_limit = _full(_idx) * (AUTORANGE_UP_PCT / 100.0f);
+    // up-ranging, at once
+    if (overload || (predicted > up_limit)) {
+      _downSince = 0;
+      // on overload the ADC clipped value is taken, no use going beyond the range holding it
+      int target = _fitIdx(predicted, AUTORANGE_FIT_PCT);
+      if (target <= _idx)
+        return false;
+      _switch(target, now_ms);
+      return true;
+    }
+    // down-ranging after settling time
+    int target = _fitIdx(a, AUTORANGE_DOWN_PCT);
+    if (target >= _idx) {
+      _downSince = 0;
+      return false;
+    }
+    _predicted = target;
+    if (!_downSince)
+      _downSince = now_ms | 1; // 0 = not pending
+    if (!holdoff && ((now_ms - _downSince) >= AUTORANGE_SETTLE_MS)) {
+      _switch(target, now_ms);
+      return true;
+    }
+    return false;
+  }
+
+private:
+  int _first, _last, _idx;
+  int _predicted = 0;
+  bool _enabled = false;
+  bool _hasLast = false;
+  float _lastValue = 0, _slope = 0;
+  uint32_t _lastMs = 0, _switchMs = 0, _downSince = 0;
+
+  static float _full(int range_idx) { return meterRangeFullScale(range_idx); }
+
+  // Smallest range holding value below pct of full scale, _last if none
+  int _fitIdx(float value, int pct) const {
+    for (int i = _first; i < _last; i++)
+      if (value <= _full(i) * (pct / 100.0f)) return i;
+    return _last;
+  }
+
+  void _switch(int range_idx, uint32_t now_ms) {
+    _idx = range_idx;
+    _predicted = range_idx;
+    _switchMs = now_ms;
+    _downSince = 0; // trend is in base unit, kept over switch
+  }
+
+  void _reset() {
+    _predicted = _idx;
+    _downSince = 0;
+    _slope = 0;
+    _hasLast = false;
+    _switchMs = 0;
+  }
+};
+
+#endif // AUTORANGE_H
@@ -34,6 +34,8 @@ https://github.com/Bodmer/TFT_eSPI/blob/master/TFT_eSPI.h
 #include "guiObject.h" // Common GUI object for all widgets
 #include "Free_Fonts.h" // Include large fonts
 #include "meterScaleDefaults.h"
+#include "textFormat.h"
+#include "tftDma.h"
 
 #define TICK_COUNT_BG 16      // 16 fine ticks for bargraph
 
@@ -106,7 +108,7 @@ public:
     for (int i = 0; i < 3; i++)
         _tft->drawRect(bargraph.x + i, bargraph.y + i, bargraph.width - 2 * i, bargraph.height - 2 * i, bargraph.bezelColor);
     _tft->drawRect(bargraph.x + 3, bargraph.y + 3, bargraph.width - 6, bargraph.height - 6, TFT_DARKGREY);
-    _tft->fillRect(bargraph.x + 4, bargraph.y + 4, bargraph.width - 8, bargraph.height - 8, bargraph.scaleColor);
+    tftDma.fillRect(bargraph.x + 4, bargraph.y + 4, bargraph.width - 8, bargraph.height - 8, bargraph.scaleColor);
 
     _tft->drawRect(bargraph.barXstart - 1, bargraph.barYstart - 1, bargraph.barWidth + 2, bargraph.barHeight + 2, bargraph.textColor);
     _tft->fillRectVGradient(bargraph.barXstart, bargraph.barYstart, bargraph.barWidth, bargraph.barHeight, bargraph.scaleColor, bargraph.scaleGradientColor);
@@ -127,17 +129,17 @@ public:
                 if (bargraph.height > 50) {
                     _tft->setTextDatum(BL_DATUM);
                     _tft->setFreeFont(FF21);
-                    _tft->drawString(meterScaleUnits[bargraph.range_idx], x1_tick, bargraph.y + bargraph.height - 5);
+                    _tft->drawString(meterRanges[bargraph.range_idx].unit, x1_tick, bargraph.y + bargraph.height - 5);
                 } else {
                     _tft->setTextDatum(TL_DATUM);
-                    _tft->drawString(meterScaleUnits[bargraph.range_idx], x1_tick, y1, 1);
+                    _tft->drawString(meterRanges[bargraph.range_idx].unit, x1_tick, y1, 1);
                 }
             } else if (idx == 16) {
                 _tft->setTextDatum(TR_DATUM);
-                _tft->drawString(String(bargraph.maxVal * mult, bargraph.scaleDecimals), x1_tick, y1, 1);
+                _tft->drawString(LabelBuf().fixed(bargraph.maxVal * mult, bargraph.scaleDecimals), x1_tick, y1, 1);
             } else {
                 _tft->setTextDatum(TC_DATUM);
-                _tft->drawString(String(bargraph.maxVal * mult, bargraph.scaleDecimals), x1_tick, y1, 1);
+                _tft->drawString(LabelBuf().fixed(bargraph.maxVal * mult, bargraph.scaleDecimals), x1_tick, y1, 1);
             }
             mult += 0.25;
         }
@@ -153,9 +155,9 @@ public:
   // Redraws the meter frame with the new settings
   void setRangeIdxColor(int range_idx, uint16_t color = TFT_GREEN, bool peak_tracking = false) {
     bargraph.needleColor = color;
-    bargraph.maxVal = meterScaleMaxVal[range_idx];
-    bargraph.valDecimals = meterValDecimals[range_idx];
-    bargraph.scaleDecimals = meterScaleDecimals[range_idx];
+    bargraph.maxVal = meterRanges[range_idx].maxVal;
+    bargraph.valDecimals = meterRanges[range_idx].valDecimals;
+    bargraph.scaleDecimals = meterRanges[range_idx].scaleDecimals;
     bargraph.gradientColor = _tft->alphaBlend(100, color, TFT_BLACK);
     bargraph.scaleGradientColor = _tft->alphaBlend(160, bargraph.scaleColor, TFT_BLACK);
     bargraph.range_idx = range_idx;
@@ -164,6 +166,19 @@ public:
     setLevel(bargraph.levelIntegrator, true);
   }
 
+  // Rescale level and peak on range change, factor = old full scale / new full scale.
+  // Call before setRangeIdxColor().
+  void rescaleLevel(float factor) {
+    bargraph.levelIntegrator *= factor;
+    bargraph.peakIntegrator *= factor;
+  }
+
+  // Clear level and peak integrator without drawing, for reproducible screen captures
+  void resetLevel() {
+    bargraph.levelIntegrator = 0.0f;
+    bargraph.peakIntegrator = 0.0f;
+  }
+
   void setLevel(float level, bool full_redraw = false) {
     if (full_redraw) {
       drawFrame();
@@ -192,6 +207,7 @@ public:
 
   void update(float level, float levelMark, bool full_redraw = false) {
     if (!_visible || !_enabled) return; // Do not draw if not visible
+    PROF_SCOPE(prof_bargraph);
     if (level > 1.0) level = 1.0;
     if (level < 0.0) level = 0.0;
     float level_integrator = bargraph.levelIntegrator;
@@ -413,7 +429,7 @@ public:
     for (int i = 0; i < 3; i++)
         _tft->drawRect(bargraph.x + i, bargraph.y + i, bargraph.width - 2 * i, bargraph.height - 2 * i, bargraph.bezelColor);
     _tft->drawRect(bargraph.x + 3, bargraph.y + 3, bargraph.width - 6, bargraph.height - 6, TFT_DARKGREY);
-    _tft->fillRect(bargraph.x + 4, bargraph.y + 4, bargraph.width - 8, bargraph.height - 8, bargraph.scaleColor);
+    tftDma.fillRect(bargraph.x + 4, bargraph.y + 4, bargraph.width - 8, bargraph.height - 8, bargraph.scaleColor);
 
     _tft->drawRect(bargraph.barXstart - 1, bargraph.barYstart - 1, bargraph.barWidth + 2, bargraph.barHeight + 2, bargraph.textColor);
     _tft->fillRectHGradient(bargraph.barXstart, bargraph.barYstart, bargraph.barWidth, bargraph.barHeight, bargraph.scaleColor, bargraph.scaleGradientColor);
@@ -432,14 +448,14 @@ public:
         if (idx < 16) { // Only draw text for first 4 ticks
           if (idx == 0) {
             _tft->setTextDatum(TL_DATUM);
-            _tft->drawString(String(bargraph.maxVal * mult, bargraph.scaleDecimals), _baseline_x + tl + 1, y1 + 1, 1);
+            _tft->drawString(LabelBuf().fixed(bargraph.maxVal * mult, bargraph.scaleDecimals), _baseline_x + tl + 1, y1 + 1, 1);
           } else {
             _tft->setTextDatum(ML_DATUM);
-            _tft->drawString(String(bargraph.maxVal * mult, bargraph.scaleDecimals), _baseline_x + tl + 1, y1 + 1, 1);
+            _tft->drawString(LabelBuf().fixed(bargraph.maxVal * mult, bargraph.scaleDecimals), _baseline_x + tl + 1, y1 + 1, 1);
           }
         } else if (idx == 16) {
           _tft->setTextDatum(BL_DATUM);
-          _tft->drawString(meterScaleUnits[bargraph.range_idx], _baseline_x + tl + 4, y1 + 3, 2);
+          _tft->drawString(meterRanges[bargraph.range_idx].unit, _baseline_x + tl + 4, y1 + 3, 2);
         }
         mult -= 0.25; // Decrease index for next tick
       }
@@ -454,9 +470,9 @@ public:
   // Redraws the meter frame with the new settings
   void setRangeIdxColor(int range_idx, uint16_t color = TFT_GREEN, bool peak_tracking = false) {
     bargraph.needleColor = color;
-    bargraph.maxVal = meterScaleMaxVal[range_idx];
-    bargraph.valDecimals = meterValDecimals[range_idx];
-    bargraph.scaleDecimals = meterScaleDecimals[range_idx];
+    bargraph.maxVal = meterRanges[range_idx].maxVal;
+    bargraph.valDecimals = meterRanges[range_idx].valDecimals;
+    bargraph.scaleDecimals = meterRanges[range_idx].scaleDecimals;
     bargraph.gradientColor = _tft->alphaBlend(100, color, TFT_BLACK);
     bargraph.scaleGradientColor = _tft->alphaBlend(160, bargraph.scaleColor, TFT_BLACK);
     bargraph.range_idx = range_idx;
@@ -465,6 +481,19 @@ public:
     setLevel(bargraph.levelIntegrator, true);
   }
 
+  // Rescale level and peak on range change, factor = old full scale / new full scale.
+  // Call before setRangeIdxColor().
+  void rescaleLevel(float factor) {
+    bargraph.levelIntegrator *= factor;
+    bargraph.peakIntegrator *= factor;
+  }
+
+  // Clear level and peak integrator without drawing, for reproducible screen captures
+  void resetLevel() {
+    bargraph.levelIntegrator = 0.0f;
+    bargraph.peakIntegrator = 0.0f;
+  }
+
 // #########################################################################
 
   // Update the bar graph with new values. It will only redraw partial bars needed
@@ -474,6 +503,7 @@ public:
   // The levelMark triangle indicator is only draw if levelMark >= 0.0.
   void update(float level, float levelMark, bool full_redraw = false) {
     if (!_visible || !_enabled) return; // Do not draw if not visible
+    PROF_SCOPE(prof_bargraph);
     if (level > 1.0) level = 1.0;
     if (level < 0.0) level = 0.0;
     float level_integrator = bargraph.levelIntegrator;
@@ -23,13 +23,47 @@
 #include "Free_Fonts.h" // Include large fonts
 
 int dayspermonth_arr[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-String day_names[7] = {"Son", "Mon", "Die", "Mit", "Don", "Fre", "Sam"};
+const char *day_names[7] = {"Son", "Mon", "Die", "Mit", "Don", "Fre", "Sam"};
 
 // -------------------------------------------------------------------------------
 
 // Wetterdaten von https://randomnerdtutorials.com/esp8266-weather-forecaster/
 
-// Set of tabs on bottom of panel area with a common area for tab content
+// sin(pos * 6°) for the 60 positions of the clock face, Q14 fixed point (16384 = 1.0)
+static const int16_t clock_sin_q14[60] = {
+       0,   1713,   3406,   5063,   6664,   8192,   9630,  10963,  12176,  13255,
+   14189,  14968,  15582,  16026,  16294,  16384,  16294,  16026,  15582,  14968,
+   14189,  13255,  12176,  10963,   9630,   8192,   6664,   5063,   3406,   1713,
+       0,  -1713,  -3406,  -5063,  -6664,  -8192,  -9630, -10963, -12176, -13255,
+  -14189, -14968, -15582, -16026, -16294, -16384, -16294, -16026, -15582, -14968,
+  -14189, -13255, -12176, -10963,  -9630,  -8192,  -6664,  -5063,  -3406,  -1713
+};
+
+#define CLOCK_HAND_HOUR 0
+#define CLOCK_HAND_MIN 1
+#define CLOCK_HAND_SEC 2
+#define CLOCK_MAX_DIRTY 9   // 3 alte Zeiger, 3 Striche, 3 neue Zeiger
+
+// Bounding box of drawn pixels, inclusive
+struct clockRect_t {
+  int16_t x0, y0, x1, y1;
+};
+
+// Geometry of a hand as last drawn
+struct clockHand_t {
+  int16_t x1, y1, x2, y2; // from (center or tail) to tip
+  float r1, r2;           // wedge radius at start and tip
+  int16_t dot_r;          // tail dot radius (second hand), 0 = none
+  clockRect_t box;        // all pixels touched by the hand
+  int8_t pos;             // 60-step position, -1 = not drawn
+};
+
+// Analog clock face with hour, minute and second hands.
+// Hands are redrawn incrementally: only a hand whose 60-step position changed is
+// erased and drawn again. Pixels under the erased hand (ticks, other hands, center
+// disc) are restored by redrawing those parts clipped to the erased area, so a
+// second tick touches the second hand and small patches only. All drawing passes
+// the background color, no pixels are read back from the display.
 class AnalogClock : public GUIObject {
 
 public:
@@ -46,21 +80,13 @@ public:
 		_bordercolor  = bordercolor;
 		_tickscolor   = tickscolor;
 		_handscolor   = handscolor;
-    _center_x     = x + _size / 2;
-    _center_y     = y + _size / 2;
-    _radius       = (size - 2) / 2;
-    _outer_radius = (float)_radius - 2;
 		_textcolor    = textcolor;
 		_textfont     = textfont;
   	_textfreefont = NULL;
 		_enabled = true;    // enabled by default
 		_active = true;  // active by default
 		_visible = true;  // visible by default
-    for (int z = 0; z < 360; z += 6) {
-      // Begin at 0° and stop at 360° in minute/second ticks
-      // Convert degrees to radians
-      _sin_table[z / 6] = sin(z / 57.296); // Store sine values for each second
-    }
+    _initGeometry();
   }
 
   // Overloaded function to use a FreeFont instead of a text font
@@ -73,176 +99,96 @@ public:
 		_bordercolor  = bordercolor;
 		_tickscolor   = tickscolor;
 		_handscolor   = handscolor;
-    _center_x     = x + _size / 2;
-    _center_y     = y + _size / 2;
-    _radius       = (size - 2) / 2;
-    _outer_radius = (float)_radius - 2;
 		_textcolor    = textcolor;
 		_textfont     = 255;// Default to 255, meaning use the FreeFont
 		_textfreefont = textfreefont;
 		_enabled = true;    // enabled by default
 		_active = true;  // active by default
 		_visible = true;  // visible by default
-    for (int z = 0; z < 360; z += 6) {
-      // Begin at 0° and stop at 360° in minute/second ticks
-      // Convert degrees to radians
-      _sin_table[z / 6] = sin(z / 57.296); // Store sine values for each second
-    }
+    _initGeometry();
 	}
 
-
-  void drawHourHand(int hour60, uint16_t color_mh) {
-    // clock hours hand, 60 divs resolution
-    int x1, x2, x3, y1, y2, y3;
-    uint16_t dimhandscolor = _tft->alphaBlend(128, color_mh, _bgcolor);
-    float hand_length = _outer_radius * 0.65;
-    float hand_width = _outer_radius / 9;
-    x3 = _center_x + (get_sin(hour60) * hand_length); // Endpunkt Zeiger
-    y3 = _center_y - (get_cos(hour60) * hand_length);
-    //_tft->fillTriangle(x1, y1, x2, y2, x3, y3, dimhandscolor);
-    // Draw an anti-aliased wide line from ax,ay to bx,by with different width at each end aw, bw and with radiused ends
-    // If bg_color is not included the background pixel colour will be read from TFT or sprite
-    _tft->drawWedgeLine(_center_x, _center_y, x3, y3, hand_width, 1, dimhandscolor);
-    _tft->drawWideLine(_center_x, _center_y, x3, y3, 2, color_mh, _bgcolor);
-  }
-
-  void drawMinuteHand(int min60, uint16_t color_mh) {
-    // clock minute hand
-    int x1, x2, x3, y1, y2, y3;
-    uint16_t dimhandscolor = _tft->alphaBlend(128, color_mh, _bgcolor);
-    float hand_length = _outer_radius * 0.9;
-    float hand_width = _outer_radius / 12.5;
-    x3 = _center_x + (get_sin(min60) * hand_length); // Endpunkt Zeiger
-    y3 = _center_y - (get_cos(min60) * hand_length);
-    //_tft->fillTriangle(x1, y1, x2, y2, x3, y3, dimhandscolor);
-    _tft->drawWedgeLine(_center_x, _center_y, x3, y3, hand_width, 1, dimhandscolor);
-    _tft->drawWideLine(_center_x, _center_y, x3, y3, 2, color_mh, _bgcolor);
-  }
-
-  void drawSecondHand(int sec60, uint16_t color_sec) {
-    // clock seconds hand
-    int x1, x2, y1, y2;
-    float hand_length = _outer_radius * 0.95;
-    float hand_width = _outer_radius / 5; // here: opposite direction
-    x1 = _center_x + (get_sin(sec60 - 30) * hand_width);
-    y1 = _center_y - (get_cos(sec60 - 30) * hand_width);
-    x2 = _center_x + (get_sin(sec60) * hand_length);
-    y2 = _center_y - (get_cos(sec60) * hand_length);
-    _tft->drawWideLine(x1, y1, x2, y2, 2, color_sec, _bgcolor);
-    _tft->fillCircle(x1, y1, hand_width / 3, color_sec);
-  }
-
-  void drawHands(int hour60, int min, int sec, uint16_t color_mh, uint16_t color_sec) {
-    // Draw hour hand
-    drawHourHand(hour60, color_mh);
-    // Draw minute hand
-    drawMinuteHand(min, color_mh);
-    // Draw second hand
-    _tft->fillCircle(_center_x, _center_y, _radius / 10, color_mh);
-    drawSecondHand(sec, color_sec);
-  }
-
-
-
   void draw(int hour, int min, int sec, bool redraw)  {
     if (!_visible || !_enabled) return; // Do not draw if not visible or not enabled
     hour = hour % 12; // Convert hour to 12-hour format
+    _hour_old = hour;
 
-    uint16_t my_textcolor = _textcolor;
-    uint16_t my_handscolor = _handscolor;
-    uint16_t my_facecolor = _bordercolor;
-    uint16_t my_tickscolor = _tickscolor;
-    uint16_t my_bgcolor = _bgcolor;
-
+    _cur_handscolor = _handscolor;
+    _cur_facecolor = _bordercolor;
+    _cur_tickscolor = _tickscolor;
+    _cur_bgcolor = _bgcolor;
     if (!_active) {
-      my_textcolor = TFT_DARKGREY;
-      my_handscolor = TFT_GREY;
-      my_facecolor = TFT_GREY;
-      my_tickscolor = TFT_GREY;
-      my_bgcolor = TFT_BLACK;
+      _cur_handscolor = TFT_GREY;
+      _cur_facecolor = TFT_GREY;
+      _cur_tickscolor = TFT_GREY;
+      _cur_bgcolor = TFT_BLACK;
     }
 
-    if (redraw) {
-      _tft->drawCircle(_center_x, _center_y, _radius, my_facecolor);
-      _tft->drawCircle(_center_x, _center_y, _radius - 1, _tft->alphaBlend(128, my_facecolor, my_bgcolor));
-      _tft->fillCircle(_center_x, _center_y, _radius - 2, my_bgcolor);
-    }
+    int8_t pos[3];
+    pos[CLOCK_HAND_HOUR] = hour * 5 + min / 12; // Convert hour to minute scale
+    pos[CLOCK_HAND_MIN] = min;
+    pos[CLOCK_HAND_SEC] = sec;
+    bool changed[3];
+    _dirtyCount = 0;
 
-    if (redraw || sec != _sec_old || min != _min_old) {
-      int hour60 = hour * 5 + min / 12; // Convert hour to minute scale
-      // erase hands to background if changed
-      if ((hour60 != _hour60_old) || redraw) {
-        drawHourHand(_hour60_old, my_bgcolor); // Print time in HH:MM:SS format
-        _hour60_old = hour60;
-      }
-      if ((min != _min_old) || redraw) {
-        drawMinuteHand(_min_old, my_bgcolor); // Print time in HH:MM:SS format
-        _min_old = min;
-      }
-      if ((sec != _sec_old) || redraw) {
-        drawSecondHand(_sec_old, my_bgcolor); // Print time in HH:MM:SS format
-        _sec_old = sec;
+    if (redraw) {
+      _tft->drawCircle(_center_x, _center_y, _radius, _cur_facecolor);
+      _tft->drawCircle(_center_x, _center_y, _radius - 1, _tft->alphaBlend(128, _cur_facecolor, _cur_bgcolor));
+      _tft->fillCircle(_center_x, _center_y, _radius - 2, _cur_bgcolor);
+      for (int z = 0; z < 60; z += 5)
+        _drawTick(z);
+      for (int i = 0; i < 3; i++)
+        changed[i] = true;
+    } else {
+      // erase moved hands, remember erased areas
+      for (int i = 0; i < 3; i++) {
+        changed[i] = (pos[i] != _hands[i].pos);
+        if (changed[i] && (_hands[i].pos >= 0)) {
+          _drawHand(i, _cur_bgcolor, _cur_bgcolor);
+          _addDirty(_hands[i].box);
+        }
       }
-      if (redraw || sec % 5 == 1 || (min % 5 == 1 && sec % 5 == 0)) {
-        // redraw clock face, might have been destroyed by erasing old hands
-        int x1, x2, y1, y2;
-        // clock face hour ticks
-        float outer_radius = _outer_radius - 2;
-        float inner_radius = _outer_radius * 0.87;
-        float tick_radius;
-        for (int z = 0; z < 60; z += 5) {
-          if (z % 15 == 0) {
-            tick_radius = inner_radius * 0.87; // Longer ticks for hour marks
-          } else {
-            tick_radius = inner_radius;
-          }
-          x1 = (_center_x + (get_sin(z) * outer_radius));
-          y1 = (_center_y - (get_cos(z) * outer_radius));
-          x2 = (_center_x + (get_sin(z) * tick_radius));
-          y2 = (_center_y - (get_cos(z) * tick_radius));
-          if (min == z || sec == z) {
-            _tft->drawWideLine(x1, y1, x1, y1, 2, my_tickscolor, my_bgcolor); // draw dot only if hands match tick
-          } else  {
-            _tft->drawWideLine(x1, y1, x2, y2, 2, my_tickscolor, my_bgcolor);
-          }
+      // restore ticks under erased minute and second hands, hour hand is too short
+      for (int i = CLOCK_HAND_MIN; i <= CLOCK_HAND_SEC; i++) {
+        int z = _hands[i].pos;
+        if (changed[i] && (z >= 0) && (z % 5 == 0)) {
+          _drawTick(z);
+          _addDirty(_tickBox(z));
         }
       }
-      drawHands(hour60, min, sec, my_handscolor, TFT_RED); // draw new hands
     }
-  /*
-    // now add temperature if needed
-    _tft->setCursor(88, 56); // - 6 = Baseline
-    _tft->print(tempNow, 1);
-    // _tft->write(0x7F);
-    _tft->setCursor(120, 56); // Baseline
-    _tft->print("C");
-    _tft->setCursor(114, 52); // Baseline
-    _tft->print("o");
-    yield();
-  */
+
+    // redraw in stacking order hour, minute, center disc, second:
+    // changed hands completely, unchanged ones only where they overlap dirty areas
+    for (int i = 0; i < 3; i++) {
+      if (i == CLOCK_HAND_SEC)
+        _restoreDisc();
+      if (changed[i]) {
+        _setHand(i, pos[i]);
+        _drawHand(i, (i == CLOCK_HAND_SEC) ? TFT_RED : _cur_handscolor, _cur_bgcolor);
+        _addDirty(_hands[i].box);
+      } else {
+        _restoreHand(i);
+      }
+    }
   }
 
   void update(int hour, int min, int sec, bool redraw)  {
     if (!_visible || !_enabled) return; // Do not draw if not visible or not enabled
-    if (redraw) {
-      _tft->fillCircle(_center_x, _center_y, _radius - 1, _bgcolor);
-    }
-    if (_sec_old != sec || redraw) {
+    if (_hands[CLOCK_HAND_SEC].pos != sec || redraw) {
       draw(hour, min, sec, redraw); // draw new hands
     }
   }
 
   // Overload with timeinfo
   void update(struct tm *timeinfo, bool redraw)  {
-    if (!_visible || !_enabled) return; // Do not draw if not visible or not enabled
-    if (_sec_old != timeinfo->tm_sec || redraw)
-      draw(timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, redraw); // draw new hands
+    update(timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, redraw);
   }
 
   // Redraw of object, will be called when the object needs to be redrawn without state change
   void redraw(bool active) override {
     _active = active; // Set active state
-    update(_hour_old, _min_old, _sec_old, true); // draw object
+    _redrawLast();
   }
 
   // Active state, object responds to user input when active; may be visible or not visible, though
@@ -250,7 +196,7 @@ public:
   void setActive(bool active, bool redraw = false) {
     _active = active;
     if (redraw)
-      update(_hour_old, _min_old, _sec_old, true);
+      _redrawLast();
   }
 
 	// Enabled state overrides Active and Visible states. Object will be ignored and not drawn if not enabled
@@ -258,31 +204,168 @@ public:
   void setEnabled(bool enabled, bool redraw = false) {
     _enabled = enabled;
     if (_visible && _enabled && redraw)
-      update(_hour_old, _min_old, _sec_old, true);
+      _redrawLast();
   }
 
   // -------------------------------------------------------------------------------
 
 private:
-  uint16_t  _handscolor, _tickscolor; // Selected tab index
-  int _min_old = 0, _sec_old = 0, _hour_old = 0, _hour60_old = 0;
-  int _min = 0, _sec = 0, _hour = 0;
-  float _sin_table[60];
-  float get_sin(int idx) {
-    if (idx < 0) idx += 60; // Ensure positive index
-    if (idx >= 60) idx -= 60; // Ensure index is within bounds
-    return _sin_table[idx];
+  uint16_t  _handscolor, _tickscolor;
+  uint16_t _cur_handscolor, _cur_facecolor, _cur_tickscolor, _cur_bgcolor; // colors of current draw()
+  int _hour_old = 0;
+  int16_t _outer_radius, _tick_outer, _tick_inner, _tick_inner_long;
+  int16_t _hour_len, _min_len, _sec_len, _sec_tail, _disc_r;
+  float _hour_w, _min_w;
+  clockHand_t _hands[3];
+  clockRect_t _dirty[CLOCK_MAX_DIRTY];
+  int _dirtyCount = 0;
+
+  void _initGeometry() {
+    _center_x = _x + _size / 2;
+    _center_y = _y + _size / 2;
+    _radius = (_size - 2) / 2;
+    _outer_radius = _radius - 2;
+    _tick_outer = _outer_radius - 2;
+    _tick_inner = _outer_radius * 87 / 100;
+    _tick_inner_long = _tick_inner * 87 / 100; // Longer ticks for hour marks
+    _hour_len = _outer_radius * 65 / 100;
+    _hour_w = _outer_radius / 9.0;
+    _min_len = _outer_radius * 90 / 100;
+    _min_w = _outer_radius / 12.5;
+    _sec_len = _outer_radius * 95 / 100;
+    _sec_tail = _outer_radius / 5; // here: opposite direction
+    _disc_r = _radius / 10;
+    for (int i = 0; i < 3; i++)
+      _hands[i].pos = -1;
+  }
+
+  // Point at 60-step position pos and distance len from center
+  int16_t _px(int pos, int16_t len) {
+    return _center_x + (((int32_t)clock_sin_q14[_wrap(pos)] * len + 8192) >> 14);
+  }
+
+  int16_t _py(int pos, int16_t len) {
+    return _center_y - (((int32_t)clock_sin_q14[_wrap(pos + 15)] * len + 8192) >> 14);
+  }
+
+  static int _wrap(int pos) {
+    if (pos < 0) pos += 60; // Ensure positive index
+    if (pos >= 60) pos -= 60; // Ensure index is within bounds
+    return pos;
+  }
+
+  // Set geometry and bounding box of hand for new position
+  void _setHand(int hand, int pos) {
+    clockHand_t *h = &_hands[hand];
+    h->pos = pos;
+    h->dot_r = 0;
+    switch (hand) {
+    case CLOCK_HAND_HOUR:
+    case CLOCK_HAND_MIN: {
+      int16_t len = (hand == CLOCK_HAND_HOUR) ? _hour_len : _min_len;
+      h->x1 = _center_x;
+      h->y1 = _center_y;
+      h->r1 = (hand == CLOCK_HAND_HOUR) ? _hour_w : _min_w;
+      h->r2 = 1;
+      h->x2 = _px(pos, len);
+      h->y2 = _py(pos, len);
+      break;
+    }
+    default:
+      h->x1 = _px(pos - 30, _sec_tail);
+      h->y1 = _py(pos - 30, _sec_tail);
+      h->x2 = _px(pos, _sec_len);
+      h->y2 = _py(pos, _sec_len);
+      h->r1 = 1;
+      h->r2 = 1;
+      h->dot_r = _sec_tail / 3;
+      break;
+    }
+    int16_t r1 = (int16_t)h->r1 + 2, r2 = (int16_t)h->r2 + 2; // antialiasing margin
+    if (h->dot_r + 1 > r1) r1 = h->dot_r + 1;
+    h->box.x0 = min(h->x1 - r1, h->x2 - r2);
+    h->box.y0 = min(h->y1 - r1, h->y2 - r2);
+    h->box.x1 = max(h->x1 + r1, h->x2 + r2);
+    h->box.y1 = max(h->y1 + r1, h->y2 + r2);
+  }
+
+  // Draw hand with current geometry, color = bgcolor erases it
+  void _drawHand(int hand, uint16_t color, uint16_t bgcolor) {
+    clockHand_t *h = &_hands[hand];
+    if (h->dot_r) {
+      // second hand: thin line and dot on the tail
+      _tft->drawWideLine(h->x1, h->y1, h->x2, h->y2, 2, color, bgcolor);
+      _tft->fillCircle(h->x1, h->y1, h->dot_r, color);
+    } else if (color == bgcolor) {
+      _tft->drawWedgeLine(h->x1, h->y1, h->x2, h->y2, h->r1, h->r2, bgcolor, bgcolor);
+    } else {
+      // Draw an anti-aliased wedge from center to tip, wider at the center, and a line on top
+      _tft->drawWedgeLine(h->x1, h->y1, h->x2, h->y2, h->r1, h->r2, _tft->alphaBlend(128, color, bgcolor), bgcolor);
+      _tft->drawWideLine(h->x1, h->y1, h->x2, h->y2, 2, color, bgcolor);
+    }
   }
 
-  float get_cos(int idx) {
-    idx += 15;
-    if (idx < 0) idx += 60; // Ensure positive index
-    if (idx >= 60) idx -= 60; // Ensure index is within bounds
-    return _sin_table[idx];
+  // Redraw parts of an unchanged hand that overlap dirty areas
+  void _restoreHand(int hand) {
+    clockHand_t *h = &_hands[hand];
+    if (h->pos < 0) return;
+    for (int i = 0; i < _dirtyCount; i++) {
+      if (_clip(_dirty[i], h->box)) {
+        _drawHand(hand, (hand == CLOCK_HAND_SEC) ? TFT_RED : _cur_handscolor, _cur_bgcolor);
+        _tft->resetViewport();
+      }
+    }
+  }
+
+  void _restoreDisc() {
+    clockRect_t disc = { (int16_t)(_center_x - _disc_r), (int16_t)(_center_y - _disc_r),
+                         (int16_t)(_center_x + _disc_r), (int16_t)(_center_y + _disc_r) };
+    for (int i = 0; i < _dirtyCount; i++) {
+      if (_clip(_dirty[i], disc)) {
+        _tft->fillCircle(_center_x, _center_y, _disc_r, _cur_handscolor);
+        _tft->resetViewport();
+      }
+    }
+  }
+
+  // Set viewport to intersection of a and b, absolute coordinates.
+  // Returns false if they do not overlap
+  bool _clip(const clockRect_t &a, const clockRect_t &b) {
+    int16_t x0 = max(a.x0, b.x0), y0 = max(a.y0, b.y0);
+    int16_t x1 = min(a.x1, b.x1), y1 = min(a.y1, b.y1);
+    if ((x0 > x1) || (y0 > y1)) return false;
+    _tft->setViewport(x0, y0, x1 - x0 + 1, y1 - y0 + 1, false);
+    return true;
   }
 
-  float _outer_radius;
+  void _addDirty(const clockRect_t &r) {
+    if (_dirtyCount < CLOCK_MAX_DIRTY)
+      _dirty[_dirtyCount++] = r;
+  }
+
+  // Hour tick at 60-step position z (multiple of 5)
+  void _drawTick(int z) {
+    int16_t inner = (z % 15 == 0) ? _tick_inner_long : _tick_inner;
+    _tft->drawWideLine(_px(z, _tick_outer), _py(z, _tick_outer), _px(z, inner), _py(z, inner),
+                       2, _cur_tickscolor, _cur_bgcolor);
+  }
+
+  clockRect_t _tickBox(int z) {
+    int16_t inner = (z % 15 == 0) ? _tick_inner_long : _tick_inner;
+    int16_t x1 = _px(z, _tick_outer), y1 = _py(z, _tick_outer);
+    int16_t x2 = _px(z, inner), y2 = _py(z, inner);
+    clockRect_t r = { (int16_t)(min(x1, x2) - 2), (int16_t)(min(y1, y2) - 2),
+                      (int16_t)(max(x1, x2) + 2), (int16_t)(max(y1, y2) + 2) };
+    return r;
+  }
+
+  // Full redraw with last drawn time
+  void _redrawLast() {
+    int min = (_hands[CLOCK_HAND_MIN].pos >= 0) ? _hands[CLOCK_HAND_MIN].pos : 0;
+    int sec = (_hands[CLOCK_HAND_SEC].pos >= 0) ? _hands[CLOCK_HAND_SEC].pos : 0;
+    update(_hour_old, min, sec, true);
+  }
 
 };
 
-#endif
\ No newline at end of file
+#endif
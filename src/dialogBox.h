@@ -26,6 +26,9 @@
 #include "guiObject.h" // Common GUI object for all widgets
 #include "Free_Fonts.h" // Include large fonts
 #include "buttons.h"
+#include "guiArena.h"
+#include "uiQueue.h"
+#include "tftDma.h"
 
 
 #define MSG_WIDTH 236
@@ -73,7 +76,8 @@ DialogBox(TFT_eSPI *tft, TouchProvider *touchProvider)
 	// Draw a dialog box with a message. Does not restore screen content.
 	// message1 is the main message, message2 is an optional secondary message
   // msgType sets the icon type (and leaves space for buttons if needed)
-	void draw(String message1, String message2, int msgType) {
+	void draw(const char *message1, const char *message2, int msgType) {
+		UI_CHECK_RENDER_TASK(); // only from loop(), other tasks use uiQueue
 
 		uint32_t my_msg_height = (msgType >= DB_INFO_OK) ? MSG_HEIGHT : MSG_HEIGHT * 3 / 5;
 		uint16_t center_x = DISPLAY_W / 2; 	// 160 Pixel
@@ -96,13 +100,13 @@ DialogBox(TFT_eSPI *tft, TouchProvider *touchProvider)
     // draw dialog/message box
 		_tft->drawRect(x0, y0, MSG_WIDTH, my_msg_height, TFT_WHITE);
 		_tft->drawRect(x0 + 1, y0 + 1, MSG_WIDTH - 2, my_msg_height - 2, TFT_WHITE);
-		_tft->fillRect(x0 + 2, y0 + 2, MSG_WIDTH - 4, my_msg_height - 4, TFT_DIALOGGREY);
+		tftDma.fillRect(x0 + 2, y0 + 2, MSG_WIDTH - 4, my_msg_height - 4, TFT_DIALOGGREY);
 
     // draw message text relative to center
 		_tft->setTextFont(2);
 		_tft->setTextColor(TFT_WHITE, TFT_DIALOGGREY);
 		_tft->setTextDatum(MC_DATUM); // middle center text datum
-		if (message2.length() == 0) {
+		if ((message2 == NULL) || (message2[0] == '\0')) {
 			_tft->drawString(message1, center_x + 10, msg_center_y, 2);
 		} else {
 			_tft->drawString(message1, center_x + 10, msg_center_y - 8, 2);
@@ -149,17 +153,15 @@ DialogBox(TFT_eSPI *tft, TouchProvider *touchProvider)
 	// Draw a dialog box with a message for a specified time
 	// message1 is the main message, message2 is an optional secondary message
   // Screen content will be restored after the message box is displayed
-  void message(String message1, String message2, int duration, int msgType = DB_INFO) {
+  void message(const char *message1, const char *message2, int duration, int msgType = DB_INFO) {
     uint16_t x0 = DISPLAY_W / 2 - MSG_WIDTH_2;
     uint16_t y0 = DISPLAY_H / 2 - MSG_HEIGHT_2;
-    uint16_t *screenbuf;
-    screenbuf = new uint16_t[MSG_WIDTH * MSG_HEIGHT]; // Create a screen buffer
-    _tft->readRect(x0, y0, MSG_WIDTH, MSG_HEIGHT, screenbuf);
+    GuiArenaScope arena_scope; // screen buffer freed on return
+    uint16_t *screenbuf = _saveUnder(x0, y0);
     draw(message1, message2, msgType);
     delay(duration);
     // Restore screen content
-    _tft->pushRect(x0, y0, MSG_WIDTH, MSG_HEIGHT, screenbuf);
-    delete[] screenbuf; // Free the screen buffer memory
+    _restore(x0, y0, screenbuf);
     delay(100);  // Wait a bit before restoring the screen
   }
 
@@ -174,15 +176,14 @@ DialogBox(TFT_eSPI *tft, TouchProvider *touchProvider)
 	// Show a modal dialog with a message and an OK button
 	// Returns true if OK was pressed, false if CANCEL was pressed
   // Screen content will be restored after the message box is displayed
-	bool modalDlg(String message1, String message2, int msgType = DB_INFO_OK) {
+	bool modalDlg(const char *message1, const char *message2, int msgType = DB_INFO_OK) {
 		uint16_t center_x = DISPLAY_W / 2;
 		uint16_t center_y = DISPLAY_H / 2; // 120 Pixel
     uint16_t x0 = center_x - MSG_WIDTH_2;
     uint16_t y0 = center_y - MSG_HEIGHT_2;
 
-    uint16_t *screenbuf;
-    screenbuf = new uint16_t[MSG_WIDTH * MSG_HEIGHT]; // Create a screen buffer
-    _tft->readRect(x0, y0, MSG_WIDTH, MSG_HEIGHT, screenbuf);
+    GuiArenaScope arena_scope; // screen buffer freed on return
+    uint16_t *screenbuf = _saveUnder(x0, y0);
 
 		uint16_t tx, ty; // button coordinates
 		ty = center_y + 34; // Button y position
@@ -221,8 +222,7 @@ DialogBox(TFT_eSPI *tft, TouchProvider *touchProvider)
 		_btnOK.setEnabled(false, false);
 		_tft->setTextFont(2);
     // Restore screen content
-    _tft->pushRect(x0, y0, MSG_WIDTH, MSG_HEIGHT, screenbuf);
-    delete[] screenbuf; // Free the screen buffer memory
+    _restore(x0, y0, screenbuf);
     delay(100);  // Wait a bit before restoring the screen
 		_tft->setTextColor(TFT_WHITE, TFT_BLACK);
 		return result;
@@ -235,6 +235,22 @@ private:
   int16_t  _x2, _y2;              // Coordinates of bottom-right corner of dialog box
   PushButton _btnOK;
   PushButton _btnCancel;
+
+  // Save screen content under the dialog in a temporary arena buffer,
+  // NULL if the arena is full (area is cleared on restore)
+  uint16_t *_saveUnder(uint16_t x0, uint16_t y0) {
+    uint16_t *buf = (uint16_t *)guiArena.alloc(MSG_WIDTH * MSG_HEIGHT * sizeof(uint16_t), gui_mem_large);
+    if (buf)
+      _tft->readRect(x0, y0, MSG_WIDTH, MSG_HEIGHT, buf);
+    return buf;
+  }
+
+  void _restore(uint16_t x0, uint16_t y0, uint16_t *buf) {
+    if (buf)
+      tftDma.pushRect(x0, y0, MSG_WIDTH, MSG_HEIGHT, buf);
+    else
+      tftDma.fillRect(x0, y0, MSG_WIDTH, MSG_HEIGHT, TFT_BLACK);
+  }
 };
 
 #endif
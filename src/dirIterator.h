@@ -0,0 +1,254 @@
+#ifndef DIRITERATOR_H
+#define DIRITERATOR_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Directory iterator for SPIFFS (or any fs::FS) and SdFat volumes.
+// Entries are fetched lazily one by one with openNextFile(), so even large
+// directories never need more memory than a single entry.
+// Supports suffix filtering ("bmp", ".html", "" = all) and paging via skip().
+// Used by DirListSource for the modal menu and by the web server directory listing.
+//
+// Usage:
+//   DirIterator dir(SPIFFS);
+//   dir.setFilter(".bmp");
+//   dir.begin();
+//   dir.skip(page * 10);            // page offset
+//   dirEntry_t entry;
+//   while (dir.next(entry)) { ... }
+//   dir.end();
+//
+// For SdFat, start_SD() must be called before begin() and end_SD() after end().
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SdFat.h>
+
+#define DIR_NAME_LEN 32     // max. Länge eines Dateinamens inkl. Nullterminator, wie menuArr_t
+#define DIR_FILTER_LEN 8    // max. Länge des Suffix-Filters
+
+struct dirEntry_t {
+  char name[DIR_NAME_LEN];
+  uint32_t size;
+  bool isDir;
+};
+
+class DirIterator {
+public:
+  // Iterator on a fs::FS file system like SPIFFS
+  DirIterator(fs::FS &fs, const char *path = "/") : _fs(&fs), _sd(NULL) { _init(path); }
+
+  // Overload for SdFat volumes, the SPI bus must be claimed by start_SD()
+  DirIterator(SdFat &sd, const char *path = "/") : _fs(NULL), _sd(&sd) { _init(path); }
+
+  ~DirIterator() { end(); }
+
+  // Set suffix filter, compared case-insensitive against the end of the file name.
+  // Empty string or NULL shows all entries
+  void setFilter(const char *suffix) {
+    if (suffix == NULL)
+      suffix = "";
+    strncpy(_filter, suffix, DIR_FILTER_LEN - 1);
+    _filter[DIR_FILTER_LEN - 1] = '\0';
+  }
+
+  // Open directory and fetch first matching entry. Returns false if directory can not be opened
+  bool begin() {
+    end();
+    if (_fs) {
+      _root = _fs->open(_path);
+      if (!_root || !_root.isDirectory())
+        return false;
+    } else {
+      if (!_sdRoot.open(_path, O_RDONLY) || !_sdRoot.isDir())
+        return false;
+    }
+    _isOpen = true;
+    _index = 0;
+    _fetch();
+    return true;
+  }
+
+  // Close directory handles, may be called multiple times
+  void end() {
+    if (!_isOpen) return;
+    if (_fs)
+      _root.close();
+    else
+      _sdRoot.close();
+    _isOpen = false;
+    _hasNext = false;
+  }
+
+  // Restart from first entry
+  bool rewind() {
+    return begin();
+  }
+
+  // Get next matching entry, returns false at end of directory
+  bool next(dirEntry_t &entry) {
+    if (!_hasNext) return false;
+    entry = _next;
+    _index++;
+    _fetch();
+    return true;
+  }
+
+  // Skip count matching entries, e.g. to start at a page offset.
+  // Returns number of entries actually skipped
+  int skip(int count) {
+    int skipped = 0;
+    while ((skipped < count) && _hasNext) {
+      _index++;
+      _fetch();
+      skipped++;
+    }
+    return skipped;
+  }
+
+  // True if at least one more matching entry follows
+  bool hasMore() const { return _hasNext; }
+
+  // Number of matching entries delivered or skipped since begin()
+  int index() const { return _index; }
+
+private:
+  fs::FS *_fs;
+  SdFat *_sd;
+  fs::File _root;
+  FsFile _sdRoot;
+  char _path[DIR_NAME_LEN];
+  char _filter[DIR_FILTER_LEN];
+  dirEntry_t _next;     // lookahead entry, so hasMore() knows if a next page exists
+  bool _hasNext;
+  bool _isOpen;
+  int _index;
+
+  void _init(const char *path) {
+    strncpy(_path, path, DIR_NAME_LEN - 1);
+    _path[DIR_NAME_LEN - 1] = '\0';
+    _filter[0] = '\0';
+    _hasNext = false;
+    _isOpen = false;
+    _index = 0;
+  }
+
+  // Case-insensitive suffix compare
+  bool _matches(const char *name) const {
+    size_t flen = strlen(_filter);
+    if (flen == 0) return true;
+    size_t nlen = strlen(name);
+    if (nlen < flen) return false;
+    return (strcasecmp(name + nlen - flen, _filter) == 0);
+  }
+
+  // Read ahead to next matching entry, opens only one file handle at a time
+  void _fetch() {
+    _hasNext = false;
+    if (!_isOpen) return;
+    if (_fs) {
+      fs::File file = _root.openNextFile();
+      while (file) {
+        if (_matches(file.name())) {
+          strncpy(_next.name, file.name(), DIR_NAME_LEN - 1);
+          _next.name[DIR_NAME_LEN - 1] = '\0';
+          _next.size = file.size();
+          _next.isDir = file.isDirectory();
+          _hasNext = true;
+          file.close();
+          return;
+        }
+        file.close();
+        file = _root.openNextFile();
+      }
+    } else {
+      FsFile file;
+      while (file.openNext(&_sdRoot, O_RDONLY)) {
+        file.getName(_next.name, DIR_NAME_LEN);
+        if (_matches(_next.name)) {
+          _next.size = file.fileSize();
+          _next.isDir = file.isDir();
+          _hasNext = true;
+          file.close();
+          return;
+        }
+        file.close();
+      }
+    }
+  }
+};
+
+// ##############################################################################
+
+#define DIR_CACHE_ENTRIES 16  // Namen im Cache von DirListSource
+
+// Random access to entry names for virtualized lists like ModalMenu::select().
+// Names are read on demand into a cache of DIR_CACHE_ENTRIES consecutive
+// entries; a miss re-positions the cache around the requested index, going
+// backwards rewinds the directory. begin() counts the entries once.
+class DirListSource {
+public:
+  DirListSource(fs::FS &fs, const char *path = "/") : _dir(fs, path) { }
+  DirListSource(SdFat &sd, const char *path = "/") : _dir(sd, path) { }
+
+  // Open directory, returns number of matching entries
+  int begin(const char *filter) {
+    _dir.setFilter(filter);
+    _count = 0;
+    _cacheStart = 0;
+    _cacheLen = 0;
+    if (!_dir.begin()) return 0;
+    _count = _dir.skip(0x7FFFFFFF);
+    return _count;
+  }
+
+  void end() { _dir.end(); }
+
+  int count() const { return _count; }
+
+  // Name of entry idx, "" if out of range. Valid until next call
+  const char *name(int idx) {
+    if ((idx < 0) || (idx >= _count)) return "";
+    if ((idx < _cacheStart) || (idx >= _cacheStart + _cacheLen))
+      _fill(idx);
+    if ((idx < _cacheStart) || (idx >= _cacheStart + _cacheLen))
+      return ""; // directory shrank since begin()
+    return _cache[idx - _cacheStart];
+  }
+
+  // Adapter for ModalMenu::select(), ctx is the DirListSource
+  static const char *menuItem(int idx, void *ctx) {
+    return ((DirListSource *)ctx)->name(idx);
+  }
+
+private:
+  DirIterator _dir;
+  int _count = 0, _cacheStart = 0, _cacheLen = 0;
+  char _cache[DIR_CACHE_ENTRIES][DIR_NAME_LEN];
+
+  void _fill(int idx) {
+    int start = idx - DIR_CACHE_ENTRIES / 2;
+    if (start < 0) start = 0;
+    if (start < _dir.index())
+      _dir.rewind();
+    _dir.skip(start - _dir.index());
+    _cacheStart = start;
+    _cacheLen = 0;
+    dirEntry_t entry;
+    while ((_cacheLen < DIR_CACHE_ENTRIES) && _dir.next(entry))
+      strcpy(_cache[_cacheLen++], entry.name);
+  }
+};
+
+#endif // DIRITERATOR_H
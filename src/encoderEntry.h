@@ -38,6 +38,7 @@
 #include "touchProvider.h" // Common touch provider for all widgets
 #include "guiObject.h" // Common GUI object for all widgets
 #include "Free_Fonts.h" // Include large fonts
+#include "textFormat.h"
 
 
 // Integer entry field with encoder inc/dec, inherits from GUIObject
@@ -157,7 +158,7 @@ class EncoderEntryField : public GUIObject {
     }
     _tft->setTextColor(my_textcolor, my_bgcolor);
 		_tft->setTextDatum(CL_DATUM); // Center datum for text
-    _tft->drawString(String(_value), _x + _borderwidth + 4, _y + _h / 2 - 1);
+    _tft->drawString(LabelBuf().num(_value), _x + _borderwidth + 4, _y + _h / 2 - 1);
 		_tft->setTextDatum(tempdatum);
 		_tft->setTextPadding(tempPadding);
 	}
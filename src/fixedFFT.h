@@ -0,0 +1,165 @@
+#ifndef FIXEDFFT_H
+#define FIXEDFFT_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Fixed-point radix-2 FFT for blocks of 12 bit ADC samples, N = 2^k up to FFT_MAX_SIZE.
+//
+// Data is int32, twiddle factors and Hann window are Q15. Windowed samples
+// keep FFT_FRAC_BITS fractional bits. Butterflies are computed in place
+// (decimation in time, bit-reversed input order) without scaling: 12 bit
+// samples grow by at most log2(N) bits, so N = 2048 needs 27 bits including
+// fractional bits and no stage can overflow. Twiddle products use a 32x16
+// bit multiply with 64 bit intermediate, which the ESP32 does in two
+// instructions.
+//
+// compute() takes raw samples, removes the block mean (DC would leak through
+// the window and cover the low bins), applies the window, transforms and
+// returns the magnitude of bins 0..N/2-1 in dB relative to a full scale sine
+// (amplitude FFT_FULL_SCALE). Tables and work buffers are allocated by begin()
+// and freed by end(), so no RAM is used while the spectrum page is closed.
+// Alternatively the caller passes one buffer of workSize(n) bytes to begin(),
+// e.g. from the GUI arena, which is then not freed by end().
+//
+// Host compilable, see tools/fft_bench for accuracy check and timing.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define FFT_MAX_SIZE 2048
+#define FFT_FULL_SCALE 2048     // Amplitude Vollaussteuerung 12-Bit-ADC
+#define FFT_FRAC_BITS 4         // Nachkommabits der Samples nach Fensterung
+#define FFT_MIN_DB -120.0f      // für leere Bins
+
+class FixedFFT {
+public:
+  FixedFFT() { }
+  ~FixedFFT() { end(); }
+
+  // Bytes of tables and work buffers for size n
+  static size_t workSize(int n) {
+    return 2 * n * sizeof(int32_t) + 2 * n * sizeof(int16_t); // re, im, window, cos + sin
+  }
+
+  // Set up tables for size n (power of 2, 8..FFT_MAX_SIZE) in work (workSize(n) bytes,
+  // 4 byte aligned) or allocated if NULL. False if invalid or out of memory
+  bool begin(int n, void *work = NULL) {
+    end();
+    if ((n < 8) || (n > FFT_MAX_SIZE) || (n & (n - 1))) return false;
+    _owned = (work == NULL);
+    if (_owned)
+      work = malloc(workSize(n));
+    if (!work) return false;
+    _n = n;
+    _log2n = 0;
+    while ((1 << _log2n) < n) _log2n++;
+    _re = (int32_t *)work;
+    _im = _re + n;
+    _window = (int16_t *)(_im + n);
+    _cos = _window + n;
+    _sin = _cos + n / 2;
+    for (int i = 0; i < n / 2; i++) {
+      double a = 2.0 * M_PI * i / n;
+      _cos[i] = _q15(cos(a));
+      _sin[i] = _q15(-sin(a)); // e^(-j a)
+    }
+    for (int i = 0; i < n; i++)
+      _window[i] = _q15(0.5 - 0.5 * cos(2.0 * M_PI * i / n)); // Hann
+    // bin magnitude of a full scale sine: amplitude * N / 2 * Hann coherent gain 0.5
+    _refDb = 20.0f * log10f((float)FFT_FULL_SCALE * (1 << FFT_FRAC_BITS) * n / 4.0f);
+    return true;
+  }
+
+  void end() {
+    if (_owned) free(_re);
+    _owned = false;
+    _re = _im = NULL;
+    _cos = _sin = _window = NULL;
+    _n = 0;
+  }
+
+  int size() const { return _n; }
+  int bins() const { return _n / 2; }
+
+  // Window and transform n raw samples, magnitudes of bins() bins into db[]
+  void compute(const int16_t *samples, float *db) {
+    _load(samples);
+    transform();
+    magnitudeDb(db);
+  }
+
+  // In-place FFT of re()/im(), input in bit-reversed order as written by _load()
+  void transform() {
+    for (int s = 1; s <= _log2n; s++) {
+      int half = 1 << (s - 1);
+      int step = _n >> s; // twiddle index step
+      for (int k = 0; k < _n; k += 2 * half) {
+        for (int j = 0; j < half; j++) {
+          int32_t wr = _cos[j * step], wi = _sin[j * step];
+          int32_t *ar = &_re[k + j], *ai = &_im[k + j];
+          int32_t *br = &_re[k + j + half], *bi = &_im[k + j + half];
+          // t = b * w, Q15
+          int32_t tr = (int32_t)(((int64_t)*br * wr - (int64_t)*bi * wi) >> 15);
+          int32_t ti = (int32_t)(((int64_t)*br * wi + (int64_t)*bi * wr) >> 15);
+          *br = *ar - tr;
+          *bi = *ai - ti;
+          *ar += tr;
+          *ai += ti;
+        }
+      }
+    }
+  }
+
+  // Magnitudes of bins 0..bins()-1 in dB relative to full scale sine
+  void magnitudeDb(float *db) const {
+    for (int i = 0; i < _n / 2; i++) {
+      float re = (float)_re[i], im = (float)_im[i];
+      float mag2 = re * re + im * im;
+      db[i] = (mag2 > 0) ? 10.0f * log10f(mag2) - _refDb : FFT_MIN_DB;
+    }
+  }
+
+  int32_t *re() { return _re; }
+  int32_t *im() { return _im; }
+
+private:
+  int _n = 0, _log2n = 0;
+  int32_t *_re = NULL, *_im = NULL;
+  int16_t *_cos = NULL, *_sin = NULL, *_window = NULL;
+  float _refDb = 0;
+  bool _owned = false;      // work buffer allocated by begin()
+
+  static int16_t _q15(double v) {
+    long q = lround(v * 32768.0);
+    return (int16_t)((q > 32767) ? 32767 : ((q < -32768) ? -32768 : q));
+  }
+
+  // Remove mean, apply window and store in bit-reversed order
+  void _load(const int16_t *samples) {
+    int32_t sum = 0;
+    for (int i = 0; i < _n; i++)
+      sum += samples[i];
+    int32_t mean = sum / _n;
+    for (int i = 0; i < _n; i++) {
+      int r = 0;
+      for (int b = 0; b < _log2n; b++)
+        r |= ((i >> b) & 1) << (_log2n - 1 - b);
+      _re[r] = ((samples[i] - mean) * (int32_t)_window[i]) >> (15 - FFT_FRAC_BITS);
+      _im[r] = 0;
+    }
+  }
+};
+
+#endif // FIXEDFFT_H
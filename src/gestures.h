@@ -0,0 +1,267 @@
+#ifndef GESTURES_H
+#define GESTURES_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Gesture recognizer on the filtered touch stream of TouchProvider.
+//
+// update() is fed with every touch sample (pressed, screen x/y, time) and
+// recognizes:
+//  - tap: released within GESTURE_SLOP_PX of the start, before long press
+//  - double tap: second tap within GESTURE_DOUBLE_MS and GESTURE_DOUBLE_PX
+//    of the first one
+//  - long press: held still for GESTURE_LONG_MS, reported while still held,
+//    the release after it is no tap
+//  - swipe left/right/up/down: released after at least GESTURE_SWIPE_MIN_PX
+//    along one axis (twice as much as along the other), faster than
+//    GESTURE_SWIPE_MIN_VEL px/s and within GESTURE_SWIPE_MAX_MS
+//  - drag start/move/end: moved beyond GESTURE_SLOP_PX, moves while held,
+//    end on release (followed by a swipe if it was one)
+//
+// Pages and widgets subscribe with a mask of gesture types and a screen area.
+// A gesture goes to the first enabled subscriber (in subscription order)
+// whose mask contains its type and whose area contains the start point of
+// the touch. Subscribers with tap but without double tap in their mask get
+// a double tap as a second tap. Drag capture: the subscriber that took
+// drag start gets all drag moves, the drag end and the swipe of this touch,
+// even outside of its area; nobody else sees them.
+//
+// Widgets with their own modal touch loops (bargraph markers, dialogs) keep
+// the touch stream from update() while they run. A gap of more than
+// GESTURE_GAP_MS between samples cancels the gesture in progress, so
+// nothing is recognized from their touches.
+//
+// Handlers are called from update(), i.e. from the render task.
+// Pure logic without hardware access, time is passed by the caller.
+// See tools/gesture_sim for a simulation.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define GESTURE_MAX_SUBS 8
+#define GESTURE_SLOP_PX 10          // Bewegung bis dahin gilt als Stillhalten
+#define GESTURE_LONG_MS 800         // langes Drücken
+#define GESTURE_DOUBLE_MS 350       // max. Pause zwischen zwei Taps
+#define GESTURE_DOUBLE_PX 24        // max. Abstand zweier Taps
+#define GESTURE_SWIPE_MIN_PX 50     // Mindestweg Wischen
+#define GESTURE_SWIPE_MIN_VEL 250   // px/s, Mindestgeschwindigkeit Wischen
+#define GESTURE_SWIPE_MAX_MS 700    // längere Bewegungen sind nur Ziehen
+#define GESTURE_GAP_MS 150          // Lücke im Touch-Strom bricht Geste ab
+
+enum gestureType_e {
+  gesture_tap = 0,
+  gesture_double_tap,
+  gesture_long_press,
+  gesture_swipe_left,
+  gesture_swipe_right,
+  gesture_swipe_up,
+  gesture_swipe_down,
+  gesture_drag_start,
+  gesture_drag_move,
+  gesture_drag_end,
+  gesture_count
+};
+
+#define GESTURE_MASK(t) (1u << (t))
+#define GESTURE_SWIPES_H (GESTURE_MASK(gesture_swipe_left) | GESTURE_MASK(gesture_swipe_right))
+#define GESTURE_SWIPES_V (GESTURE_MASK(gesture_swipe_up) | GESTURE_MASK(gesture_swipe_down))
+#define GESTURE_DRAG (GESTURE_MASK(gesture_drag_start) | GESTURE_MASK(gesture_drag_move) | GESTURE_MASK(gesture_drag_end))
+
+struct gesture_t {
+  gestureType_e type;
+  int16_t x0, y0;   // start of the touch
+  int16_t x, y;     // current position, release position for tap, swipe and drag end
+  int16_t dx, dy;   // x - x0, y - y0
+  int32_t vx, vy;   // mean velocity since touch down, px/s
+  uint32_t ms;      // time since touch down
+};
+
+typedef void (*gestureHandler_t)(const gesture_t &g);
+
+class GestureRecognizer {
+public:
+  GestureRecognizer() { }
+
+  // Subscribe handler to the gesture types in mask starting in the area,
+  // returns subscription id, -1 if there is no free slot
+  int subscribe(uint16_t mask, int16_t x, int16_t y, int16_t w, int16_t h, gestureHandler_t handler) {
+    if ((_count >= GESTURE_MAX_SUBS) || !handler) return -1;
+    sub_t &s = _subs[_count];
+    s.mask = mask;
+    s.x = x;
+    s.y = y;
+    s.w = w;
+    s.h = h;
+    s.handler = handler;
+    s.enabled = true;
+    return _count++;
+  }
+
+  void setEnabled(int id, bool enabled) {
+    if ((id < 0) || (id >= _count)) return;
+    _subs[id].enabled = enabled;
+    if (!enabled && (_drag == id)) _drag = -1; // no more drag events for it
+  }
+
+  bool isEnabled(int id) const { return (id >= 0) && (id < _count) && _subs[id].enabled; }
+
+  // Next touch sample, x/y only valid while pressed
+  void update(bool pressed, int16_t x, int16_t y, uint32_t now_ms) {
+    if (_down && ((uint32_t)(now_ms - _last) > GESTURE_GAP_MS))
+      reset(); // touch stream interrupted, e.g. by a modal widget loop
+    if (pressed) {
+      if (!_down) {
+        _down = true;
+        _moved = false;
+        _long = false;
+        _drag = -1;
+        _x0 = _x = x;
+        _y0 = _y = y;
+        _start = _last = now_ms;
+        return;
+      }
+      bool changed = (x != _x) || (y != _y);
+      _x = x;
+      _y = y;
+      _last = now_ms;
+      if (!_moved) {
+        if ((abs(x - _x0) > GESTURE_SLOP_PX) || (abs(y - _y0) > GESTURE_SLOP_PX)) {
+          _moved = true;
+          _drag = _dispatch(gesture_drag_start, now_ms);
+        } else if (!_long && ((uint32_t)(now_ms - _start) >= GESTURE_LONG_MS)) {
+          _long = true;
+          _tapValid = false;
+          _dispatch(gesture_long_press, now_ms);
+        }
+      } else if (changed && (_drag >= 0)) {
+        _send(_drag, gesture_drag_move, now_ms);
+      }
+      return;
+    }
+    if (!_down) return;
+    _down = false; // released, at the last pressed position
+    if (_moved) {
+      int owner = _drag;
+      if (owner >= 0) _send(owner, gesture_drag_end, now_ms);
+      int type = _swipe(now_ms);
+      if (type >= 0) {
+        if (owner < 0)
+          _dispatch((gestureType_e)type, now_ms);
+        else if (_subs[owner].mask & GESTURE_MASK(type))
+          _send(owner, (gestureType_e)type, now_ms);
+      }
+      _drag = -1;
+      _tapValid = false;
+    } else if (!_long) {
+      if (_tapValid && ((uint32_t)(_start - _tapTime) <= GESTURE_DOUBLE_MS)
+        && (abs(_x0 - _tapX) <= GESTURE_DOUBLE_PX) && (abs(_y0 - _tapY) <= GESTURE_DOUBLE_PX)) {
+        _tapValid = false;
+        _dispatch(gesture_double_tap, now_ms);
+      } else {
+        _tapValid = true;
+        _tapTime = now_ms;
+        _tapX = _x0;
+        _tapY = _y0;
+        _dispatch(gesture_tap, now_ms);
+      }
+    }
+  }
+
+  // Cancel the gesture in progress, a captured drag gets its drag end
+  void reset() {
+    if (_down) {
+      if (_drag >= 0) _send(_drag, gesture_drag_end, _last);
+      _cancelled++;
+    }
+    _down = false;
+    _drag = -1;
+    _tapValid = false;
+  }
+
+  bool active() const { return _down; }
+  uint32_t cancelled() const { return _cancelled; }
+
+private:
+  struct sub_t {
+    uint16_t mask = 0;
+    int16_t x = 0, y = 0, w = 0, h = 0;
+    gestureHandler_t handler = nullptr;
+    bool enabled = false;
+  };
+
+  sub_t _subs[GESTURE_MAX_SUBS];
+  int _count = 0;
+  bool _down = false, _moved = false, _long = false;
+  int _drag = -1;               // subscriber capturing the drag
+  int16_t _x0 = 0, _y0 = 0, _x = 0, _y = 0;
+  uint32_t _start = 0, _last = 0;
+  bool _tapValid = false;       // last tap can start a double tap
+  uint32_t _tapTime = 0;
+  int16_t _tapX = 0, _tapY = 0;
+  uint32_t _cancelled = 0;
+
+  // Swipe type of the finished touch, -1 if none
+  int _swipe(uint32_t now_ms) const {
+    uint32_t ms = now_ms - _start;
+    if (_long || (ms > GESTURE_SWIPE_MAX_MS)) return -1;
+    if (ms == 0) ms = 1;
+    int32_t dx = _x - _x0, dy = _y - _y0;
+    int32_t adx = abs(dx), ady = abs(dy);
+    if ((adx >= GESTURE_SWIPE_MIN_PX) && (adx >= 2 * ady) && (adx * 1000 / (int32_t)ms >= GESTURE_SWIPE_MIN_VEL))
+      return (dx < 0) ? gesture_swipe_left : gesture_swipe_right;
+    if ((ady >= GESTURE_SWIPE_MIN_PX) && (ady >= 2 * adx) && (ady * 1000 / (int32_t)ms >= GESTURE_SWIPE_MIN_VEL))
+      return (dy < 0) ? gesture_swipe_up : gesture_swipe_down;
+    return -1;
+  }
+
+  gesture_t _event(gestureType_e type, uint32_t now_ms) const {
+    gesture_t g;
+    uint32_t ms = now_ms - _start;
+    g.type = type;
+    g.x0 = _x0;
+    g.y0 = _y0;
+    g.x = _x;
+    g.y = _y;
+    g.dx = _x - _x0;
+    g.dy = _y - _y0;
+    g.vx = ms ? (int32_t)g.dx * 1000 / (int32_t)ms : 0;
+    g.vy = ms ? (int32_t)g.dy * 1000 / (int32_t)ms : 0;
+    g.ms = ms;
+    return g;
+  }
+
+  void _send(int id, gestureType_e type, uint32_t now_ms) {
+    gesture_t g = _event(type, now_ms);
+    _subs[id].handler(g);
+  }
+
+  // First subscriber for the gesture at the start point, returns its id or -1
+  int _dispatch(gestureType_e type, uint32_t now_ms) {
+    for (int i = 0; i < _count; i++) {
+      const sub_t &s = _subs[i];
+      if (!s.enabled) continue;
+      gestureType_e t = type;
+      if (!(s.mask & GESTURE_MASK(t))) {
+        if ((t != gesture_double_tap) || !(s.mask & GESTURE_MASK(gesture_tap))) continue;
+        t = gesture_tap;
+      }
+      if ((_x0 < s.x) || (_x0 >= s.x + s.w) || (_y0 < s.y) || (_y0 >= s.y + s.h)) continue;
+      _send(i, t, now_ms);
+      return i;
+    }
+    return -1;
+  }
+};
+
+#endif // GESTURES_H
@@ -32,8 +32,18 @@
 
 #define ADC_DIV_VOLT    3333.3  // für Vollausschlag 1 = ADC-Wert 4000 von 0..4095
 
+// Messbereiche in meterScaleDefaults.h, auf die sich die ADC-Skalierungen beziehen
+#define AMP_RANGE_FIRST 0   // 30mA
+#define AMP_RANGE_LO    2   // 300mA, Lo Range, ADC_DIV_LORANGE
+#define AMP_RANGE_HI    3   // 1A, Hi Range, ADC_DIV_HIRANGE
+#define AMP_RANGE_LAST  4   // 3A
+#define VOLT_RANGE_FIRST 5  // 1V
+#define VOLT_RANGE_REF  7   // 10V, ADC_DIV_VOLT
+#define VOLT_RANGE_LAST 9   // 100V
+
 #define SCOPETIMER_MS 70 // abhängig von Oszi-Breite, Punkte in X-Richtung (Time)
-#define UPDATETIMER_MS SCOPETIMER_MS/2
+#define UPDATETIMER_MS 35 // Messung, Touch und Anzeige, siehe jobScheduler.h
+#define BLINKTIMER_MS 100 // blinkende LEDs
 
 // https://rgbcolorpicker.com/565
 
@@ -54,10 +64,23 @@
 
 #include "hwdefs.h" // Hardware pins and definitions for ESP32 board
 #include "meterScaleDefaults.h"
+#include "autoRange.h"
+#include "runningStats.h"
+#include "scopeTrigger.h"
+#include "settingsStore.h"
+#include "guiArena.h"
+#include "jobScheduler.h"
+#include "uiQueue.h"
 
 #include "MCP3421.h"
+#include "spiBusArbiter.h"
 #include "TouchProvider.h"
+#include "dirIterator.h"
+#include "sdLogger.h"
 #include <TFT_eSPI.h>
+#include "profiler.h"
+#include "tftDma.h"
+#include "powerManager.h"
 //#include <WiFi.h>
 #include <time.h>
 
@@ -68,7 +91,14 @@
 #include <FS.h>
 */
 
-TFT_eSPI tft = TFT_eSPI();       // Invoke custom library as global
+#ifdef PROFILER
+  ProfTFT tft = ProfTFT();       // TFT_eSPI counting pixels sent to display, see profiler.h
+#else
+  TFT_eSPI tft = TFT_eSPI();       // Invoke custom library as global
+#endif
+
+// VSPI bus shared by SD card and XPT2046 touch controller, see spiBusArbiter.h
+SpiBusArbiter spiArbiter;
 
 // TouchProvider class for handling touch events as a common provider for all widgets
 // This allows the widgets to access touch events through a shared TouchProvider instance
@@ -81,9 +111,13 @@ SdFat SD; // Create an instance of the SD library
 // #define SD_CS_PIN 5 // Chip Select Pin für SD-Karte, in platformio.ini definiert
 // SPI-Geschwindigkeit
 #define SPI_SPEED SD_SCK_MHZ(4)
-SPIClass SPI_SD = SPIClass(VSPI); // SPI instance for SD Card
 bool SD_OK = false; // true, wenn SD-Karte initialisiert
 
+// Messwert-Logger auf SD-Karte, Rohwerte des internen ADC mit SDLOG_SAMPLE_MS Abtastrate
+#define SDLOG_SAMPLE_MS 1     // 1 kHz
+#define SDLOG_CHANNELS 2      // Amps, Volts
+SdLogger sdLogger(&SD, &spiArbiter);
+
 #define MY_TIMEZONE "CET-1CEST,M3.5.0/02,M10.5.0/03" // https://github.com/nayarsystems/posix_tz_db/blob/master/zones.csv
 #define MY_NTP_SERVER "de.pool.ntp.org"
 
@@ -104,6 +138,7 @@ enum instrStates_e {
   state_meterInit = 0, state_meter,
   state_bgInit, state_bg,
   state_scopeInit, state_scope,
+  state_fftInit, state_fft,
   state_setupInit, state_setup,
   state_invalid
 };
@@ -120,7 +155,6 @@ bool rangeChanged = true;   // true, wenn Messbereich geändert wurde
 bool measurementChanged = true;   // true, wenn Messart (Volt/Amps) geändert wurde
 
 typedef char menuArr_t[16][32];
-menuArr_t dirArr;
 
 // uint16_t screenBuffer[DISPLAY_W * DISPLAY_H]; // Buffer for screen drawing
 
@@ -128,21 +162,25 @@ menuArr_t dirArr;
 // ############################## CREDENTIALS ###################################
 // ##############################################################################
 
-// -----------------------------EEPROM-DEFAULTS----------------------------------
+// -----------------------------SETTINGS-DEFAULTS--------------------------------
 
-// bei Änderung der Settings-Struktur auch diesen Wert ändern:
-#define SETTINGS_VALIDFLAG 0x53
+// Kennung des Formats von settings_t, nicht für den Import des alten EEPROM-Abbilds verwenden
+#define SETTINGS_VALIDFLAG 0x54
+// Kennung des EEPROM-Abbilds der Firmware vor dem NVS-Store (Byte 511), Layout settings_legacy_t
+#define SETTINGS_LEGACY_FLAG 0x53
+// bei Änderungen, die eine Umrechnung erfordern, erhöhen und Umrechnung mit settingsStore.setMigration() anmelden
+#define SETTINGS_STORE_VERSION 1
 
 // Voreinstellungen und Skalierungen des Messgeräts, in Credentials gespeichert
-struct {
+struct settings_t {
   char ssid[32] = "FCKAFD";      // Default Router SSID
   char password[32] = "z28hev111";  // Default Router PW
   //char ssid[32] = "WILHELM.TEL-Z7XLWCE1";      // Default Router SSID
   //char password[32] = "15456528653098957079";  // Default Router PW
   uint16_t wifiWPSpin = 0;
 
-  uint16_t touchCalData[6];
-  uint16_t touchCalDataOK = 0; // 0x55A5, auf 0 setzen, um Neukalibrierung zu erzwingen
+  uint16_t touchCalData[6];    // 2-Ecken-Kalibrierung älterer Firmware (CYD) oder TFT_eSPI
+  uint16_t touchCalDataOK = 0; // 0x55A1 oder TOUCH_CAL_AFFINE, auf 0 setzen, um Neukalibrierung zu erzwingen
 
   uint16_t spkrTick = 1;
   uint16_t spkrBeep = 1;
@@ -150,12 +188,13 @@ struct {
   bool ampHiRangeOn = true;   // true = Hi Range, false = Lo Range
   int ampRangeIdx = 2;        // 2 = 300mA, 3 = 1A, 4 = 3A
   int voltRangeIdx = 7;       // 7 = 10V, 8 = 30V, 9 = 100V
+  bool autoRangeOn = false;   // Auto-Ranging über alle Bereiche, siehe autoRange.h
 
   int adcRawOffsetVolts = ADC2_OFFS; // ADC-Nullpunkt DC-Messung Strom (0) und Spannung (1), Integer-Rohwert
   int adcRawOffsetAmps  = ADC1_OFFS; // ADC-Nullpunkt DC-Messung Strom (0) und Spannung (1), Integer-Rohwert
 
   // 10 Messbereiche, Skalierung der ADC-Werte, Reihenfolge wie in meterScaleDefaults.h
-  float adcScalings[10]  = {1.002, 1.003, 1, 1, 1, 1, 1.007, 1, 1, 1}; // Amps/Volts-Skalierung
+  float adcScalings[METER_RANGE_COUNT]  = {1.002, 1.003, 1, 1, 1, 1, 1.007, 1, 1, 1}; // Amps/Volts-Skalierung
 
   bool wifiEnabled = false;
   bool wifiAPenabled = false;
@@ -166,65 +205,166 @@ struct {
   float config_float[6] = {0.0, 0.0, 0.0, 0.0, 0.5, 0.775};
 
   bool config_bool[6] = {false, false, false, false, false, false};
+
+  // neue Felder nur hier anfügen
+  int32_t touchAffine[6] = {0, 0, 0, 0, 0, 0}; // 3-Punkt-Kalibrierung CYD, siehe touchFilter.h
 } settings;
 
+// Persistente Felder, IDs nie ändern oder wiederverwenden, neue Felder hinten anfügen
+const settingsField_t settingsFields[] = {
+  SETTINGS_FIELD(settings_t, 1, ssid, SF_PREFIX),
+  SETTINGS_FIELD(settings_t, 2, password, SF_PREFIX),
+  SETTINGS_FIELD(settings_t, 3, wifiWPSpin, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 4, touchCalData, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 5, touchCalDataOK, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 6, spkrTick, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 7, spkrBeep, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 8, ampHiRangeOn, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 9, ampRangeIdx, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 10, voltRangeIdx, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 11, autoRangeOn, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 12, adcRawOffsetVolts, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 13, adcRawOffsetAmps, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 14, adcScalings, SF_PREFIX),
+  SETTINGS_FIELD(settings_t, 15, wifiEnabled, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 16, wifiAPenabled, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 17, wifiWPSused, SF_DEFAULT),
+  SETTINGS_FIELD(settings_t, 18, config_int, SF_PREFIX),
+  SETTINGS_FIELD(settings_t, 19, config_float, SF_PREFIX),
+  SETTINGS_FIELD(settings_t, 20, config_bool, SF_PREFIX),
+  SETTINGS_FIELD(settings_t, 21, touchAffine, SF_DEFAULT),
+};
+
+// EEPROM-Abbild der Firmware vor dem NVS-Store (Kennung 0x53), nur für den einmaligen Import.
+// Eingefroren: nie ändern, Felder werden in importLegacySettings() einzeln übernommen
+struct settings_legacy_t {
+  char ssid[32];
+  char password[32];
+  uint16_t wifiWPSpin;
+  uint16_t touchCalData[6];
+  uint16_t touchCalDataOK;
+  uint16_t spkrTick;
+  uint16_t spkrBeep;
+  bool ampHiRangeOn;
+  int ampRangeIdx;
+  int voltRangeIdx;
+  int adcRawOffsetVolts;
+  int adcRawOffsetAmps;
+  float adcScalings[10];
+  bool wifiEnabled;
+  bool wifiAPenabled;
+  bool wifiWPSused;
+  int config_int[6];
+  float config_float[6];
+  bool config_bool[6];
+};
+static_assert(sizeof(settings_legacy_t) < 511, "legacy EEPROM image overlaps valid flag");
+
+NvsSettingsBackend settingsNvs; // NVS-Namespace "tftpanel"
+SettingsStore settingsStore(&settings, sizeof(settings), settingsFields,
+  sizeof(settingsFields) / sizeof(settingsFields[0]), SETTINGS_STORE_VERSION);
+
 float markerVolts = 0.0; // Variable to store the set value for volts
+AutoRanger ampRanger = AutoRanger(AMP_RANGE_FIRST, AMP_RANGE_LAST);    // Auto-Ranging Strom
+AutoRanger voltRanger = AutoRanger(VOLT_RANGE_FIRST, VOLT_RANGE_LAST); // Auto-Ranging Spannung
+ChannelStats statsAmps, statsVolts; // Statistik in A bzw. V, siehe runningStats.h
+portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED; // add/reset in loop(), Kopie für /stats im Webserver-Task
+bool statsReadoutOn = true; // Statistikzeilen der Bargraph-Seite, aus während goldenRun()
 float markerAmps = 0.0; // Variable to store the set value for amps
+ScopeTrigger scopeTrigger; // getriggerte Aufnahme der Scope-Seite, siehe scopeTrigger.h
+
+// Faktor interner ADC-Rohwert mit Offset auf Fullscale des aktuellen Bereichs,
+// gleiche Skalierung wie in loop(). Für Aufnahmen, die nicht über loop() laufen.
+float adcLevelGain(active_measurement_e measurement) {
+  if (measurement == amps) {
+    bool amps_lo = (settings.ampRangeIdx <= AMP_RANGE_LO);
+    return settings.adcScalings[settings.ampRangeIdx] / (amps_lo ? ADC_DIV_LORANGE : ADC_DIV_HIRANGE)
+      * meterRangeFullScale(amps_lo ? AMP_RANGE_LO : AMP_RANGE_HI) / meterRangeFullScale(settings.ampRangeIdx);
+  }
+  return settings.adcScalings[settings.voltRangeIdx] / ADC_DIV_VOLT
+    * meterRangeFullScale(VOLT_RANGE_REF) / meterRangeFullScale(settings.voltRangeIdx);
+}
 
-/* Store WLAN credentials to "EEPROM" */
-void saveCredentials() {
-  // Speichert die WLAN-Zugangsdate in "EEPROM"
-  EEPROM.begin(512); // 512 Bytes für EEPROM reservieren
-  EEPROM.put(0, settings);
-  EEPROM.write(511, SETTINGS_VALIDFLAG);
-  EEPROM.commit();
-  EEPROM.end();
-  DEBUG_PRINTLN("EEPROM saved");
+// Interner ADC-Rohwert in Fullscale 0..1.0 des aktuellen Bereichs
+float adcRawToLevel(active_measurement_e measurement, int raw) {
+  int offset = (measurement == amps) ? settings.adcRawOffsetAmps : settings.adcRawOffsetVolts;
+  return (float)(raw + offset) * adcLevelGain(measurement);
 }
 
-/* Load WLAN credentials from "EEPROM" or use predefined strings */
-void loadCredentials() {
-  EEPROM.begin(512); // 512 Bytes für EEPROM reservieren
-  if (EEPROM.read(511) == SETTINGS_VALIDFLAG) {
-    EEPROM.get(0, settings);
-    EEPROM.end();
-    DEBUG_PRINTLN("EEPROM read");
-  } else {
-    DEBUG_PRINTLN("EEPROM invalid, using defaults");
-    EEPROM.end();
-    saveCredentials(); // vorbelegte Werte speichern
+// Fullscale-Pegel in internen ADC-Rohwert, z.B. für Triggerschwelle
+int adcLevelToRaw(active_measurement_e measurement, float level) {
+  int offset = (measurement == amps) ? settings.adcRawOffsetAmps : settings.adcRawOffsetVolts;
+  return (int)(level / adcLevelGain(measurement)) - offset;
+}
+
+/* Store settings to NVS */
+void saveCredentials(bool now = false) {
+  // Nur geänderte Felder werden geschrieben. Ohne now sammelt settingsStore.update()
+  // in loop() Änderungen für SETTINGS_COMMIT_DELAY_MS, z.B. mehrere Web-Formulare
+  settingsStore.markDirty(millis());
+  if (now) {
+    int written = settingsStore.commit();
+    DEBUG_PRINT("Settings saved, fields written: ");
+    DEBUG_PRINTLN(written);
   }
-  markerAmps = settings.config_float[4];
-  markerVolts = settings.config_float[5];
 }
 
-// ##############################################################################
+// Copy the fields of the old EEPROM image into settings, new fields keep their defaults
+void importLegacySettings(const settings_legacy_t &old) {
+  memcpy(settings.ssid, old.ssid, sizeof(settings.ssid));
+  settings.ssid[sizeof(settings.ssid) - 1] = 0;
+  memcpy(settings.password, old.password, sizeof(settings.password));
+  settings.password[sizeof(settings.password) - 1] = 0;
+  settings.wifiWPSpin = old.wifiWPSpin;
+  for (int i = 0; i < 6; i++)
+    settings.touchCalData[i] = old.touchCalData[i];
+  settings.touchCalDataOK = old.touchCalDataOK; // 0x55A1: 2-Ecken-Kalibrierung
+  settings.spkrTick = old.spkrTick;
+  settings.spkrBeep = old.spkrBeep;
+  settings.ampHiRangeOn = old.ampHiRangeOn;
+  if ((old.ampRangeIdx >= AMP_RANGE_FIRST) && (old.ampRangeIdx <= AMP_RANGE_LAST))
+    settings.ampRangeIdx = old.ampRangeIdx;
+  if ((old.voltRangeIdx >= VOLT_RANGE_FIRST) && (old.voltRangeIdx <= VOLT_RANGE_LAST))
+    settings.voltRangeIdx = old.voltRangeIdx;
+  settings.adcRawOffsetVolts = old.adcRawOffsetVolts;
+  settings.adcRawOffsetAmps = old.adcRawOffsetAmps;
+  for (int i = 0; (i < 10) && (i < METER_RANGE_COUNT); i++)
+    settings.adcScalings[i] = old.adcScalings[i];
+  settings.wifiEnabled = old.wifiEnabled;
+  settings.wifiAPenabled = old.wifiAPenabled;
+  settings.wifiWPSused = old.wifiWPSused;
+  for (int i = 0; i < 6; i++) {
+    settings.config_int[i] = old.config_int[i];
+    settings.config_float[i] = old.config_float[i];
+    settings.config_bool[i] = old.config_bool[i];
+  }
+}
 
-// Get the directory of files in SPIFFS
-// This function retrieves the names of files in the SPIFFS filesystem
-// and stores them in the dest_arr array. It returns the number of files found.
-int getDirectory(menuArr_t array, char* filter) {
-  DEBUG_PRINTLN("######### SPIFFS DIR #########");
-  File root = SPIFFS.open("/");
-  File file = root.openNextFile();
-  int idx = 0;
-  while (file) {
-    DEBUG_PRINT(idx);
-    DEBUG_PRINT(" = ");
-    DEBUG_PRINTLN(file.name());
-    if ((strlen(filter) == 0) || (strstr(file.name(), filter) != NULL)) {
-      strcpy(array[idx], file.name());
-      idx++;
+/* Load settings from NVS, from old "EEPROM" image or use predefined values */
+void loadCredentials() {
+  settingsNvs.begin("tftpanel");
+  int loaded = settingsStore.load(&settingsNvs);
+  if (loaded) {
+    DEBUG_PRINT("Settings read, fields: ");
+    DEBUG_PRINTLN(loaded);
+  } else {
+    // Store leer: einmalig altes EEPROM-Abbild übernehmen, sonst Voreinstellungen
+    EEPROM.begin(512);
+    if (EEPROM.read(511) == SETTINGS_LEGACY_FLAG) {
+      settings_legacy_t old;
+      EEPROM.get(0, old);
+      importLegacySettings(old);
+      DEBUG_PRINTLN("EEPROM settings imported");
+    } else {
+      DEBUG_PRINTLN("No settings stored, using defaults");
     }
-    if (idx > 15)
-      break;
-    file = root.openNextFile();
+    EEPROM.end();
+    saveCredentials(true); // alle Felder speichern
   }
-  DEBUG_PRINTLN("##############################");
-  return idx;
+  markerAmps = settings.config_float[4];
+  markerVolts = settings.config_float[5];
 }
 
-
 // ##############################################################################
 // ########################### G U I  HELPERS ###################################
 // ##############################################################################
@@ -338,36 +478,41 @@ int32_t adcReadRaw() {
 // ############################ TICKER OBJECTS ##################################
 // ##############################################################################
 
-// Global variables and objects
-Ticker UpdateTicker, ScopeTicker, EncoderTicker, ToggleTicker, SecondTicker;
-int update_tick = 0;
-int scope_tick = 0;
-int encoder_tick = 0;
-int toggle_tick = 0;
-int second_tick = 0;
-bool toggle_bool = false; // Toggle state for blinking text
+// Jobs of loop(), run by the scheduler in order of priority, see jobScheduler.h
+enum schedJob_e {
+  job_acquire = 0,  // ADC lesen, skalieren, Statistik, Auto-Ranging
+  job_touch,        // Touch und Encoder auswerten
+  job_scope,        // Scope-Messwert eintragen, nur auf Scope-Seite
+  job_render,       // Seite, numerische Anzeige und LEDs aktualisieren
+  job_blink,        // blinkende LEDs
+  job_clock,        // Uhr und Statistikzeile, jede Sekunde
+  job_power,        // Hintergrundbeleuchtung, Idle-Zustand
+  job_pen,          // Touch-Abtastung mit 200 Hz für die Filter
+  job_count
+};
 
-// ##############################################################################
+JobScheduler scheduler;
 
-void second_tick_callback() {
-  // Callback von SecondTicker
-  second_tick += 1;
-}
+// Timer task sampling, independent of loop() load
+Ticker EncoderTicker, LogTicker, TrigTicker;
 
-void toggle_tick_callback() {
-  // Callback von ToggleTicker
-  toggle_bool = !toggle_bool;
-  toggle_tick += 1;
-}
+// ##############################################################################
 
-void update_tick_callback() {
-  // Callback von UpdateTicker
-  update_tick += 1;
+void log_tick_callback() {
+  // Callback von LogTicker, schreibt ADC-Rohwerte in den SD-Logger
+  // log() blockiert nicht, der Block wird im Hintergrund geschrieben
+  int16_t values[SDLOG_CHANNELS];
+  values[0] = analogRead(DC_PIN_AMPS);
+  values[1] = analogRead(DC_PIN_VOLTS);
+  sdLogger.log(esp_timer_get_time(), values); // 64 bit us, no wrap on multi-day logs
 }
 
-void scope_tick_callback() {
-  // Callback von ScopeTicker
-  scope_tick += 1;
+void trig_tick_callback() {
+  // Callback von TrigTicker, ADC-Rohwerte für getriggerte Scope-Aufnahme
+  int16_t values[TRIG_CHANNELS];
+  values[0] = analogRead(DC_PIN_AMPS);
+  values[1] = analogRead(DC_PIN_VOLTS);
+  scopeTrigger.push(values, millis());
 }
 
 void encoder_tick_callback() {
@@ -381,11 +526,13 @@ void encoder_tick_callback() {
 
 // TFT Touchscreen Calibration
 
-// This function calibrates the touchscreen and stores the calibration data in EEPROM
+// This function calibrates the touchscreen and stores the calibration data in NVS
 void touch_calibrate() {
 #ifdef BOARD_CYD
-  if (settings.touchCalDataOK == 0x55A1) {
-    // calibration data valid
+  if ((settings.touchCalDataOK == TOUCH_CAL_AFFINE) && touchProvider.setTouchAffine(settings.touchAffine)) {
+    // 3-point calibration data valid
+  } else if (settings.touchCalDataOK == 0x55A1) {
+    // 2-corner calibration of older firmware, still usable
     touchProvider.setTouchCYD(settings.touchCalData);
   } else {
     // data not valid so recalibrate
@@ -393,14 +540,17 @@ void touch_calibrate() {
     tft.setTextSize(1);
     tft.setTextColor(TFT_WHITE, TFT_BLACK);
     tft.setTextDatum(MC_DATUM); // middle center text datum
-    tft.drawString(F("Touch corners as indicated"), DISPLAY_W / 2, DISPLAY_H / 2 - 20, 2 );
-    touchProvider.calibrateTouchCYD(settings.touchCalData, TFT_MAGENTA, TFT_BLACK, 15);
+    tft.drawString(F("Touch targets as indicated"), DISPLAY_W / 2, DISPLAY_H / 2 - 20, 2 );
+    while (!touchProvider.calibrateTouchCYD(settings.touchAffine, TFT_MAGENTA, TFT_BLACK, 15)) {
+      tft.setTextColor(TFT_RED, TFT_BLACK);
+      tft.drawString(F("Please repeat"), DISPLAY_W / 2, DISPLAY_H / 2, 2);
+    }
     tft.setTextColor(TFT_GREEN, TFT_BLACK);
     tft.drawString(F("Calibration complete!"), DISPLAY_W / 2, DISPLAY_H / 2, 2);
     delay(500);
-    settings.touchCalDataOK = 0x55A1;
-    touchProvider.setTouchCYD(settings.touchCalData);
-    saveCredentials(); // store data
+    settings.touchCalDataOK = TOUCH_CAL_AFFINE;
+    touchProvider.setTouchAffine(settings.touchAffine);
+    saveCredentials(true); // store data
     tft.setTextDatum(TL_DATUM); // middle center text datum
     tft.setTextFont(1);
   }
@@ -421,7 +571,7 @@ void touch_calibrate() {
     delay(500);
     settings.touchCalDataOK = 0x55A1;
     tft.setTouch(settings.touchCalData);
-    saveCredentials(); // store data
+    saveCredentials(true); // store data
     tft.setTextDatum(TL_DATUM); // middle center text datum
     tft.setTextFont(1);
   }
@@ -433,36 +583,61 @@ void touch_calibrate() {
 //##############################################################################
 
 // This implementation uses the VSPI interface for both the SD card and the Touchscreen
-// The Touchscreen SPI is deinitialized when the SD card is used and reinitialized afterwards
+// VSPI is started once by spiArbiter, both devices stay configured.
+// start_SD() claims the bus for the SD card, end_SD() hands it back to the touch controller.
+// Must always be called in pairs, also if start_SD() failed
 
-// Initialize SPI for SD card and end Touchscreen SPI to free the bus
+// Claim SPI bus for SD card, mount card on first call
 bool start_SD() {
-  DEBUG_PRINTLN("End XPT SPI");
-  #ifdef BOARD_CYD
-    touchProvider.end(); // Deinitialize touch provider SPI to free it for SD card
-  #endif
-  // SPI bus must be deinitialized before initializing it, otherwise
-  // it might throw a "addApbChangeCallback(): duplicate func" exception
-  DEBUG_PRINTLN("Start SD SPI");
-  SPI_SD.begin(SD_SCK, SD_MISO, SD_MOSI, SD_CS_PIN); // SCK, MISO, MOSI, SS
+  spiArbiter.acquire(spi_dev_sd);
   if (!SD_OK) {
     DEBUG_PRINTLN("Start SD FAT");
-    SD_OK = SD.begin(SdSpiConfig(SD_CS_PIN, SHARED_SPI, SD_SCK_MHZ(10), &SPI_SD));
+    SD_OK = SD.begin(SdSpiConfig(SD_CS_PIN, SHARED_SPI, SD_SCK_MHZ(10), spiArbiter.spi()));
   }
   return SD_OK;
 }
 
-// End SPI for SD card and reinitialize Touchscreen SPI
+// Release SPI bus after SD card use
 void end_SD() {
-  DEBUG_PRINTLN("End SD, Start XPT SPI");
-  SPI_SD.end(); // Deinitialize SPI for SD card to free it for Touchscreen
-  #ifdef BOARD_CYD
-    touchProvider.reInit(); // Re-Initialize touch provider SPI after SD card use
-  #endif
+  spiArbiter.release();
+}
+
+// Start SD card logging, file name from current epoch time
+bool sdLogStart() {
+  if (sdLogger.isRunning()) return true;
+  if (!start_SD()) {
+    end_SD();
+    return false;
+  }
+  char filename[32];
+  time(&now);
+  snprintf(filename, sizeof(filename), "/log_%lu.kbl", (unsigned long)now);
+  if (!sdLogger.begin(filename, SDLOG_CHANNELS)) {
+    DEBUG_PRINTLN("SD Log start failed");
+    end_SD();
+    return false;
+  }
+  end_SD(); // writer task claims the bus per block slice
+  DEBUG_PRINT("SD Log started: ");
+  DEBUG_PRINTLN(filename);
+  LogTicker.attach_ms(SDLOG_SAMPLE_MS, log_tick_callback);
+  return true;
+}
+
+// Stop SD card logging, flush buffers and close file
+void sdLogStop() {
+  if (!sdLogger.isRunning()) return;
+  LogTicker.detach();
+  sdLogger.end();
+  if (sdLogger.writeError())
+    DEBUG_PRINTLN("SD Log write failed, file cut off");
+  DEBUG_PRINTLN("SD Log stopped");
 }
 
 void hardwareInit() {
   Serial.begin(115200);    // For debug
+  guiArena.begin();        // GUI buffer pool, before heap gets fragmented
+  uiQueue.begin();         // loop task is render task, other tasks post commands
 
   #ifdef DEBUG_STARTUP
     spkrOKbeep();
@@ -504,6 +679,12 @@ void hardwareInit() {
   #else
     tft.setRotation(1);
   #endif
+  tftDma.begin(&tft); // DMA for page clears and large fills, see tftDma.h
+  #ifdef BOARD_CYD
+    powerManager.begin(TFT_LED_PIN, XPT2046_IRQ); // backlight PWM by LDR, touch wakes loop
+  #else
+    powerManager.begin(TFT_LED_PIN);
+  #endif
   tft.fillScreen(TFT_BLUE);
   tft.setCursor(0, 4);
   tft.setTextColor(TFT_WHITE, TFT_BLUE);
@@ -511,6 +692,11 @@ void hardwareInit() {
   tft.println(F("TFT Panel initialised"));
 
   tft.println(F("Start SD SPI..."));
+  spiArbiter.begin();
+  #ifdef BOARD_CYD
+    touchProvider.begin(&spiArbiter);
+    touchProvider.setReadHook([](bool reading) { powerManager.touchReading(reading); }); // reads toggle PENIRQ
+  #endif
 
   if (start_SD()) {
     DEBUG_PRINTLN("SD Init done");
@@ -521,14 +707,21 @@ void hardwareInit() {
     DEBUG_PRINTLN("SD Init failed!");
     tft.println(F("ERROR: SD Init failed or card not present!"));
   }
-  end_SD(); // Reinitialize Touch SPI
-
-  tft.println(F("Install tickers..."));
-  SecondTicker.attach_ms(1000, second_tick_callback);
-  UpdateTicker.attach_ms(UPDATETIMER_MS, update_tick_callback);
-  ScopeTicker.attach_ms(SCOPETIMER_MS, scope_tick_callback);
-  ToggleTicker.attach_ms(333, toggle_tick_callback); // Toggle every 333 ms, e.g. for blinking text
-  toggle_bool = false;
+  end_SD(); // Release SPI bus for Touch
+
+  tft.println(F("Install jobs..."));
+  // Priorität 0 und 1 behalten ihre Periode, ab SCHED_PRIO_SHED wird bei Überlast gestreckt
+  scheduler.add(job_acquire, "acquire", UPDATETIMER_MS, 0);
+  scheduler.add(job_touch, "touch", UPDATETIMER_MS, 1);
+  scheduler.add(job_scope, "scope", SCOPETIMER_MS, 1);
+  scheduler.add(job_clock, "clock", 1000, 1);
+  scheduler.add(job_render, "render", UPDATETIMER_MS, 2);
+  scheduler.add(job_blink, "blink", BLINKTIMER_MS, 3);
+  scheduler.add(job_power, "power", POWER_UPDATE_MS, 3);
+  // Pen-Job: ein verspätetes Sample ist nur eine Lücke im Filter, erst nach TOUCH_PEN_DEADLINE_MS
+  // zählt es als Überlauf, sonst würde jedes Rendern > 5 ms die Anzeige strecken
+  scheduler.add(job_pen, "pen", TOUCH_SAMPLE_MS, 1, TOUCH_PEN_DEADLINE_MS);
+  scheduler.setEnabled(job_scope, false, millis()); // enabled with scope page
   #ifdef ENCODER_ENABLED
     pinMode(ENCA_PIN, INPUT_PULLUP);
     pinMode(ENCB_PIN, INPUT_PULLUP);
@@ -556,7 +749,7 @@ void hardwareInit() {
   if (start_SD()) {
     SD.ls(LS_DATE | LS_SIZE | LS_R);  // LS_R recursive
   }
-  end_SD(); // Reinitialize Touch SPI
+  end_SD(); // Release SPI bus for Touch
 
 
 }
@@ -0,0 +1,225 @@
+#ifndef GUIARENA_H
+#define GUIARENA_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Arena for all GUI buffers that are not part of the widget objects.
+//
+// Two pools, both reserved once at boot, so GUI buffers never fragment the
+// heap and the headroom is known:
+//  - gui_mem_fast: static array in internal RAM, for buffers used in tight
+//    loops (FFT work buffers, dB values)
+//  - gui_mem_large: save-unders, scope traces, sample blocks. Placed in PSRAM
+//    if the board has one (BOARD_HAS_PSRAM and psramFound()), else taken from
+//    the internal heap in begin(). Requests fall back to the fast pool if
+//    the large pool is missing or full.
+//
+// Each pool is filled from both ends:
+//  - allocPermanent() from the bottom, for buffers living until reset, e.g.
+//    scope traces. Listed with a tag in report().
+//  - alloc() from the top, released in LIFO order with mark()/release() or a
+//    GuiArenaScope, e.g. a dialog save-under or the buffers of a page.
+// No free() of single buffers and no locking: only the loop task allocates.
+// High water marks show how much of each pool was ever used.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef ARDUINO
+  #include <Arduino.h>
+  #include <esp_heap_caps.h>
+#endif
+
+#ifndef GUI_ARENA_FAST_SIZE
+  #define GUI_ARENA_FAST_SIZE (12 * 1024)   // FFT 512 (6K) + dB-Werte (1K) + Reserve
+#endif
+#ifndef GUI_ARENA_LARGE_SIZE
+  #define GUI_ARENA_LARGE_SIZE (64 * 1024)  // Dialog-Hintergrund 236x124 (58K) + Scope + Spektrum
+#endif
+#ifndef GUI_ARENA_PSRAM_SIZE
+  #define GUI_ARENA_PSRAM_SIZE (512 * 1024) // mit PSRAM, Platz für weitere Seiten
+#endif
+#define GUI_ARENA_ALIGN 8
+#define GUI_ARENA_TAGS 8        // Anzahl gelisteter permanenter Puffer
+#define MEM_REPORT_SIZE 2048    // JSON von memBudgetReport()
+
+enum guiMem_e {
+  gui_mem_fast = 0,
+  gui_mem_large,
+  gui_mem_count
+};
+
+struct guiArenaMark_t {
+  size_t top[gui_mem_count];
+};
+
+class GuiArena {
+public:
+  GuiArena() {
+    _pool[gui_mem_fast].base = _fastPool;
+    _pool[gui_mem_fast].size = sizeof(_fastPool);
+    _reset(_pool[gui_mem_fast]);
+  }
+
+  // Reserve the large pool, call once at boot before the first page
+  void begin() {
+    if (_pool[gui_mem_large].base) return;
+    size_t size = GUI_ARENA_LARGE_SIZE;
+    uint8_t *base = NULL;
+#ifdef ARDUINO
+  #ifdef BOARD_HAS_PSRAM
+    if (psramFound()) {
+      base = (uint8_t *)ps_malloc(GUI_ARENA_PSRAM_SIZE);
+      if (base) {
+        size = GUI_ARENA_PSRAM_SIZE;
+        _psram = true;
+      }
+    }
+  #endif
+    if (!base)
+      base = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#else
+    base = (uint8_t *)malloc(size);
+#endif
+    if (!base) return; // everything goes to the fast pool
+    _pool[gui_mem_large].base = base;
+    _pool[gui_mem_large].size = size;
+    _reset(_pool[gui_mem_large]);
+  }
+
+  // Buffer until reset, NULL if out of memory
+  void *allocPermanent(size_t size, guiMem_e mem, const char *tag) {
+    size = _align(size);
+    pool_t *p = _select(size, mem);
+    if (!p) return NULL;
+    void *ptr = p->base + p->bottom;
+    p->bottom += size;
+    _updateHigh(*p);
+    if (_tagCount < GUI_ARENA_TAGS) {
+      _tags[_tagCount].tag = tag;
+      _tags[_tagCount].size = size;
+      _tags[_tagCount].mem = (p == &_pool[gui_mem_fast]) ? gui_mem_fast : gui_mem_large;
+      _tagCount++;
+    }
+    return ptr;
+  }
+
+  // Temporary buffer until release() of an earlier mark, NULL if out of memory
+  void *alloc(size_t size, guiMem_e mem) {
+    size = _align(size);
+    pool_t *p = _select(size, mem);
+    if (!p) return NULL;
+    p->top -= size;
+    _updateHigh(*p);
+    return p->base + p->top;
+  }
+
+  guiArenaMark_t mark() const {
+    guiArenaMark_t m;
+    for (int i = 0; i < gui_mem_count; i++)
+      m.top[i] = _pool[i].top;
+    return m;
+  }
+
+  // Free all alloc() buffers since mark m
+  void release(const guiArenaMark_t &m) {
+    for (int i = 0; i < gui_mem_count; i++)
+      if ((m.top[i] >= _pool[i].top) && (m.top[i] <= _pool[i].size))
+        _pool[i].top = m.top[i];
+  }
+
+  size_t size(guiMem_e mem) const { return _pool[mem].size; }
+  size_t used(guiMem_e mem) const { return _pool[mem].bottom + (_pool[mem].size - _pool[mem].top); }
+  size_t highWater(guiMem_e mem) const { return _pool[mem].high; }
+  uint32_t failures() const { return _failures; }
+  bool isPsram() const { return _psram; }
+
+  // JSON object with size, use and high water mark per pool and the permanent buffers
+  size_t report(char *buf, size_t size) const {
+    static const char *names[gui_mem_count] = { "fast", "large" };
+    size_t len = snprintf(buf, size, "{\"psram\":%s,\"failures\":%lu",
+      _psram ? "true" : "false", (unsigned long)_failures);
+    for (int i = 0; (i < gui_mem_count) && (len < size); i++)
+      len += snprintf(buf + len, size - len, ",\"%s\":{\"size\":%u,\"used\":%u,\"high\":%u}", names[i],
+        (unsigned)_pool[i].size, (unsigned)used((guiMem_e)i), (unsigned)_pool[i].high);
+    if (len < size) len += snprintf(buf + len, size - len, ",\"permanent\":[");
+    for (int i = 0; (i < _tagCount) && (len < size); i++)
+      len += snprintf(buf + len, size - len, "%s{\"tag\":\"%s\",\"pool\":\"%s\",\"size\":%u}",
+        i ? "," : "", _tags[i].tag, names[_tags[i].mem], (unsigned)_tags[i].size);
+    if (len < size) len += snprintf(buf + len, size - len, "]}");
+    return len;
+  }
+
+private:
+  struct pool_t {
+    uint8_t *base = NULL;
+    size_t size = 0;
+    size_t bottom = 0;      // permanent buffers below
+    size_t top = 0;         // temporary buffers above
+    size_t high = 0;
+  };
+  struct tag_t {
+    const char *tag;
+    size_t size;
+    guiMem_e mem;
+  };
+
+  alignas(GUI_ARENA_ALIGN) uint8_t _fastPool[GUI_ARENA_FAST_SIZE];
+  pool_t _pool[gui_mem_count];
+  tag_t _tags[GUI_ARENA_TAGS];
+  int _tagCount = 0;
+  uint32_t _failures = 0;
+  bool _psram = false;
+
+  static size_t _align(size_t size) { return (size + GUI_ARENA_ALIGN - 1) & ~(size_t)(GUI_ARENA_ALIGN - 1); }
+
+  static void _reset(pool_t &p) {
+    p.bottom = 0;
+    p.top = p.size;
+    p.high = 0;
+  }
+
+  static void _updateHigh(pool_t &p) {
+    size_t u = p.bottom + (p.size - p.top);
+    if (u > p.high) p.high = u;
+  }
+
+  // Pool with room for size, large falls back to fast
+  pool_t *_select(size_t size, guiMem_e mem) {
+    if ((mem == gui_mem_large) && _pool[gui_mem_large].base && (_pool[gui_mem_large].top - _pool[gui_mem_large].bottom >= size))
+      return &_pool[gui_mem_large];
+    if (_pool[gui_mem_fast].top - _pool[gui_mem_fast].bottom >= size)
+      return &_pool[gui_mem_fast];
+    _failures++;
+    return NULL;
+  }
+};
+
+GuiArena guiArena;
+
+// Memory budget as JSON: static objects, arena, heap. Defined in panel_gui.h
+// with the widget list, used by the /mem route of the web server
+size_t memBudgetReport(char *buf, size_t size);
+
+// Releases all temporary arena buffers of a block
+class GuiArenaScope {
+public:
+  GuiArenaScope() : _mark(guiArena.mark()) { }
+  ~GuiArenaScope() { guiArena.release(_mark); }
+private:
+  guiArenaMark_t _mark;
+};
+
+#endif // GUIARENA_H
@@ -40,6 +40,7 @@
 #include <TFT_eSPI.h>
 #include "touchProvider.h" // Common touch provider for all widgets
 #include "guiObject.h" // Common GUI object for all widgets
+#include "profiler.h" // PROF_SCOPE() instrumentation, empty if PROFILER not defined
 
 
 // The action callback can do anything and is called when the object is pressed.
@@ -0,0 +1,263 @@
+#ifndef IMAGEBLIT_H
+#define IMAGEBLIT_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Image blitter for 24 bit BMP and RGB565 raw files from SPIFFS (or any fs::FS).
+//
+// Instead of reading one pixel row per pushImage() call, the file is read in
+// chunks of several rows (about IMG_CHUNK_BYTES), converted with a kernel that
+// loads 4 BGR888 pixels as three 32 bit words, and each chunk is pushed with
+// one address window. Pixels are converted directly into display byte order,
+// so no byte swapping is needed while pushing.
+// Where TFT_eSPI supports DMA (ESP32_DMA), two output buffers are used: the
+// next chunk is read and converted while the previous one is sent by DMA.
+//
+// RGB565 raw files (".565") hold an imgRawHeader_t and pixel rows top-down in
+// display byte order (big endian), they are read straight into the output
+// buffer without any conversion. Create them with tools/bmp2raw.
+//
+// Without ARDUINO defined, only the header format and conversion kernel are
+// compiled, for use by host tools.
+
+#ifdef ARDUINO
+  #include <Arduino.h>
+  #include <TFT_eSPI.h>
+  #include <FS.h>
+  #include <esp_heap_caps.h>
+  #include "profiler.h"
+  #include "tftDma.h"
+#else
+  #include <cstdint>
+  #include <cstring>
+#endif
+
+#define IMG_CHUNK_BYTES 8192      // Größe des Lesepuffers, bestimmt Zeilen pro Chunk
+#define IMG_RAW_MAGIC 0x35363552UL  // "R565" little endian
+#define IMG_BMP_MAGIC 0x4D42        // "BM"
+
+// Header of a RGB565 raw file, followed by w * h big endian pixels, top row first
+struct imgRawHeader_t {
+  uint32_t magic;   // IMG_RAW_MAGIC
+  uint16_t w;
+  uint16_t h;
+};
+
+// Convert one BGR888 pixel to RGB565 in display byte order (big endian)
+inline uint16_t imgBgrTo565be(uint32_t b, uint32_t g, uint32_t r) {
+  uint16_t c = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+  return (c >> 8) | (c << 8);
+}
+
+// Convert n BGR888 pixels (BMP row order) to big endian RGB565.
+// src must be 4 byte aligned, BMP rows are padded to 4 bytes anyway.
+// 4 pixels are loaded as 3 words: B0 G0 R0 B1 | G1 R1 B2 G2 | R2 B3 G3 R3
+inline void imgConvertBGR888(const uint8_t *src, uint16_t *dst, int n) {
+  const uint32_t *s = (const uint32_t *)src;
+  for (int quads = n >> 2; quads > 0; quads--) {
+    uint32_t w0 = s[0], w1 = s[1], w2 = s[2];
+    s += 3;
+    dst[0] = imgBgrTo565be(w0 & 0xFF, (w0 >> 8) & 0xFF, (w0 >> 16) & 0xFF);
+    dst[1] = imgBgrTo565be(w0 >> 24, w1 & 0xFF, (w1 >> 8) & 0xFF);
+    dst[2] = imgBgrTo565be((w1 >> 16) & 0xFF, w1 >> 24, w2 & 0xFF);
+    dst[3] = imgBgrTo565be((w2 >> 8) & 0xFF, (w2 >> 16) & 0xFF, w2 >> 24);
+    dst += 4;
+  }
+  const uint8_t *b = (const uint8_t *)s;
+  for (int i = n & 3; i > 0; i--) {
+    *dst++ = imgBgrTo565be(b[0], b[1], b[2]);
+    b += 3;
+  }
+}
+
+#ifdef ARDUINO
+
+class ImageBlitter {
+public:
+  ImageBlitter(TFT_eSPI *tft) { _tft = tft; }
+
+  ~ImageBlitter() { _free(); }
+
+  // Draw a 24 bit BMP or RGB565 raw file at x, y, file type by magic number.
+  // Returns false if file not found or format not supported
+  bool draw(fs::FS &fs, const char *filename, int16_t x, int16_t y) {
+    if ((x >= DISPLAY_W) || (y >= DISPLAY_H)) return false;
+    fs::File file = fs.open(filename, "r");
+    if (!file) {
+      DEBUG_PRINTLN("File not found");
+      return false;
+    }
+    uint32_t startTime = millis();
+    uint8_t hdr[54]; // BMP file header + BITMAPINFOHEADER, one read
+    size_t len = file.read(hdr, sizeof(hdr));
+    bool ok = false;
+    if ((len >= sizeof(imgRawHeader_t)) && (_get32(hdr) == IMG_RAW_MAGIC))
+      ok = _drawRaw(file, hdr, x, y);
+    else if ((len == sizeof(hdr)) && (_get16(hdr) == IMG_BMP_MAGIC))
+      ok = _drawBmp(file, hdr, x, y);
+    file.close();
+    _lastMillis = millis() - startTime;
+    if (ok) {
+      DEBUG_PRINT("Loaded in "); DEBUG_PRINT(_lastMillis);
+      DEBUG_PRINTLN(" ms");
+    } else {
+      DEBUG_PRINTLN("Image format not recognized.");
+    }
+    return ok;
+  }
+
+  // Duration of last draw() in ms
+  uint32_t lastMillis() const { return _lastMillis; }
+
+private:
+  TFT_eSPI *_tft;
+  uint8_t *_inBuf = NULL;
+  uint16_t *_outBuf[2] = {NULL, NULL};
+  int _outCount = 0;
+  int _cur = 0;
+  bool _dmaActive = false;
+  bool _dmaReady = false;
+  uint32_t _lastMillis = 0;
+
+  static uint16_t _get16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+  static uint32_t _get32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+  // 24 bit uncompressed BMP, bottom-up or top-down (negative height)
+  bool _drawBmp(fs::File &file, const uint8_t *hdr, int16_t x, int16_t y) {
+    uint32_t seekOffset = _get32(hdr + 10);
+    int32_t w = (int32_t)_get32(hdr + 18);
+    int32_t h = (int32_t)_get32(hdr + 22);
+    if ((_get16(hdr + 26) != 1) || (_get16(hdr + 28) != 24) || (_get32(hdr + 30) != 0) || (w <= 0))
+      return false;
+    bool bottomUp = (h > 0);
+    if (!bottomUp) h = -h;
+    size_t stride = (w * 3 + 3) & ~3;
+    int rows = _alloc(w, h, stride);
+    if (rows == 0) return false;
+    file.seek(seekOffset);
+    _begin();
+    for (int32_t r0 = 0; r0 < h; r0 += rows) {
+      int n = (h - r0 < rows) ? (h - r0) : rows;
+      if (file.read(_inBuf, n * stride) != n * stride) break;
+      uint16_t *out = _outBuf[_cur];
+      for (int i = 0; i < n; i++) {
+        // BMP is stored bottom-up, reverse rows within the chunk
+        int dst_row = bottomUp ? (n - 1 - i) : i;
+        imgConvertBGR888(_inBuf + i * stride, out + dst_row * w, w);
+      }
+      int16_t ty = bottomUp ? (y + h - r0 - n) : (y + r0);
+      _push(x, ty, w, n);
+    }
+    _end();
+    return true;
+  }
+
+  // RGB565 raw file, no conversion needed
+  bool _drawRaw(fs::File &file, const uint8_t *hdr, int16_t x, int16_t y) {
+    int32_t w = _get16(hdr + 4);
+    int32_t h = _get16(hdr + 6);
+    if ((w == 0) || (h == 0)) return false;
+    int rows = _alloc(w, h, 0);
+    if (rows == 0) return false;
+    file.seek(sizeof(imgRawHeader_t));
+    _begin();
+    for (int32_t r0 = 0; r0 < h; r0 += rows) {
+      int n = (h - r0 < rows) ? (h - r0) : rows;
+      size_t len = n * w * 2;
+      if (file.read((uint8_t *)_outBuf[_cur], len) != len) break;
+      _push(x, y + r0, w, n);
+    }
+    _end();
+    return true;
+  }
+
+  // Allocate buffers for as many rows as fit into IMG_CHUNK_BYTES,
+  // fewer rows if heap is short. stride = 0: no input buffer needed (raw file).
+  // Returns rows per chunk, 0 if out of memory
+  int _alloc(int32_t w, int32_t h, size_t stride) {
+    _free();
+    size_t rowBytes = stride ? stride : (size_t)w * 2;
+    int rows = IMG_CHUNK_BYTES / rowBytes;
+    if (rows < 1) rows = 1;
+    if (rows > h) rows = h;
+    #ifdef ESP32_DMA
+      if (!_dmaReady)
+        _dmaReady = tftDma.begin(_tft); // initDMA() once for all DMA users
+      _outCount = _dmaReady ? 2 : 1;
+    #else
+      _outCount = 1;
+    #endif
+    while (rows > 0) {
+      bool ok = true;
+      if (stride)
+        ok = (_inBuf = (uint8_t *)malloc(rows * stride)) != NULL;
+      for (int i = 0; ok && (i < _outCount); i++) {
+        // DMA capable memory for output buffers
+        ok = (_outBuf[i] = (uint16_t *)heap_caps_malloc(rows * w * 2, MALLOC_CAP_DMA)) != NULL;
+      }
+      if (ok) return rows;
+      _free();
+      rows /= 2;
+    }
+    DEBUG_PRINTLN("ImageBlitter: out of memory");
+    return 0;
+  }
+
+  void _free() {
+    free(_inBuf);
+    _inBuf = NULL;
+    for (int i = 0; i < 2; i++) {
+      heap_caps_free(_outBuf[i]);
+      _outBuf[i] = NULL;
+    }
+  }
+
+  void _begin() {
+    _cur = 0;
+    _dmaActive = false;
+    _tft->startWrite();
+  }
+
+  // Push one converted chunk with a single address window
+  void _push(int16_t x, int16_t y, int32_t w, int rows) {
+    PROF_PIXELS(w * rows);
+    bool oldSwapBytes = _tft->getSwapBytes();
+    _tft->setSwapBytes(false); // pixels are already in display byte order
+    #ifdef ESP32_DMA
+      if (_outCount == 2) {
+        _tft->dmaWait(); // previous chunk sent, its buffer is free for the next read
+        _tft->pushImageDMA(x, y, w, rows, _outBuf[_cur]);
+        _dmaActive = true;
+        _cur ^= 1;
+        _tft->setSwapBytes(oldSwapBytes);
+        return;
+      }
+    #endif
+    _tft->pushImage(x, y, w, rows, _outBuf[_cur]);
+    _tft->setSwapBytes(oldSwapBytes);
+  }
+
+  void _end() {
+    #ifdef ESP32_DMA
+      if (_dmaActive)
+        _tft->dmaWait();
+    #endif
+    _tft->endWrite();
+    _free();
+  }
+};
+
+#endif // ARDUINO
+
+#endif // IMAGEBLIT_H
@@ -0,0 +1,231 @@
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Cooperative scheduler for the jobs of loop(): acquisition, touch, scope,
+// page rendering, LED blinking, clock.
+//
+// Each job has a period, a deadline relative to its release time and a
+// priority (0 = most important). loop() asks next() for the job to run and
+// reports its run time with done():
+//   int job = scheduler.next(now_ms);
+//   if (job >= 0) { ...run...; scheduler.done(job, now_ms, run_us); }
+// next() returns the due job with the lowest priority number, among equal
+// priorities the one released first. Jobs are never interrupted, so a long
+// job delays the others; a job started after its deadline counts as overrun.
+// Releases advance by the period, so there is no drift; periods that passed
+// completely without a run are counted as skipped and not made up.
+//
+// Load shedding: every SCHED_WINDOW_MS the run time of all jobs is compared
+// to the window. Above SCHED_LOAD_HIGH percent, or if a job with priority
+// below SCHED_PRIO_SHED was overrun, the shed level goes up by one and the
+// periods and deadlines of jobs with priority SCHED_PRIO_SHED and above are
+// doubled. Below SCHED_LOAD_LOW percent without such overruns it goes down
+// again. Acquisition and touch keep their rate, only display refresh slows.
+// setMinShed() keeps the level from going below a floor, e.g. while the
+// measured values are stable (see powerManager.h).
+// Disabled jobs (e.g. scope on other pages) are not run at all.
+//
+// msUntilNext() tells how long loop() may sleep, trigger() releases a job at
+// once, e.g. touch after a touch interrupt.
+//
+// Pure logic without hardware access, time is passed by the caller.
+// See tools/sched_sim for a simulation with overload.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define SCHED_MAX_JOBS 8
+#define SCHED_WINDOW_MS 1000    // Messfenster für Auslastung
+#define SCHED_LOAD_HIGH 75      // Prozent, darüber Perioden strecken
+#define SCHED_LOAD_LOW 40       // Prozent, darunter wieder verkürzen
+#define SCHED_MAX_SHED 3        // maximal Faktor 8
+#define SCHED_PRIO_SHED 2       // Jobs ab dieser Priorität werden gestreckt
+#define SCHED_JSON_SIZE 2048
+
+class JobScheduler {
+public:
+  JobScheduler() { }
+
+  // Define job id (0..SCHED_MAX_JOBS-1), deadline_ms = 0: same as period
+  bool add(int id, const char *name, uint32_t period_ms, uint8_t prio, uint32_t deadline_ms = 0) {
+    if ((id < 0) || (id >= SCHED_MAX_JOBS) || !period_ms) return false;
+    job_t &j = _jobs[id];
+    j.name = name;
+    j.period = period_ms;
+    j.deadline = deadline_ms ? deadline_ms : period_ms;
+    j.prio = prio;
+    j.enabled = true;
+    j.defined = true;
+    j.release = _now;
+    if (id >= _count) _count = id + 1;
+    return true;
+  }
+
+  // Enable or disable job, an enabled job is released at once
+  void setEnabled(int id, bool enabled, uint32_t now_ms) {
+    if ((id < 0) || (id >= _count)) return;
+    if (enabled && !_jobs[id].enabled)
+      _jobs[id].release = now_ms;
+    _jobs[id].enabled = enabled;
+  }
+
+  bool isEnabled(int id) const { return (id >= 0) && (id < _count) && _jobs[id].enabled; }
+
+  // Release enabled job now, e.g. on an interrupt
+  void trigger(int id, uint32_t now_ms) {
+    if ((id < 0) || (id >= _count) || !_jobs[id].enabled) return;
+    if ((int32_t)(_jobs[id].release - now_ms) > 0)
+      _jobs[id].release = now_ms;
+  }
+
+  // Time until the next release, 0 if a job is due, max_ms if none is sooner
+  uint32_t msUntilNext(uint32_t now_ms, uint32_t max_ms) const {
+    uint32_t wait = max_ms;
+    for (int i = 0; i < _count; i++) {
+      const job_t &j = _jobs[i];
+      if (!j.defined || !j.enabled) continue;
+      int32_t d = (int32_t)(j.release - now_ms);
+      if (d <= 0) return 0;
+      if ((uint32_t)d < wait) wait = d;
+    }
+    return wait;
+  }
+
+  // Due job to run now, -1 if none
+  int next(uint32_t now_ms) {
+    _now = now_ms;
+    _adapt(now_ms);
+    int best = -1;
+    for (int i = 0; i < _count; i++) {
+      const job_t &j = _jobs[i];
+      if (!j.defined || !j.enabled || ((int32_t)(now_ms - j.release) < 0)) continue;
+      if ((best < 0) || (j.prio < _jobs[best].prio)
+        || ((j.prio == _jobs[best].prio) && ((int32_t)(j.release - _jobs[best].release) < 0)))
+        best = i;
+    }
+    return best;
+  }
+
+  // Job started at start_ms has finished after run_us
+  void done(int id, uint32_t start_ms, uint32_t run_us) {
+    if ((id < 0) || (id >= _count)) return;
+    job_t &j = _jobs[id];
+    uint32_t period = effectivePeriod(id);
+    uint32_t late = start_ms - j.release;
+    j.runs++;
+    if (late > j.maxLate) j.maxLate = late;
+    if (late > (j.deadline << _shift(j))) {
+      j.overruns++;
+      if (j.prio < SCHED_PRIO_SHED)
+        _criticalOverrun = true;
+    }
+    j.sumRunUs += run_us;
+    if (run_us > j.maxRunUs) j.maxRunUs = run_us;
+    _busyUs += run_us;
+    j.release += period;
+    if ((int32_t)(start_ms - j.release) >= 0) {
+      uint32_t missed = (start_ms - j.release) / period + 1;
+      j.skipped += missed;
+      j.release += missed * period;
+    }
+  }
+
+  // Period after load shedding
+  uint32_t effectivePeriod(int id) const { return _jobs[id].period << _shift(_jobs[id]); }
+
+  // Lower limit of the shed level, 0..SCHED_MAX_SHED, takes effect with the next release
+  void setMinShed(int level) {
+    if (level < 0) level = 0;
+    if (level > SCHED_MAX_SHED) level = SCHED_MAX_SHED;
+    _minShed = level;
+  }
+
+  int shedLevel() const { return (_loadShed > _minShed) ? _loadShed : _minShed; }
+  int load() const { return _load; }          // percent of last window
+  int peakLoad() const { return _peakLoad; }  // percent since resetStats()
+  uint32_t runs(int id) const { return _jobs[id].runs; }
+  uint32_t overruns(int id) const { return _jobs[id].overruns; }
+  uint32_t skipped(int id) const { return _jobs[id].skipped; }
+
+  void resetStats() {
+    for (int i = 0; i < _count; i++) {
+      job_t &j = _jobs[i];
+      j.runs = j.overruns = j.skipped = j.maxLate = j.maxRunUs = 0;
+      j.sumRunUs = 0;
+    }
+    _peakLoad = 0;
+  }
+
+  // JSON object with load, shed level and statistics of all jobs
+  size_t report(char *buf, size_t size) const {
+    size_t len = snprintf(buf, size, "{\"load_pct\":%d,\"peak_load_pct\":%d,\"shed_level\":%d,\"jobs\":[",
+      _load, _peakLoad, shedLevel());
+    bool first = true;
+    for (int i = 0; (i < _count) && (len < size); i++) {
+      const job_t &j = _jobs[i];
+      if (!j.defined) continue;
+      len += snprintf(buf + len, size - len, "%s{\"name\":\"%s\",\"prio\":%u,\"enabled\":%s,"
+        "\"period_ms\":%lu,\"runs\":%lu,\"overruns\":%lu,\"skipped\":%lu,\"max_late_ms\":%lu,"
+        "\"avg_us\":%lu,\"max_us\":%lu}", first ? "" : ",", j.name, (unsigned)j.prio,
+        j.enabled ? "true" : "false", (unsigned long)effectivePeriod(i), (unsigned long)j.runs,
+        (unsigned long)j.overruns, (unsigned long)j.skipped, (unsigned long)j.maxLate,
+        (unsigned long)(j.runs ? j.sumRunUs / j.runs : 0), (unsigned long)j.maxRunUs);
+      first = false;
+    }
+    if (len < size) len += snprintf(buf + len, size - len, "]}\n");
+    return len;
+  }
+
+private:
+  struct job_t {
+    const char *name = "";
+    uint32_t period = 0, deadline = 0;
+    uint8_t prio = 0;
+    bool enabled = false, defined = false;
+    uint32_t release = 0;
+    uint32_t runs = 0, overruns = 0, skipped = 0;
+    uint32_t maxLate = 0, maxRunUs = 0;
+    uint64_t sumRunUs = 0;
+  };
+
+  job_t _jobs[SCHED_MAX_JOBS];
+  int _count = 0;
+  uint32_t _now = 0;
+  uint32_t _windowStart = 0;
+  uint64_t _busyUs = 0;
+  bool _criticalOverrun = false;
+  int _loadShed = 0;      // shed level by load
+  int _minShed = 0;
+  int _load = 0, _peakLoad = 0;
+
+  int _shift(const job_t &j) const { return (j.prio >= SCHED_PRIO_SHED) ? shedLevel() : 0; }
+
+  void _adapt(uint32_t now_ms) {
+    uint32_t elapsed = now_ms - _windowStart;
+    if (elapsed < SCHED_WINDOW_MS) return;
+    _load = (int)(_busyUs / (elapsed * 10ULL));
+    if (_load > _peakLoad) _peakLoad = _load;
+    if ((_criticalOverrun || (_load > SCHED_LOAD_HIGH)) && (_loadShed < SCHED_MAX_SHED))
+      _loadShed++;
+    else if (!_criticalOverrun && (_load < SCHED_LOAD_LOW) && (_loadShed > 0))
+      _loadShed--;
+    _busyUs = 0;
+    _criticalOverrun = false;
+    _windowStart = now_ms;
+  }
+};
+
+#endif // JOBSCHEDULER_H
@@ -27,9 +27,12 @@
 #include "guiObject.h" // Common GUI object for all widgets
 #include "Free_Fonts.h" // Include large fonts
 #include "buttons.h"
+#include "textFormat.h"
+#include "tftDma.h"
 
 
 #define KEYPAD_PADDING 10 // 10 Pixel line padding on each side
+#define KEYPAD_ENTRY_SIZE 16 // max. 15 Zeichen im Eingabefeld
 #define ENTRY_TOP 28 // Top position of the entry field relative to Y
 
 #define SMALLBUTTON_W 50
@@ -94,12 +97,9 @@ NumericKeypad(TFT_eSPI *tft, TouchProvider *touchProvider) : _tft(tft), _touchPr
 
 // ##############################################################################
 
-	// Show a modal dialog with keypad, OK and cancel key
-	// The user can enter a value (default set by setEntryValue(float)) using the keypad
-	// returns the entered number
-	float entry(String message1, uint16_t decimal_digits, bool use_plusminus) {
-    // _tft->readRect(0,0, DISPLAY_W, DISPLAY_H, screenBuffer);
-    _touchProvider->waitReleased();
+	// Draw dialog box with message, entry field showing the entry value and 4 x 4 keypad.
+	// Called by entry(), public for benchmarking
+	void draw(const char *message1, uint16_t decimal_digits, bool use_plusminus) {
 		_use_decimal = decimal_digits > 0;
 		_use_plusminus = use_plusminus;
 		_tft->setTextFont(2);
@@ -113,40 +113,54 @@ NumericKeypad(TFT_eSPI *tft, TouchProvider *touchProvider) : _tft(tft), _touchPr
 		// draw entry field
 		_tft->drawRect(_entry_left, _entry_top, _entry_width, _entry_height, TFT_WHITE);
 		// Make Cancel Button
-		_entry_valid = false;
-		bool cancelled = false;
-		bool enter_ok = false;
-		bool decimal_entered = false;
 		_btnCancel.init(_x + _w - SMALLBUTTON_W - KEYPAD_PADDING, _y + 5, SMALLBUTTON_W, SMALLBUTTON_H, TFT_WHITE, TFT_RED, TFT_BLACK, 1, 1);
 		_btnCancel.setLabel("CANCEL");
 		_btnCancel.setActive(true, true);
 
     if (_use_decimal) {
-      _entryStr = String(_entry_value, decimal_digits);
+      _entryStr.clear().fixed(_entry_value, decimal_digits);
     } else {
-      _entryStr = String((int)rint(_entry_value));
+      _entryStr.clear().num((long)rint(_entry_value));
     }
 		_drawEntryString();
-		char const *label;
 
 		// Draw 4 x 4 keypad
 		for (int row = 0; row < 4; row++) {
 			for (int col = 0; col < 4; col++) {
-				label = _keypad[row][col];
-				_drawKeypadButton(label, false, col, row);
+				_drawKeypadButton(_keypad[row][col], false, col, row);
 			}
 		}
+	}
+
+	// Draw a single key pressed (active) or released
+	void drawKey(int row, int col, bool is_active) {
+		_drawKeypadButton(_keypad[row][col], is_active, col, row);
+	}
+
+	// Show a modal dialog with keypad, OK and cancel key
+	// The user can enter a value (default set by setEntryValue(float)) using the keypad
+	// returns the entered number
+	float entry(const char *message1, uint16_t decimal_digits, bool use_plusminus) {
+    // _tft->readRect(0,0, DISPLAY_W, DISPLAY_H, screenBuffer);
+    _touchProvider->waitReleased();
+		draw(message1, decimal_digits, use_plusminus);
+		_entry_valid = false;
+		bool cancelled = false;
+		bool enter_ok = false;
+		bool decimal_entered = false;
+		char const *label;
     unsigned long blink_time = millis();
     while (!enter_ok) {
       #ifdef ENCODER_ENABLED
         int enc_delta = _touchProvider->getEncDelta();
         if (enc_delta) {
           spkrTick(); // Play a click sound when an item is selected
+          long entry_int = atol(_entryStr);
           // Handle encoder input
           if (enc_delta > 0) {
-            _entryStr = String(_entryStr.toInt() + 1);  // Encoder turned right
+            _entryStr.clear().num(entry_int + 1);  // Encoder turned right
           } else {
-            _entryStr = String(_entryStr.toInt() - 1);  // Encoder turned left
+            _entryStr.clear().num(entry_int - 1);  // Encoder turned left
           }
           _drawEntryString();
         }
@@ -169,12 +183,12 @@ NumericKeypad(TFT_eSPI *tft, TouchProvider *touchProvider) : _tft(tft), _touchPr
               if (_first_press) {
                 _first_press = false;
                 if (_entryStr == "0") {
-                  _entryStr = "";
+                  _entryStr.clear();
                 }
               }
 							label = _keypad[row][col];
 							if (label[0] == '\0') continue; // Skip empty labels
-              decimal_entered = _entryStr.indexOf('.') >= 0 || _entryStr.indexOf(',') >= 0;
+              decimal_entered = strchr(_entryStr, '.') || strchr(_entryStr, ',');
 							if ((!_use_decimal || decimal_entered) && (label[0] == '.' || label[0] == ',')) continue; // Skip decimal point button
 							_drawKeypadButton(label, true, col, row);
 							if (row == 3 && col == 3) { // OK button
@@ -182,19 +196,21 @@ NumericKeypad(TFT_eSPI *tft, TouchProvider *touchProvider) : _tft(tft), _touchPr
 								spkrOKbeep();
 								break;
 							} else if (row == 0 && col == 3) { // Backspace button
-								_entryStr.remove(_entryStr.length() - 1);
+								_entryStr.chop();
                 if (_entryStr.length() == 0) {
-                  _entryStr = "0";
+                  _entryStr.add('0');
                   _first_press = true; // start over again
                 }
               } else if (row == 2 && col == 3) { // +/- button
                 if (_use_decimal) {
-								  _entryStr = String(-_entryStr.toFloat(), decimal_digits);
+                  float entry_float = atof(_entryStr);
+								  _entryStr.clear().fixed(-entry_float, decimal_digits);
                 } else {
-                  _entryStr = String(-_entryStr.toInt());
+                  long entry_int = atol(_entryStr);
+                  _entryStr.clear().num(-entry_int);
                 }
 							} else {
-								_entryStr += label;
+								_entryStr.add(label); // truncated when field is full
 							}
 							_drawEntryString();
 							spkrClick(); // Play a click sound when an item is selected
@@ -217,10 +233,10 @@ NumericKeypad(TFT_eSPI *tft, TouchProvider *touchProvider) : _tft(tft), _touchPr
 		}
 		delay(100);
 		_touchProvider->waitReleased();
-		_tft->fillRect(_x, _y, _w, _h, TFT_BLACK);
+		tftDma.fillRect(_x, _y, _w, _h, TFT_BLACK);
 		if (!cancelled && _entryStr.length()) {
 			_entry_valid = true;
-			_entry_value = _entryStr.toFloat(); // Convert the entry string to float
+			_entry_value = atof(_entryStr); // Convert the entry string to float
 		}
 		_tft->setTextDatum(TL_DATUM); // top left text datum
     //_tft->pushRect(0,0, DISPLAY_W, DISPLAY_H, screenBuffer);
@@ -249,7 +265,7 @@ private:
 		{"7", "8", "9", "+/-"},
 		{"\0", "0", ".", "OK"}
 	};
-	String _entryStr = "0"; // Entry string, initialized to "0"
+	TextBuf<KEYPAD_ENTRY_SIZE> _entryStr = "0"; // Entry string, initialized to "0"
 	float _entry_value = 0.0;  // Default entry value
 	bool _entry_valid = false; // Set to true if a valid entry is made
   bool _use_decimal = false;
@@ -20,6 +20,7 @@
 // uint16_t color picker: https://rgbcolorpicker.com/565
 
 #define DEBUG           // Enable debugging messages
+//#define PROFILER      // Enable frame time profiler, HUD and /prof report, see profiler.h
 //#define DEBUG_STARTUP // Enable startup debugging messages and wait time
 
 #include <Arduino.h>
@@ -48,10 +49,16 @@
 
 void setup(void) {
   hardwareInit();
+  #ifdef DEBUG
+    static char mem_report[MEM_REPORT_SIZE];
+    memBudgetReport(mem_report, sizeof(mem_report));
+    Serial.print(mem_report); // memory budget, also on /mem
+  #endif
   delay(2000);
   // Optional: Display a splash screen from SPIFFS
-  tft.fillScreen(TFT_BLACK);
-  drawBmp("/splash.bmp", 0, 8);
+  tftDma.fillScreen(TFT_BLACK);
+  if (!drawBmp("/splash.565", 0, 8)) // pre-converted RGB565, see tools/bmp2raw
+    drawBmp("/splash.bmp", 0, 8);
   delay(500);
 
   if (adcPresent == 0) {
@@ -59,17 +66,18 @@ void setup(void) {
   }
 
   #ifdef WIFI_ENABLED
+    // Connections are established in background by wifiManager.update() in loop(),
+    // settings.wifiEnabled is cleared by wifi_state_changed() if connection fails
     if (settings.wifiEnabled) {
       if (settings.wifiAPenabled)
         wifi_connect_ap();
       else
         wifi_connect_sta();
-      settings.wifiEnabled = wifi_connected(); // Check if connected to WiFi
     } else {
       if (dialogBox.modalDlg("Connect to WIFI?", "", 17)) {
-        wifi_connect_sta();
         settings.wifiAPenabled = false;
-        settings.wifiEnabled = wifi_connected(); // Check if connected to WiFi
+        settings.wifiEnabled = true;
+        wifi_connect_sta();
       } else {
         stop_server();
       }
@@ -80,6 +88,7 @@ void setup(void) {
   delay(500);
   spkrOKbeep();
   measurementChanged = true; // Force redraw of numeric display
+  setAutoRange(settings.autoRangeOn);
   enablePageControls(state_invalid);
 }
 
@@ -96,127 +105,371 @@ void setup(void) {
 //
 // ##############################################################################
 
-void loop() {
+// Redraw controls of current page, e.g. after a benchmark or HUD overlay
+void redrawCurrentPage() {
+  if (instrState == state_setup)
+    enablePageControls(state_setupInit);
+  else
+    enablePageControls((instrStates_e)(instrState & ~1)); // Init state of current page
+}
 
-  if (second_tick) {
-    getLocalTime(timeinfo, 0);
-    analogClock.update(timeinfo, false);
-    second_tick = 0;
+// Execute commands posted by other tasks (web server), see uiQueue.h
+// Trigger setting posted by the web server, only while trigger sampling is stopped
+void setTriggerParam(const uiCmd_t &cmd) {
+  switch (cmd.cmd) {
+  case ui_cmd_trig_mode:
+    scopeTrigger.mode = (trigMode_e)constrain(cmd.arg, trig_roll, trig_single);
+    break;
+  case ui_cmd_trig_edge:
+    scopeTrigger.edge = (cmd.arg == trig_falling) ? trig_falling : trig_rising;
+    break;
+  case ui_cmd_trig_source:
+    scopeTrigger.source = (cmd.arg == volts) ? volts : amps;
+    break;
+  case ui_cmd_trig_level:
+    markerAmps = (float)cmd.arg / UI_LEVEL_SCALE; // raw level is set in armScopeTrigger()
+    break;
+  case ui_cmd_trig_pre:
+    scopeTrigger.prePct = cmd.arg;
+    break;
+  case ui_cmd_trig_holdoff:
+    scopeTrigger.holdoffMs = cmd.arg;
+    break;
+  default:
+    break;
   }
+}
 
-  if (update_tick) {
-    update_tick = 0;
-    handleGUI(); // Handle GUI events and button presses
-
-    int16_t adc1_raw, adc2_raw; // ADC-Rohwerte
-    bool adc1_ovld, adc2_ovld;   // ADC-Overload-Flag
-
-    // Anzeige aktualisieren
-    float level_fs_amps, level_fs_volts; // Level in full scale, 0 bis 1.0
-    if (adcPresent) {
-      // Pegel von externem ADC MCP3421 lesen
-      if (adc_MCP3421.IsReady())  {
-        adc1_raw = adc_MCP3421.ReadRaw() + settings.adcRawOffsetAmps; // ADC-Wert A-Messung
-        adc_MCP3421.Trigger();
-        if (settings.ampHiRangeOn) {
-          level_fs_amps = (float)(adc1_raw) * settings.adcScalings[settings.ampRangeIdx] / ADC_DIV_HIRANGE_EXT; // interner ADC, umrechnen auf Fullscale = 1.0
-          settings.ampRangeIdx = 3; // Hi Range
+void handleUiCommands() {
+  uiCmd_t cmd;
+  bool rearm = false;
+  while (uiQueue.receive(&cmd)) {
+    switch (cmd.cmd) {
+    case ui_cmd_sdlog:
+      // SD logging requested by web server
+      if (cmd.arg)
+        sdLogStart();
+      else
+        sdLogStop();
+      break;
+    case ui_cmd_stats_reset:
+      portENTER_CRITICAL(&statsMux);
+      statsAmps.reset(millis());
+      statsVolts.reset(millis());
+      portEXIT_CRITICAL(&statsMux);
+      break;
+    case ui_cmd_trig_rearm:
+      rearm = true; // once for all trigger parameters of a web form
+      break;
+    case ui_cmd_trig_mode:
+    case ui_cmd_trig_edge:
+    case ui_cmd_trig_source:
+    case ui_cmd_trig_level:
+    case ui_cmd_trig_pre:
+    case ui_cmd_trig_holdoff:
+      // trigger settings from web server, sampling stopped while they change
+      TrigTicker.detach();
+      scopeTrigger.stop();
+      setTriggerParam(cmd);
+      rearm = true;
+      break;
+    case ui_cmd_redraw:
+      redrawCurrentPage();
+      break;
+    #ifdef PROFILER
+      case ui_cmd_prof:
+        if (cmd.arg == ui_prof_hud) {
+          profiler.hud = true;
+        } else if (cmd.arg == ui_prof_off) {
+          profiler.hud = false;
+          redrawCurrentPage(); // HUD vom Bildschirm entfernen
+        } else if (cmd.arg == ui_prof_reset) {
+          profiler.reset();
+        } else if (cmd.arg == ui_prof_serial) {
+          static char report[PROF_REPORT_SIZE];
+          profiler.report(report, sizeof(report));
+          Serial.print(report);
         }
-        else {
-          level_fs_amps = (float)(adc1_raw) * settings.adcScalings[settings.ampRangeIdx] / ADC_DIV_LORANGE_EXT; // interner ADC, umrechnen auf Fullscale = 1.0
-          settings.ampRangeIdx = 2; // Default Range
+        break;
+      case ui_cmd_bench:
+        // Widget benchmark requested by web server
+        Serial.print(widgetBench.run());
+        redrawCurrentPage();
+        break;
+      case ui_cmd_golden: {
+        // Golden image check or save requested by web server
+        bool save = (cmd.arg != 0);
+        int mismatches = goldenRun(save);
+        Serial.print(screenCapture.report());
+        if (!save && mismatches) {
+          DEBUG_PRINT("Golden images differing: ");
+          DEBUG_PRINTLN(mismatches);
         }
-        adc1_ovld = (adc1_raw > ADC_OVERLOAD_DC_EXT); // ADC-Wert Overload-Grenze
+        break;
       }
+    #endif
+    default:
+      break;
+    }
+  }
+  // Trigger-Einstellung geändert, neu armieren
+  if (rearm && (instrState == state_scope))
+    enableStdControls(state_scopeInit);
+}
+
+// Ergebnisse der letzten Messung von acquireLevels(), für die anderen Jobs
+float levelFsAmps = 0, levelFsVolts = 0; // Level in full scale, 0 bis 1.0
+bool ovldAmps = false, ovldVolts = false; // ADC-Overload-Flag
+
+// Acquisition job: read ADCs, scale to full scale of current range, statistics and auto-ranging
+void acquireLevels() {
+  int16_t adc1_raw, adc2_raw; // ADC-Rohwerte
+
+  // ADC-Skalierung Lo oder Hi Range, bei Auto-Ranging nach aktuellem Bereich
+  bool amps_lo;
+  if (settings.autoRangeOn) {
+    amps_lo = (settings.ampRangeIdx <= AMP_RANGE_LO);
+  } else {
+    amps_lo = !settings.ampHiRangeOn;
+    settings.ampRangeIdx = amps_lo ? AMP_RANGE_LO : AMP_RANGE_HI;
+  }
+  float level_fs_amps = levelFsAmps; // unverändert, wenn externer ADC nicht bereit
+  bool adc1_ovld = ovldAmps;
+  if (adcPresent) {
+    // Pegel von externem ADC MCP3421 lesen
+    if (adc_MCP3421.IsReady())  {
+      adc1_raw = adc_MCP3421.ReadRaw() + settings.adcRawOffsetAmps; // ADC-Wert A-Messung
+      adc_MCP3421.Trigger();
+      // externer ADC, umrechnen auf Fullscale = 1.0 in Lo oder Hi Range
+      level_fs_amps = (float)(adc1_raw) * settings.adcScalings[settings.ampRangeIdx] / (amps_lo ? ADC_DIV_LORANGE_EXT : ADC_DIV_HIRANGE_EXT);
+      adc1_ovld = (adc1_raw > ADC_OVERLOAD_DC_EXT); // ADC-Wert Overload-Grenze
+      // auf angezeigten Bereich umrechnen, Faktor 1 ohne Auto-Ranging
+      level_fs_amps *= meterRangeFullScale(amps_lo ? AMP_RANGE_LO : AMP_RANGE_HI) / meterRangeFullScale(settings.ampRangeIdx);
+    }
+  } else {
+    // Pegel von internem ADC lesen
+    adc1_raw = analogRead(DC_PIN_AMPS) + settings.adcRawOffsetAmps; // ADC-Wert A-Messung
+    // interner ADC, umrechnen auf Fullscale = 1.0 in Lo oder Hi Range
+    level_fs_amps = (float)(adc1_raw) * settings.adcScalings[settings.ampRangeIdx] / (amps_lo ? ADC_DIV_LORANGE : ADC_DIV_HIRANGE);
+    adc1_ovld = (adc1_raw > ADC_OVERLOAD_DC); // ADC-Wert Overload-Grenze
+    // auf angezeigten Bereich umrechnen, Faktor 1 ohne Auto-Ranging
+    level_fs_amps *= meterRangeFullScale(amps_lo ? AMP_RANGE_LO : AMP_RANGE_HI) / meterRangeFullScale(settings.ampRangeIdx);
+  }
+
+  adc2_raw = analogRead(DC_PIN_VOLTS) + settings.adcRawOffsetVolts; // ADC-Wert V-Messung
+  bool adc2_ovld = (adc2_raw > ADC_OVERLOAD_DC); // ADC-Wert Overload-Grenze
+  if (adc2_ovld)
+    adc2_raw = ADC_OVERLOAD_DC; // ADC-Wert Overload-Grenze
+
+  float level_fs_volts = (float)(adc2_raw) * settings.adcScalings[settings.voltRangeIdx] / ADC_DIV_VOLT; // interner ADC, umrechnen auf Fullscale = 1.0
+  level_fs_volts *= meterRangeFullScale(VOLT_RANGE_REF) / meterRangeFullScale(settings.voltRangeIdx);
+
+  // Messwerte in A bzw. V für Auto-Ranging und Statistik
+  uint32_t now = millis();
+  float amps_value = level_fs_amps * meterRangeFullScale(settings.ampRangeIdx);
+  float volts_value = level_fs_volts * meterRangeFullScale(settings.voltRangeIdx);
+  portENTER_CRITICAL(&statsMux); // /stats copies them in the web server task
+  if (!adc1_ovld)
+    statsAmps.add(amps_value, now); // übersteuerte Werte verfälschen die Statistik
+  if (!adc2_ovld)
+    statsVolts.add(volts_value, now);
+  portEXIT_CRITICAL(&statsMux);
+
+  if (settings.autoRangeOn) {
+    // Auto-Ranging, Level danach im neuen Bereich
+    if (ampRanger.update(amps_value, adc1_ovld, now)) {
+      changeMeasurementRange(amps, ampRanger.getRangeIdx());
+      level_fs_amps = amps_value / meterRangeFullScale(settings.ampRangeIdx);
+    }
+    if (voltRanger.update(volts_value, adc2_ovld, now)) {
+      changeMeasurementRange(volts, voltRanger.getRangeIdx());
+      level_fs_volts = volts_value / meterRangeFullScale(settings.voltRangeIdx);
+    }
+  }
+  levelFsAmps = level_fs_amps;
+  levelFsVolts = level_fs_volts;
+  ovldAmps = adc1_ovld;
+  ovldVolts = adc2_ovld;
+  powerManager.noteLevels(level_fs_amps, level_fs_volts, now); // stable values lower the redraw rate
+}
+
+// Scope job: new sample of the roll mode trace, every SCOPETIMER_MS
+void scopeSample() {
+  if ((instrState != state_scope) || (scopeTrigger.mode != trig_roll)) return;
+  scrollingScope.newSample(levelFsAmps, 0); // Scope trace 0
+  scrollingScope.newSample(levelFsVolts, 1); // Scope trace 1
+  scrollingScope.grid(); // könnte vom Trace überschrieben worden sein
+  scrollingScope.trace(0);
+  scrollingScope.trace(1);
+}
+
+// Render job: update the main display based on the current state
+void renderPage() {
+  switch (instrState) {
+  case state_meter:
+    if (rangeChanged || measurementChanged)
+      enableStdControls(state_meterInit);
+    if (activeMeasurement == amps) {
+      analogMeter.setLevel(levelFsAmps);
     } else {
-      // Pegel von internem ADC lesen
-      adc1_raw = analogRead(DC_PIN_AMPS) + settings.adcRawOffsetAmps; // ADC-Wert A-Messung
-      if (settings.ampHiRangeOn) {
-        level_fs_amps = (float)(adc1_raw) * settings.adcScalings[settings.ampRangeIdx] / ADC_DIV_HIRANGE; // interner ADC, umrechnen auf Fullscale = 1.0
-        settings.ampRangeIdx = 3; // Hi Range
-      }
-      else {
-        level_fs_amps = (float)(adc1_raw) * settings.adcScalings[settings.ampRangeIdx] / ADC_DIV_LORANGE; // interner ADC, umrechnen auf Fullscale = 1.0
-        settings.ampRangeIdx = 2; // Default Range
-      }
-      adc1_ovld = (adc1_raw > ADC_OVERLOAD_DC); // ADC-Wert Overload-Grenze
+      analogMeter.setLevel(levelFsVolts);
     }
-    if (adc1_ovld)
-      adc1_raw = ADC_OVERLOAD_DC; // ADC-Wert Overload-Grenze
+    break;
+  case state_bg:
+    if (rangeChanged || measurementChanged)
+      enableStdControls(state_bgInit);
+    barGraphAmps.update(levelFsAmps, markerAmps);
+    barGraphVolts.update(levelFsVolts, markerVolts);
+    break;
+  case state_scope:
+    if (rangeChanged || measurementChanged)
+      enableStdControls(state_scopeInit);
+    // getriggerte Aufnahme mit TRIG_SAMPLE_MS, Anzeige wenn vollständig,
+    // Roll-Modus im Scope-Job
+    if ((scopeTrigger.mode != trig_roll) && scopeTrigger.captured())
+      showScopeCapture();
+    barGraphVert.update(levelFsAmps, markerAmps); // Update vertical bar graph for Amps
+    break;
+  case state_fft:
+    // Spektrum in dBFS des internen ADC, unabhängig vom Messbereich
+    if (measurementChanged)
+      enableStdControls(state_fftInit);
+    {
+      PROF_SCOPE(prof_fft);
+      const float *spectrum = spectrumSampler.getSpectrum(); // NULL bis Block voll
+      if (spectrum)
+        spectrumView.update(spectrum);
+    }
+    break;
+  case state_setup:
+    // handled by setup button actions
+    break;
+  default:
+    break;
+  }
 
-    adc2_raw = analogRead(DC_PIN_VOLTS) + settings.adcRawOffsetVolts; // ADC-Wert V-Messung
-    adc2_ovld = (adc2_raw > ADC_OVERLOAD_DC); // ADC-Wert Overload-Grenze
-    if (adc2_ovld)
-      adc2_raw = ADC_OVERLOAD_DC; // ADC-Wert Overload-Grenze
+  // update the numeric display range and color
+  if (measurementChanged) {
+    if (activeMeasurement == amps) {
+      analogMeter.setRangeIdxColor(settings.ampRangeIdx); // default red needle
+      numericDisplay.setRangeIdxColor(settings.voltRangeIdx, TFT_BLUE);
+    } else {
+      analogMeter.setRangeIdxColor(settings.voltRangeIdx);
+      numericDisplay.setRangeIdxColor(settings.ampRangeIdx, TFT_DARKGREEN);
+    }
+  }
+  // update display and redraw number if enabled
+  if (activeMeasurement == amps)
+    numericDisplay.setLevel(levelFsVolts);
+  else
+    numericDisplay.setLevel(levelFsAmps);
 
-    level_fs_volts = (float)(adc2_raw) * settings.adcScalings[settings.voltRangeIdx] / ADC_DIV_VOLT; // interner ADC, umrechnen auf Fullscale = 1.0
+  ovldLED.setState(ovldAmps, false); // disabled in setup page
+  #ifndef WIFI_ENABLED
+    statusLED.setState(false, false); // Set status LED to Off, not blinking
+  #endif
+
+  rangeChanged = false;
+  measurementChanged = false;
+}
+
+// Clock job: clock, statistics line and profiler HUD, every second
+void updateClock() {
+  if (getLocalTime(timeinfo, 0)) // valid after NTP sync started by config_time()
+    timeOK = wifi_connected();
+  {
+    PROF_SCOPE(prof_clock);
+    analogClock.update(timeinfo, false);
+  }
+  if (instrState == state_bg)
+    drawStatsReadout(); // Statistik der letzten STATS_WINDOW_BLOCKS Sekunden
+  #ifdef PROFILER
+    if (profiler.hud)
+      profDrawHUD(&tft); // Frame time overlay, top right corner
+  #endif
+}
 
-    int active_secondary_measurement = (active_measurement_e)((activeMeasurement + 1) % 2);
+// Power job: backlight and idle state, display jobs follow the state
+void updatePower(uint32_t now) {
+  powerManager.update(now);
+  scheduler.setMinShed(powerManager.idleShed());
+  bool visible = !powerManager.isBlank();
+  if (visible && !scheduler.isEnabled(job_render))
+    measurementChanged = true; // redraw numbers after wake
+  scheduler.setEnabled(job_render, visible, now);
+  scheduler.setEnabled(job_blink, visible, now);
+  // 200 Hz touch sampling only when active, touch job and interrupt wake from idle
+  scheduler.setEnabled(job_pen, powerManager.state() == power_active, now);
+}
 
+// Light sleep stops WiFi, Ticker callbacks and sampling timers
+bool lightSleepAllowed() {
+  #ifdef ENCODER_ENABLED
+    bool encoder = true; // polled by EncoderTicker
+  #else
+    bool encoder = false;
+  #endif
+  #ifdef WIFI_ENABLED
+    bool wifi = settings.wifiEnabled;
+  #else
+    bool wifi = false;
+  #endif
+  return !encoder && !wifi && !sdLogger.isRunning() && !scopeTrigger.isArmed() && !spectrumSampler.isRunning();
+}
 
-    // Update the main display based on the current state
-    switch (instrState) {
-    case state_meter:
-      if (rangeChanged || measurementChanged)
-        enableStdControls(state_meterInit);
-      if (activeMeasurement == amps) {
-        analogMeter.setLevel(level_fs_amps);
-      } else {
-        analogMeter.setLevel(level_fs_volts);
-      }
+void loop() {
+
+  #ifdef WIFI_ENABLED
+    wifiManager.update(); // WiFi connection state machine, never blocks
+  #endif
+
+  handleUiCommands(); // requests of web server, drawing only in this task
+
+  // geänderte Einstellungen verzögert speichern, siehe saveCredentials()
+  settingsStore.update(millis());
+
+  // one due job per pass, most important first, see jobScheduler.h
+  uint32_t now = millis();
+  int job = scheduler.next(now);
+  if (job < 0) {
+    // nothing due: CPU halted or light sleep until next release, touch wakes earlier
+    powerManager.idle(scheduler.msUntilNext(now, POWER_MAX_IDLE_MS), lightSleepAllowed());
+    if (powerManager.takeTouchIrq())
+      scheduler.trigger(job_touch, millis());
+    return;
+  }
+  uint32_t start_us = micros();
+  {
+    PROF_SCOPE(prof_frame);
+    switch (job) {
+    case job_acquire:
+      acquireLevels();
       break;
-    case state_bg:
-      if (rangeChanged || measurementChanged)
-        enableStdControls(state_bgInit);
-      barGraphAmps.update(level_fs_amps, markerAmps);
-      barGraphVolts.update(level_fs_volts, markerVolts);
+    case job_touch:
+      handleGUI(); // Handle GUI events and button presses
       break;
-    case state_scope:
-      if (rangeChanged || measurementChanged)
-        enableStdControls(state_scopeInit);
-      // Scope-Messwerte updaten, Trace zeichnen, Overload/Saved-LED anzeigen
-      if (scope_tick) {
-        // neuen Scope-Messwert eintragen
-        scope_tick = 0;
-        scrollingScope.newSample(level_fs_amps, 0); // Scope trace 0
-        scrollingScope.newSample(level_fs_volts, 1); // Scope trace 1
-        scrollingScope.grid(); // könnte vom Trace überschrieben worden sein
-        scrollingScope.trace(0);
-        scrollingScope.trace(1);
-      }
-      barGraphVert.update(level_fs_amps, markerAmps); // Update vertical bar graph for Amps
+    case job_scope:
+      scopeSample();
+      break;
+    case job_render:
+      renderPage();
       break;
-    case state_setup:
-      // handled by setup button actions
+    case job_blink:
+      handleGuiUpdates(); // blinking LEDs
+      break;
+    case job_clock:
+      updateClock();
+      break;
+    case job_power:
+      updatePower(now);
+      break;
+    case job_pen:
+      // sample for median and IIR, buttons are evaluated by touch job, gestures at once
+      gestures.update(touchProvider.checkTouch(), touchProvider.tx, touchProvider.ty, now);
       break;
     default:
       break;
     }
-
-    // update the numeric display range and color
-    if (measurementChanged) {
-      if (activeMeasurement == amps) {
-        analogMeter.setRangeIdxColor(settings.ampRangeIdx); // default red needle
-        numericDisplay.setRangeIdxColor(settings.voltRangeIdx, TFT_BLUE);
-      } else {
-        analogMeter.setRangeIdxColor(settings.voltRangeIdx);
-        numericDisplay.setRangeIdxColor(settings.ampRangeIdx, TFT_DARKGREEN);
-      }
-    }
-    // update display and redraw number if enabled
-    if (activeMeasurement == amps)
-      numericDisplay.setLevel(level_fs_volts);
-    else
-      numericDisplay.setLevel(level_fs_amps);
-
-    ovldLED.setState(adc1_ovld, false); // disabled in setup page
-    #ifdef WIFI_ENABLED
-      statusLED.setState(wifi_connected(), true); // Set status LED to On, blinking
-    #else
-      statusLED.setState(false, false); // Set status LED to Off, not blinking
-    #endif
-
-    rangeChanged = false;
-    measurementChanged = false;
   }
+  scheduler.done(job, now, micros() - start_us);
 }
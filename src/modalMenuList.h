@@ -19,6 +19,15 @@
 // Modal List Select Box for menus, directories, WIFI networks etc.
 // If ENCODER_ENABLED is set, it uses the rotary encoder (param encdelta) for navigation
 // encdelta should be NULL when ENCODER_ENABLED is not set
+//
+// The list is virtualized: entries are pulled by index from a callback, so
+// the number of entries is not limited by an array. Only visible rows are
+// drawn. The list scrolls by pixels, by touch drag with kinetic coasting
+// after release, or by encoder. With LISTBOX_BLIT_SCROLL, the visible rows
+// are moved by reading back and rewriting the display (only defined with a
+// TFT_MISO pin, as on CYD) and only the newly exposed rows are rendered;
+// without it, all visible rows are redrawn on every scroll step.
+// The blit buffer comes from the GUI arena, see guiArena.h.
 
 #include <Arduino.h>
 #include <TFT_eSPI.h>
@@ -26,6 +35,8 @@
 #include "guiObject.h" // Common GUI object for all widgets
 #include "Free_Fonts.h" // Include large fonts
 #include "buttons.h"
+#include "tftDma.h"
+#include "guiArena.h"
 
 // TODO: make these constants settable
 #define LISTBOX_X (DISPLAY_W/8) // List Box X position, centered
@@ -38,9 +49,21 @@
 #define LISTFIELD_LEFT (LISTBOX_X + LISTBOX_PADDING) // linke X-Koordinate
 #define LISTFIELD_TOP_OFFS (LISTFIELD_H + 8) // obere Y-Koordinate Listenfelder
 
+#if defined(TFT_MISO) && (TFT_MISO >= 0)
+  #define LISTBOX_BLIT_SCROLL   // sichtbare Zeilen per readRect/pushRect verschieben, braucht TFT_MISO
+#endif
+#define LISTBOX_BLIT_ROWS 8     // Zeilen pro readRect()
+#define LISTBOX_DRAG_PX 6       // Mindestweg, ab dem ein Touch als Ziehen gilt
+#define LISTBOX_FRICTION 0.85f  // Abbremsung pro Frame beim Ausrollen
+#define LISTBOX_FRAME_MS 20
+
 #define SMALLBUTTON_W 50
 #define SMALLBUTTON_H 18
 
+// Callback delivering the text of entry idx, ctx as passed to select().
+// The returned string must stay valid until the next call.
+typedef const char *(*menuItemFn_t)(int idx, void *ctx);
+
 // ##############################################################################
 //
 //  ##     ## ######## ##    ## ##     ##
@@ -64,89 +87,108 @@ ModalMenu(TFT_eSPI *tft, TouchProvider *touchProvider)
 	: _tft(tft), _touchProvider(touchProvider), _x1(0), _y1(0),
     btnCancel(_tft, _touchProvider) {}
 
+	// Select from a prefilled array of entry_count entries, returns index or -1 if cancelled
+	int select(menuArr_t array, int entry_count, const char *message1) {
+		return select(_arrayItem, entry_count, message1, array);
+	}
+
 	// Draw a modal menu with a message and selectable entries
-	// message1 is the main message, message2 is an optional secondary message
-	// This function displays a list of entries in a modal dialog and allows the user to select an entry
-	// The entries are passed in the array parameter, and the number of entries is specified by entry_count
-	int select(menuArr_t array, int entry_count, String message1) {
-		// bietet vorbefüllte Liste zur Auswahl an, z.B. Directory
-		// liefert Eintrag zurück oder -1, wenn CANCEL gewählt wurde
-		//setSetupBtnsActive(false, (instrState == state_menu));
-		strcpy(array[entry_count], "CANCEL"); // immer letzter Eintrag
-		int selected_line = 0;
-		int start_line = 0;
-		int linecount = entry_count + 1; // inkl. CANCEL
+	// message1 is the main message
+	// Entries 0..entry_count-1 are fetched by item(idx, ctx) when they become visible,
+	// a CANCEL entry is appended. Returns the selected entry or -1 if CANCEL was chosen
+	int select(menuItemFn_t item, int entry_count, const char *message1, void *ctx = NULL) {
+		_item = item;
+		_ctx = ctx;
+		_entryCount = entry_count;
+		int total = entry_count + 1; // inkl. CANCEL
+		int linecount = total;
 		if (linecount > LISTBOX_MAXLINES)
 			linecount = LISTBOX_MAXLINES;
-		int selected_item = 0;
 
-		tft.setTextFont(2);
-		tft.setTextColor(TFT_WHITE, TFT_MEDGREY);
-		tft.setTextDatum(TL_DATUM); // top left text datum
+		_tft->setTextFont(2);
+		_tft->setTextColor(TFT_WHITE, TFT_MEDGREY);
+		_tft->setTextDatum(TL_DATUM); // top left text datum
 		int listbox_height = LISTFIELD_H * (linecount + 2); // total height of the list box
-    int listbox_y = DISPLAY_H / 2 - listbox_height / 2; // center the list box vertically
-		int listfield_top = listbox_y + LISTFIELD_TOP_OFFS; // top position of the list box
-		int listfield_bottom = listfield_top + (linecount * LISTFIELD_H); // bottom position of the list box
-    tft.fillRect(LISTBOX_X + 1, listbox_y, LISTBOX_W - 2, listbox_height - 2, TFT_MEDGREY);
-		tft.drawRect(LISTBOX_X, listbox_y, LISTBOX_W, listbox_height, TFT_WHITE);
-		tft.drawString(message1, LISTFIELD_LEFT + 2, listbox_y + 6, 2);
+		int listbox_y = DISPLAY_H / 2 - listbox_height / 2; // center the list box vertically
+		_top = listbox_y + LISTFIELD_TOP_OFFS; // top position of the list box
+		_visibleH = linecount * LISTFIELD_H;
+		_maxScroll = total * LISTFIELD_H - _visibleH;
+		_scroll = 0;
+		_selected = 0;
+		_tft->fillRect(LISTBOX_X + 1, listbox_y, LISTBOX_W - 2, listbox_height - 2, TFT_MEDGREY);
+		_tft->drawRect(LISTBOX_X, listbox_y, LISTBOX_W, listbox_height, TFT_WHITE);
+		_tft->drawString(message1, LISTFIELD_LEFT + 2, listbox_y + 6, 2);
 		bool cancelled = false;
 		btnCancel.init(LISTFIELD_LEFT + LISTFIELD_W - SMALLBUTTON_W, listbox_y + 5, SMALLBUTTON_W, SMALLBUTTON_H, TFT_WHITE, TFT_RED, TFT_BLACK, 1, 1);
 		btnCancel.setLabel("CANCEL");
 		btnCancel.setActive(true, true);
 
 		spkrBeep(50);
-		_drawModalListEntries(array, start_line, selected_line, linecount, listfield_top);
-		int last_selected_line = selected_line;
+		_drawRows(0, _visibleH + 1);
+		_drawScrollBar();
+		bool tracking = false, dragged = false;
+		int start_y = 0, last_y = 0;
+		float velocity = 0; // px per frame, kinetic scrolling after release
 		while (true) {
 			if (btnCancel.checkPressed(true)) { // Check if CANCEL button is pressed
 				cancelled = true;
 				break;
 			}
 			#ifdef ENCODER_ENABLED
-        int enc_delta = _touchProvider->getEncDelta(true);
+				int enc_delta = _touchProvider->getEncDelta(true);
 				if (enc_delta != 0) {
 					spkrTick();
-					if (((selected_line + start_line) < entry_count) || (enc_delta < 0))
-						selected_line += enc_delta;
-					if (selected_line < 0) {
-						selected_line = 0;
-						if (start_line > 0) {
-							start_line--;
-							// Repaint when scrolling up
-							_drawModalListEntries(array, start_line, selected_line, linecount, listfield_top);
-						}
-					} else if (selected_line >= LISTBOX_MAXLINES) {
-						// End of displayed list range reached?
-						selected_line = LISTBOX_MAXLINES - 1;
-						start_line++;
-						// Repaint when scrolling down
-						_drawModalListEntries(array, start_line, selected_line, linecount, listfield_top);
-					} else {
-						// Repaint just the changed lines
-						_drawModalListLine(array[start_line + last_selected_line], false, last_selected_line, listfield_top);
-						_drawModalListLine(array[start_line + selected_line], true, selected_line, listfield_top);
-					}
-					last_selected_line = selected_line;
+					velocity = 0;
+					_select(constrain(_selected + enc_delta, 0, total - 1));
 				}
 				if (!digitalRead(ENCBTN_PIN))
 					break;
 			#endif // ENCODER_ENABLED
-			if (_touchProvider->checkWithin(LISTFIELD_LEFT, listfield_top, LISTFIELD_LEFT + LISTFIELD_W, listfield_bottom)) {
-				selected_line = (_touchProvider->ty - listfield_top) / LISTFIELD_H;
-				if (selected_line < linecount)
-					break;
+			bool touched = _touchProvider->checkTouch();
+			if (touched && (tracking || _touchProvider->isPressedWithin(LISTFIELD_LEFT, _top, LISTFIELD_LEFT + LISTFIELD_W, _top + _visibleH))) {
+				int ty = _touchProvider->ty;
+				if (!tracking) {
+					// touch down, stop coasting
+					tracking = true;
+					dragged = false;
+					start_y = ty;
+					velocity = 0;
+				} else {
+					if (abs(ty - start_y) > LISTBOX_DRAG_PX)
+						dragged = true;
+					if (dragged) {
+						int dy = last_y - ty; // finger up = content up = scroll increases
+						_scrollTo(_scroll + dy);
+						velocity = velocity * 0.5f + dy * 0.5f;
+					}
+				}
+				last_y = ty;
+			} else if (tracking) {
+				// released: tap selects, drag continues with its velocity
+				tracking = false;
+				if (!dragged) {
+					int idx = (last_y - _top + _scroll) / LISTFIELD_H;
+					if ((idx >= 0) && (idx < total)) {
+						_selected = idx;
+						break;
+					}
+				}
+			} else if (fabsf(velocity) >= 1.0f) {
+				int old_scroll = _scroll;
+				_scrollTo(_scroll + (int)velocity);
+				velocity = (_scroll == old_scroll) ? 0 : velocity * LISTBOX_FRICTION;
 			}
-			delay(20);
+			delay(LISTBOX_FRAME_MS);
 		}
 		if (cancelled)
-		  spkrCancelBeep();
+			spkrCancelBeep();
 		else
 			spkrClick(); // Play a click sound when an item is selected
-		selected_item = selected_line + start_line;
-		_drawModalListEntries(array, start_line, selected_line, linecount, listfield_top);
+		int selected_item = _selected;
+		_ensureVisible(selected_item);
+		_drawRows(0, _visibleH + 1); // show selection
 		delay(200);
-		tft.fillRect(LISTBOX_X, listbox_y, LISTBOX_W, listbox_height, TFT_MEDGREY);
+		tftDma.fillRect(LISTBOX_X, listbox_y, LISTBOX_W, listbox_height, TFT_MEDGREY);
 		#ifdef DEBUG
 			DEBUG_PRINT("Item Selected: ");
 			if (selected_item == entry_count || cancelled)
@@ -170,34 +212,123 @@ private:
   int16_t  _x2, _y2;              // Coordinates of bottom-right corner of dialog box
   PushButton btnCancel;
 	volatile int _encdelta; // Current state of the button
+	menuItemFn_t _item = NULL;
+	void *_ctx = NULL;
+	int _entryCount = 0;
+	int _top = 0;        // screen y of list area
+	int _visibleH = 0;   // height of list area
+	int _scroll = 0;     // content offset in pixels, 0.._maxScroll
+	int _maxScroll = 0;
+	int _selected = 0;   // highlighted entry
+
+	static const char *_arrayItem(int idx, void *ctx) {
+		return ((char (*)[32])ctx)[idx];
+	}
 
-	// Draws a single line in the modal list
-	void _drawModalListLine(char *text, bool is_active, int line, int top) {
+	const char *_text(int idx) {
+		return (idx >= _entryCount) ? "CANCEL" : _item(idx, _ctx);
+	}
+
+	// Draws entry idx at its scroll position, caller clips to list area
+	void _drawModalListLine(int idx) {
+		const char *text = _text(idx);
+		bool is_active = (idx == _selected);
 		uint16_t line_color = TFT_WHITE;
-		top += line * LISTFIELD_H;
-		if ((strcmp(text, "CANCEL")) == 0)
+		int top = _top + idx * LISTFIELD_H - _scroll;
+		if (idx >= _entryCount)
 			line_color = TFT_RED; // CANCEL line
 		if (is_active) {
-			tft.fillRect(LISTFIELD_LEFT + 1, top + 1, LISTFIELD_W - 2, LISTFIELD_H - 1, line_color);
-			tft.setTextColor(TFT_BLACK, line_color);
+			_tft->fillRect(LISTFIELD_LEFT + 1, top + 1, LISTFIELD_W - 2, LISTFIELD_H - 1, line_color);
+			_tft->setTextColor(TFT_BLACK, line_color);
 		} else {
-			tft.fillRect(LISTFIELD_LEFT + 1, top + 1, LISTFIELD_W - 2, LISTFIELD_H - 1, TFT_BLACK);
-			tft.setTextColor(line_color, TFT_BLACK);
+			_tft->fillRect(LISTFIELD_LEFT + 1, top + 1, LISTFIELD_W - 2, LISTFIELD_H - 1, TFT_BLACK);
+			_tft->setTextColor(line_color, TFT_BLACK);
 		}
-		tft.drawString(text, LISTFIELD_LEFT + 5, top + 2, 2);
-		tft.drawRect(LISTFIELD_LEFT, top, LISTFIELD_W, LISTFIELD_H + 1, TFT_WHITE);
+		_tft->drawString(text, LISTFIELD_LEFT + 5, top + 2, 2);
+		_tft->drawRect(LISTFIELD_LEFT, top, LISTFIELD_W, LISTFIELD_H + 1, TFT_WHITE);
+	}
+
+	// Draws all entries overlapping rows y0..y1-1 of the list area, clipped to these rows
+	void _drawRows(int y0, int y1) {
+		if (y0 < 0) y0 = 0;
+		if (y1 > _visibleH + 1) y1 = _visibleH + 1;
+		if (y1 <= y0) return;
+		_tft->setViewport(LISTFIELD_LEFT, _top + y0, LISTFIELD_W, y1 - y0, false); // clip only
+		_tft->setTextDatum(TL_DATUM); // top left text datum
+		int first = (_scroll + y0 - 1) / LISTFIELD_H; // -1: bottom border belongs to line above
+		if (first < 0) first = 0;
+		for (int idx = first; (idx <= _entryCount) && (idx * LISTFIELD_H - _scroll < y1 - 1); idx++) // top border is bottom border of line above
+			_drawModalListLine(idx);
+		_tft->resetViewport();
+	}
+
+	// Scroll list content to offset, only newly exposed rows are drawn
+	void _scrollTo(int scroll) {
+		scroll = constrain(scroll, 0, _maxScroll);
+		int d = scroll - _scroll;
+		if (d == 0) return;
+		#ifdef LISTBOX_BLIT_SCROLL
+			if ((abs(d) < _visibleH) && _blit(d)) {
+				_scroll = scroll;
+				if (d > 0)
+					_drawRows(_visibleH - d, _visibleH + 1); // exposed at bottom
+				else
+					_drawRows(0, -d + 1); // exposed at top
+				_drawScrollBar();
+				return;
+			}
+		#endif
+		_scroll = scroll;
+		_drawRows(0, _visibleH + 1);
+		_drawScrollBar();
 	}
 
-	// Draws a list of entries in a modal dialog
-	// The entries are drawn in a list format with a specified start entry and active line
-	// startentry is the index of the first entry to display, active_line is the index of the currently selected line
-	// count is the number of lines to display
-	// The function fills the background of each line with a color based on whether it is active or not
-	void _drawModalListEntries(menuArr_t array, int startentry, int active_line, int count, int top) {
-		tft.setTextDatum(TL_DATUM); // top left text datum
-		for (int i = 0; i < count; i++) {
-			_drawModalListLine(array[startentry + i], (i == active_line), i, top);
+	#ifdef LISTBOX_BLIT_SCROLL
+	// Move rows of the list area by d pixels up (d > 0) or down (d < 0),
+	// false if there is no buffer, then the caller redraws all rows
+	bool _blit(int d) {
+		GuiArenaScope arena_scope; // buffer freed on return
+		uint16_t *buf = (uint16_t *)guiArena.alloc(LISTFIELD_W * LISTBOX_BLIT_ROWS * sizeof(uint16_t), gui_mem_large);
+		if (!buf) return false;
+		int h = _visibleH - abs(d); // rows to move
+		for (int done = 0; done < h; done += LISTBOX_BLIT_ROWS) {
+			int rows = min(LISTBOX_BLIT_ROWS, h - done);
+			// moving up: copy from top, moving down: copy from bottom, source is never overwritten before read
+			int dst = (d > 0) ? _top + done : _top + _visibleH - done - rows;
+			_tft->readRect(LISTFIELD_LEFT, dst + d, LISTFIELD_W, rows, buf);
+			_tft->pushRect(LISTFIELD_LEFT, dst, LISTFIELD_W, rows, buf);
 		}
+		return true;
+	}
+	#endif
+
+	// Scroll minimal distance so entry idx is fully visible
+	void _ensureVisible(int idx) {
+		int y = idx * LISTFIELD_H;
+		if (y < _scroll)
+			_scrollTo(y);
+		else if (y + LISTFIELD_H > _scroll + _visibleH)
+			_scrollTo(y + LISTFIELD_H - _visibleH);
+	}
+
+	// Move highlight to entry idx, e.g. by encoder
+	void _select(int idx) {
+		int old = _selected;
+		_selected = idx;
+		_drawRows(old * LISTFIELD_H - _scroll, (old + 1) * LISTFIELD_H - _scroll + 1);
+		_ensureVisible(idx);
+		_drawRows(idx * LISTFIELD_H - _scroll, (idx + 1) * LISTFIELD_H - _scroll + 1);
+	}
+
+	// Thin position indicator right of the list, only if the list scrolls
+	void _drawScrollBar() {
+		if (_maxScroll <= 0) return;
+		int x = LISTFIELD_LEFT + LISTFIELD_W + 3;
+		int total_h = _visibleH + _maxScroll;
+		int bar_h = max(8, _visibleH * _visibleH / total_h);
+		int bar_y = _top + (_visibleH - bar_h) * _scroll / _maxScroll;
+		_tft->fillRect(x, _top, 3, _visibleH, TFT_MEDGREY);
+		_tft->fillRect(x, bar_y, 3, bar_h, TFT_WHITE);
 	}
 
 };
@@ -65,9 +65,20 @@ public:
   void setRangeIdxColor(int range_idx, uint16_t color = TFT_BLACK) {
     _textcolor = color;
     _range_idx = range_idx;
-    _maxVal = meterScaleMaxVal[range_idx];
-    _valdecimals = meterValDecimals[range_idx];
-    setLevel(0.0f, true); // Reset level and redraw
+    _maxVal = meterRanges[range_idx].maxVal;
+    _valdecimals = meterRanges[range_idx].valDecimals;
+    setLevel(_levelIntegrator, true); // keep level, e.g. rescaled by rescaleLevel(), and redraw
+  }
+
+  // Rescale level integrator on range change, factor = old full scale / new full scale.
+  // Call before setRangeIdxColor().
+  void rescaleLevel(float factor) {
+    _levelIntegrator *= factor;
+  }
+
+  // Clear level integrator without drawing, for reproducible screen captures
+  void resetLevel() {
+    _levelIntegrator = 0.0f;
   }
 
   // Update the numeric display with a new level
@@ -93,12 +104,12 @@ public:
       if (_draw_units) {
         _tft->setTextDatum(TR_DATUM);
         _tft->setTextColor(my_textcolor, my_fillcolor);
-        _tft->drawString(meterScaleUnits[_range_idx], _x + _w - 10, _y + 8);
+        _tft->drawString(meterRanges[_range_idx].unit, _x + _w - 10, _y + 8);
         _tft->setTextDatum(TL_DATUM);
       }
     }
     // _tft->setTextFont(7); // Seven-segment font
-    int str_len = strlen(meterScaleUnits[_range_idx]); // get number of chars to display
+    int str_len = strlen(meterRanges[_range_idx].unit); // get number of chars to display
     float last_level = _levelIntegrator;
     _levelIntegrator = level * LVLINTEGRATOR + _levelIntegrator * (1 - LVLINTEGRATOR);
     if (full_redraw || (_levelIntegrator > last_level + 0.001) || (_levelIntegrator < last_level - 0.001))    {
@@ -60,6 +60,9 @@
 #include "meterScaleDefaults.h"
 #include "encoderEntry.h" // Include encoder entry widget for numeric input with encoder
 #include "clock.h"
+#include "imageBlit.h"
+#include "spectrumAnalyzer.h"
+#include "gestures.h"
 
 
 #define BUTTON_W 70
@@ -90,11 +93,6 @@ PushButton dirBtn  = PushButton(&tft, &touchProvider);          // Directory But
 PushButton touchCalBtn  = PushButton(&tft, &touchProvider);     // Touch Calibration Button
 PushButton scanWifiBtn  = PushButton(&tft, &touchProvider);     // Scan WiFi Button
 PushButton startWPSBtn  = PushButton(&tft, &touchProvider);     // Start WPS Button
-#ifndef ENCODER_ENABLED
-  // invisible buttons
-  PushButton leftWipeBtn  = PushButton(&tft, &touchProvider);     // Left Wipe Button
-  PushButton rightWipeBtn  = PushButton(&tft, &touchProvider);    // Right Wipe Button
-#endif
 LedIndicator statusLED = LedIndicator(&tft, &touchProvider);    // LED toggle widget
 LedIndicator ovldLED = LedIndicator(&tft, &touchProvider);      // LED toggle widget
 
@@ -108,7 +106,7 @@ RadioButtons radioButtons = RadioButtons(&tft, &touchProvider); // A Radio butto
 labelArray_t  radioLabels = {"Beep 1", "Test 2", "Radio 3", "Radio 4", "Radio 5"}; // up to 10 radio buttons
 
 CheckboxGroup optionCheckboxGroup = CheckboxGroup(&tft, &touchProvider);
-labelArray_t  checkLabels = {"Option 1", "FCK TRMP", "Another Option", "Always bother me", "This is no option"}; // up to 10 checkbox buttons
+labelArray_t  checkLabels = {"Auto Range", "FCK TRMP", "Another Option", "Always bother me", "This is no option"}; // up to 10 checkbox buttons
 
 BottomTabs setupTabs = BottomTabs(&tft, &touchProvider);
 labelArray_t  tabLabels = {"Setup", "WiFi", "Test", "Dummy"}; // Some tab labels for the setup page tabs, up to 10 tabs
@@ -133,9 +131,6 @@ AnalogClock analogClock = AnalogClock(&tft, &touchProvider);
 // Objects are handled in this order in the GUI "checkPressed()" main loop
 GUIObject *guiObjects[] = {
   &setupBtn, &statusLED, &ovldLED, &switchRange, &numericDisplay,
-  #ifndef ENCODER_ENABLED
-    &leftWipeBtn, &rightWipeBtn,
-  #endif
   // setupTabs will erase area on redraw, so all buttons on tabs must follow after it
   &setupTabs, &offsetBtn, &saveBtn, &exitBtn,
   &enaBeepCheckbox, &touchCalBtn, &dirBtn, &radioButtons,
@@ -178,12 +173,27 @@ const int guiUpdateObjectsCount = sizeof(guiUpdateObjects) / sizeof(guiUpdateObj
 // Complex objects, not inherited from GUIobject
 AnalogMeter analogMeter = AnalogMeter(&tft); // Initialize analog meter with TFT_eSPI object
 ScrollingScope scrollingScope = ScrollingScope(&tft); // Initialize scrolling scope with TFT_eSPI object
+SpectrumView spectrumView = SpectrumView(&tft);
+SpectrumSampler spectrumSampler; // ADC block sampling, runs only while spectrum page is open
 
 // use touchProvider, to disable touch events remove "&touchProvider" overload on bargraphs
 HorizontalBargraph barGraphAmps = HorizontalBargraph(&tft, &touchProvider); // Initialize horizontal bar graph with TFT_eSPI object
 HorizontalBargraph barGraphVolts = HorizontalBargraph(&tft, &touchProvider); // Initialize horizontal bar graph with TFT_eSPI object
 VerticalBargraph barGraphVert = VerticalBargraph(&tft, &touchProvider); // Initialize vertical bar graph with TFT_eSPI object
 
+// Swipes, taps and long press on the measurement pages, fed by handleGUI() and the pen job
+GestureRecognizer gestures;
+int gesturePageSwipe = -1;  // subscription ids, set in initControls()
+int gestureScopePlot = -1;
+
+#ifdef PROFILER
+  // Widget benchmark with own widget instances, started by web server, run in loop()
+  #include "widgetBench.h"
+  WidgetBench widgetBench = WidgetBench(&tft, &touchProvider);
+  // Golden image check of pages and widgets, see screenCapture.h
+  ScreenCapture screenCapture = ScreenCapture(&tft, &SD, &spiArbiter);
+#endif
+
 
 int setupTabIndex = 0;
 int oldRangeIdx = -1;
@@ -202,77 +212,87 @@ int oldRangeIdx = -1;
 
 // Show Bitmap File
 
-// These read 16- and 32-bit types from the SD card file.
-// BMP data is stored little-endian, Arduino is little-endian too.
-// May need to reverse subscript order if porting elsewhere.
-
-uint16_t read16(fs::File &f) {
-  uint16_t result;
-  ((uint8_t *)&result)[0] = f.read(); // LSB
-  ((uint8_t *)&result)[1] = f.read(); // MSB
-  return result;
-}
-
-uint32_t read32(fs::File &f) {
-  uint32_t result;
-  ((uint8_t *)&result)[0] = f.read(); // LSB
-  ((uint8_t *)&result)[1] = f.read();
-  ((uint8_t *)&result)[2] = f.read();
-  ((uint8_t *)&result)[3] = f.read(); // MSB
-  return result;
-}
-
-// Draw a BMP file from the SPIFFS file system to the TFT display
-void drawBmp(const char *filename, int16_t x, int16_t y) {
-  if ((x >= DISPLAY_W) || (y >= DISPLAY_H)) return;
-  fs::File bmpFS;
-  // Open requested file on SD card
-  bmpFS = SPIFFS.open(filename, "r");
-  if (!bmpFS) {
-    DEBUG_PRINTLN("File not found");
-    return;
-  }
-  uint32_t seekOffset;
-  uint16_t w, h, row, col;
-  uint8_t  r, g, b;
-  uint32_t startTime = millis();
-  if (read16(bmpFS) == 0x4D42) {
-    read32(bmpFS);
-    read32(bmpFS);
-    seekOffset = read32(bmpFS);
-    read32(bmpFS);
-    w = read32(bmpFS);
-    h = read32(bmpFS);
-
-    if ((read16(bmpFS) == 1) && (read16(bmpFS) == 24) && (read32(bmpFS) == 0)) {
-      y += h - 1;
-      bool oldSwapBytes = tft.getSwapBytes();
-      tft.setSwapBytes(true);
-      bmpFS.seek(seekOffset);
-      uint16_t padding = (4 - ((w * 3) & 3)) & 3;
-      uint8_t lineBuffer[w * 3 + padding];
-      for (row = 0; row < h; row++) {
-        bmpFS.read(lineBuffer, sizeof(lineBuffer));
-        uint8_t*  bptr = lineBuffer;
-        uint16_t* tptr = (uint16_t*)lineBuffer;
-        // Convert 24 to 16-bit colours
-        for (uint16_t col = 0; col < w; col++) {
-          b = *bptr++;
-          g = *bptr++;
-          r = *bptr++;
-          *tptr++ = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-        }
-        // Push the pixel row to screen, pushImage will crop the line if needed
-        // y is decremented as the BMP image is drawn bottom up
-        tft.pushImage(x, y--, w, 1, (uint16_t*)lineBuffer);
-      }
-      tft.setSwapBytes(oldSwapBytes);
-      DEBUG_PRINT("Loaded in "); DEBUG_PRINT(millis() - startTime);
-      DEBUG_PRINTLN(" ms");
-    }
-    else DEBUG_PRINTLN("BMP format not recognized.");
-  }
-  bmpFS.close();
+// Chunked BMP/RGB565 raw loader, see imageBlit.h
+ImageBlitter imageBlitter = ImageBlitter(&tft);
+
+// Draw a 24 bit BMP or RGB565 raw file from the SPIFFS file system to the TFT display
+// Returns false if file not found or format not supported
+bool drawBmp(const char *filename, int16_t x, int16_t y) {
+  return imageBlitter.draw(SPIFFS, filename, x, y);
+}
+
+// ##############################################################################
+//
+//  ##     ## ######## ##     ##
+//  ###   ### ##       ###   ###
+//  #### #### ##       #### ####
+//  ## ### ## ######   ## ### ##
+//  ##     ## ##       ##     ##
+//  ##     ## ##       ##     ##
+//  ##     ## ######## ##     ##
+//
+// ##############################################################################
+
+// Memory budget of static objects. Every global widget and large object is
+// listed here once; the sum is checked against GUI_STATIC_BUDGET at compile
+// time, so a new page with too many or too large widgets fails to build.
+// Buffers allocated at runtime belong to the GUI arena, see guiArena.h.
+// Report as JSON on Serial at boot and on the /mem route of the web server.
+
+#define GUI_STATIC_BUDGET (56 * 1024) // statische Objekte in internem RAM
+
+#define GUI_STATIC_LIST(X) \
+  X(tft) X(touchProvider) X(spiArbiter) X(sdLogger) X(settingsStore) \
+  X(ampRanger) X(voltRanger) X(statsAmps) X(statsVolts) X(scopeTrigger) X(guiArena) \
+  X(switchRange) X(offsetBtn) X(setupBtn) X(saveBtn) X(exitBtn) X(dirBtn) \
+  X(touchCalBtn) X(scanWifiBtn) X(startWPSBtn) X(gestures) \
+  X(statusLED) X(ovldLED) X(enaBeepCheckbox) X(wifiEnaCheckbox) X(wifiAPCheckbox) \
+  X(numericDisplay) X(radioButtons) X(optionCheckboxGroup) X(setupTabs) \
+  X(slider1) X(slider2) X(numericKeypad) X(dialogBox) X(modalMenu) \
+  X(encoderEntry) X(analogClock) X(analogMeter) X(scrollingScope) \
+  X(spectrumView) X(spectrumSampler) X(barGraphAmps) X(barGraphVolts) \
+  X(barGraphVert) X(imageBlitter)
+
+struct memObject_t {
+  const char *name;
+  size_t size;
+};
+
+#define MEM_OBJECT_ENTRY(obj) { #obj, sizeof(obj) },
+#define MEM_OBJECT_SIZE(obj) sizeof(obj) +
+
+const memObject_t memObjects[] = { GUI_STATIC_LIST(MEM_OBJECT_ENTRY) };
+const size_t memStaticTotal = GUI_STATIC_LIST(MEM_OBJECT_SIZE) 0;
+
+static_assert((GUI_STATIC_LIST(MEM_OBJECT_SIZE) 0) <= GUI_STATIC_BUDGET,
+  "static GUI objects exceed GUI_STATIC_BUDGET, see memBudgetReport()");
+
+#ifdef ARDUINO
+  // DRAM segments from the linker script
+  extern uint8_t _data_start, _data_end, _bss_start, _bss_end;
+#endif
+
+size_t memBudgetReport(char *buf, size_t size) {
+  size_t len = snprintf(buf, size, "{\"static\":{\"budget\":%u,\"total\":%u,\"objects\":[",
+    (unsigned)GUI_STATIC_BUDGET, (unsigned)memStaticTotal);
+  for (size_t i = 0; (i < sizeof(memObjects) / sizeof(memObjects[0])) && (len < size); i++)
+    len += snprintf(buf + len, size - len, "%s{\"name\":\"%s\",\"size\":%u}",
+      i ? "," : "", memObjects[i].name, (unsigned)memObjects[i].size);
+#ifdef ARDUINO
+  if (len < size)
+    len += snprintf(buf + len, size - len, "]},\"dram\":{\"data\":%u,\"bss\":%u},"
+      "\"heap\":{\"free\":%lu,\"min_free\":%lu,\"largest\":%lu},\"psram_free\":%lu,\"arena\":",
+      (unsigned)(&_data_end - &_data_start), (unsigned)(&_bss_end - &_bss_start),
+      (unsigned long)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+      (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+      (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL),
+      (unsigned long)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+#else
+  if (len < size) len += snprintf(buf + len, size - len, "]},\"arena\":");
+#endif
+  if (len < size) len += guiArena.report(buf + len, size - len);
+  if (len < size) len += snprintf(buf + len, size - len, "}\n");
+  return len;
 }
 
 // ##############################################################################
@@ -363,6 +383,7 @@ void disableAllControls() {
 void drawEnabledControls(bool active) {
   DEBUG_PRINT("Draw active controls, active = ");
   DEBUG_PRINTLN(active);
+  PROF_SCOPE(prof_redraw);
   for (int idx = 0; idx < guiObjectsCount; idx++) {
     guiObjects[idx]->redraw(active);
   }
@@ -394,11 +415,20 @@ void drawControlGroup(int32_t group_mask, bool active) {
 // ##############################################################################
 
 void initControls(); // forward declaration
+void drawStatsReadout();
+void armScopeTrigger();
 
 // Standard measurement pages
 // will enable and draw main page controls
 void enableStdControls(instrStates_e newState) {
   if (newState == state_invalid) return; // first valid state
+  spectrumSampler.stop(); // restarted below if spectrum page
+  TrigTicker.detach(); // restarted below if triggered scope
+  scopeTrigger.stop();
+  // scope job samples the roll mode trace
+  scheduler.setEnabled(job_scope, (newState == state_scopeInit) && (scopeTrigger.mode == trig_roll), millis());
+  gestures.setEnabled(gesturePageSwipe, true);
+  gestures.setEnabled(gestureScopePlot, newState == state_scopeInit);
   drawControlGroup(PAGE_MAIN, true); // draw group controls in active state
   // Set the range index to opposite measurement
   if (activeMeasurement == amps)
@@ -433,16 +463,32 @@ void enableStdControls(instrStates_e newState) {
       barGraphVolts.init(0, 100, MAINWINDOW_W, 55);
       barGraphVolts.setRangeIdxColor(settings.voltRangeIdx, TFT_BLUE, true);
       barGraphVolts.update(0, markerVolts, true);     // Draw scale and bar
+      drawStatsReadout();
       break;
     case state_scopeInit:
       // Initialize scope controls
       instrState = state_scope; // next state
       scrollingScope.init(5, 0, 240, MAINWINDOW_H);
+      if (scopeTrigger.mode == trig_roll)
+        scrollingScope.setTimeAxis(0, 0);
+      else
+        scrollingScope.setTimeAxis(TRIG_CAPTURE_LEN * TRIG_SAMPLE_MS, (TRIG_CAPTURE_LEN * scopeTrigger.prePct / 100) * TRIG_SAMPLE_MS);
       scrollingScope.newTrace(TFT_GREEN, settings.ampRangeIdx, 0, activeMeasurement == amps); // Init trace 0, Amps
       scrollingScope.newTrace(TFT_CYAN, settings.voltRangeIdx, 1, activeMeasurement == volts); // Init trace 1, Volts
       barGraphVert.init(250, 0, 70, MAINWINDOW_H);
       barGraphVert.setRangeIdxColor(settings.ampRangeIdx, TFT_GREEN, true);
       barGraphVert.update(0, markerAmps, true); // Redraw vertical bar graph for Amps
+      armScopeTrigger();
+      break;
+    case state_fftInit:
+      // Initialize spectrum of active measurement, internal ADC
+      instrState = state_fft; // next state
+      spectrumView.init(0, 0, MAINWINDOW_W, MAINWINDOW_H, spectrumSampler.binHz(), SPEC_FFT_SIZE / 2,
+        (activeMeasurement == amps) ? TFT_GREEN : TFT_CYAN);
+      if (!spectrumSampler.start((activeMeasurement == amps) ? DC_PIN_AMPS : DC_PIN_VOLTS)) {
+        tft.setTextColor(TFT_RED, TFT_BLACK);
+        tft.drawCentreString("Out of memory", MAINWINDOW_W / 2, MAINWINDOW_H / 2, 2);
+      }
       break;
     default:
       break;
@@ -486,14 +532,21 @@ void enablePageControls(instrStates_e newState) {
     case state_meterInit:
     case state_bgInit:
     case state_scopeInit:
+    case state_fftInit:
       // Initialize meter controls
       touchProvider.resetEncDelta();
-      tft.fillScreen(TFT_BLACK); // also clear screen on startup as instrState changes to state_meterInit
+      tftDma.fillScreen(TFT_BLACK); // also clear screen on startup as instrState changes to state_meterInit
       enableStdControls(newState); // will enable and draw main page controls
       break;
     case state_setupInit:
       // Initialize setup controls to last open tab
-      tft.fillScreen(TFT_BLACK);
+      spectrumSampler.stop();
+      TrigTicker.detach(); // no trigger sampling on the setup page
+      scopeTrigger.stop();
+      scheduler.setEnabled(job_scope, false, millis());
+      gestures.setEnabled(gesturePageSwipe, false);
+      gestures.setEnabled(gestureScopePlot, false);
+      tftDma.fillScreen(TFT_BLACK);
       setupTabIndex = 0;
       instrState = state_setup; // next state
       enableTabControls(setupTabIndex);
@@ -503,6 +556,128 @@ void enablePageControls(instrStates_e newState) {
   }
 }
 
+// One line of sliding window statistics below a horizontal bargraph
+void drawStatsLine(const ChannelStats &stats, int y, uint16_t color, const char *unit) {
+  StatsAccu w = stats.window();
+  TextBuf<64> line; // values with SI prefix and 4 significant digits
+  line.add("avg ").si(w.getMean()).add(" rms ").si(w.getRms()).add(" sd ").si(w.getStdDev())
+    .add(" min ").si(w.minVal).add(" max ").si(w.maxVal).add(' ').add(unit);
+  tft.setTextFont(1);
+  tft.setTextColor(color, TFT_BLACK);
+  tft.setTextDatum(TL_DATUM);
+  tft.setTextPadding(MAINWINDOW_W); // overwrite previous line
+  tft.drawString(line, 0, y);
+  tft.setTextPadding(0);
+}
+
+// Statistics readout of both channels on bargraph page, called every second
+void drawStatsReadout() {
+  if (!statsReadoutOn) return; // live values would differ in every golden image
+  drawStatsLine(statsAmps, 88, TFT_GREEN, "A");
+  drawStatsLine(statsVolts, 158, TFT_CYAN, "V");
+}
+
+// ##############################################################################
+
+// Triggered scope capture: start acquisition with TRIG_SAMPLE_MS. The trigger
+// level is the set point marker of the vertical bargraph, in full scale of
+// the source channel's range.
+void armScopeTrigger() {
+  static const char *mode_names[] = { "ROLL", "AUTO", "NORM", "SNGL" };
+  scrollingScope.status(mode_names[scopeTrigger.mode], TFT_YELLOW);
+  if (scopeTrigger.mode == trig_roll) return;
+  scopeTrigger.level = adcLevelToRaw((active_measurement_e)scopeTrigger.source, markerAmps);
+  if (scopeTrigger.length() != TRIG_CAPTURE_LEN)
+    scopeTrigger.setLength(TRIG_CAPTURE_LEN);
+  scopeTrigger.arm();
+  TrigTicker.attach_ms(TRIG_SAMPLE_MS, trig_tick_callback);
+}
+
+// Draw a complete capture and re-arm, in single mode the trace stays frozen
+void showScopeCapture() {
+  float levels[TRIG_MAX_LEN];
+  int n = scopeTrigger.length();
+  scrollingScope.clear();
+  for (int c = 0; c < TRIG_CHANNELS; c++) {
+    for (int i = 0; i < n; i++)
+      levels[i] = adcRawToLevel((active_measurement_e)c, scopeTrigger.sample(c, i));
+    scrollingScope.setTrace(c, levels, n);
+    scrollingScope.trace(c, false);
+  }
+  scrollingScope.triggerMarker((float)scopeTrigger.triggerPos() / (n - 1), markerAmps,
+    scopeTrigger.forced() ? TFT_DARKGREY : TFT_YELLOW);
+  if (scopeTrigger.mode == trig_single) {
+    TrigTicker.detach();
+    scopeTrigger.stop();
+    scrollingScope.status("STOP", TFT_RED);
+  } else {
+    scopeTrigger.arm(); // waits for holdoff
+  }
+}
+
+// Tap on scope plot cycles trigger mode roll, auto, normal, single.
+// In single mode, a tap re-arms. A long press returns to roll mode.
+void scopePlotGesture(const gesture_t &g) {
+  spkrClick();
+  if (g.type == gesture_long_press)
+    scopeTrigger.mode = trig_roll;
+  else if (scopeTrigger.mode != trig_single)
+    scopeTrigger.mode = (trigMode_e)(scopeTrigger.mode + 1);
+  enableStdControls(state_scopeInit);
+}
+
+// Switch auto-ranging on or off. Off returns to the manual ranges,
+// current range by Hi Range switch, voltage 10V.
+void setAutoRange(bool enabled) {
+  settings.autoRangeOn = enabled;
+  if (!enabled)
+    settings.voltRangeIdx = VOLT_RANGE_REF;
+  ampRanger.setRangeIdx(settings.ampRangeIdx);
+  voltRanger.setRangeIdx(settings.voltRangeIdx);
+  ampRanger.setEnabled(enabled);
+  voltRanger.setEnabled(enabled);
+  rangeChanged = true;
+}
+
+// Range changed by auto-ranging. Instead of initializing the whole page,
+// only the widget showing the measurement gets the new scale. Its level
+// integrator is rescaled, so the needle or bar is at the right position at once.
+void changeMeasurementRange(active_measurement_e measurement, int new_idx) {
+  int *range_idx = (measurement == amps) ? &settings.ampRangeIdx : &settings.voltRangeIdx;
+  if (*range_idx == new_idx) return;
+  float factor = meterRangeFullScale(*range_idx) / meterRangeFullScale(new_idx);
+  *range_idx = new_idx;
+  if ((instrState == state_meter) || (instrState == state_bg) || (instrState == state_scope) || (instrState == state_fft)) {
+    if (measurement != activeMeasurement) {
+      // secondary measurement on numeric display
+      numericDisplay.rescaleLevel(factor);
+      numericDisplay.setRangeIdxColor(new_idx, (measurement == amps) ? TFT_DARKGREEN : TFT_BLUE);
+    }
+  }
+  switch (instrState) {
+    case state_meter:
+      if (measurement == activeMeasurement) {
+        analogMeter.rescaleLevel(factor);
+        analogMeter.setRangeIdxColor(new_idx);
+      }
+      break;
+    case state_bg:
+      if (measurement == amps) {
+        barGraphAmps.rescaleLevel(factor);
+        barGraphAmps.setRangeIdxColor(new_idx, TFT_GREEN, true);
+      } else {
+        barGraphVolts.rescaleLevel(factor);
+        barGraphVolts.setRangeIdxColor(new_idx, TFT_BLUE, true);
+      }
+      break;
+    case state_scope:
+      rangeChanged = true; // trace history is in old range, init page
+      break;
+    default:
+      break;
+  }
+}
+
 
 // ##############################################################################
 //
@@ -523,15 +698,15 @@ void enablePageControls(instrStates_e newState) {
 // This function is called when the Done button is pressed
 void saveBtnPressed(void) {
   spkrClick();
-  saveCredentials();
+  saveCredentials(true);
   drawEnabledControls(false);  // grey out enabled controls
-  dialogBox.message(F("Settings saved"), F("to EEPROM memory"), 1000);
+  dialogBox.message("Settings saved", "to flash memory", 1000);
   drawEnabledControls(true);   // redraw inactive controls when menu is closed to restore window
 }
 
 void exitBtnPressed(void) {
   spkrClick();
-  tft.fillScreen(TFT_BLACK);
+  tftDma.fillScreen(TFT_BLACK);
   enablePageControls(state_meterInit);
 }
 
@@ -539,8 +714,8 @@ void touchCalBtnPressed(void) {
   spkrClick();
   drawEnabledControls(false);  // grey out enabled controls
   settings.touchCalDataOK = 0; // Reset calibration data
-  saveCredentials(); // store data
-  dialogBox.message(F("Calibration data reset"), F("Reboot to apply"), 1000);
+  saveCredentials(true); // store data before reboot
+  dialogBox.message("Calibration data reset", "Reboot to apply", 1000);
   DEBUG_PRINTLN("Calibration data reset");
   drawEnabledControls(true);   // redraw inactive controls when menu is closed to restore window
 }
@@ -552,13 +727,15 @@ void dirBtnPressed(void) {
   drawEnabledControls(false);
   // here we must wait for button release as modalListSelect disables it
   touchProvider.waitReleased(); // Wait for button release
-  int dir_entries = getDirectory(dirArr,  "");
-  int file_num = modalMenu.select(dirArr, dir_entries, "Select file to load");
+  // entries are read on demand while scrolling, no limit on directory size
+  DirListSource dir(SPIFFS);
+  int file_num = modalMenu.select(DirListSource::menuItem, dir.begin(""), "Select file to load", &dir);
   if (file_num >= 0) {
     tft.setTextDatum(TL_DATUM);  // Top left text datum
     tft.setTextColor(TFT_WHITE, TFT_BLACK);
-    tft.drawString(dirArr[file_num], 170, 110, 2);
+    tft.drawString(dir.name(file_num), 170, 110, 2);
   }
+  dir.end();
   drawEnabledControls(true);   // redraw inactive controls when menu is closed to restore window
 }
 
@@ -578,40 +755,26 @@ void wifiEnaCheckboxPressed(void) {
   drawEnabledControls(false);
   if (wifiEnaCheckbox.isChecked()) {
     #ifdef WIFI_ENABLED
-      wl_status_t status = WL_DISCONNECTED; // Initialize status to disconnected
       settings.wifiEnabled = true;
-      status = WiFi.status(); // Get the current WiFi status
-      if (status != WL_CONNECTED) {
+      if (!wifi_connected() && !wifiManager.isBusy()) {
         settings.wifiAPenabled = wifiAPCheckbox.isChecked();
+        // non-blocking, checkbox is cleared by wifi_state_changed() if connection fails
         if (settings.wifiAPenabled) {
-          status = wifi_connect_ap();
+          wifi_connect_ap();
         } else {
-          status = wifi_connect_sta();
-          if (status != WL_CONNECTED) {
-            wifiEnaCheckbox.setState(false, true);
-          }
+          wifi_connect_sta();
         }
-        #ifdef DEBUG
-          Serial.println("AsyncWebServer and ElegantOTA started");
-          Serial.print("on Server IP Address: ");
-          if (settings.wifiAPenabled) {
-            Serial.println(WiFi.softAPIP());
-          } else {
-            Serial.println(WiFi.localIP());
-          }
-        #endif
       }
     #endif
   } else {
     #ifdef WIFI_ENABLED
       settings.wifiEnabled = false;
-      stop_server(); // Stop the server if connected
-      WiFi.disconnect();
+      wifi_disconnect(); // Stop the server and WiFi
     #endif
   }
   #ifndef WIFI_ENABLED
     wifiEnaCheckbox.setState(false, true);
-    dialogBox.message(F("WIFI disabled in FW"), "", 2000, 2); // Show message if WIFI is not enabled
+    dialogBox.message("WIFI disabled in FW", "", 2000, 2); // Show message if WIFI is not enabled
   #endif
   drawEnabledControls(true);   // redraw inactive controls when menu is closed to restore window
 }
@@ -624,13 +787,12 @@ void wifiAPCheckboxPressed(void) {
       if (setupTabs.isEnabled())
         setupTabs.setActive(false, true);
       // If AP mode is enabled and checkbox is unchecked, disable AP mode
-      WiFi.softAPdisconnect(true);
-      stop_server(); // Stop the server if connected
+      wifi_disconnect(); // Stop the server and AP
       wifiEnaCheckbox.setState(false, true);
       settings.wifiEnabled = false; // Disable AP mode
     }
   #else // not WIFI_ENABLED
-    dialogBox.message(F("WIFI disabled in FW"), "", 2000, 2); // Show message if WIFI is not enabled
+    dialogBox.message("WIFI disabled in FW", "", 2000, 2); // Show message if WIFI is not enabled
   #endif
   settings.wifiAPenabled = wifiAPCheckbox.isChecked();
   drawEnabledControls(true);   // redraw inactive controls when menu is closed to restore window
@@ -701,11 +863,11 @@ void scanWifiBtnPressed(void) {
   spkrClick();
   drawEnabledControls(false);
   #ifdef WIFI_ENABLED
-    menuArr_t wifiArr;
-    int n = wifi_scanNetworks(wifiArr);
-    int menu_item = modalMenu.select(wifiArr, n, "Select WIFI network");
+    int n = wifi_scanNetworks();
+    int menu_item = modalMenu.select(wifi_menuItem, n, n ? "Select WIFI network" : "No networks found");
+    WiFi.scanDelete(); // free scan result
   #else // not WIFI_ENABLED
-    dialogBox.message(F("WIFI disabled in FW"), "", 2000, DB_ERROR); // Show message if WIFI is not enabled
+    dialogBox.message("WIFI disabled in FW", "", 2000, DB_ERROR); // Show message if WIFI is not enabled
   #endif
   drawEnabledControls(true);   // redraw inactive controls when menu is closed to restore window
 }
@@ -717,7 +879,7 @@ void startWPSBtnPressed(void) {
   #ifdef WIFI_ENABLED
     wps_connect(); // Start WPS connection
   #else // not WIFI_ENABLED
-    dialogBox.message(F("WIFI disabled in FW"), "", 2000, DB_ERROR); // Show message if WIFI is not enabled
+    dialogBox.message("WIFI disabled in FW", "", 2000, DB_ERROR); // Show message if WIFI is not enabled
   #endif
   drawEnabledControls(true);   // redraw inactive controls when menu is closed to restore window
 }
@@ -730,7 +892,10 @@ void enaBeepPressed(void) {
 void optionsPressed(void) {
   spkrClick();
   int16_t idx = optionCheckboxGroup.getSelectedItem(); // last pressed item
-  settings.config_bool[idx] = optionCheckboxGroup.getItemState(idx);
+  if (idx == 0)
+    setAutoRange(optionCheckboxGroup.getItemState(idx));
+  else
+    settings.config_bool[idx] = optionCheckboxGroup.getItemState(idx);
 }
 
 void slider1Pressed(void) {
@@ -757,7 +922,7 @@ void encoderEntryPressed(void) {
     drawEnabledControls(false);
     numericKeypad.init(30, 10, 260, 220, TFT_WINDOWGREY); // Initialize numeric keypad position and size
     numericKeypad.setEntryValue((float)settings.config_int[0]);
-    settings.config_int[0] = rint(numericKeypad.entry(F("Enter value"), 0, true));
+    settings.config_int[0] = rint(numericKeypad.entry("Enter value", 0, true));
     encoderEntry.setValue(settings.config_int[0]); // Update the encoder entry field with the new value
     drawEnabledControls(true);   // redraw inactive controls when keypad is closed to restore window
   #endif
@@ -773,29 +938,35 @@ void numericDisplayPressed(void) {
   enableStdControls((instrStates_e)(instrState & ~1)); // Back to init state
 }
 
-void leftWipeBtnPressed(void) {
-  spkrClick();
-  if (instrState <= state_meter) {
-    enablePageControls(state_scopeInit);
-  } else {
-    enablePageControls((instrStates_e)(instrState - 3)); // Cycle through measurement states
-  }
-  DEBUG_PRINT("Left wipe, cycle states to ");
-  DEBUG_PRINTLN(instrState - 3);
+// Init state of previous/next measurement page, cycles meter, bargraph, scope, spectrum
+instrStates_e prevMeasurementPage() {
+  if (instrState <= state_meter)
+    return state_fftInit;
+  return (instrStates_e)((instrState & ~1) - 2);
 }
 
-void rightWipeBtnPressed(void) {
+instrStates_e nextMeasurementPage() {
+  int next = (instrState & ~1) + 2;
+  if (next >= state_setupInit)
+    return state_meterInit;
+  return (instrStates_e)next;
+}
+
+// Swipe over a measurement page: to the left shows the next page, to the right the previous one
+void pageSwiped(const gesture_t &g) {
   spkrClick();
-  enablePageControls((instrStates_e)((instrState + 1) % 6)); // Cycle through measurement states
-  DEBUG_PRINT("Right wipe, cycle states to ");
-  DEBUG_PRINTLN((instrState + 1) % 6);
+  instrStates_e newState = (g.type == gesture_swipe_left) ? nextMeasurementPage() : prevMeasurementPage();
+  DEBUG_PRINT("Swipe, cycle states to ");
+  DEBUG_PRINTLN(newState);
+  enablePageControls(newState); // Cycle through measurement states
 }
 
 // Press action for the High Range ON/OFF switch
 void switchRangeToggled(void) {
   spkrClick();
   settings.ampHiRangeOn = switchRange.getState();
-  rangeChanged = true;
+  setAutoRange(false); // manual range selection
+  optionCheckboxGroup.setItemState(0, false);
 }
 
 void setupBtnPressed(void) {
@@ -906,9 +1077,10 @@ void initControls() {
   optionCheckboxGroup.init(10, 20, 20, 5, TFT_WHITE, TFT_WINDOWGREY, TFT_WHITE, 2, 2);
   optionCheckboxGroup.setPressAction(optionsPressed); // Default action for checkbox group
   optionCheckboxGroup.setLabelArray(&checkLabels);
-  for (int idx = 0; idx < 5; idx++) {
+  for (int idx = 1; idx < 5; idx++) {
     optionCheckboxGroup.setItemState(idx, settings.config_bool[idx]);
   }
+  optionCheckboxGroup.setItemState(0, settings.autoRangeOn);
 
   slider1.init(10, 160, 300, 30, TFT_WHITE, TFT_CYAN, TFT_RED, 2, 2);
   slider1.setLevel(settings.config_float[0]);
@@ -926,12 +1098,10 @@ void initControls() {
   setupBtn.setPressAction(setupBtnPressed); // Set setup button action
   setupBtn.setLabel("S");
 
-  #ifndef ENCODER_ENABLED
-    leftWipeBtn.init(0, 0, 50, MAINWINDOW_H); // always invisible
-    leftWipeBtn.setPressAction(leftWipeBtnPressed);
-    rightWipeBtn.init(MAINWINDOW_W - 50, 0, 50, MAINWINDOW_H); // always invisible
-    rightWipeBtn.setPressAction(rightWipeBtnPressed);
-  #endif
+  // Touches starting on a bargraph move its marker and are no gestures
+  gestureScopePlot = gestures.subscribe(GESTURE_MASK(gesture_tap) | GESTURE_MASK(gesture_long_press),
+    5, 0, 240, MAINWINDOW_H - SCOPE_TEXT_H, scopePlotGesture);
+  gesturePageSwipe = gestures.subscribe(GESTURE_SWIPES_H, 0, 0, MAINWINDOW_W, MAINWINDOW_H, pageSwiped);
 
   switchRange.initCenter(BUTTON_W/2 + 3, 218, BUTTON_W, BUTTON_H, TFT_WHITE, TFT_GREEN, TFT_WHITE, 2, 2);
   switchRange.setLabelDatum(0, -5, TC_DATUM);
@@ -946,7 +1116,7 @@ void initControls() {
   ovldLED.setLabel("OVL");
 
   #ifdef WIFI_ENABLED
-    statusLED.setState(wifi_connected(), true, true); // Set status LED to On, blinking
+    wifi_show_state(true); // Status LED color and blinking by connection state
   #else
     statusLED.setState(false, false, true); // Set status LED to Off, not blinking
   #endif
@@ -973,21 +1143,35 @@ void initControls() {
 // ##############################################################################
 
 
+// Update objects that need frequent update like blinking LEDs,
+// called by the blink job in main loop
+void handleGuiUpdates() {
+  PROF_SCOPE(prof_update);
+  for (int idx = 0; idx < guiUpdateObjectsCount; idx++) {
+    guiUpdateObjects[idx]->update(); // Update all objects that need to be updated
+  }
+}
+
 // Handle the GUI, check for button presses and call the appropriate actions
 // This function must be called regularly in main loop to update the GUI
 void handleGUI() {
+  PROF_SCOPE(prof_gui);
   int idx;
   // Check for touch input, gets the touch coordinates and sets pressed to true if a valid touch is detected
-  if (touchProvider.checkTouch()) {
+  bool touched = touchProvider.checkTouch();
+  if (touched) {
+    scheduler.trigger(job_power, millis()); // full rate and brightness at once
+    if (powerManager.activity(millis())) {
+      touchProvider.waitReleased(); // first touch only wakes the display
+      return;
+    }
+  }
+  gestures.update(touched, touchProvider.tx, touchProvider.ty, millis()); // page swipe, scope plot
+  if (touched) {
     for (idx = 0; idx < guiObjectsCount; idx++) {
       guiObjects[idx]->checkPressed(true); // Check if any object was pressed
     }
   }
-  // Update objects that need frequent update like blinking LEDs
-  for (idx = 0; idx < guiUpdateObjectsCount; idx++) {
-    guiUpdateObjects[idx]->update(); // Update all objects that need to be updated
-  }
-
   if (barGraphAmps.checkPressed()) {
     markerAmps = barGraphAmps.getLevelMarker();
   }
@@ -996,25 +1180,73 @@ void handleGUI() {
   }
   if (barGraphVert.checkPressed()) {
     markerAmps = barGraphVert.getLevelMarker();
+    if ((instrState == state_scope) && (scopeTrigger.mode != trig_roll))
+      uiQueue.post(ui_cmd_trig_rearm); // new trigger level
   }
   #ifdef ENCODER_ENABLED
     if (instrState != state_setup) {
       int enc_delta = touchProvider.getEncDelta();
       if (enc_delta) {
+        powerManager.activity(millis());
+        scheduler.trigger(job_power, millis());
         // Handle encoder input
         spkrClick();
         if (enc_delta < 0) {
-          if (instrState <= state_meter) {
-            enablePageControls(state_scopeInit);
-          } else {
-            enablePageControls((instrStates_e)(instrState - 3)); // Cycle through measurement states
-          }
+          enablePageControls(prevMeasurementPage()); // Cycle through measurement states
         } else {
-          enablePageControls((instrStates_e)((instrState + 1) % 6)); // Cycle through measurement states
+          enablePageControls(nextMeasurementPage());
         }
       }
     }
   #endif
 }
 
+#ifdef PROFILER
+// Capture all measurement pages, setup tabs and widget states as golden images
+// and compare them with the reference on SD card, or save a new reference.
+// Called from loop(), redraws the current page afterwards. Returns number of mismatches.
+int goldenRun(bool save) {
+  instrStates_e oldState = instrState;
+  bool sd_ok = start_SD(); // mount only, screenCapture claims the bus per stripe
+  end_SD();
+  screenCapture.begin(save, sd_ok);
+  bool stats_on = statsReadoutOn;
+  statsReadoutOn = false; // bargraph page without live statistics
+  static const struct { instrStates_e state; const char *name; } pages[] = {
+    { state_meterInit, "p_meter" }, { state_bgInit, "p_bargraph" }, { state_scopeInit, "p_scope" }
+  };
+  for (auto &page : pages) {
+    // live levels would differ from run to run, pages are drawn from zero
+    numericDisplay.resetLevel();
+    analogMeter.resetLevel();
+    barGraphAmps.resetLevel();
+    barGraphVolts.resetLevel();
+    barGraphVert.resetLevel();
+    enablePageControls(page.state);
+    statusLED.setColor(TFT_GREEN);
+    statusLED.setState(false, false, true); // WiFi state would change the LED
+    screenCapture.capture(page.name);
+  }
+  // setup tabs, WiFi tab skipped as the clock shows the current time
+  enablePageControls(state_setupInit);
+  screenCapture.capture("p_setup");
+  setupTabs.setSelectedItem(2, true);
+  enableTabControls(2);
+  screenCapture.capture("p_options");
+  widgetBench.run(&screenCapture);
+  int mismatches = screenCapture.end();
+  statsReadoutOn = stats_on;
+  // redraw page that was open before
+  setupTabs.setSelectedItem(0, false);
+  if (oldState == state_setup)
+    enablePageControls(state_setupInit);
+  else
+    enablePageControls((instrStates_e)(oldState & ~1)); // Init state of old page
+  #ifdef WIFI_ENABLED
+    wifi_show_state(true); // restore status LED
+  #endif
+  return mismatches;
+}
+#endif
+
 #endif
\ No newline at end of file
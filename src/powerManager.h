@@ -0,0 +1,300 @@
+#ifndef POWERMANAGER_H
+#define POWERMANAGER_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Power saving for battery units: backlight, redraw rate, CPU clock and sleep.
+//
+// States, by time since the last touch or encoder turn and since the last
+// change of the measured values:
+//  - power_active: full redraw rate, full backlight
+//  - power_idle:   values stable for POWER_STABLE_MS, display jobs run at
+//                  1/2^POWER_IDLE_SHED of their rate (scheduler floor), CPU
+//                  at POWER_IDLE_CPU_MHZ
+//  - power_dim:    no touch for POWER_DIM_MS, backlight at POWER_DIM_PCT
+//  - power_blank:  no touch for POWER_BLANK_MS, backlight off, display jobs
+//                  stopped by loop(). The first touch only wakes the display.
+// A touch or encoder turn (activity()) returns to power_active at once.
+//
+// Backlight: LEDC PWM on the backlight pin. On boards with a light sensor
+// (LDR_PIN, CYD) the brightness follows the ambient light: the LDR is read
+// every POWER_UPDATE_MS and low-pass filtered (fixed-point IIR, about 2 s),
+// the duty cycle moves by at most POWER_BL_STEP per update, so neither
+// flicker nor a passing shadow is visible. Calibrate LDR_RAW_BRIGHT and
+// LDR_RAW_DARK per unit with the raw values shown on /power.
+//
+// Sleep: idle() is called by loop() when no job is due. The loop task blocks
+// until the next job release, so the idle task halts the CPU (WAITI) instead
+// of spinning loop(). A touch interrupt (XPT2046 PENIRQ) ends the wait early
+// and is reported by takeTouchIrq(). Reading the XPT2046 toggles PENIRQ, so
+// the touch provider calls touchReading() around each access; edges from
+// then until POWER_IRQ_HOLDOFF_US after the read are ignored, otherwise
+// every touch read would wake the loop and count as activity. In power_blank, and only if the caller
+// allows it (no WiFi, no timer sampling running), the chip goes to light
+// sleep instead, woken by the timer or the touch interrupt. Light sleep
+// stops the APB clock, which would stall WiFi, the Ticker callbacks and the
+// LEDC backlight; the latter is off in power_blank anyway.
+
+#include <Arduino.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define POWER_UPDATE_MS 250         // LDR-Abfrage und Timeouts, Periode des Power-Jobs
+#define POWER_STABLE_MS 3000        // Messwerte so lange unverändert -> Idle
+#define POWER_STABLE_DELTA 0.01f    // Änderung in Full Scale, die als neuer Wert zählt
+#define POWER_IDLE_SHED 2           // Anzeige im Idle mit 1/4 Rate
+#define POWER_DIM_MS 60000UL        // ohne Touch -> Hintergrundbeleuchtung gedimmt, 0 = nie
+#define POWER_BLANK_MS 600000UL     // ohne Touch -> Anzeige dunkel, 0 = nie
+#define POWER_DIM_PCT 25            // Helligkeit gedimmt in Prozent
+#define POWER_IDLE_CPU_MHZ 80       // CPU-Takt ab Idle, 0 = unverändert
+#define POWER_MAX_IDLE_MS 100       // längste Wartezeit in idle()
+#define POWER_SLEEP_MIN_MS 3        // kürzere Pausen ohne Light Sleep
+#define POWER_IRQ_HOLDOFF_US 200    // PENIRQ-Flanken so lange nach Touch-Lesen ignorieren
+#define POWER_JSON_SIZE 320
+
+#define POWER_BL_CHANNEL 7          // LEDC-Kanal (Arduino 2.x), 0 benutzt tone()
+#define POWER_BL_FREQ 5000          // PWM-Frequenz Hintergrundbeleuchtung
+#define POWER_BL_MIN 24             // Duty bei Dunkelheit, 0..255
+#define POWER_BL_MAX 255            // Duty bei hellem Umgebungslicht
+#define POWER_BL_STEP 8             // größte Duty-Änderung pro Update
+#define POWER_LDR_SHIFT 3           // IIR 1/8 pro Update, ca. 2 s Zeitkonstante
+
+#ifndef LDR_RAW_BRIGHT
+  #define LDR_RAW_BRIGHT 0          // ADC-Wert bei hellem Licht (CYD: fällt mit Helligkeit)
+#endif
+#ifndef LDR_RAW_DARK
+  #define LDR_RAW_DARK 1200         // ADC-Wert bei Dunkelheit
+#endif
+
+enum powerState_e {
+  power_active = 0,
+  power_idle,
+  power_dim,
+  power_blank
+};
+
+class PowerManager {
+public:
+  PowerManager() { }
+
+  // Take over backlight pin with PWM and attach touch interrupt (-1: none),
+  // call after tft.init() from the loop task
+  void begin(uint8_t bl_pin, int irq_pin = -1) {
+    _blPin = bl_pin;
+    _irqPin = irq_pin;
+    _task = xTaskGetCurrentTaskHandle();
+    _cpuMhz = getCpuFrequencyMhz();
+    #if ESP_ARDUINO_VERSION_MAJOR >= 3
+      ledcAttach(_blPin, POWER_BL_FREQ, 8);
+    #else
+      ledcSetup(POWER_BL_CHANNEL, POWER_BL_FREQ, 8);
+      ledcAttachPin(_blPin, POWER_BL_CHANNEL);
+    #endif
+    _ldrFilt = -1;
+    _readLdr();
+    _duty = _targetDuty();
+    _writeDuty();
+    if (_irqPin >= 0) {
+      pinMode(_irqPin, INPUT); // XPT2046 PENIRQ has its own pull-up
+      _attachIrq();
+    }
+    _lastTouch = _lastChange = millis();
+  }
+
+  // Touch or encoder turn: back to full rate and brightness. Returns true if
+  // the display was blank, the touch should then only wake it
+  bool activity(uint32_t now_ms) {
+    bool was_blank = (_state == power_blank);
+    _lastTouch = _lastChange = now_ms;
+    _setState(power_active);
+    _duty = _targetDuty(); // no ramp on wake
+    _writeDuty();
+    return was_blank;
+  }
+
+  // New measured values in full scale, changes above POWER_STABLE_DELTA end idle
+  void noteLevels(float level_a, float level_b, uint32_t now_ms) {
+    if ((fabsf(level_a - _levelA) > POWER_STABLE_DELTA) || (fabsf(level_b - _levelB) > POWER_STABLE_DELTA)) {
+      _levelA = level_a;
+      _levelB = level_b;
+      _lastChange = now_ms;
+      if (_state == power_idle) _setState(power_active);
+    }
+  }
+
+  // Power job: ambient light, backlight ramp and state timeouts
+  void update(uint32_t now_ms) {
+    uint32_t untouched = now_ms - _lastTouch;
+    powerState_e s = power_active;
+    if (POWER_BLANK_MS && (untouched >= POWER_BLANK_MS))
+      s = power_blank;
+    else if (POWER_DIM_MS && (untouched >= POWER_DIM_MS))
+      s = power_dim;
+    else if ((now_ms - _lastChange >= POWER_STABLE_MS) && (untouched >= POWER_STABLE_MS))
+      s = power_idle;
+    _setState(s);
+    _readLdr();
+    int target = _targetDuty();
+    int diff = target - _duty;
+    if (diff > POWER_BL_STEP) diff = POWER_BL_STEP;
+    if (diff < -POWER_BL_STEP) diff = -POWER_BL_STEP;
+    if ((diff > 2) || (diff < -2) || (target == 0) || (target == POWER_BL_MAX)) {
+      _duty += diff;
+      _writeDuty();
+    }
+  }
+
+  // Wait up to ms until the next job, light sleep if sleep_ok and display blank
+  void idle(uint32_t ms, bool sleep_ok) {
+    if (ms == 0) return;
+    uint32_t start = millis();
+    if (sleep_ok && (_state == power_blank) && (ms >= POWER_SLEEP_MIN_MS)) {
+      esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+      if (_irqPin >= 0) {
+        detachInterrupt(_irqPin);
+        gpio_wakeup_enable((gpio_num_t)_irqPin, GPIO_INTR_LOW_LEVEL);
+        esp_sleep_enable_gpio_wakeup();
+      }
+      Serial.flush(); // UART stops in light sleep
+      esp_light_sleep_start();
+      if (_irqPin >= 0) {
+        if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO)
+          _touchIrq = true;
+        gpio_wakeup_disable((gpio_num_t)_irqPin);
+        _attachIrq();
+      }
+      _sleepMs += millis() - start;
+    } else {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms)); // touch interrupt ends wait
+    }
+    _idleMs += millis() - start;
+  }
+
+  // Touch controller access starts (true) or ends (false), see setReadHook() in touchProvider.h
+  void touchReading(bool reading) {
+    if (!reading)
+      _irqUnmaskUs = (uint32_t)esp_timer_get_time();
+    _irqMasked = reading;
+  }
+
+  // True once after a touch interrupt
+  bool takeTouchIrq() {
+    if (!_touchIrq) return false;
+    _touchIrq = false;
+    return true;
+  }
+
+  powerState_e state() const { return _state; }
+  bool isBlank() const { return _state == power_blank; }
+  int idleShed() const { return (_state == power_active) ? 0 : POWER_IDLE_SHED; }
+  uint8_t duty() const { return _duty; }
+
+  // JSON object with state, backlight, light sensor and idle time since boot
+  size_t report(char *buf, size_t size) const {
+    static const char *names[] = { "active", "idle", "dim", "blank" };
+    uint32_t up = millis();
+    return snprintf(buf, size, "{\"state\":\"%s\",\"duty\":%u,\"ldr_raw\":%d,\"ldr_filtered\":%d,"
+      "\"cpu_mhz\":%lu,\"idle_pct\":%lu,\"sleep_pct\":%lu,\"touch_irqs\":%lu}\n",
+      names[_state], (unsigned)_duty, _ldrRaw, (_ldrFilt < 0) ? -1 : (int)(_ldrFilt >> 4),
+      (unsigned long)getCpuFrequencyMhz(),
+      (unsigned long)(up ? (uint64_t)_idleMs * 100 / up : 0),
+      (unsigned long)(up ? (uint64_t)_sleepMs * 100 / up : 0), (unsigned long)_irqCount);
+  }
+
+private:
+  uint8_t _blPin = 0;
+  int _irqPin = -1;
+  TaskHandle_t _task = NULL;
+  powerState_e _state = power_active;
+  uint32_t _cpuMhz = 240;
+  int _duty = POWER_BL_MAX;
+  int _ldrRaw = -1;
+  int32_t _ldrFilt = -1;          // raw value * 16, -1 before first reading
+  float _levelA = 0, _levelB = 0;
+  uint32_t _lastTouch = 0, _lastChange = 0;
+  uint32_t _idleMs = 0, _sleepMs = 0;
+  volatile bool _touchIrq = false;
+  volatile bool _irqMasked = false;   // touch controller is being read
+  volatile uint32_t _irqUnmaskUs = 0;
+  volatile uint32_t _irqCount = 0;
+
+  static void IRAM_ATTR _isr(void *arg) {
+    PowerManager *p = (PowerManager *)arg;
+    if (p->_irqMasked || ((uint32_t)esp_timer_get_time() - p->_irqUnmaskUs < POWER_IRQ_HOLDOFF_US))
+      return; // edge caused by reading the controller
+    p->_touchIrq = true;
+    p->_irqCount++;
+    BaseType_t woken = pdFALSE;
+    if (p->_task) vTaskNotifyGiveFromISR(p->_task, &woken);
+    if (woken) portYIELD_FROM_ISR();
+  }
+
+  void _attachIrq() {
+    attachInterruptArg(_irqPin, _isr, this, FALLING);
+  }
+
+  void _readLdr() {
+    #ifdef LDR_PIN
+      _ldrRaw = analogRead(LDR_PIN);
+      if (_ldrFilt < 0)
+        _ldrFilt = (int32_t)_ldrRaw << 4;
+      else
+        _ldrFilt += (((int32_t)_ldrRaw << 4) - _ldrFilt) >> POWER_LDR_SHIFT;
+    #endif
+  }
+
+  // Duty for ambient light and state
+  int _targetDuty() const {
+    if (_state == power_blank) return 0;
+    int duty = POWER_BL_MAX;
+    #ifdef LDR_PIN
+      if (_ldrFilt >= 0) {
+        int32_t raw = _ldrFilt >> 4;
+        int32_t b = (LDR_RAW_DARK - raw) * 256 / (LDR_RAW_DARK - LDR_RAW_BRIGHT); // 256 = hell
+        if (b < 0) b = 0;
+        if (b > 256) b = 256;
+        duty = POWER_BL_MIN + (POWER_BL_MAX - POWER_BL_MIN) * b / 256;
+      }
+    #endif
+    if (_state == power_dim)
+      duty = duty * POWER_DIM_PCT / 100;
+    return duty;
+  }
+
+  void _writeDuty() {
+    #if ESP_ARDUINO_VERSION_MAJOR >= 3
+      ledcWrite(_blPin, _duty);
+    #else
+      ledcWrite(POWER_BL_CHANNEL, _duty);
+    #endif
+  }
+
+  void _setState(powerState_e s) {
+    if (s == _state) return;
+    if (POWER_IDLE_CPU_MHZ && (_cpuMhz > POWER_IDLE_CPU_MHZ)) {
+      if ((_state == power_active) && (s != power_active))
+        setCpuFrequencyMhz(POWER_IDLE_CPU_MHZ); // SPI and UART keep their clock (APB 80 MHz)
+      else if ((_state != power_active) && (s == power_active))
+        setCpuFrequencyMhz(_cpuMhz);
+    }
+    _state = s;
+  }
+};
+
+PowerManager powerManager;
+
+#endif // POWERMANAGER_H
@@ -0,0 +1,376 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Frame time and display traffic profiler, enabled by #define PROFILER in main.cpp.
+//
+// PROF_SCOPE(section) at the start of a block measures CPU cycles of that block
+// and the pixels and bytes sent to the display meanwhile. Per section, calls,
+// total and maximum cycles and a log2 histogram of cycles per call are kept.
+// Sections are inclusive, e.g. prof_frame contains all other sections.
+//
+// Display traffic is counted by ProfTFT, a TFT_eSPI with counting drawing
+// primitives (pixels, lines, rectangles, characters), and by PROF_PIXELS() in
+// code pushing images. Each primitive is assumed to set an address window
+// (PROF_WINDOW_BYTES) and send 2 bytes per pixel. Anti-aliased lines and
+// arcs write directly to the display and are not counted.
+//
+// Heap allocations are counted per section, too, if the firmware is linked
+// with wrappers for malloc(), calloc() and realloc() (PROF_HEAP, see below).
+// Only allocations of the task running the sections (loop()) are counted per
+// section, those of other tasks (web server, WiFi) in a separate total.
+//
+// Results are shown in a corner overlay (profDrawHUD(), once per second) and
+// exported as JSON by report(), via /prof on the web server or on Serial.
+// Without PROFILER defined, PROF_SCOPE() and PROF_PIXELS() compile to nothing.
+// Without ARDUINO defined, cycles are derived from the host clock at
+// PROF_CPU_MHZ, so the same sections and report work in host builds.
+
+#ifdef PROFILER
+
+#ifdef ARDUINO
+  #include <Arduino.h>
+  #include <TFT_eSPI.h>
+  #include <esp_heap_caps.h>
+  #include "textFormat.h"
+#else
+  #include <cstdint>
+  #include <cstdio>
+  #include <cstring>
+  #include <chrono>
+#endif
+
+#define PROF_CPU_MHZ 240        // Cycles per µs, host stand-in
+#define PROF_HIST_BUCKETS 12    // Bucket 0: < 2^11 cycles, 11: >= 2^21 cycles
+#define PROF_HIST_SHIFT 10      // log2 of lowest bucket limit minus 1
+#define PROF_WINDOW_BYTES 11    // CASET, PASET, RAMWR mit Parametern
+#define PROF_REPORT_SIZE 2560   // JSON report buffer
+#define PROF_HUD_W 84           // 14 characters of font 1
+#define PROF_HUD_H 34           // 4 lines of font 1
+
+enum profSection_e {
+  prof_frame = 0,   // one job run in loop(), see jobScheduler.h
+  prof_gui,         // handleGUI()
+  prof_redraw,      // GUIObject::redraw() of all controls
+  prof_update,      // GUIObject::update(), blinking LEDs etc.
+  prof_meter,       // AnalogMeter::setLevel()
+  prof_scope,       // ScrollingScope::trace()
+  prof_bargraph,    // bargraph update()
+  prof_clock,       // AnalogClock::update()
+  prof_fft,         // FixedFFT::compute() and SpectrumView::update()
+  prof_sections
+};
+
+struct profSection_t {
+  uint32_t calls;
+  uint64_t cycles;      // total
+  uint32_t maxCycles;   // since reset()
+  uint32_t peakCycles;  // since last takePeak(), for HUD
+  uint32_t pixels;
+  uint32_t bytes;
+  uint32_t allocs;      // heap allocations, with PROF_HEAP only
+  uint32_t hist[PROF_HIST_BUCKETS];
+};
+
+// Heap allocation counter. Add to build_flags in platformio.ini:
+//   -D PROF_HEAP -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc
+// The linker then routes all calls, including those in Arduino String and the
+// libraries, through the __wrap_ functions below. Without PROF_HEAP, counts stay 0.
+#if defined(PROF_HEAP) && defined(ARDUINO)
+
+static TaskHandle_t profHeapTask = NULL;   // task counted per section, set by first ProfScope
+static volatile uint32_t profHeapAllocs = 0, profHeapOtherAllocs = 0;
+
+extern "C" {
+  void *__real_malloc(size_t size);
+  void *__real_calloc(size_t n, size_t size);
+  void *__real_realloc(void *ptr, size_t size);
+
+  static inline void profHeapCount() {
+    if (xTaskGetCurrentTaskHandle() == profHeapTask)
+      profHeapAllocs++;
+    else
+      profHeapOtherAllocs++;
+  }
+
+  void *__wrap_malloc(size_t size) { profHeapCount(); return __real_malloc(size); }
+  void *__wrap_calloc(size_t n, size_t size) { profHeapCount(); return __real_calloc(n, size); }
+  void *__wrap_realloc(void *ptr, size_t size) { if (size) profHeapCount(); return __real_realloc(ptr, size); }
+}
+
+inline void profHeapWatchTask() { if (!profHeapTask) profHeapTask = xTaskGetCurrentTaskHandle(); }
+
+#else
+
+static const uint32_t profHeapAllocs = 0, profHeapOtherAllocs = 0;
+inline void profHeapWatchTask() { }
+
+#endif // PROF_HEAP
+
+class Profiler {
+public:
+  bool hud = false; // draw overlay in loop()
+
+  Profiler() { reset(); }
+
+  void reset() {
+    memset(_sec, 0, sizeof(_sec));
+    _allocsStart = profHeapAllocs;
+    _otherAllocsStart = profHeapOtherAllocs;
+    _pixels = 0;
+    _bytes = 0;
+    _prims = 0;
+    _startCycles = cycles();
+  }
+
+  // Current cycle counter, wraps after 17 s at 240 MHz, differences are valid
+  static uint32_t cycles() {
+    #ifdef ARDUINO
+      return ESP.getCycleCount();
+    #else
+      static const auto t0 = std::chrono::steady_clock::now();
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+      return (uint32_t)((uint64_t)ns * PROF_CPU_MHZ / 1000);
+    #endif
+  }
+
+  // Count pixels sent to the display, calls = number of address windows
+  void addPixels(uint32_t pixels, uint32_t calls = 1) {
+    if (_paused) return;
+    _prims++;
+    _pixels += pixels;
+    _bytes += pixels * 2 + calls * PROF_WINDOW_BYTES;
+  }
+
+  uint32_t pixels() const { return _pixels; }
+  uint32_t bytes() const { return _bytes; }
+  uint32_t primitives() const { return _prims; } // counted drawing calls
+  static uint32_t allocs() { return profHeapAllocs; } // heap allocations of loop task
+
+  // Stop counting display traffic, e.g. while drawing the HUD
+  void pause(bool paused) { _paused = paused; }
+
+  void record(profSection_e s, uint32_t cycles, uint32_t pixels, uint32_t bytes, uint32_t allocs) {
+    profSection_t *sec = &_sec[s];
+    sec->calls++;
+    sec->cycles += cycles;
+    if (cycles > sec->maxCycles) sec->maxCycles = cycles;
+    if (cycles > sec->peakCycles) sec->peakCycles = cycles;
+    sec->pixels += pixels;
+    sec->bytes += bytes;
+    sec->allocs += allocs;
+    sec->hist[_bucket(cycles)]++;
+  }
+
+  const profSection_t &section(profSection_e s) const { return _sec[s]; }
+
+  // Maximum cycles of section since last call
+  uint32_t takePeak(profSection_e s) {
+    uint32_t peak = _sec[s].peakCycles;
+    _sec[s].peakCycles = 0;
+    return peak;
+  }
+
+  static const char *name(profSection_e s) {
+    static const char *names[prof_sections] = {
+      "frame", "gui", "redraw", "update", "meter", "scope", "bargraph", "clock", "fft"
+    };
+    return names[s];
+  }
+
+  // Lower cycle limit of histogram bucket
+  static uint32_t bucketCycles(int bucket) { return bucket ? (1UL << (bucket + PROF_HIST_SHIFT)) : 0; }
+
+  // Write all sections as JSON into buf, returns length
+  size_t report(char *buf, size_t size) {
+    size_t len = 0;
+    uint32_t elapsed_ms = (cycles() - _startCycles) / (PROF_CPU_MHZ * 1000UL);
+    len += snprintf(buf + len, size - len, "{\"cpu_mhz\":%d,\"elapsed_ms\":%lu,\"pixels\":%lu,\"bytes\":%lu,\"primitives\":%lu,"
+      "\"allocs\":%lu,\"allocs_other\":%lu,", PROF_CPU_MHZ, (unsigned long)elapsed_ms, (unsigned long)_pixels,
+      (unsigned long)_bytes, (unsigned long)_prims, (unsigned long)(profHeapAllocs - _allocsStart),
+      (unsigned long)(profHeapOtherAllocs - _otherAllocsStart));
+    #ifdef ARDUINO
+      // largest free block much smaller than free heap: fragmentation
+      len += snprintf(buf + len, size - len, "\"heap_free\":%lu,\"heap_min_free\":%lu,\"heap_largest\":%lu,",
+        (unsigned long)heap_caps_get_free_size(MALLOC_CAP_8BIT), (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+        (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    #endif
+    len += snprintf(buf + len, size - len, "\"hist_cycles\":[");
+    for (int b = 0; (b < PROF_HIST_BUCKETS) && (len < size); b++)
+      len += snprintf(buf + len, size - len, "%s%lu", b ? "," : "", (unsigned long)bucketCycles(b));
+    len += snprintf(buf + len, size - len, "],\"sections\":[");
+    for (int s = 0; (s < prof_sections) && (len < size); s++) {
+      const profSection_t *sec = &_sec[s];
+      uint32_t avg_us = sec->calls ? (uint32_t)(sec->cycles / sec->calls / PROF_CPU_MHZ) : 0;
+      len += snprintf(buf + len, size - len, "%s{\"name\":\"%s\",\"calls\":%lu,\"avg_us\":%lu,\"max_us\":%lu,"
+        "\"pixels\":%lu,\"bytes\":%lu,\"allocs\":%lu,\"hist\":[", s ? "," : "", name((profSection_e)s),
+        (unsigned long)sec->calls, (unsigned long)avg_us, (unsigned long)(sec->maxCycles / PROF_CPU_MHZ),
+        (unsigned long)sec->pixels, (unsigned long)sec->bytes, (unsigned long)sec->allocs);
+      for (int b = 0; (b < PROF_HIST_BUCKETS) && (len < size); b++)
+        len += snprintf(buf + len, size - len, "%s%lu", b ? "," : "", (unsigned long)sec->hist[b]);
+      if (len < size)
+        len += snprintf(buf + len, size - len, "]}");
+    }
+    if (len < size)
+      len += snprintf(buf + len, size - len, "]}\n");
+    return (len < size) ? len : size - 1;
+  }
+
+private:
+  profSection_t _sec[prof_sections];
+  uint32_t _pixels = 0, _bytes = 0, _prims = 0;
+  uint32_t _startCycles = 0;
+  uint32_t _allocsStart = 0, _otherAllocsStart = 0;
+  bool _paused = false;
+
+  static int _bucket(uint32_t cycles) {
+    cycles >>= PROF_HIST_SHIFT;
+    int b = cycles ? (31 - __builtin_clz(cycles)) : 0;
+    return (b < PROF_HIST_BUCKETS) ? b : PROF_HIST_BUCKETS - 1;
+  }
+};
+
+Profiler profiler;
+
+// Measures the enclosing block, use PROF_SCOPE()
+class ProfScope {
+public:
+  ProfScope(profSection_e s) : _s(s), _start(Profiler::cycles()),
+    _pixels(profiler.pixels()), _bytes(profiler.bytes()), _allocs(Profiler::allocs()) { profHeapWatchTask(); }
+  ~ProfScope() {
+    profiler.record(_s, Profiler::cycles() - _start, profiler.pixels() - _pixels, profiler.bytes() - _bytes,
+      Profiler::allocs() - _allocs);
+  }
+private:
+  profSection_e _s;
+  uint32_t _start, _pixels, _bytes, _allocs;
+};
+
+#define PROF_SCOPE(s) ProfScope _prof_scope(s)
+#define PROF_PIXELS(n) profiler.addPixels(n)
+
+#ifdef ARDUINO
+
+// TFT_eSPI counting the pixels of its virtual drawing primitives.
+// Composite calls (lines, characters) count an estimate only if they did not
+// already count by calling the primitives.
+class ProfTFT : public TFT_eSPI {
+public:
+  ProfTFT() : TFT_eSPI() { }
+
+  void drawPixel(int32_t x, int32_t y, uint32_t color) override {
+    TFT_eSPI::drawPixel(x, y, color);
+    profiler.addPixels(1);
+  }
+
+  void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) override {
+    TFT_eSPI::drawFastHLine(x, y, w, color);
+    if (w > 0) profiler.addPixels(w);
+  }
+
+  void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) override {
+    TFT_eSPI::drawFastVLine(x, y, h, color);
+    if (h > 0) profiler.addPixels(h);
+  }
+
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) override {
+    TFT_eSPI::fillRect(x, y, w, h, color);
+    if ((w > 0) && (h > 0)) profiler.addPixels(w * h);
+  }
+
+  void drawLine(int32_t xs, int32_t ys, int32_t xe, int32_t ye, uint32_t color) override {
+    uint32_t before = profiler.pixels();
+    TFT_eSPI::drawLine(xs, ys, xe, ye, color);
+    if (profiler.pixels() == before) {
+      int32_t dx = abs(xe - xs), dy = abs(ye - ys);
+      profiler.addPixels(((dx > dy) ? dx : dy) + 1, ((dx < dy) ? dx : dy) + 1); // one window per step
+    }
+  }
+
+  void drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size) override {
+    uint32_t before = profiler.pixels();
+    TFT_eSPI::drawChar(x, y, c, color, bg, size);
+    if (profiler.pixels() == before)
+      profiler.addPixels(6 * 8 * size * size); // GLCD font 1
+  }
+
+  int16_t drawChar(uint16_t uniCode, int32_t x, int32_t y, uint8_t font) override {
+    uint32_t before = profiler.pixels();
+    int16_t w = TFT_eSPI::drawChar(uniCode, x, y, font);
+    if ((profiler.pixels() == before) && (w > 0))
+      profiler.addPixels(w * fontHeight(font));
+    return w;
+  }
+};
+
+// Corner overlay: frame time avg/max, CPU load of frames, pixels and bytes per second,
+// heap allocations of loop task per second and largest free heap block
+void profDrawHUD(TFT_eSPI *tft) {
+  static uint32_t last_ms = 0, last_calls = 0, last_pixels = 0, last_bytes = 0, last_allocs = 0;
+  static uint64_t last_cycles = 0;
+  const profSection_t &frame = profiler.section(prof_frame);
+  uint32_t now = millis();
+  uint32_t ms = now - last_ms;
+  if (ms == 0) return;
+  uint32_t calls = frame.calls - last_calls;
+  uint64_t cycles = frame.cycles - last_cycles;
+  float avg_ms = calls ? (float)cycles / calls / (PROF_CPU_MHZ * 1000.0) : 0;
+  float max_ms = profiler.takePeak(prof_frame) / (PROF_CPU_MHZ * 1000.0);
+  uint32_t load = (uint32_t)(cycles / (PROF_CPU_MHZ * 10UL) / ms); // percent
+  uint32_t px_s = (uint64_t)(profiler.pixels() - last_pixels) * 1000 / ms;
+  uint32_t bytes_s = (uint64_t)(profiler.bytes() - last_bytes) * 1000 / ms;
+  uint32_t allocs_s = (uint64_t)(Profiler::allocs() - last_allocs) * 1000 / ms;
+  last_ms = now;
+  last_calls = frame.calls;
+  last_cycles = frame.cycles;
+  last_pixels = profiler.pixels();
+  last_bytes = profiler.bytes();
+  last_allocs = Profiler::allocs();
+
+  char line[4][16];
+  TextBuf<16> frame_ms; // no float printf, it allocates itself
+  frame_ms.add('F').fixed(avg_ms, 1).add('/').fixed(max_ms, 1).add("ms");
+  strcpy(line[0], frame_ms);
+  snprintf(line[1], sizeof(line[1]), "L%3lu%% %4lukp", (unsigned long)load, (unsigned long)(px_s / 1000));
+  snprintf(line[2], sizeof(line[2]), "S %5lukB/s", (unsigned long)(bytes_s / 1000));
+  snprintf(line[3], sizeof(line[3]), "A%4lu/s B%3luk", (unsigned long)allocs_s,
+    (unsigned long)(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT) / 1024));
+
+  profiler.pause(true); // HUD not counted
+  uint8_t datum = tft->getTextDatum();
+  uint16_t padding = tft->getTextPadding();
+  int16_t x = DISPLAY_W - PROF_HUD_W;
+  tft->fillRect(x, 0, PROF_HUD_W, PROF_HUD_H, TFT_BLACK);
+  tft->setTextFont(1);
+  tft->setTextDatum(TL_DATUM);
+  tft->setTextPadding(0);
+  tft->setTextColor(TFT_YELLOW, TFT_BLACK);
+  for (int i = 0; i < 4; i++)
+    tft->drawString(line[i], x + 1, 1 + i * 8);
+  tft->setTextDatum(datum);
+  tft->setTextPadding(padding);
+  profiler.pause(false);
+}
+
+#endif // ARDUINO
+
+#else
+
+#define PROF_SCOPE(s)
+#define PROF_PIXELS(n)
+
+#endif // PROFILER
+
+#endif // PROFILER_H
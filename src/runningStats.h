@@ -0,0 +1,155 @@
+#ifndef RUNNINGSTATS_H
+#define RUNNINGSTATS_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Running statistics of a measurement channel in base unit (A or V), so
+// range changes do not invalidate them.
+//
+// StatsAccu holds count, mean and sum of squared deviations (Welford, no
+// cancellation as with sum and sum of squares), mean square for RMS, and
+// min/max with time stamp. add() is O(1); two accumulators can be merged
+// (Chan et al.), which the sliding window uses.
+//
+// ChannelStats keeps two accumulators per channel:
+//  - total: since last reset()
+//  - window: last STATS_WINDOW_BLOCKS * STATS_BLOCK_MS, a ring of block
+//    accumulators. add() only touches the current block, window() merges
+//    the blocks, so the window slides in steps of STATS_BLOCK_MS.
+//
+// Pure logic without hardware access, time is passed by the caller.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define STATS_BLOCK_MS 1000     // Schrittweite des gleitenden Fensters
+#define STATS_WINDOW_BLOCKS 10  // Fensterlänge 10 s
+#define STATS_JSON_SIZE 512
+
+class StatsAccu {
+public:
+  StatsAccu() { reset(); }
+
+  void reset() {
+    count = 0;
+    mean = 0;
+    m2 = 0;
+    meanSq = 0;
+    minVal = maxVal = 0;
+    minMs = maxMs = 0;
+  }
+
+  void add(float value, uint32_t now_ms) {
+    count++;
+    double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+    meanSq += ((double)value * value - meanSq) / count;
+    if ((count == 1) || (value < minVal)) { minVal = value; minMs = now_ms; }
+    if ((count == 1) || (value > maxVal)) { maxVal = value; maxMs = now_ms; }
+  }
+
+  // Add all values of other accumulator
+  void merge(const StatsAccu &other) {
+    if (!other.count) return;
+    if (!count) { *this = other; return; }
+    uint32_t n = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / n;
+    m2 += other.m2 + delta * delta * ((double)count * other.count / n);
+    meanSq += (other.meanSq - meanSq) * other.count / n;
+    if (other.minVal < minVal) { minVal = other.minVal; minMs = other.minMs; }
+    if (other.maxVal > maxVal) { maxVal = other.maxVal; maxMs = other.maxMs; }
+    count = n;
+  }
+
+  float getMean() const { return (float)mean; }
+  float getRms() const { return (float)sqrt(meanSq); }
+  float getStdDev() const { return (count > 1) ? (float)sqrt(m2 / (count - 1)) : 0; } // sample std deviation
+
+  uint32_t count;
+  float minVal, maxVal;
+  uint32_t minMs, maxMs;  // time stamps of min and max
+
+private:
+  double mean, m2, meanSq;
+};
+
+class ChannelStats {
+public:
+  ChannelStats() { reset(0); }
+
+  // Restart total and window
+  void reset(uint32_t now_ms) {
+    total.reset();
+    for (int i = 0; i < STATS_WINDOW_BLOCKS; i++)
+      _blocks[i].reset();
+    _current = 0;
+    _blockStart = now_ms;
+    _resetMs = now_ms;
+  }
+
+  void add(float value, uint32_t now_ms) {
+    total.add(value, now_ms);
+    // start new block(s), clears those that fell out of the window
+    int steps = 0;
+    while (((now_ms - _blockStart) >= STATS_BLOCK_MS) && (steps < STATS_WINDOW_BLOCKS)) {
+      _current = (_current + 1) % STATS_WINDOW_BLOCKS;
+      _blocks[_current].reset();
+      _blockStart += STATS_BLOCK_MS;
+      steps++;
+    }
+    if ((now_ms - _blockStart) >= STATS_BLOCK_MS)
+      _blockStart = now_ms; // longer pause than the window
+    _blocks[_current].add(value, now_ms);
+  }
+
+  // Statistics of the sliding window, O(STATS_WINDOW_BLOCKS)
+  StatsAccu window() const {
+    StatsAccu w;
+    for (int i = 0; i < STATS_WINDOW_BLOCKS; i++)
+      w.merge(_blocks[i]);
+    return w;
+  }
+
+  uint32_t resetMs() const { return _resetMs; }
+
+  // JSON object with total and window, time stamps as age in ms
+  size_t toJson(char *buf, size_t size, uint32_t now_ms) const {
+    StatsAccu w = window();
+    size_t len = snprintf(buf, size, "{\"since_ms\":%lu,\"total\":", (unsigned long)(now_ms - _resetMs));
+    if (len < size) len += _accuJson(buf + len, size - len, total, now_ms);
+    if (len < size) len += snprintf(buf + len, size - len, ",\"window_ms\":%d,\"window\":", STATS_BLOCK_MS * STATS_WINDOW_BLOCKS);
+    if (len < size) len += _accuJson(buf + len, size - len, w, now_ms);
+    if (len < size) len += snprintf(buf + len, size - len, "}");
+    return len;
+  }
+
+  StatsAccu total;
+
+private:
+  StatsAccu _blocks[STATS_WINDOW_BLOCKS];
+  int _current = 0;
+  uint32_t _blockStart = 0, _resetMs = 0;
+
+  static size_t _accuJson(char *buf, size_t size, const StatsAccu &a, uint32_t now_ms) {
+    return snprintf(buf, size, "{\"n\":%lu,\"mean\":%.6g,\"rms\":%.6g,\"stddev\":%.6g,"
+      "\"min\":%.6g,\"min_age_ms\":%lu,\"max\":%.6g,\"max_age_ms\":%lu}",
+      (unsigned long)a.count, a.getMean(), a.getRms(), a.getStdDev(),
+      a.minVal, (unsigned long)(now_ms - a.minMs), a.maxVal, (unsigned long)(now_ms - a.maxMs));
+  }
+};
+
+#endif // RUNNINGSTATS_H
@@ -0,0 +1,164 @@
+#ifndef SCOPETRIGGER_H
+#define SCOPETRIGGER_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Trigger engine for the scope page. push() is called at the acquisition rate
+// (TRIG_SAMPLE_MS, Ticker callback) with raw ADC values of all channels and
+// writes them into a ring buffer of length() samples.
+//
+// Sequence after arm():
+//  - holdoff: wait holdoffMs after the last trigger
+//  - pre-fill: collect prePct percent of length() samples as history
+//  - armed: look for an edge of the source channel through level. The signal
+//    must first be TRIG_HYST LSB on the other side of the level, so noise
+//    around the level does not trigger. In auto mode, a missing trigger is
+//    forced after TRIG_AUTO_MS, the display keeps running.
+//  - post: fill the rest of the buffer after the trigger
+//  - captured: push() ignores samples until loop() has read the capture with
+//    sample() and called arm() again (not in single mode, the trace stays
+//    frozen until the next arm()).
+//
+// Only push() writes while not captured, only loop() reads while captured,
+// so the state variable is the only shared flag.
+// Pure logic without hardware access, time is passed by the caller.
+
+#include <stdint.h>
+
+#define TRIG_CHANNELS 2         // Strom, Spannung
+#define TRIG_MAX_LEN 320        // SCOPE_MAXPOINTS
+#define TRIG_CAPTURE_LEN 200    // Aufnahmelänge, 200 ms bei TRIG_SAMPLE_MS
+#define TRIG_SAMPLE_MS 1        // Abtastrate der getriggerten Aufnahme
+#define TRIG_HYST 8             // ADC-LSB Hysterese der Triggerschwelle
+#define TRIG_AUTO_MS 500        // Auto-Modus: erzwungener Trigger nach dieser Zeit
+
+enum trigMode_e {
+  trig_roll = 0,    // no trigger, free running roll chart
+  trig_auto,        // trigger on edge, forced after TRIG_AUTO_MS
+  trig_normal,      // trigger on edge only
+  trig_single       // one capture, frozen until re-armed
+};
+
+enum trigEdge_e {
+  trig_rising = 0,
+  trig_falling
+};
+
+class ScopeTrigger {
+public:
+  ScopeTrigger() { }
+
+  // Configuration, takes effect on next arm(). push() reads it from the
+  // Ticker context, so change it only while stopped (stop() or Ticker detached)
+  trigMode_e mode = trig_roll;
+  trigEdge_e edge = trig_rising;
+  int source = 0;           // channel index
+  int level = 2048;         // raw ADC value
+  int prePct = 25;          // pre-trigger history in percent of length
+  uint32_t holdoffMs = 100; // minimum time between triggers
+
+  // Set capture length in samples, stops acquisition
+  void setLength(int len) {
+    _state = st_idle;
+    _len = (len < 2) ? 2 : ((len > TRIG_MAX_LEN) ? TRIG_MAX_LEN : len);
+    _pos = 0;
+  }
+  int length() const { return _len; }
+
+  // Start next capture
+  void arm() {
+    _state = st_idle;
+    _pre = (_len * prePct) / 100;
+    if (_pre >= _len) _pre = _len - 1;
+    _count = 0;
+    _beyond = false;
+    _forced = false;
+    _state = st_holdoff;
+  }
+
+  void stop() { _state = st_idle; }
+
+  // New set of raw values, one per channel
+  void push(const int16_t *values, uint32_t now_ms) {
+    switch (_state) {
+      case st_holdoff:
+        if ((now_ms - _trigMs) < holdoffMs) return;
+        _armMs = now_ms;
+        _state = st_prefill;
+        // fall through
+      case st_prefill:
+        _write(values);
+        if (++_count >= _pre) {
+          _armMs = now_ms;
+          _state = st_armed;
+        }
+        break;
+      case st_armed:
+        _write(values);
+        _forced = !_isEdge(values[source]);
+        if (!_forced || ((mode == trig_auto) && ((now_ms - _armMs) >= TRIG_AUTO_MS))) {
+          _trigIdx = (_pos + _len - 1) % _len; // sample just written
+          _trigMs = now_ms;
+          _count = _len - _pre - 1; // samples after trigger sample
+          _state = (_count > 0) ? st_post : st_captured;
+        }
+        break;
+      case st_post:
+        _write(values);
+        if (--_count <= 0)
+          _state = st_captured;
+        break;
+      default:
+        break;
+    }
+  }
+
+  bool captured() const { return _state == st_captured; }
+  bool isArmed() const { return (_state != st_idle) && (_state != st_captured); }
+  bool forced() const { return _forced; }   // auto trigger without edge
+  int triggerPos() const { return _pre; }   // index of trigger sample in capture
+
+  // Captured raw value of channel, i = 0..length()-1 in time order
+  int16_t sample(int channel, int i) const {
+    int idx = (_trigIdx - _pre + i + 2 * _len) % _len;
+    return _buf[channel][idx];
+  }
+
+private:
+  enum state_e { st_idle, st_holdoff, st_prefill, st_armed, st_post, st_captured };
+  volatile state_e _state = st_idle;
+  int16_t _buf[TRIG_CHANNELS][TRIG_MAX_LEN];
+  int _len = TRIG_MAX_LEN;
+  int _pos = 0, _count = 0, _pre = 0, _trigIdx = 0;
+  uint32_t _trigMs = 0, _armMs = 0;
+  bool _beyond = false;       // signal was on the other side of level
+  bool _forced = false;
+
+  void _write(const int16_t *values) {
+    for (int c = 0; c < TRIG_CHANNELS; c++)
+      _buf[c][_pos] = values[c];
+    _pos = (_pos + 1) % _len;
+  }
+
+  bool _isEdge(int value) {
+    if (edge == trig_rising) {
+      if (value < level - TRIG_HYST) _beyond = true;
+      return _beyond && (value >= level);
+    }
+    if (value > level + TRIG_HYST) _beyond = true;
+    return _beyond && (value <= level);
+  }
+};
+
+#endif // SCOPETRIGGER_H
@@ -0,0 +1,198 @@
+#ifndef SCREENCAPTURE_H
+#define SCREENCAPTURE_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Golden image check for widget rendering, available with #define PROFILER.
+//
+// capture() reads the display back in stripes, computes a CRC32 over the pixels
+// and, if an SD card is present, saves the screen as RGB565 raw file
+// (imgRawHeader_t, big endian pixels, same format as ImageBlitter uses) to
+// GOLDEN_DIR/<name>.565. CRC32 is the zlib one, computed over the file's pixel
+// data, so tools/img_diff can check saved files on the PC.
+//
+// In check mode, the CRCs are compared with GOLDEN_DIR/ref.txt ("name crc" per
+// line); in save mode, ref.txt is rewritten with the current CRCs. Compare
+// saved images of a mismatch with the reference images using tools/img_diff,
+// which prints a per-pixel diff report and writes a diff image.
+//
+// The display must support reading (TFT_MISO connected), as on CYD.
+//
+// The SD card shares VSPI with touch and the SD logger (spiBusArbiter.h):
+// the bus is claimed per file operation and per stripe written, not for the
+// whole run. The stripe buffer comes from the GUI arena.
+
+#ifdef PROFILER
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include <SdFat.h>
+#include <rom/crc.h>
+#include "imageBlit.h"
+#include "guiArena.h"
+#include "spiBusArbiter.h"
+
+#define GOLDEN_DIR "/golden"
+#define GOLDEN_STRIPE_ROWS 8    // Zeilen pro readRect()
+#define GOLDEN_MAX_IMAGES 32
+#define GOLDEN_NAME_LEN 24
+#define GOLDEN_REPORT_SIZE 2560
+
+struct goldenEntry_t {
+  char name[GOLDEN_NAME_LEN];
+  uint32_t crc;
+  uint32_t ref;       // reference CRC, 0 = none
+};
+
+class ScreenCapture {
+public:
+  ScreenCapture(TFT_eSPI *tft, SdFat *sd, SpiBusArbiter *bus) : _tft(tft), _sd(sd), _bus(bus) { }
+
+  // Start a run. save = true: write new reference, false: compare with reference.
+  // sd_ok: SD card mounted, bus not held by caller, else CRCs only
+  void begin(bool save, bool sd_ok) {
+    _save = save;
+    _sdOk = sd_ok;
+    _count = 0;
+    _refCount = 0;
+    if (_sdOk) {
+      _bus->acquire(spi_dev_sd);
+      _sd->mkdir(GOLDEN_DIR);
+      if (!_save)
+        _loadRef();
+      _bus->release();
+    }
+  }
+
+  // Read back the whole display, returns CRC32 of pixels, 0 if out of memory
+  uint32_t capture(const char *name) {
+    GuiArenaScope arena_scope; // stripe freed on return
+    uint16_t *stripe = (uint16_t *)guiArena.alloc(DISPLAY_W * GOLDEN_STRIPE_ROWS * sizeof(uint16_t), gui_mem_large);
+    uint32_t crc = 0;
+    FsFile file;
+    bool write = false;
+    if (stripe && _sdOk) {
+      char path[48];
+      snprintf(path, sizeof(path), GOLDEN_DIR "/%s.565", name);
+      _bus->acquire(spi_dev_sd);
+      write = file.open(path, O_WRONLY | O_CREAT | O_TRUNC);
+      if (write) {
+        imgRawHeader_t hdr = { IMG_RAW_MAGIC, DISPLAY_W, DISPLAY_H };
+        file.write(&hdr, sizeof(hdr));
+      }
+      _bus->release();
+    }
+    for (int y = 0; stripe && (y < DISPLAY_H); y += GOLDEN_STRIPE_ROWS) {
+      int rows = (DISPLAY_H - y < GOLDEN_STRIPE_ROWS) ? DISPLAY_H - y : GOLDEN_STRIPE_ROWS;
+      int n = DISPLAY_W * rows;
+      _tft->readRect(0, y, DISPLAY_W, rows, stripe); // already in display byte order, as in raw files
+      crc = crc32_le(crc, (const uint8_t *)stripe, n * 2);
+      if (write) {
+        _bus->acquire(spi_dev_sd); // touch and SD logger get the bus between stripes
+        file.write(stripe, n * 2);
+        _bus->release();
+      }
+    }
+    if (write) {
+      _bus->acquire(spi_dev_sd);
+      file.close();
+      _bus->release();
+    }
+    if (_count < GOLDEN_MAX_IMAGES) {
+      goldenEntry_t *e = &_entries[_count++];
+      strncpy(e->name, name, sizeof(e->name) - 1);
+      e->name[sizeof(e->name) - 1] = '\0';
+      e->crc = crc;
+      e->ref = _findRef(e->name);
+    }
+    return crc;
+  }
+
+  // Finish run, writes reference in save mode. Returns number of mismatches
+  int end() {
+    if (_sdOk && _save) {
+      FsFile file;
+      _bus->acquire(spi_dev_sd);
+      if (file.open(GOLDEN_DIR "/ref.txt", O_WRONLY | O_CREAT | O_TRUNC)) {
+        for (int i = 0; i < _count; i++) {
+          char line[48];
+          int len = snprintf(line, sizeof(line), "%s %08lx\n", _entries[i].name, (unsigned long)_entries[i].crc);
+          file.write(line, len);
+        }
+        file.close();
+      }
+      _bus->release();
+    }
+    return mismatches();
+  }
+
+  int mismatches() const {
+    int n = 0;
+    for (int i = 0; i < _count; i++)
+      if (!_save && _entries[i].ref && (_entries[i].ref != _entries[i].crc)) n++;
+    return n;
+  }
+
+  // JSON report of last run
+  const char *report() {
+    size_t len = snprintf(_report, sizeof(_report), "{\"mode\":\"%s\",\"sd\":%s,\"images\":[",
+      _save ? "save" : "check", _sdOk ? "true" : "false");
+    for (int i = 0; (i < _count) && (len < sizeof(_report)); i++) {
+      const goldenEntry_t *e = &_entries[i];
+      const char *result = _save ? "saved" : (!e->ref ? "no_ref" : ((e->ref == e->crc) ? "ok" : "DIFF"));
+      len += snprintf(_report + len, sizeof(_report) - len, "%s\n{\"name\":\"%s\",\"crc\":\"%08lx\",\"ref\":\"%08lx\",\"result\":\"%s\"}",
+        i ? "," : "", e->name, (unsigned long)e->crc, (unsigned long)e->ref, result);
+    }
+    if (len < sizeof(_report))
+      snprintf(_report + len, sizeof(_report) - len, "],\"mismatches\":%d}\n", mismatches());
+    return _report;
+  }
+
+private:
+  TFT_eSPI *_tft;
+  SdFat *_sd;
+  SpiBusArbiter *_bus;
+  bool _save = false, _sdOk = false;
+  goldenEntry_t _entries[GOLDEN_MAX_IMAGES];
+  int _count = 0;
+  goldenEntry_t _refs[GOLDEN_MAX_IMAGES];
+  int _refCount = 0;
+  char _report[GOLDEN_REPORT_SIZE] = "";
+
+  void _loadRef() {
+    FsFile file;
+    if (!file.open(GOLDEN_DIR "/ref.txt", O_RDONLY)) return;
+    char line[48];
+    while ((_refCount < GOLDEN_MAX_IMAGES) && (file.fgets(line, sizeof(line)) > 0)) {
+      char *sep = strchr(line, ' ');
+      if (!sep) continue;
+      *sep = '\0';
+      goldenEntry_t *r = &_refs[_refCount++];
+      strncpy(r->name, line, sizeof(r->name) - 1);
+      r->name[sizeof(r->name) - 1] = '\0';
+      r->crc = strtoul(sep + 1, NULL, 16);
+    }
+    file.close();
+  }
+
+  uint32_t _findRef(const char *name) const {
+    for (int i = 0; i < _refCount; i++)
+      if (strcmp(_refs[i].name, name) == 0) return _refs[i].crc;
+    return 0;
+  }
+};
+
+#endif // PROFILER
+
+#endif // SCREENCAPTURE_H
@@ -31,6 +31,9 @@ Speed optimisation by cm 4/2024
 #include "guiObject.h" // Common GUI object for all widgets
 #include "Free_Fonts.h" // Include large fonts
 #include "meterScaleDefaults.h"
+#include "textFormat.h"
+#include "guiArena.h"
+#include "tftDma.h"
 
 #define NUM_TRACES 2 	// Anzahl der Spuren, die gleichzeitig angezeigt werden können
 
@@ -52,7 +55,10 @@ public:
        _tft = tftptr;
     }
 
-    void trace(int trace_idx) {
+    // Draw trace, erase: remove previous roll mode trace shifted by one pixel
+    void trace(int trace_idx, bool erase = true) {
+        PROF_SCOPE(prof_scope);
+        if (!scope.traces[trace_idx].traceVals) return;
         int baseY = scope.screen_h + scope.posY;
         uint16_t bg_color = _tft->color565(0, 60, 30);
         uint16_t color = scope.traces[trace_idx].color;
@@ -61,8 +67,9 @@ public:
         int16_t last_traceY_old = 0;
         for (int i = 1; i < (scope.screen_w - 2); i++) {
             traceY = scope.traces[trace_idx].traceVals[i - 1];
-            _tft->drawLine(i + scope.posX, baseY - last_traceY_old,
-                          i + scope.posX + 1, baseY - traceY, bg_color);
+            if (erase)
+                _tft->drawLine(i + scope.posX, baseY - last_traceY_old,
+                              i + scope.posX + 1, baseY - traceY, bg_color);
             last_traceY_old = traceY;
             traceY = scope.traces[trace_idx].traceVals[i];
             if (i > 1)
@@ -89,19 +96,37 @@ public:
         scope.height = height;
         scope.screen_w = width - SCOPE_TEXT_W - 1;
         scope.screen_h = height - SCOPE_TEXT_H - 2;
+        // Trace buffers live in the GUI arena (PSRAM if present), allocated on first init
+        for (int trace_idx = 0; trace_idx < NUM_TRACES; trace_idx++)
+            if (!scope.traces[trace_idx].traceVals)
+                scope.traces[trace_idx].traceVals = (int16_t *)guiArena.allocPermanent(
+                    SCOPE_MAXPOINTS * sizeof(int16_t), gui_mem_large, "scope");
         _tft->fillRect(scope.posX, scope.screen_h + 2, scope.screen_w, SCOPE_TEXT_H - 2, TFT_BLACK);
         _tft->fillRect(scope.posX + scope.screen_w + 1, scope.posY, SCOPE_TEXT_W - 1, scope.screen_h, TFT_BLACK);
-        _tft->fillRect(posX, posY, scope.screen_w + 1, scope.screen_h + 1, _tft->color565(0, 60, 30));
+        clear();
+    }
+
+    // Clear plot area and draw grid, e.g. before a new triggered capture
+    void clear() {
+        tftDma.fillRect(scope.posX, scope.posY, scope.screen_w + 1, scope.screen_h + 1, _tft->color565(0, 60, 30));
         grid();
     }
 
+    // Time axis labels of following newTrace() calls. span_ms = 0: roll mode,
+    // seconds before now. Else triggered capture of span_ms, labels in ms
+    // relative to trigger at trig_ms from left edge.
+    void setTimeAxis(int span_ms, int trig_ms) {
+        _spanMs = span_ms;
+        _trigMs = trig_ms;
+    }
+
     void newTrace(uint16_t color, int range_idx, int trace_idx, bool show_y_labels) {
         scope.traces[trace_idx].color = color;
         scope.traces[trace_idx].range_idx = range_idx;
-        scope.traces[trace_idx].scaledecimals = meterScaleSmallDecimals[range_idx];
-        scope.traces[trace_idx].maxVal = meterScaleMaxVal[range_idx];
-        scope.traces[trace_idx].scaledecimals = meterScaleDecimals[range_idx];
-        for (int i = 0; i < (scope.screen_w); i++) {
+        scope.traces[trace_idx].scaledecimals = meterRanges[range_idx].smallDecimals;
+        scope.traces[trace_idx].maxVal = meterRanges[range_idx].maxVal;
+        scope.traces[trace_idx].scaledecimals = meterRanges[range_idx].scaleDecimals;
+        for (int i = 0; scope.traces[trace_idx].traceVals && (i < scope.screen_w); i++) {
             scope.traces[trace_idx].traceVals[i] = 0;
         }
         int grid_pixels = 2 * scope.screen_w / SCOPE_DIVX;
@@ -118,7 +143,10 @@ public:
             } else {
                 _tft->setTextDatum(TC_DATUM);
             }
-            _tft->drawString(String(time_val) + "s", scope.posX + i, posY, 1);
+            if (_spanMs)
+                _tft->drawString(LabelBuf().num(i * _spanMs / scope.screen_w - _trigMs).add("ms"), scope.posX + i, posY, 1);
+            else
+                _tft->drawString(LabelBuf().num(time_val).add("s"), scope.posX + i, posY, 1);
             time_val -= 5;
         }
         if (show_y_labels) {
@@ -135,7 +163,7 @@ public:
                 } else {
                     _tft->setTextDatum(CL_DATUM);
                 }
-                _tft->drawFloat(val, meterScaleSmallDecimals[range_idx], scope.posX + scope.screen_w + 3, posY - i, 1);
+                _tft->drawFloat(val, meterRanges[range_idx].smallDecimals, scope.posX + scope.screen_w + 3, posY - i, 1);
                 val += scope.traces[trace_idx].maxVal / SCOPE_DIVY;
             }
         }
@@ -143,23 +171,59 @@ public:
     }
 
     void newSample(float level, int trace_idx) {
+        if (!scope.traces[trace_idx].traceVals) return;
         for (int i = 0; i < (scope.screen_w - 2); i++) {
             scope.traces[trace_idx].traceVals[i] = scope.traces[trace_idx].traceVals[i + 1];
         }
+        scope.traces[trace_idx].traceVals[scope.screen_w - 2] = _levelToY(level);
+    }
+
+    // Replace whole trace by n levels, e.g. a triggered capture, stretched to plot width.
+    // Call clear() and trace(idx, false), erasing only works for the roll mode predecessor.
+    void setTrace(int trace_idx, const float *levels, int n) {
+        int points = scope.screen_w - 1;
+        if (!scope.traces[trace_idx].traceVals) return;
+        for (int i = 0; i < points; i++)
+            scope.traces[trace_idx].traceVals[i] = _levelToY(levels[(n > 1) ? (i * (n - 1)) / (points - 1) : 0]);
+    }
+
+    // Dashed vertical line at trigger position (0..1 of plot width)
+    // and a tick at trigger level on the left edge
+    void triggerMarker(float pos, float level, uint16_t color) {
+        int x = scope.posX + 1 + (int)(pos * (scope.screen_w - 2));
+        for (int y = scope.posY + 1; y < scope.posY + scope.screen_h; y += 6)
+            _tft->drawFastVLine(x, y, 3, color);
+        int y = scope.posY + scope.screen_h - _levelToY(level);
+        _tft->drawFastHLine(scope.posX + 1, y, 6, color);
+    }
+
+    // Short status text below the y labels, e.g. trigger mode
+    void status(const char *text, uint16_t color) {
+        _tft->setTextFont(1);
+        _tft->setTextColor(color, TFT_BLACK);
+        _tft->setTextDatum(TL_DATUM);
+        _tft->setTextPadding(SCOPE_TEXT_W - 2);
+        _tft->drawString(text, scope.posX + scope.screen_w + 3, scope.posY + scope.screen_h + 4, 1);
+        _tft->setTextPadding(0);
+    }
+
+private:
+    TFT_eSPI *_tft;
+    int _spanMs = 0, _trigMs = 0;
+
+    int16_t _levelToY(float level) {
         int16_t traceY = (int16_t)(level * scope.screen_h);
         if (traceY >= scope.screen_h)
             traceY = scope.screen_h - 1;
-        scope.traces[trace_idx].traceVals[scope.screen_w - 2] = traceY;
+        return traceY;
     }
 
-private:
-    TFT_eSPI *_tft;
     struct trace_t {
         int range_idx;
         int scaledecimals;
         float maxVal;
         uint16_t color;
-        int16_t traceVals[SCOPE_MAXPOINTS];
+        int16_t *traceVals = NULL;  // SCOPE_MAXPOINTS values, see init()
     };
     struct {
         int posX, posY, width, height;
@@ -0,0 +1,617 @@
+#ifndef SDLOGGER_H
+#define SDLOGGER_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// SD card measurement logger with double-buffered 512 byte block writes.
+//
+// Samples (64 bit timestamp + up to LOG_MAX_CHANNELS raw values) are delta
+// encoded into 512 byte blocks, LOG_BUFFER_BLOCKS blocks make up one buffer.
+// A full buffer is handed to a background writer task via a FreeRTOS queue
+// while the producer continues with the other buffer. Writes are always whole,
+// block-aligned buffers into a preallocated contiguous file, so the SD card
+// never has to search for free clusters while logging.
+//
+// File format (version LOG_FORMAT_VERSION), all values little endian:
+//   [data block 0] ... [data block n-1] [index blocks] [trailer block]
+// Data block: logBlockHeader_t with time range and min/max per channel, then
+// records. First record of a block is relative to zero, following records are
+// deltas to the previous record: time as unsigned varint (LEB128), values as
+// zigzag varints. Every block decodes on its own, so a reader can binary-search
+// blocks by time and skip blocks by their min/max without decoding.
+// Index: up to LOG_INDEX_ENTRIES logIndexEntry_t, each summarizing groupBlocks
+// consecutive data blocks. When the index is full, neighbouring entries are
+// merged and the group size doubles, so the index RAM stays fixed for any
+// log length. Trailer: logTrailer_t at the start of the last block.
+// Index and trailer are written by end(); after a brown-out they are missing
+// and a reader has to scan the block headers instead.
+//
+// Every LOG_SYNC_INTERVAL_MS a block is flagged with LOG_FLAG_SYNC and the
+// writer syncs the file after writing it. After a brown-out, all blocks up to
+// the last sync-flagged block are guaranteed to be on the card; the reader
+// stops at the first block with wrong magic or sequence number.
+//
+// log() never blocks: if both buffers are busy, the sample is dropped and counted.
+// A short write or failed sync stops the log: the file is truncated to the
+// blocks written completely and closed, the buffer stays queued and further
+// samples are dropped, writeError() reports it. The reader scans such a file
+// like one after a brown-out.
+// Only one producer (task or ticker) may call log().
+//
+// With a SpiBusArbiter, the writer claims the SPI bus for LOG_BUS_SLICE_BLOCKS
+// blocks at a time and gives a waiting touch read a slot between slices.
+//
+// Without ARDUINO defined, a host stand-in writes to a regular file
+// (buffer handoff is synchronous then), see tools/sdlog_bench.
+// A host reader/exporter is in tools/sdlog_reader.
+
+#ifdef ARDUINO
+  #include <Arduino.h>
+  #include <SdFat.h>
+  #include "spiBusArbiter.h"
+#else
+  #include <cstdint>
+  #include <cstdio>
+  #include <cstring>
+  #include <chrono>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #ifndef DEBUG_PRINTF
+    #define DEBUG_PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+  #endif
+#endif
+
+#define LOG_BLOCK_SIZE 512
+#define LOG_BUFFER_BLOCKS 8     // Blöcke pro Puffer, 4 KB pro Schreibvorgang
+#define LOG_BUFFER_SIZE (LOG_BLOCK_SIZE * LOG_BUFFER_BLOCKS)
+#define LOG_BUFFER_COUNT 2      // Doppelpuffer
+#define LOG_MAX_CHANNELS 4
+#define LOG_SYNC_INTERVAL_MS 1000
+#define LOG_PREALLOC_BYTES (64UL * 1024UL * 1024UL) // 64 MB zusammenhängend vorbelegen
+#define LOG_WRITER_STACK 4096
+#define LOG_WRITER_PRIO 2
+#define LOG_BUS_SLICE_BLOCKS 2  // Blöcke pro SPI-Buszuteilung, dazwischen darf Touch lesen
+#define LOG_INDEX_ENTRIES 128   // Index-Einträge im RAM, 6 KB
+#define LOG_INDEX_GROUP_MIN 16  // Datenblöcke pro Index-Eintrag zu Beginn
+
+#define LOG_MAGIC 0x4C50424BUL        // "KBPL" little endian
+#define LOG_INDEX_MAGIC 0x4950424BUL  // "KBPI" little endian
+#define LOG_FORMAT_VERSION 2
+#define LOG_FLAG_SYNC 0x01       // Datei nach diesem Block synchronisiert
+#define LOG_FLAG_LAST 0x02       // letzter Block der Aufzeichnung
+
+// 48 byte header at start of every 512 byte data block
+struct logBlockHeader_t {
+  uint32_t magic;       // LOG_MAGIC
+  uint32_t seq;         // fortlaufende Blocknummer ab 0
+  uint64_t t_first;     // Zeitstempel erstes Sample (us)
+  uint64_t t_last;      // Zeitstempel letztes Sample (us)
+  uint16_t count;       // Anzahl Samples im Block
+  uint16_t used;        // belegte Nutzdaten-Bytes nach dem Header
+  uint8_t channels;     // Kanäle pro Sample
+  uint8_t flags;        // LOG_FLAG_xxx
+  uint8_t version;      // LOG_FORMAT_VERSION
+  uint8_t reserved;
+  int16_t vmin[LOG_MAX_CHANNELS]; // Minimum pro Kanal im Block
+  int16_t vmax[LOG_MAX_CHANNELS]; // Maximum pro Kanal im Block
+};
+
+// Index entry, summarizes "blocks" data blocks starting at first_block
+struct logIndexEntry_t {
+  uint64_t t_first;
+  uint64_t t_last;
+  uint32_t first_block;
+  uint32_t blocks;
+  uint32_t samples;
+  uint32_t reserved;
+  int16_t vmin[LOG_MAX_CHANNELS];
+  int16_t vmax[LOG_MAX_CHANNELS];
+};
+
+// Trailer at start of the last block of a completely written log file
+struct logTrailer_t {
+  uint32_t magic;         // LOG_INDEX_MAGIC
+  uint8_t version;        // LOG_FORMAT_VERSION
+  uint8_t channels;
+  uint16_t entrySize;     // sizeof(logIndexEntry_t)
+  uint32_t dataBlocks;    // Anzahl Datenblöcke, Index beginnt bei Block dataBlocks
+  uint32_t indexEntries;
+  uint32_t groupBlocks;   // Datenblöcke pro Index-Eintrag (letzter ggf. weniger)
+  uint32_t dropped;       // verworfene Samples
+  uint64_t samples;
+  uint64_t t_first;
+  uint64_t t_last;
+};
+
+#define LOG_PAYLOAD_SIZE (LOG_BLOCK_SIZE - sizeof(logBlockHeader_t))
+// Worst case encoded record: 10 byte time varint, 3 bytes per channel delta
+#define LOG_RECORD_MAX(ch) (10 + 3 * (ch))
+
+// Varint helpers, shared with the host reader
+inline uint8_t *logPutVarint(uint8_t *p, uint64_t v) {
+  while (v >= 0x80) {
+    *p++ = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  *p++ = (uint8_t)v;
+  return p;
+}
+
+inline const uint8_t *logGetVarint(const uint8_t *p, const uint8_t *end, uint64_t *v) {
+  uint64_t result = 0;
+  int shift = 0;
+  while ((p < end) && (shift < 64)) {
+    uint8_t b = *p++;
+    result |= (uint64_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) {
+      *v = result;
+      return p;
+    }
+    shift += 7;
+  }
+  return NULL; // truncated
+}
+
+inline uint32_t logZigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t logUnzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+class SdLogger {
+public:
+
+#ifdef ARDUINO
+  SdLogger(SdFat *sd, SpiBusArbiter *bus = NULL) : _sd(sd), _bus(bus) { _reset(); }
+#else
+  SdLogger() { _reset(); }
+#endif
+
+  // Create log file, preallocate and start writer task.
+  // On the device, the SD card must be started with start_SD() before,
+  // end_SD() may be called right after begin() returned.
+  bool begin(const char *filename, uint8_t channels) {
+    if (_running) return false;
+    if ((channels == 0) || (channels > LOG_MAX_CHANNELS)) return false;
+    _reset();
+    _channels = channels;
+#ifdef ARDUINO
+    if (!_file.open(filename, O_RDWR | O_CREAT | O_TRUNC)) {
+      DEBUG_PRINTLN("SdLogger: open failed");
+      return false;
+    }
+    if (!_file.preAllocate(LOG_PREALLOC_BYTES)) {
+      DEBUG_PRINTLN("SdLogger: preAllocate failed, file not contiguous");
+    }
+    _queue = xQueueCreate(LOG_BUFFER_COUNT + 1, sizeof(uint8_t));
+    _done = xSemaphoreCreateBinary();
+    if (!_queue || !_done) {
+      _file.close();
+      return false;
+    }
+    xTaskCreatePinnedToCore(_writerTask, "sdlog", LOG_WRITER_STACK, this, LOG_WRITER_PRIO, &_task, 0);
+#else
+    _fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (_fd < 0) return false;
+    #ifdef __linux__
+      posix_fallocate(_fd, 0, LOG_PREALLOC_BYTES);
+    #endif
+#endif
+    _lastSyncMs = _millis();
+    _fillBuf = 0;
+    _bufState[0] = buf_filling;
+    _running = true;
+    return true;
+  }
+
+  // Append one sample, values must hold "channels" raw values.
+  // Timestamps must not decrease, use a 64 bit clock for multi-day logs.
+  // Returns false if the sample was dropped (both buffers busy or not running)
+  bool log(uint64_t time_us, const int16_t *values) {
+    if (!_running) return false;
+    if (_writeError) {
+      _dropped++;
+      return false;
+    }
+    if ((_fillBuf < 0) && !_claimBuffer()) {
+      _dropped++;
+      return false;
+    }
+    uint8_t *block = _buffers[_fillBuf] + _blockIdx * LOG_BLOCK_SIZE;
+    logBlockHeader_t *hdr = (logBlockHeader_t *)block;
+    if (_recordIdx == 0)
+      _openBlock(hdr, time_us);
+    if (time_us < hdr->t_last)
+      time_us = hdr->t_last; // clock went backwards, keep deltas positive
+    uint8_t *payload = block + sizeof(logBlockHeader_t);
+    uint8_t *p = logPutVarint(payload + hdr->used, time_us - hdr->t_last);
+    for (int ch = 0; ch < _channels; ch++) {
+      int16_t v = values[ch];
+      p = logPutVarint(p, logZigzag((int32_t)v - _prevValues[ch]));
+      _prevValues[ch] = v;
+      if (v < hdr->vmin[ch]) hdr->vmin[ch] = v;
+      if (v > hdr->vmax[ch]) hdr->vmax[ch] = v;
+    }
+    hdr->used = p - payload;
+    hdr->t_last = time_us;
+    _recordIdx++;
+    hdr->count = _recordIdx;
+    _samples++;
+    if ((int)(LOG_PAYLOAD_SIZE - hdr->used) < LOG_RECORD_MAX(_channels)) {
+      // no room for another worst case record
+      _closeBlock(block);
+      _recordIdx = 0;
+      _blockIdx++;
+      if (_blockIdx >= LOG_BUFFER_BLOCKS)
+        _handoff(LOG_BUFFER_BLOCKS);
+    }
+    return true;
+  }
+
+  // Flush pending samples, write index and trailer, truncate preallocated space and close file.
+  // On the device, the SPI bus must not be held by the caller, the writer needs it.
+  void end() {
+    if (!_running) return;
+    _running = false;
+    if ((_fillBuf >= 0) && !_writeError) {
+      int blocks = _blockIdx;
+      if (_recordIdx > 0) {
+        _closeBlock(_buffers[_fillBuf] + _blockIdx * LOG_BLOCK_SIZE);
+        blocks++;
+      }
+      if (blocks > 0) {
+        ((logBlockHeader_t *)(_buffers[_fillBuf] + (blocks - 1) * LOG_BLOCK_SIZE))->flags |= LOG_FLAG_LAST;
+        _bufSync[_fillBuf] = true;
+        _handoff(blocks);
+      }
+    }
+#ifdef ARDUINO
+    uint8_t stop_cmd = 0xFF;
+    xQueueSend(_queue, &stop_cmd, portMAX_DELAY);
+    xSemaphoreTake(_done, portMAX_DELAY); // writer has written all buffers
+    vQueueDelete(_queue);
+    vSemaphoreDelete(_done);
+    if (!_writeError) {
+      _busAcquire();
+      _writeIndex();
+      _file.truncate(_bytesWritten);
+      _file.close();
+      _busRelease();
+    }
+#else
+    if (!_writeError) {
+      _writeIndex();
+      if (ftruncate(_fd, _bytesWritten) < 0)
+        DEBUG_PRINTF("SdLogger: truncate failed\n");
+      fsync(_fd);
+      close(_fd);
+      _fd = -1;
+    }
+#endif
+    DEBUG_PRINTF("SdLogger: %u samples, %u blocks, %u index entries, %u dropped\n",
+      (unsigned)_samples, (unsigned)_blocksWritten, (unsigned)_indexCount, (unsigned)_dropped);
+  }
+
+  bool isRunning() const { return _running; }
+  bool writeError() const { return _writeError; }           // file closed after a failed write
+  uint32_t samples() const { return _samples; }
+  uint32_t droppedSamples() const { return _dropped; }
+  uint32_t blocksWritten() const { return _blocksWritten; }
+  uint32_t bytesWritten() const { return _bytesWritten; }   // file size after end()
+  uint32_t maxWriteMicros() const { return _maxWriteUs; }   // longest buffer write
+
+private:
+  enum { buf_free = 0, buf_filling, buf_queued };
+
+  uint8_t _buffers[LOG_BUFFER_COUNT][LOG_BUFFER_SIZE] __attribute__((aligned(4)));
+  volatile uint8_t _bufState[LOG_BUFFER_COUNT];
+  volatile uint16_t _bufBlocks[LOG_BUFFER_COUNT]; // number of valid blocks in queued buffer
+  volatile bool _bufSync[LOG_BUFFER_COUNT];        // sync file after writing buffer
+  int _fillBuf;                 // buffer being filled, -1 if none available
+  int _blockIdx, _recordIdx;
+  uint8_t _channels;
+  int16_t _prevValues[LOG_MAX_CHANNELS]; // last values in current block for delta encoding
+  uint32_t _seq, _lastSyncMs;
+  volatile uint32_t _samples, _dropped, _blocksWritten, _bytesWritten, _maxWriteUs;
+  volatile bool _running;
+  volatile bool _writeError;
+
+  // Index, filled by the producer when a block is closed
+  logIndexEntry_t _index[LOG_INDEX_ENTRIES];
+  uint32_t _indexCount;     // completed entries
+  uint32_t _groupBlocks;    // data blocks per entry
+  uint32_t _groupFill;      // data blocks in current entry
+
+#ifdef ARDUINO
+  SdFat *_sd;
+  SpiBusArbiter *_bus;
+  FsFile _file;
+  QueueHandle_t _queue;
+  SemaphoreHandle_t _done;
+  TaskHandle_t _task;
+
+  static uint32_t _millis() { return millis(); }
+  static uint32_t _micros() { return micros(); }
+
+  // Background writer, receives buffer indices from the queue
+  static void _writerTask(void *arg) {
+    SdLogger *self = (SdLogger *)arg;
+    uint8_t idx;
+    while (true) {
+      xQueueReceive(self->_queue, &idx, portMAX_DELAY);
+      if (idx == 0xFF) break;
+      self->_writeBuffer(idx);
+    }
+    xSemaphoreGive(self->_done);
+    vTaskDelete(NULL);
+  }
+
+  void _busAcquire() {
+    if (_bus) _bus->acquire(spi_dev_sd);
+  }
+
+  void _busRelease() {
+    if (_bus) _bus->release();
+  }
+
+  bool _fileWrite(const uint8_t *data, size_t len) {
+    return _file.write(data, len) == len;
+  }
+#else
+  int _fd = -1;
+
+  static uint32_t _millis() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+  }
+  static uint32_t _micros() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+  }
+
+  bool _fileWrite(const uint8_t *data, size_t len) {
+    return write(_fd, data, len) == (ssize_t)len;
+  }
+#endif
+
+  void _reset() {
+    for (int i = 0; i < LOG_BUFFER_COUNT; i++) {
+      _bufState[i] = buf_free;
+      _bufBlocks[i] = 0;
+      _bufSync[i] = false;
+    }
+    _fillBuf = -1;
+    _blockIdx = 0;
+    _recordIdx = 0;
+    _seq = 0;
+    _samples = 0;
+    _dropped = 0;
+    _blocksWritten = 0;
+    _bytesWritten = 0;
+    _maxWriteUs = 0;
+    _running = false;
+    _writeError = false;
+    _indexCount = 0;
+    _groupBlocks = LOG_INDEX_GROUP_MIN;
+    _groupFill = 0;
+  }
+
+  // Start a new data block with the first sample's timestamp
+  void _openBlock(logBlockHeader_t *hdr, uint64_t time_us) {
+    hdr->magic = LOG_MAGIC;
+    hdr->seq = _seq++;
+    hdr->t_first = time_us;
+    hdr->t_last = time_us;
+    hdr->count = 0;
+    hdr->used = 0;
+    hdr->channels = _channels;
+    hdr->flags = 0;
+    hdr->version = LOG_FORMAT_VERSION;
+    hdr->reserved = 0;
+    for (int ch = 0; ch < LOG_MAX_CHANNELS; ch++) {
+      hdr->vmin[ch] = INT16_MAX;
+      hdr->vmax[ch] = INT16_MIN;
+      _prevValues[ch] = 0;
+    }
+    if (_millis() - _lastSyncMs >= LOG_SYNC_INTERVAL_MS) {
+      hdr->flags |= LOG_FLAG_SYNC;
+      _bufSync[_fillBuf] = true;
+      _lastSyncMs = _millis();
+    }
+  }
+
+  // Clear unused tail of a block, so no stale data ends up on the card,
+  // and add the block to the index
+  void _closeBlock(uint8_t *block) {
+    logBlockHeader_t *hdr = (logBlockHeader_t *)block;
+    size_t used = sizeof(logBlockHeader_t) + hdr->used;
+    memset(block + used, 0, LOG_BLOCK_SIZE - used);
+    _indexAdd(hdr);
+  }
+
+  // Merge a block or another entry into an index entry
+  static void _indexMerge(logIndexEntry_t *e, const int16_t *vmin, const int16_t *vmax,
+                          uint64_t t_last, uint32_t blocks, uint32_t samples) {
+    for (int ch = 0; ch < LOG_MAX_CHANNELS; ch++) {
+      if (vmin[ch] < e->vmin[ch]) e->vmin[ch] = vmin[ch];
+      if (vmax[ch] > e->vmax[ch]) e->vmax[ch] = vmax[ch];
+    }
+    e->t_last = t_last;
+    e->blocks += blocks;
+    e->samples += samples;
+  }
+
+  void _indexAdd(const logBlockHeader_t *hdr) {
+    logIndexEntry_t *e = &_index[_indexCount];
+    if (_groupFill == 0) {
+      memset(e, 0, sizeof(logIndexEntry_t));
+      e->t_first = hdr->t_first;
+      e->first_block = hdr->seq;
+      for (int ch = 0; ch < LOG_MAX_CHANNELS; ch++) {
+        e->vmin[ch] = INT16_MAX;
+        e->vmax[ch] = INT16_MIN;
+      }
+    }
+    _indexMerge(e, hdr->vmin, hdr->vmax, hdr->t_last, 1, hdr->count);
+    if (++_groupFill >= _groupBlocks) {
+      _groupFill = 0;
+      if (++_indexCount >= LOG_INDEX_ENTRIES)
+        _indexCompact();
+    }
+  }
+
+  // Index full: merge neighbouring entries, double the group size
+  void _indexCompact() {
+    for (uint32_t i = 0; i < LOG_INDEX_ENTRIES / 2; i++) {
+      _index[i] = _index[2 * i];
+      const logIndexEntry_t *n = &_index[2 * i + 1];
+      _indexMerge(&_index[i], n->vmin, n->vmax, n->t_last, n->blocks, n->samples);
+    }
+    _indexCount = LOG_INDEX_ENTRIES / 2;
+    _groupBlocks *= 2;
+  }
+
+  // Called by end() after the writer finished: append index and trailer block
+  void _writeIndex() {
+    if (_groupFill > 0) {
+      _indexCount++; // incomplete last entry
+      _groupFill = 0;
+    }
+    logTrailer_t trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.magic = LOG_INDEX_MAGIC;
+    trailer.version = LOG_FORMAT_VERSION;
+    trailer.channels = _channels;
+    trailer.entrySize = sizeof(logIndexEntry_t);
+    trailer.dataBlocks = _blocksWritten;
+    trailer.indexEntries = _indexCount;
+    trailer.groupBlocks = _groupBlocks;
+    trailer.dropped = _dropped;
+    trailer.samples = _samples;
+    if (_indexCount > 0) {
+      trailer.t_first = _index[0].t_first;
+      trailer.t_last = _index[_indexCount - 1].t_last;
+    }
+    // index blocks, first log buffer is free now
+    uint8_t *buf = _buffers[0];
+    size_t len = _indexCount * sizeof(logIndexEntry_t);
+    const uint8_t *src = (const uint8_t *)_index;
+    while (len > 0) {
+      size_t chunk = (len > LOG_BUFFER_SIZE) ? LOG_BUFFER_SIZE : len;
+      size_t padded = (chunk + LOG_BLOCK_SIZE - 1) / LOG_BLOCK_SIZE * LOG_BLOCK_SIZE;
+      memcpy(buf, src, chunk);
+      memset(buf + chunk, 0, padded - chunk);
+      if (!_fileWrite(buf, padded)) return;
+      _bytesWritten += padded;
+      src += chunk;
+      len -= chunk;
+    }
+    memset(buf, 0, LOG_BLOCK_SIZE);
+    memcpy(buf, &trailer, sizeof(trailer));
+    if (_fileWrite(buf, LOG_BLOCK_SIZE))
+      _bytesWritten += LOG_BLOCK_SIZE;
+  }
+
+  // Find a free buffer for the producer
+  bool _claimBuffer() {
+    for (int i = 0; i < LOG_BUFFER_COUNT; i++) {
+      if (_bufState[i] == buf_free) {
+        _bufState[i] = buf_filling;
+        _bufSync[i] = false;
+        _fillBuf = i;
+        _blockIdx = 0;
+        _recordIdx = 0;
+        return true;
+      }
+    }
+    _fillBuf = -1;
+    return false;
+  }
+
+  // Pass filled buffer to writer and continue with next free buffer
+  void _handoff(int blocks) {
+    int idx = _fillBuf;
+    _bufBlocks[idx] = blocks;
+    _bufState[idx] = buf_queued;
+#ifdef ARDUINO
+    uint8_t cmd = idx;
+    xQueueSend(_queue, &cmd, 0); // queue holds all buffers, never blocks
+#else
+    _writeBuffer(idx);
+#endif
+    _claimBuffer();
+  }
+
+  // Called by writer: write complete blocks of one buffer, sync if requested
+  void _writeBuffer(uint8_t idx) {
+    if (_writeError) return; // file is closed, buffer stays queued
+    uint32_t start = _micros();
+    size_t len = _bufBlocks[idx] * LOG_BLOCK_SIZE;
+    size_t written = 0;
+    bool ok = true;
+#ifdef ARDUINO
+    // write in slices, touch controller on the same bus gets a slot in between
+    for (size_t pos = 0; pos < len; pos += LOG_BUS_SLICE_BLOCKS * LOG_BLOCK_SIZE) {
+      size_t slice = len - pos;
+      if (slice > LOG_BUS_SLICE_BLOCKS * LOG_BLOCK_SIZE)
+        slice = LOG_BUS_SLICE_BLOCKS * LOG_BLOCK_SIZE;
+      _busAcquire();
+      ok = _fileWrite(_buffers[idx] + pos, slice);
+      _busRelease();
+      if (!ok) break;
+      written += slice;
+      if (_bus && _bus->touchWaiting())
+        vTaskDelay(1); // let the lower priority touch read take the bus
+    }
+    if (ok && _bufSync[idx]) {
+      _busAcquire();
+      ok = _file.sync();
+      _busRelease();
+    }
+#else
+    ok = _fileWrite(_buffers[idx], len);
+    if (ok) {
+      written = len;
+      if (_bufSync[idx])
+        ok = (fsync(_fd) == 0);
+    }
+#endif
+    _bytesWritten += written;
+    _blocksWritten += written / LOG_BLOCK_SIZE;
+    uint32_t duration = _micros() - start;
+    if (duration > _maxWriteUs)
+      _maxWriteUs = duration;
+    if (!ok) {
+      _writeFailed();
+      return; // keep the buffer, nothing may overwrite it
+    }
+    _bufState[idx] = buf_free;
+  }
+
+  // Short write or failed sync: cut off a partly written slice and close the file
+  void _writeFailed() {
+    DEBUG_PRINTF("SdLogger: write failed after %u blocks\n", (unsigned)_blocksWritten);
+    _writeError = true;
+#ifdef ARDUINO
+    _busAcquire();
+    _file.truncate(_bytesWritten);
+    _file.close();
+    _busRelease();
+#else
+    if (ftruncate(_fd, _bytesWritten) < 0)
+      DEBUG_PRINTF("SdLogger: truncate failed\n");
+    close(_fd);
+    _fd = -1;
+#endif
+  }
+};
+
+#endif // SDLOGGER_H
@@ -15,6 +15,7 @@
 
 #include <Arduino.h>
 #include <SPIFFS.h>
+#include <memory>
 
 #include <WiFi.h>
 #include <WiFiClient.h>
@@ -26,6 +27,8 @@
 
 #include "Free_Fonts.h" // Include the header file attached to this sketch
 #include "global_vars.h"
+#include "textFormat.h"
+#include "dirIterator.h"
 
 // Create AsyncWebServer object on port 80
 AsyncWebServer server(80);
@@ -68,29 +71,169 @@ void onOTAEnd(bool success) {
 
 // handles uploads
 void handleUpload(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final) {
-  String logmessage = "Client:" + request->client()->remoteIP().toString() + " " + request->url();
-  DEBUG_PRINTLN(logmessage);
+  DEBUG_PRINTF("Client: %s %s\n", request->client()->remoteIP().toString().c_str(), request->url().c_str());
   if (!index) {
-    logmessage = "Upload Start: " + String(filename);
+    DEBUG_PRINTF("Upload Start: %s\n", filename.c_str());
     // open the file on first call and store the file handle in the request object
-    request->_tempFile = SPIFFS.open("/" + filename, "w");
-    DEBUG_PRINTLN(logmessage);
+    char path[64];
+    snprintf(path, sizeof(path), "/%s", filename.c_str());
+    request->_tempFile = SPIFFS.open(path, "w");
   }
   if (len) {
     // stream the incoming chunk to the opened file
     request->_tempFile.write(data, len);
-    logmessage = "Writing file: " + String(filename) + " index=" + String(index) + " len=" + String(len);
-    DEBUG_PRINTLN(logmessage);
+    DEBUG_PRINTF("Writing file: %s index=%u len=%u\n", filename.c_str(), (unsigned)index, (unsigned)len);
   }
   if (final) {
-    logmessage = "Upload Complete: " + String(filename) + ",size: " + String(index + len);
     // close the file handle as the upload is now done
     request->_tempFile.close();
-    DEBUG_PRINTLN(logmessage);
+    DEBUG_PRINTF("Upload Complete: %s, size: %u\n", filename.c_str(), (unsigned)(index + len));
     request->redirect("/");
   }
 }
 
+// ##############################################################################
+//
+//  ########  #### ########
+//  ##     ##  ##  ##     ##
+//  ##     ##  ##  ##     ##
+//  ##     ##  ##  ########
+//  ##     ##  ##  ##   ##
+//  ##     ##  ##  ##    ##
+//  ########  #### ##     ##
+//
+// ##############################################################################
+
+#define DIR_WEB_PAGE_ROWS 20  // Tabellenzeilen pro Seite im Web-Verzeichnis
+#define DIR_ROW_BUFSIZE 384   // Puffer für eine Tabellenzeile
+
+// Directory listing as HTML table rows, produced piecewise into the buffers
+// of a chunked response. Only one row is held in memory at a time, so large
+// directories neither blow the heap nor get truncated.
+// page = -1 lists all entries, otherwise DIR_WEB_PAGE_ROWS rows of given page.
+// If full_page is set, HTML header and footer with page links are sent, too.
+class DirHtmlStreamer {
+public:
+  DirHtmlStreamer(int page, const char *filter, bool full_page)
+    : _dir(SPIFFS), _page(page), _fullPage(full_page) {
+    _dir.setFilter(filter);
+    _setFilterArg(filter);
+    _dir.begin();
+    if (page > 0)
+      _dir.skip(page * DIR_WEB_PAGE_ROWS);
+    _rows = 0;
+    _pos = 0;
+    _len = 0;
+    _state = full_page ? st_header : st_rows;
+  }
+
+  // Copy next piece(s) of HTML into buffer, returns 0 when done
+  size_t fill(uint8_t *buffer, size_t max_len) {
+    size_t count = 0;
+    while (count < max_len) {
+      if (_pos >= _len) {
+        if (!_produce())
+          break;
+      }
+      size_t n = _len - _pos;
+      if (n > max_len - count)
+        n = max_len - count;
+      memcpy(buffer + count, _buf + _pos, n);
+      _pos += n;
+      count += n;
+    }
+    return count;
+  }
+
+private:
+  enum { st_header, st_rows, st_pager, st_footer, st_done } _state;
+  DirIterator _dir;
+  int _page, _rows;
+  bool _fullPage;
+  char _buf[DIR_ROW_BUFSIZE];
+  char _filterArg[8 + 3 * DIR_FILTER_LEN]; // "&filter=" URL-encoded for the page links, or empty
+  size_t _pos, _len;
+
+  // Page links keep the filter, percent-encoded as it is user input
+  void _setFilterArg(const char *filter) {
+    static const char hex[] = "0123456789ABCDEF";
+    size_t n = 0;
+    _filterArg[0] = '\0';
+    if ((filter == NULL) || (filter[0] == '\0'))
+      return;
+    n = snprintf(_filterArg, sizeof(_filterArg), "&filter=");
+    for (int i = 0; (i < DIR_FILTER_LEN - 1) && filter[i]; i++) { // same length as DirIterator keeps
+      char c = filter[i];
+      if (isalnum((unsigned char)c) || (c == '.') || (c == '-') || (c == '_') || (c == '~')) {
+        _filterArg[n++] = c;
+      } else {
+        _filterArg[n++] = '%';
+        _filterArg[n++] = hex[(uint8_t)c >> 4];
+        _filterArg[n++] = hex[(uint8_t)c & 15];
+      }
+    }
+    _filterArg[n] = '\0';
+  }
+
+  // Render next piece of HTML into _buf, returns false at end of listing
+  bool _produce() {
+    _pos = 0;
+    _len = 0;
+    while (_len == 0) {
+      switch (_state) {
+      case st_header:
+        _len = snprintf(_buf, sizeof(_buf),
+          "<!DOCTYPE html><html><head><meta charset=\"UTF-8\" /><link rel=\"stylesheet\" href=\"style.css\" />"
+          "<title>Directory</title></head><body><table>\r\n");
+        _state = st_rows;
+        break;
+      case st_rows: {
+        dirEntry_t entry;
+        if (((_page >= 0) && (_rows >= DIR_WEB_PAGE_ROWS)) || !_dir.next(entry)) {
+          _state = st_pager;
+          break;
+        }
+        _rows++;
+        const char *name = entry.name;
+        _len = snprintf(_buf, sizeof(_buf),
+          "<tr><td class=\"link\" style=\"width: 250px\"><a href=\"%s\">%s</a></td>"
+          "<td style=\"width: 100px\"><small>%u Bytes</small></td>"
+          "<td style=\"width: 200px\"><a href=\"%s\" download=\"%s\">Download</a>",
+          name, name, (unsigned)entry.size, name, name);
+        size_t nlen = strlen(name);
+        bool protect = ((nlen >= 4) && (strcmp(name + nlen - 4, "html") == 0)) ||
+                       ((nlen >= 3) && (strcmp(name + nlen - 3, "css") == 0));
+        if (!protect)
+          _len += snprintf(_buf + _len, sizeof(_buf) - _len, " or <a href=\"/?delete=/%s\">Delete</a>", name);
+        _len += snprintf(_buf + _len, sizeof(_buf) - _len, "</td></tr>\r\n");
+        break;
+      }
+      case st_pager:
+        _state = _fullPage ? st_footer : st_done;
+        if ((_page >= 0) && (_page > 0 || _dir.hasMore())) {
+          _len = snprintf(_buf, sizeof(_buf), "<tr><td>");
+          if (_page > 0)
+            _len += snprintf(_buf + _len, sizeof(_buf) - _len, "<a href=\"/dir?page=%d%s\">&lt;&lt; previous</a> ", _page - 1, _filterArg);
+          if (_dir.hasMore())
+            _len += snprintf(_buf + _len, sizeof(_buf) - _len, "<a href=\"/dir?page=%d%s\">more files &gt;&gt;</a>", _page + 1, _filterArg);
+          _len += snprintf(_buf + _len, sizeof(_buf) - _len, "</td><td></td><td></td></tr>\r\n");
+        }
+        break;
+      case st_footer:
+        _len = snprintf(_buf, sizeof(_buf), "</table><br><a href=\"/\">Back</a></body></html>\r\n");
+        _state = st_done;
+        break;
+      default:
+        _dir.end();
+        return false;
+      }
+    }
+    if (_len >= sizeof(_buf))
+      _len = sizeof(_buf) - 1; // truncated by snprintf
+    return true;
+  }
+};
+
 // ##############################################################################
 //
 //  ##     ## ######## ##     ## ##
@@ -105,7 +248,6 @@ void handleUpload(AsyncWebServerRequest *request, String filename, size_t index,
 // Server HTML Processing
 // Send values for root page, requested by placeholder in string var
 String html_process_root(const String& var) {
-  String param;
   if (var == "STA_SSID") {
     return String(settings.ssid);
   } else if (var == "STA_PASSWORD") {
@@ -123,21 +265,15 @@ String html_process_root(const String& var) {
 
   // Restliche Anzeige, keine Optionen. Tabellenzeilen <tr></tr> schicken
   } else if (var == "DIRECTORY") {
-    String dirList = "";
-    File root = SPIFFS.open("/");
-    File file = root.openNextFile();
-    String filename;
-    while (file) {
-      filename = file.name();
-      DEBUG_PRINTLN(file.name());
-      //dirList = dirList + "<a href=\"" + file.name() + "\">" + file.name() + "</a> (" + file.size() + " Bytes)<br>";
-      dirList = dirList + "<tr><td class=\"link\" style=\"width: 250px\"><a href=\"" + filename + "\">" + filename + "</a></td>";
-      dirList = dirList + "<td style=\"width: 100px\"><small>" + file.size() + " Bytes</small></td>";
-      dirList = dirList + "<td style=\"width: 200px\"><a href=\"" + filename + "\" download=\"" + filename + "\">Download</a>";
-      if ((!filename.endsWith("html")) && (!filename.endsWith("css")))
-        dirList = dirList + " or <a href=\"/?delete=/" + filename + "\">Delete</a>";
-      dirList = dirList + "</td></tr>\r\n";
-      file = root.openNextFile();
+    // only first page here, complete list is streamed by "/dir" handler
+    DirHtmlStreamer streamer(0, "", false);
+    String dirList;
+    dirList.reserve(DIR_WEB_PAGE_ROWS * 200);
+    char buf[DIR_ROW_BUFSIZE];
+    size_t len;
+    while ((len = streamer.fill((uint8_t *)buf, sizeof(buf) - 1)) > 0) {
+      buf[len] = '\0';
+      dirList += buf;
     }
     return dirList;
 
@@ -146,24 +282,32 @@ String html_process_root(const String& var) {
   }
 }
 
-// Send values for webpages, requested by placeholder in string var
+// Index of placeholder "<prefix><0..9>", -1 if var has a different name
+int html_param_index(const String& var, const char *prefix) {
+  size_t len = strlen(prefix);
+  if ((var.length() != len + 1) || strncmp(var.c_str(), prefix, len)) return -1;
+  char c = var.c_str()[len];
+  return ((c >= '0') && (c <= '9')) ? c - '0' : -1;
+}
+
+// Send values for webpages, requested by placeholder in string var.
+// The returned String is required by the template processor, values are
+// formatted on the stack to avoid further temporaries
 String html_process_page(const String& var) {
-  String param;
+  LabelBuf value;
   if(var == "adcOffsAmps") {
-    return String(settings.adcRawOffsetAmps);
+    return String(value.num(settings.adcRawOffsetAmps).c_str());
   }
   if(var == "adcOffsVolts") {
-    return String(settings.adcRawOffsetVolts);
+    return String(value.num(settings.adcRawOffsetVolts).c_str());
   }
-  for (int i = 0; i<10; i++) {
-    param = "ACTIVE_" + String(i);
-    if(((settings.ampRangeIdx == i) || (settings.voltRangeIdx == i)) && (var == param)) {
-      return String("ACTIVE");
-    }
-    param = "adcScaling_" + String(i);
-    if(var == param) {
-      return String(settings.adcScalings[i],3);
-    }
+  int i = html_param_index(var, "ACTIVE_");
+  if ((i >= 0) && ((settings.ampRangeIdx == i) || (settings.voltRangeIdx == i))) {
+    return String("ACTIVE");
+  }
+  i = html_param_index(var, "adcScaling_");
+  if (i >= 0) {
+    return String(value.fixed(settings.adcScalings[i], 3).c_str());
   }
   return String();
 }
@@ -194,9 +338,8 @@ void notFound(AsyncWebServerRequest *request) {
 // and sends a response back to the client
 void myGEThandler(AsyncWebServerRequest *request) {
   DEBUG_PRINTLN("Server GET request");
-  String value, param, redirect;
+  const char *redirect = "/";
   bool do_save = false;
-  redirect = "/";
   int param_count = request->params();
   const AsyncWebParameter* p;
   // Parameter anzeigen
@@ -222,13 +365,12 @@ void myGEThandler(AsyncWebServerRequest *request) {
         do_save = true; // ADC Skalierung wurde geändert, also speichern
       }
 
-      // Indizierte Parameter-Listen, 10 Einträge für Skalierung Messbereiche
-      for (int j = 0; j<10; j++) {
-        // adcScaling_0 bis adcScaling_9
-        if (p->name() == "adcScaling_" + String(j)) {
-          settings.adcScalings[j] = p->value().toFloat();
-          do_save = true; // ADC Skalierung wurde geändert, also speichern
-        }
+      // Indizierte Parameter-Liste, 10 Einträge für Skalierung Messbereiche
+      // adcScaling_0 bis adcScaling_9
+      int j = html_param_index(p->name(), "adcScaling_");
+      if (j >= 0) {
+        settings.adcScalings[j] = p->value().toFloat();
+        do_save = true; // ADC Skalierung wurde geändert, also speichern
       }
 
       if (p->name() == "spkrTick") {
@@ -246,19 +388,63 @@ void myGEThandler(AsyncWebServerRequest *request) {
         }
         do_save = true; // Lautsprecher Beep wurde geändert, also speichern
       } else if (p->name() == "ssid_sta") {
-        value = p->value();
-        value.toCharArray(settings.ssid, value.length() + 1); // +1 for null terminator
+        strlcpy(settings.ssid, p->value().c_str(), sizeof(settings.ssid));
         #ifdef DEBUG
           Serial.printf("SSID: %s\n", settings.ssid);
         #endif
         do_save = true; // SSID wurde geändert, also speichern
       } else if (p->name() == "pass_sta") {
-        value = p->value();
-        value.toCharArray(settings.password, value.length() + 1); // +1 for null terminator
+        strlcpy(settings.password, p->value().c_str(), sizeof(settings.password));
         #ifdef DEBUG
           Serial.printf("PASS: %s\n", settings.password);
         #endif
         do_save = true; // Passwort wurde geändert, also speichern
+      } else if (p->name() == "sdlog") {
+        // SD-Logger starten/stoppen, wird in loop() ausgeführt
+        uiQueue.post(ui_cmd_sdlog, p->value() == "on");
+      } else if (p->name() == "stats") {
+        // Statistik zurücksetzen, wird in loop() ausgeführt
+        if (p->value() == "reset")
+          uiQueue.post(ui_cmd_stats_reset);
+      } else if (p->name() == "trig") {
+        // Scope-Trigger: roll, auto, normal, single; arm startet neue Einzelaufnahme
+        // Trigger-Einstellungen setzt nur loop(), der Ticker liest sie beim Abtasten
+        if (p->value() == "roll") uiQueue.post(ui_cmd_trig_mode, trig_roll);
+        else if (p->value() == "auto") uiQueue.post(ui_cmd_trig_mode, trig_auto);
+        else if (p->value() == "normal") uiQueue.post(ui_cmd_trig_mode, trig_normal);
+        else if (p->value() == "single") uiQueue.post(ui_cmd_trig_mode, trig_single);
+        else uiQueue.post(ui_cmd_trig_rearm); // "arm": neue Aufnahme
+      } else if (p->name() == "trig_edge") {
+        uiQueue.post(ui_cmd_trig_edge, (p->value() == "falling") ? trig_falling : trig_rising);
+      } else if (p->name() == "trig_src") {
+        uiQueue.post(ui_cmd_trig_source, (p->value() == "volts") ? volts : amps);
+      } else if (p->name() == "trig_level") {
+        // Fullscale, wie Marker des Bargraphen
+        uiQueue.post(ui_cmd_trig_level, lroundf(constrain(p->value().toFloat(), 0.0f, 1.0f) * UI_LEVEL_SCALE));
+      } else if (p->name() == "trig_pre") {
+        uiQueue.post(ui_cmd_trig_pre, constrain(p->value().toInt(), 0, 100));
+      } else if (p->name() == "trig_holdoff") {
+        uiQueue.post(ui_cmd_trig_holdoff, constrain(p->value().toInt(), 0, 10000));
+      #ifdef PROFILER
+      } else if (p->name() == "prof") {
+        // Profiler: hud, off, reset oder serial (Report auf Serial ausgeben)
+        // alles in loop(), der Profiler zählt dort die Frames
+        if (p->value() == "hud") {
+          uiQueue.post(ui_cmd_prof, ui_prof_hud);
+        } else if (p->value() == "off") {
+          uiQueue.post(ui_cmd_prof, ui_prof_off);
+        } else if (p->value() == "reset") {
+          uiQueue.post(ui_cmd_prof, ui_prof_reset);
+        } else if (p->value() == "serial") {
+          uiQueue.post(ui_cmd_prof, ui_prof_serial);
+        } else if (p->value() == "bench") {
+          uiQueue.post(ui_cmd_bench); // Widget-Benchmark, wird in loop() ausgeführt
+        } else if (p->value() == "golden") {
+          uiQueue.post(ui_cmd_golden, 0); // Golden-Image-Vergleich mit Referenz auf SD-Karte
+        } else if (p->value() == "golden_save") {
+          uiQueue.post(ui_cmd_golden, 1); // neue Referenz speichern
+        }
+      #endif
       } else if (p->name() == "delete") {
         // Datei löschen, wenn Parameter "delete" gesetzt ist
         SPIFFS.remove(p->value());
@@ -269,9 +455,9 @@ void myGEThandler(AsyncWebServerRequest *request) {
   // redirect ist die Seite, die nach dem Speichern neu geladen wird
   if (do_save) {
     #ifdef DEBUG
-      Serial.println("Settings changed by web page, saving to EEPROM");
+      Serial.println("Settings changed by web page, saving to NVS");
     #endif
-    saveCredentials();
+    saveCredentials(); // written by loop() after SETTINGS_COMMIT_DELAY_MS
   }
   // Seite nochmal aktualisiert senden
   request->redirect(redirect);
@@ -308,13 +494,94 @@ void init_server() {
     DEBUG_PRINTLN("Server INDEX ROOT request");
     if(request->hasParam("delete")) {
       Serial.println("Server DELETE request");
-      String value = request->getParam("delete")->value();
+      const String &value = request->getParam("delete")->value();
       if ((!value.endsWith("html")) && (!value.endsWith("css")))
         SPIFFS.remove(value);
     }
     request->send(SPIFFS , "/index.html", String(), false, html_process_root);
   });
 
+  // Route for directory listing, streamed in chunks. Optional parameters
+  // "page" (0..n, all entries if omitted) and "filter" (file name suffix)
+  server.on("/dir", HTTP_GET, [](AsyncWebServerRequest *request){
+    DEBUG_PRINTLN("Server DIR request");
+    int page = -1;
+    const char *filter = "";
+    if (request->hasParam("page"))
+      page = request->getParam("page")->value().toInt();
+    if (request->hasParam("filter"))
+      filter = request->getParam("filter")->value().c_str(); // copied by DirIterator::setFilter()
+    std::shared_ptr<DirHtmlStreamer> streamer = std::make_shared<DirHtmlStreamer>(page, filter, true);
+    request->send(request->beginChunkedResponse("text/html",
+      [streamer](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+        return streamer->fill(buffer, max_len);
+      }));
+  });
+
+  // Route for channel statistics as JSON, reset with /get?stats=reset
+  server.on("/stats", HTTP_GET, [](AsyncWebServerRequest *request){
+    DEBUG_PRINTLN("Server STATS request");
+    char json[2 * STATS_JSON_SIZE + 32];
+    ChannelStats snap; // consistent copy, loop() adds values meanwhile
+    uint32_t now = millis();
+    size_t len = snprintf(json, sizeof(json), "{\"amps\":");
+    portENTER_CRITICAL(&statsMux);
+    snap = statsAmps;
+    portEXIT_CRITICAL(&statsMux);
+    len += snap.toJson(json + len, sizeof(json) - len, now);
+    len += snprintf(json + len, sizeof(json) - len, ",\"volts\":");
+    portENTER_CRITICAL(&statsMux);
+    snap = statsVolts;
+    portEXIT_CRITICAL(&statsMux);
+    len += snap.toJson(json + len, sizeof(json) - len, now);
+    snprintf(json + len, sizeof(json) - len, "}\n");
+    request->send(200, "application/json", json);
+  });
+
+  // Route for memory budget as JSON: static objects, GUI arena, heap, see guiArena.h
+  server.on("/mem", HTTP_GET, [](AsyncWebServerRequest *request){
+    DEBUG_PRINTLN("Server MEM request");
+    static char report[MEM_REPORT_SIZE];
+    memBudgetReport(report, sizeof(report));
+    request->send(200, "application/json", report);
+  });
+
+  // Route for job scheduler load and statistics as JSON, see jobScheduler.h
+  server.on("/sched", HTTP_GET, [](AsyncWebServerRequest *request){
+    DEBUG_PRINTLN("Server SCHED request");
+    static char report[SCHED_JSON_SIZE];
+    scheduler.report(report, sizeof(report));
+    request->send(200, "application/json", report);
+  });
+
+  // Route for power state, backlight and light sensor as JSON, see powerManager.h
+  server.on("/power", HTTP_GET, [](AsyncWebServerRequest *request){
+    DEBUG_PRINTLN("Server POWER request");
+    static char report[POWER_JSON_SIZE];
+    powerManager.report(report, sizeof(report));
+    request->send(200, "application/json", report);
+  });
+
+  #ifdef PROFILER
+    // Route for profiler report as JSON, see profiler.h
+    server.on("/prof", HTTP_GET, [](AsyncWebServerRequest *request){
+      DEBUG_PRINTLN("Server PROFILER request");
+      static char report[PROF_REPORT_SIZE];
+      profiler.report(report, sizeof(report));
+      request->send(200, "application/json", report);
+    });
+    // Route for result of last widget benchmark, started with /get?prof=bench
+    server.on("/bench", HTTP_GET, [](AsyncWebServerRequest *request){
+      DEBUG_PRINTLN("Server BENCH request");
+      request->send(200, "application/json", widgetBench.report());
+    });
+    // Route for result of last golden image run, started with /get?prof=golden
+    server.on("/golden", HTTP_GET, [](AsyncWebServerRequest *request){
+      DEBUG_PRINTLN("Server GOLDEN request");
+      request->send(200, "application/json", screenCapture.report());
+    });
+  #endif
+
   // Route for scalings page
   server.on("/scalings.html", HTTP_GET, [](AsyncWebServerRequest *request){
     DEBUG_PRINTLN("Server SCALINGS PAGE request");
@@ -0,0 +1,354 @@
+#ifndef SETTINGSSTORE_H
+#define SETTINGSSTORE_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Settings store with one record per field instead of one image of the
+// whole settings struct.
+//
+// Each field of the struct is described by a settingsField_t with a stable
+// ID (never reuse an ID for a different meaning), offset and size. A record
+// holds the size, the data and a CRC32. commit() writes only fields that
+// differ from what is stored; markDirty() and update() coalesce several
+// changes within SETTINGS_COMMIT_DELAY_MS into one commit.
+//
+// On load, a field keeps its default if its record is missing or its CRC is
+// wrong. If the stored size differs (struct changed), fields flagged
+// SF_PREFIX take the common prefix, e.g. an array that got longer, others
+// keep their default. A version record allows a migration callback for
+// changes that need code, e.g. a unit change of a field.
+//
+// Records go to a SettingsBackend: NVS via Preferences on the ESP32, which
+// is itself log-structured and wear-levelled, or an append-only log file on
+// the host (see tools/settings_sim).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#ifdef ARDUINO
+  #include <Preferences.h>
+#else
+  #include <unistd.h>
+#endif
+
+#define SETTINGS_MAX_SIZE 512           // maximale Größe der Settings-Struktur
+#define SETTINGS_MAX_FIELDS 64
+#define SETTINGS_COMMIT_DELAY_MS 2000   // Änderungen sammeln, dann schreiben
+#define SETTINGS_KEY_LEN 8
+#define SETTINGS_VERSION_KEY "ver"
+
+#define SF_DEFAULT 0    // size changed: keep default
+#define SF_PREFIX  1    // size changed: copy common prefix (arrays, strings)
+
+struct settingsField_t {
+  uint16_t id;      // stable record ID, never reused
+  uint16_t offset;  // offsetof() in struct
+  uint16_t size;    // sizeof() of field
+  uint8_t flags;    // SF_DEFAULT or SF_PREFIX
+};
+
+// Field descriptor for member of struct type, e.g. SETTINGS_FIELD(settings_t, 3, ssid, SF_PREFIX)
+#define SETTINGS_FIELD(type, id, member, flags) { id, offsetof(type, member), sizeof(type::member), flags }
+
+// CRC32 (zlib polynomial), bitwise, records are small
+inline uint32_t settingsCrc32(uint32_t crc, const uint8_t *data, size_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *data++;
+    for (int k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+// ##############################################################################
+
+class SettingsBackend {
+public:
+  virtual ~SettingsBackend() { }
+  // Read value of key into buf, false if missing or larger than max_len
+  virtual bool read(const char *key, uint8_t *buf, size_t max_len, size_t *len) = 0;
+  virtual bool write(const char *key, const uint8_t *data, size_t len) = 0;
+  // Make writes persistent
+  virtual bool commit() = 0;
+};
+
+#ifdef ARDUINO
+
+// NVS namespace, each record one blob. NVS keeps a CRC per entry and
+// spreads writes over its pages.
+class NvsSettingsBackend : public SettingsBackend {
+public:
+  bool begin(const char *name_space) { return _prefs.begin(name_space, false); }
+  void end() { _prefs.end(); }
+
+  bool read(const char *key, uint8_t *buf, size_t max_len, size_t *len) override {
+    size_t n = _prefs.getBytesLength(key);
+    if ((n == 0) || (n > max_len)) return false;
+    *len = _prefs.getBytes(key, buf, max_len);
+    return *len == n;
+  }
+  bool write(const char *key, const uint8_t *data, size_t len) override {
+    return _prefs.putBytes(key, data, len) == len;
+  }
+  bool commit() override { return true; } // Preferences commits every put
+
+private:
+  Preferences _prefs;
+};
+
+#else
+
+#define SETTINGS_FILE_COMPACT 4096      // Log-Datei ab dieser Größe neu schreiben
+
+// Append-only log file for host builds: [key length][key][value length 2][value] per
+// write. The last complete record of a key wins, a torn record at the end is ignored.
+class FileSettingsBackend : public SettingsBackend {
+public:
+  FileSettingsBackend(const char *path) { strncpy(_path, path, sizeof(_path) - 1); _path[sizeof(_path) - 1] = '\0'; }
+
+  bool read(const char *key, uint8_t *buf, size_t max_len, size_t *len) override {
+    FILE *f = fopen(_path, "rb");
+    if (!f) return false;
+    bool found = false;
+    char k[SETTINGS_KEY_LEN + 1];
+    uint8_t value[SETTINGS_MAX_SIZE + 8];
+    size_t n;
+    while (_next(f, k, value, &n)) {
+      if ((strcmp(k, key) == 0) && (n <= max_len)) {
+        memcpy(buf, value, n);
+        *len = n;
+        found = true;
+      }
+    }
+    fclose(f);
+    return found;
+  }
+
+  // Append record, a torn record left by an interrupted write is cut off first
+  bool write(const char *key, const uint8_t *data, size_t len) override {
+    FILE *f = fopen(_path, "r+b");
+    if (!f) f = fopen(_path, "w+b");
+    if (!f) return false;
+    char k[SETTINGS_KEY_LEN + 1];
+    uint8_t value[SETTINGS_MAX_SIZE + 8];
+    size_t n;
+    long end = 0;
+    while (_next(f, k, value, &n))
+      end = ftell(f);
+    bool ok = (ftruncate(fileno(f), end) == 0) && (fseek(f, end, SEEK_SET) == 0) && _put(f, key, data, len);
+    fclose(f);
+    return ok;
+  }
+
+  bool commit() override {
+    FILE *f = fopen(_path, "rb");
+    if (!f) return true;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return (size < SETTINGS_FILE_COMPACT) ? true : _compact();
+  }
+
+  int compactions = 0;
+
+private:
+  char _path[128];
+
+  static bool _put(FILE *f, const char *key, const uint8_t *data, size_t len) {
+    uint8_t klen = (uint8_t)strlen(key);
+    uint8_t vlen[2] = { (uint8_t)(len & 0xFF), (uint8_t)(len >> 8) };
+    return (fwrite(&klen, 1, 1, f) == 1) && (fwrite(key, 1, klen, f) == klen)
+      && (fwrite(vlen, 1, 2, f) == 2) && (fwrite(data, 1, len, f) == len);
+  }
+
+  static bool _next(FILE *f, char *key, uint8_t *value, size_t *len) {
+    uint8_t klen, vlen[2];
+    if ((fread(&klen, 1, 1, f) != 1) || (klen > SETTINGS_KEY_LEN)) return false;
+    if (fread(key, 1, klen, f) != klen) return false;
+    key[klen] = '\0';
+    if (fread(vlen, 1, 2, f) != 2) return false;
+    *len = vlen[0] | (vlen[1] << 8);
+    if ((*len > SETTINGS_MAX_SIZE + 8) || (fread(value, 1, *len, f) != *len)) return false;
+    return true;
+  }
+
+  // Rewrite file with the last record of each key, like an NVS page erase
+  bool _compact() {
+    char tmp[140];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", _path);
+    FILE *in = fopen(_path, "rb");
+    FILE *out = fopen(tmp, "wb");
+    if (!in || !out) {
+      if (in) fclose(in);
+      if (out) fclose(out);
+      return false;
+    }
+    char keys[SETTINGS_MAX_FIELDS + 1][SETTINGS_KEY_LEN + 1];
+    int count = 0;
+    char k[SETTINGS_KEY_LEN + 1];
+    uint8_t value[SETTINGS_MAX_SIZE + 8];
+    size_t n;
+    while (_next(in, k, value, &n)) {
+      bool known = false;
+      for (int i = 0; i < count; i++)
+        if (strcmp(keys[i], k) == 0) known = true;
+      if (!known && (count <= SETTINGS_MAX_FIELDS))
+        strcpy(keys[count++], k);
+    }
+    fclose(in);
+    bool ok = true;
+    for (int i = 0; ok && (i < count); i++)
+      if (read(keys[i], value, sizeof(value), &n))
+        ok = _put(out, keys[i], value, n);
+    fclose(out);
+    ok = ok && (rename(tmp, _path) == 0);
+    if (ok) compactions++;
+    return ok;
+  }
+};
+
+#endif // ARDUINO
+
+// ##############################################################################
+
+class SettingsStore {
+public:
+  // data: settings struct with defaults, fields: descriptors of all persistent fields
+  SettingsStore(void *data, size_t size, const settingsField_t *fields, int field_count, uint16_t version)
+    : _data((uint8_t *)data), _size(size), _fields(fields), _count(field_count), _version(version) { }
+
+  // Called on load if stored version is older, before fields are committed
+  void setMigration(void (*migrate)(uint16_t from_version, void *data)) { _migrate = migrate; }
+
+  // Load all fields, keeps defaults of missing or invalid ones.
+  // Returns number of fields loaded, 0 if the store is empty
+  int load(SettingsBackend *backend) {
+    _backend = backend;
+    _loaded = 0;
+    _migrated = 0;
+    memset(_stored, 0, sizeof(_stored));
+    if ((_size > SETTINGS_MAX_SIZE) || (_count > SETTINGS_MAX_FIELDS)) return 0;
+    for (int i = 0; i < _count; i++) {
+      const settingsField_t *f = &_fields[i];
+      uint8_t rec[SETTINGS_MAX_SIZE + 8];
+      size_t len;
+      char key[SETTINGS_KEY_LEN];
+      if (!_backend->read(_key(f->id, key), rec, sizeof(rec), &len) || (len < 6)) continue;
+      uint16_t size = rec[0] | (rec[1] << 8);
+      uint32_t crc;
+      memcpy(&crc, rec + len - 4, 4);
+      if ((size + 6u != len) || (settingsCrc32(0, rec, len - 4) != crc)) {
+        crcErrors++;
+        continue; // default
+      }
+      if (size == f->size) {
+        memcpy(_data + f->offset, rec + 2, size);
+        _stored[i] = true; // same as stored, commit only if changed
+      } else if (f->flags & SF_PREFIX) {
+        memcpy(_data + f->offset, rec + 2, (size < f->size) ? size : f->size);
+        _migrated++;
+      } else {
+        _migrated++; // default, written with next commit
+        continue;
+      }
+      _loaded++;
+    }
+    memcpy(_shadow, _data, _size); // as stored, changes by migration are written on commit
+    uint16_t stored_version = 0;
+    size_t len;
+    uint8_t ver[2];
+    if (_backend->read(SETTINGS_VERSION_KEY, ver, sizeof(ver), &len) && (len == 2))
+      stored_version = ver[0] | (ver[1] << 8);
+    if (_loaded && (stored_version < _version) && _migrate)
+      _migrate(stored_version, _data);
+    _storedVersion = stored_version;
+    return _loaded;
+  }
+
+  // Request a commit, written by update() after SETTINGS_COMMIT_DELAY_MS without further requests
+  void markDirty(uint32_t now_ms) {
+    _dirty = true;
+    _dirtyMs = now_ms;
+  }
+
+  // Call regularly from loop(), returns number of fields written
+  int update(uint32_t now_ms) {
+    if (!_dirty || ((now_ms - _dirtyMs) < SETTINGS_COMMIT_DELAY_MS)) return 0;
+    return commit();
+  }
+
+  bool isDirty() const { return _dirty; }
+
+  // Write all changed fields now, returns number of fields written
+  int commit() {
+    _dirty = false;
+    if (!_backend) return 0;
+    int written = 0;
+    for (int i = 0; i < _count; i++) {
+      const settingsField_t *f = &_fields[i];
+      if (_stored[i] && (memcmp(_data + f->offset, _shadow + f->offset, f->size) == 0)) continue;
+      uint8_t rec[SETTINGS_MAX_SIZE + 8];
+      rec[0] = f->size & 0xFF;
+      rec[1] = f->size >> 8;
+      memcpy(rec + 2, _data + f->offset, f->size);
+      uint32_t crc = settingsCrc32(0, rec, f->size + 2);
+      memcpy(rec + 2 + f->size, &crc, 4);
+      char key[SETTINGS_KEY_LEN];
+      if (_backend->write(_key(f->id, key), rec, f->size + 6)) {
+        memcpy(_shadow + f->offset, _data + f->offset, f->size);
+        _stored[i] = true;
+        written++;
+      }
+    }
+    if (_storedVersion != _version) {
+      uint8_t ver[2] = { (uint8_t)(_version & 0xFF), (uint8_t)(_version >> 8) };
+      if (_backend->write(SETTINGS_VERSION_KEY, ver, 2))
+        _storedVersion = _version;
+    }
+    _backend->commit();
+    fieldWrites += written;
+    if (written) commits++;
+    return written;
+  }
+
+  int loaded() const { return _loaded; }
+  int migrated() const { return _migrated; }  // fields with changed size
+
+  // Statistics since start
+  uint32_t commits = 0, fieldWrites = 0, crcErrors = 0;
+
+private:
+  uint8_t *_data;
+  size_t _size;
+  const settingsField_t *_fields;
+  int _count;
+  uint16_t _version;
+  uint16_t _storedVersion = 0;
+  void (*_migrate)(uint16_t from_version, void *data) = NULL;
+  SettingsBackend *_backend = NULL;
+  uint8_t _shadow[SETTINGS_MAX_SIZE];   // data as stored
+  bool _stored[SETTINGS_MAX_FIELDS];    // field has a valid record of current size
+  int _loaded = 0, _migrated = 0;
+  bool _dirty = false;
+  uint32_t _dirtyMs = 0;
+
+  static const char *_key(uint16_t id, char *key) {
+    snprintf(key, SETTINGS_KEY_LEN, "f%u", id);
+    return key;
+  }
+};
+
+#endif // SETTINGSSTORE_H
@@ -0,0 +1,249 @@
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Spectrum analyzer page: block sampler and log-magnitude bar display.
+//
+// SpectrumSampler reads the internal ADC from an esp_timer callback every
+// SPEC_SAMPLE_US into one of two blocks of SPEC_FFT_SIZE samples. A full block
+// is transformed by getSpectrum() in loop() while the other block is filled.
+// If loop() is too slow, the block being filled is overwritten (dropped()).
+// Sample blocks and FFT buffers are temporary GUI arena buffers from start()
+// to stop(): blocks in the large pool (PSRAM if present), FFT work and dB
+// values in the fast pool.
+// The external MCP3421 is too slow for this, the spectrum always uses the
+// internal ADC like the SD logger.
+//
+// SpectrumView draws the FixedFFT result as bars on a linear frequency axis,
+// one bar per SPEC_BAR_PITCH pixels holding the maximum of its bins, with
+// peak hold. Like the bargraphs, update() only draws the part of each bar
+// that changed: the grown part in bar colour, the shrunk part in background
+// colour with the dB grid lines restored.
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include <esp_timer.h>
+#include "fixedFFT.h"
+#include "guiArena.h"
+#include "tftDma.h"
+#include "textFormat.h"
+
+#define SPEC_FFT_SIZE 512       // 256..2048, Auflösung SPEC_SAMPLE_RATE / SPEC_FFT_SIZE
+#define SPEC_SAMPLE_US 250      // 4 kHz Abtastrate, Spektrum bis 2 kHz
+#define SPEC_SAMPLE_RATE (1000000.0f / SPEC_SAMPLE_US)
+#define SPEC_DB_MIN -90         // unterer Rand der Anzeige, dBFS
+#define SPEC_DB_MAX 0
+#define SPEC_GRID_DB 20         // dB-Raster
+#define SPEC_BAR_PITCH 4        // Pixel pro Balken inkl. Lücke
+#define SPEC_MAX_BARS 80
+#define SPEC_PEAK_DECAY 0.5f    // Peak-Hold-Abfall in Pixel pro Block
+#define SPEC_TEXT_W 24          // Breite der dB-Beschriftung links
+#define SPEC_TEXT_H 12          // Höhe der Frequenzbeschriftung unten
+
+// ##############################################################################
+
+class SpectrumSampler {
+public:
+  SpectrumSampler() { }
+
+  // Start sampling of ADC pin, allocates sample blocks and FFT tables
+  bool start(uint8_t pin) {
+    stop();
+    _pin = pin;
+    _mark = guiArena.mark();
+    _allocated = true;
+    _block[0] = (int16_t *)guiArena.alloc(SPEC_FFT_SIZE * sizeof(int16_t), gui_mem_large);
+    _block[1] = (int16_t *)guiArena.alloc(SPEC_FFT_SIZE * sizeof(int16_t), gui_mem_large);
+    _db = (float *)guiArena.alloc((SPEC_FFT_SIZE / 2) * sizeof(float), gui_mem_fast);
+    void *work = guiArena.alloc(FixedFFT::workSize(SPEC_FFT_SIZE), gui_mem_fast);
+    if (!_block[0] || !_block[1] || !_db || !work || !fft.begin(SPEC_FFT_SIZE, work)) {
+      stop();
+      return false;
+    }
+    _fill = 0;
+    _pos = 0;
+    _ready = -1;
+    const esp_timer_create_args_t args = { .callback = _timerCallback, .arg = this, .dispatch_method = ESP_TIMER_TASK, .name = "spectrum" };
+    if (esp_timer_create(&args, &_timer) != ESP_OK) {
+      stop();
+      return false;
+    }
+    esp_timer_start_periodic(_timer, SPEC_SAMPLE_US);
+    return true;
+  }
+
+  // Stop sampling and free all buffers
+  void stop() {
+    if (_timer) {
+      esp_timer_stop(_timer);
+      esp_timer_delete(_timer);
+      _timer = NULL;
+    }
+    fft.end();
+    if (_allocated)
+      guiArena.release(_mark);
+    _allocated = false;
+    _block[0] = _block[1] = NULL;
+    _db = NULL;
+  }
+
+  bool isRunning() const { return _timer != NULL; }
+
+  // Transform a full block if available, returns magnitudes of SPEC_FFT_SIZE / 2 bins in dBFS or NULL
+  const float *getSpectrum() {
+    int ready = _ready;
+    if (ready < 0) return NULL;
+    fft.compute(_block[ready], _db);
+    _ready = -1; // block free for sampler
+    return _db;
+  }
+
+  float binHz() const { return SPEC_SAMPLE_RATE / SPEC_FFT_SIZE; }
+  uint32_t dropped() const { return _dropped; }
+
+  FixedFFT fft;
+
+private:
+  esp_timer_handle_t _timer = NULL;
+  uint8_t _pin = 0;
+  int16_t *_block[2] = { NULL, NULL };
+  float *_db = NULL;
+  volatile int _ready = -1;   // index of full block, -1 = none
+  int _fill = 0, _pos = 0;    // sampler side
+  uint32_t _dropped = 0;
+  guiArenaMark_t _mark;
+  bool _allocated = false;
+
+  static void _timerCallback(void *arg) {
+    SpectrumSampler *self = (SpectrumSampler *)arg;
+    self->_block[self->_fill][self->_pos++] = analogRead(self->_pin);
+    if (self->_pos < SPEC_FFT_SIZE) return;
+    self->_pos = 0;
+    if (self->_ready < 0) {
+      self->_ready = self->_fill; // hand over, fill other block
+      self->_fill ^= 1;
+    } else {
+      self->_dropped++; // loop() still busy, refill same block
+    }
+  }
+};
+
+// ##############################################################################
+
+class SpectrumView {
+public:
+  SpectrumView(TFT_eSPI *tft) { _tft = tft; }
+
+  // Draw frame, grid and labels, bin_hz: frequency resolution, bins: number of bins
+  void init(int x, int y, int w, int h, float bin_hz, int bins, uint16_t color = TFT_GREEN) {
+    _plotX = x + SPEC_TEXT_W;
+    _plotY = y + 2;
+    _plotH = h - SPEC_TEXT_H - 4;
+    _bars = (w - SPEC_TEXT_W - 2) / SPEC_BAR_PITCH;
+    if (_bars > SPEC_MAX_BARS) _bars = SPEC_MAX_BARS;
+    _bins = bins;
+    _color = color;
+    _peakColor = TFT_YELLOW;
+    _bgColor = _tft->color565(0, 30, 40);
+    _gridColor = _tft->color565(0, 80, 100);
+    int plot_w = _bars * SPEC_BAR_PITCH;
+    tftDma.fillRect(x, y, w, h, TFT_BLACK);
+    tftDma.fillRect(_plotX, _plotY, plot_w, _plotH, _bgColor);
+    for (int db = SPEC_DB_MAX; db >= SPEC_DB_MIN; db -= SPEC_GRID_DB)
+      _tft->drawFastHLine(_plotX, _dbToY(db), plot_w, _gridColor);
+    _tft->setTextFont(1);
+    _tft->setTextColor(TFT_WHITE, TFT_BLACK);
+    _tft->setTextDatum(MR_DATUM);
+    for (int db = SPEC_DB_MAX; db >= SPEC_DB_MIN; db -= SPEC_GRID_DB)
+      _tft->drawNumber(db, _plotX - 3, _dbToY(db));
+    // frequency labels at 5 positions
+    _tft->setTextDatum(TC_DATUM);
+    float max_hz = bin_hz * bins;
+    for (int i = 0; i <= 4; i++) {
+      int lx = _plotX + (plot_w - 1) * i / 4;
+      float hz = max_hz * i / 4;
+      LabelBuf label;
+      if (hz >= 1000)
+        label.fixed(hz / 1000, 1).add('k');
+      else
+        label.num((int)hz);
+      _tft->drawFastVLine(lx, _plotY + _plotH, 3, TFT_WHITE);
+      _tft->drawString(label, constrain(lx, x + 12, x + w - 12), _plotY + _plotH + 4);
+    }
+    _tft->setTextDatum(TL_DATUM);
+    for (int b = 0; b < SPEC_MAX_BARS; b++) {
+      _bar[b] = 0;
+      _peak[b] = 0;
+    }
+  }
+
+  // New spectrum, db[] holds bins magnitudes in dBFS. Bin 0 (DC) is skipped.
+  void update(const float *db) {
+    int base = _plotY + _plotH; // first row below plot
+    for (int b = 0; b < _bars; b++) {
+      int first = 1 + (b * (_bins - 1)) / _bars;
+      int last = 1 + ((b + 1) * (_bins - 1)) / _bars;
+      float m = db[first];
+      for (int i = first + 1; i < last; i++)
+        if (db[i] > m) m = db[i];
+      int h = _dbToHeight(m);
+      int x = _plotX + b * SPEC_BAR_PITCH;
+      int old = _bar[b];
+      if (h > old) {
+        _tft->fillRect(x, base - h, SPEC_BAR_PITCH - 1, h - old, _color); // grown part
+      } else if (h < old) {
+        _erase(x, base - old, old - h); // shrunk part, restore background and grid
+      }
+      _bar[b] = h;
+      // peak hold with decay, drawn as one line above the bar
+      int old_peak = (int)_peak[b];
+      if (h >= _peak[b])
+        _peak[b] = h;
+      else
+        _peak[b] -= SPEC_PEAK_DECAY;
+      int peak = (int)_peak[b];
+      if ((old_peak != peak) && (old_peak > h))
+        _erase(x, base - old_peak, 1);
+      if (peak > h)
+        _tft->drawFastHLine(x, base - peak, SPEC_BAR_PITCH - 1, _peakColor);
+    }
+  }
+
+private:
+  TFT_eSPI *_tft;
+  int _plotX = 0, _plotY = 0, _plotH = 0, _bars = 0, _bins = 0;
+  uint16_t _color = TFT_GREEN, _peakColor = TFT_YELLOW, _bgColor = TFT_BLACK, _gridColor = TFT_DARKGREY;
+  uint8_t _bar[SPEC_MAX_BARS];  // bar height in pixels
+  float _peak[SPEC_MAX_BARS];   // peak height in pixels
+
+  int _dbToHeight(float db) const {
+    int h = (int)((db - SPEC_DB_MIN) * _plotH / (SPEC_DB_MAX - SPEC_DB_MIN));
+    return (h < 0) ? 0 : ((h > _plotH) ? _plotH : h);
+  }
+
+  int _dbToY(int db) const { return _plotY + _plotH - 1 - _dbToHeight(db) + ((db == SPEC_DB_MAX) ? 1 : 0); }
+
+  // Fill rows y..y+rows-1 of one bar with background, restore grid lines
+  void _erase(int x, int y, int rows) {
+    _tft->fillRect(x, y, SPEC_BAR_PITCH - 1, rows, _bgColor);
+    for (int db = SPEC_DB_MAX; db >= SPEC_DB_MIN; db -= SPEC_GRID_DB) {
+      int gy = _dbToY(db);
+      if ((gy >= y) && (gy < y + rows))
+        _tft->drawFastHLine(x, gy, SPEC_BAR_PITCH - 1, _gridColor);
+    }
+  }
+};
+
+#endif // SPECTRUMANALYZER_H
@@ -0,0 +1,125 @@
+#ifndef SPIBUSARBITER_H
+#define SPIBUSARBITER_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Time-multiplexed VSPI bus arbiter for SD card and XPT2046 touch controller.
+//
+// On the CYD, SD card and touch controller use different pins, but we have only
+// one free SPI peripheral (VSPI, the TFT uses HSPI). Instead of ending and
+// re-beginning SPIClass for every SD access, the arbiter begins VSPI once and
+// keeps both devices configured:
+//  - SCK and MOSI are routed to both pin sets in parallel via the GPIO matrix.
+//    The device not selected ignores the clock as its chip select is high.
+//  - MISO (VSPIQ input) can only come from one pin, it is switched per transaction.
+//  - Each driver sets its own clock and mode with SPI.beginTransaction()
+//    (SD 10 MHz by SdSpiConfig, XPT2046 2 MHz by its library).
+//
+// Every bus user must hold the arbiter for the duration of its transaction(s):
+//   if (spiArbiter.acquire(spi_dev_touch, pdMS_TO_TICKS(5))) { ...; spiArbiter.release(); }
+// Long SD writes are split into slices by the writer; between slices a waiting
+// touch read gets the bus (touchWaiting()), so touch input keeps working while logging.
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "soc/gpio_sig_map.h"
+
+enum spiBusDevice_e {
+  spi_dev_none = 0,
+  spi_dev_sd,
+  spi_dev_touch
+};
+
+class SpiBusArbiter {
+public:
+  SpiBusArbiter() : _spi(VSPI) { }
+
+  // Begin VSPI once and route pins for all devices, call in hardwareInit()
+  void begin() {
+    if (_mutex) return;
+    _mutex = xSemaphoreCreateMutex();
+    pinMode(SD_CS_PIN, OUTPUT);
+    digitalWrite(SD_CS_PIN, HIGH);
+    _spi.begin(SD_SCK, SD_MISO, SD_MOSI, -1); // CS handled by SdFat
+    #ifdef BOARD_CYD
+      pinMode(XPT2046_CS, OUTPUT);
+      digitalWrite(XPT2046_CS, HIGH);
+      // second set of output pins for touch controller, driven in parallel
+      pinMode(XPT2046_CLK, OUTPUT);
+      pinMatrixOutAttach(XPT2046_CLK, VSPICLK_OUT_IDX, false, false);
+      pinMode(XPT2046_MOSI, OUTPUT);
+      pinMatrixOutAttach(XPT2046_MOSI, VSPID_OUT_IDX, false, false);
+      pinMode(XPT2046_MISO, INPUT);
+    #endif
+    _routed = spi_dev_sd;  // MISO routed to SD card by _spi.begin()
+  }
+
+  // Claim the bus for a device, switch MISO routing if needed.
+  // Returns false if the bus could not be claimed within wait ticks
+  bool acquire(spiBusDevice_e dev, TickType_t wait = portMAX_DELAY) {
+    if (!_mutex) return false;
+    if (dev == spi_dev_touch)
+      _touchWaiting = true;
+    bool ok = (xSemaphoreTake(_mutex, wait) == pdTRUE);
+    if (dev == spi_dev_touch)
+      _touchWaiting = false;
+    if (!ok) {
+      _timeouts++;
+      return false;
+    }
+    if (dev != _routed) {
+      _routeMiso(dev);
+      _switches++;
+    }
+    _owner = dev;
+    return true;
+  }
+
+  // Release the bus after transaction(s)
+  void release() {
+    _owner = spi_dev_none;
+    xSemaphoreGive(_mutex);
+  }
+
+  // True while a touch read waits for the bus, SD writer should yield
+  bool touchWaiting() const { return _touchWaiting; }
+
+  spiBusDevice_e owner() const { return _owner; }
+  SPIClass *spi() { return &_spi; }
+
+  uint32_t switches() const { return _switches; }  // number of MISO re-routings
+  uint32_t timeouts() const { return _timeouts; }  // acquire() calls timed out
+
+private:
+  SPIClass _spi;
+  SemaphoreHandle_t _mutex = NULL;
+  volatile spiBusDevice_e _routed = spi_dev_none;
+  volatile spiBusDevice_e _owner = spi_dev_none;
+  volatile bool _touchWaiting = false;
+  uint32_t _switches = 0;
+  uint32_t _timeouts = 0;
+
+  // Route VSPI MISO input to the pin of the selected device
+  void _routeMiso(spiBusDevice_e dev) {
+    #ifdef BOARD_CYD
+      if (dev == spi_dev_touch)
+        pinMatrixInAttach(XPT2046_MISO, VSPIQ_IN_IDX, false);
+      else
+        pinMatrixInAttach(SD_MISO, VSPIQ_IN_IDX, false);
+    #endif
+    _routed = dev;
+  }
+};
+
+#endif // SPIBUSARBITER_H
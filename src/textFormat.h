@@ -0,0 +1,166 @@
+#ifndef TEXTFORMAT_H
+#define TEXTFORMAT_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Number formatting into fixed-size buffers, without heap.
+//
+// Widgets and web handlers used Arduino String temporaries for labels, e.g.
+// String(val, decimals) or String(ms) + "ms". Each one is a malloc() and
+// free() per draw, which fragments the heap over days of uptime. Floats are
+// converted here with integer arithmetic instead of printf("%f"), whose
+// newlib implementation allocates as well.
+//
+// TextBuf<N> is a small string on the stack with chainable appends, usable
+// directly where a const char * is expected:
+//   _tft->drawString(LabelBuf().fixed(maxVal * 0.5f, 1), x, y, 2);
+//   LabelBuf().num(ms).add("ms")
+// Text that does not fit is truncated, the buffer is always terminated.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FMT_MAX_DECIMALS 6
+
+// Unsigned integer to decimal, at least min_digits with leading zeros.
+// Returns length written, buf is always terminated
+inline size_t fmtUint(char *buf, size_t size, uint64_t value, int min_digits = 1) {
+  if (size == 0) return 0;
+  char tmp[24];
+  int n = 0;
+  do {
+    tmp[n++] = '0' + (char)(value % 10);
+    value /= 10;
+  } while ((value || (n < min_digits)) && (n < (int)sizeof(tmp)));
+  size_t len = 0;
+  while (n && (len < size - 1))
+    buf[len++] = tmp[--n];
+  buf[len] = '\0';
+  return len;
+}
+
+// Signed integer to decimal, returns length written
+inline size_t fmtInt(char *buf, size_t size, long value) {
+  if (size < 2) return fmtUint(buf, size, 0);
+  if (value >= 0) return fmtUint(buf, size, (uint64_t)value);
+  buf[0] = '-';
+  return 1 + fmtUint(buf + 1, size - 1, (uint64_t)(-(int64_t)value));
+}
+
+// Float to fixed-point decimal with given decimals (0..FMT_MAX_DECIMALS),
+// rounded half away from zero like String(value, decimals). Returns length written
+inline size_t fmtFixed(char *buf, size_t size, float value, int decimals) {
+  static const uint32_t scale[FMT_MAX_DECIMALS + 1] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+  if (size == 0) return 0;
+  if (decimals < 0) decimals = 0;
+  if (decimals > FMT_MAX_DECIMALS) decimals = FMT_MAX_DECIMALS;
+  const char *special = isnan(value) ? "nan" : (isinf(value) ? ((value < 0) ? "-inf" : "inf") : NULL);
+  double scaled = fabs((double)value) * scale[decimals] + 0.5;
+  if (!special && (scaled >= 1e18)) special = "ovf";
+  size_t len = 0;
+  if (special) {
+    while (special[len] && (len < size - 1)) { buf[len] = special[len]; len++; }
+    buf[len] = '\0';
+    return len;
+  }
+  uint64_t n = (uint64_t)scaled;
+  if ((value < 0) && n && (size > 1))
+    buf[len++] = '-'; // no "-0.00"
+  len += fmtUint(buf + len, size - len, n / scale[decimals]);
+  if (decimals && (len < size - 1)) {
+    buf[len++] = '.';
+    len += fmtUint(buf + len, size - len, n % scale[decimals], decimals);
+  }
+  buf[len] = '\0';
+  return len;
+}
+
+// Value with SI prefix (u, m, none) and given significant digits, e.g. "1.234",
+// "12.34m", "123.4u". Returns length written
+inline size_t fmtSI(char *buf, size_t size, float value, int digits = 4) {
+  float a = fabsf(value);
+  const char *prefix = "";
+  if ((a < 1.0f) && (a != 0) && isfinite(a)) {
+    if (a >= 0.001f) { value *= 1e3f; a *= 1e3f; prefix = "m"; }
+    else { value *= 1e6f; a *= 1e6f; prefix = "u"; }
+  }
+  int int_digits = ((a >= 1.0f) && isfinite(a)) ? (int)floorf(log10f(a)) + 1 : 1;
+  int decimals = digits - int_digits;
+  if (decimals < 0) decimals = 0;
+  // rounding can add a digit, e.g. 9.9996 -> 10.000
+  if ((decimals > 0) && (a * powf(10.0f, (float)decimals) + 0.5f >= powf(10.0f, (float)digits)))
+    decimals--;
+  size_t len = fmtFixed(buf, size, value, decimals);
+  for (int i = 0; prefix[i] && (len < size - 1); i++)
+    buf[len++] = prefix[i];
+  if (size) buf[len] = '\0';
+  return len;
+}
+
+// ##############################################################################
+
+// Fixed-size string on the stack with chainable appends
+template <size_t N>
+class TextBuf {
+public:
+  TextBuf() { clear(); }
+  TextBuf(const char *s) { clear(); add(s); }
+
+  TextBuf &clear() {
+    _len = 0;
+    _buf[0] = '\0';
+    return *this;
+  }
+
+  TextBuf &add(const char *s) {
+    while (*s && (_len < N - 1))
+      _buf[_len++] = *s++;
+    _buf[_len] = '\0';
+    return *this;
+  }
+
+  TextBuf &add(char c) {
+    if (_len < N - 1) {
+      _buf[_len++] = c;
+      _buf[_len] = '\0';
+    }
+    return *this;
+  }
+
+  TextBuf &num(long value) { _len += fmtInt(_buf + _len, N - _len, value); return *this; }
+  TextBuf &fixed(float value, int decimals) { _len += fmtFixed(_buf + _len, N - _len, value, decimals); return *this; }
+  TextBuf &si(float value, int digits = 4) { _len += fmtSI(_buf + _len, N - _len, value, digits); return *this; }
+
+  // Remove last character
+  TextBuf &chop() {
+    if (_len) _buf[--_len] = '\0';
+    return *this;
+  }
+
+  const char *c_str() const { return _buf; }
+  operator const char *() const { return _buf; }
+  size_t length() const { return _len; }
+  size_t capacity() const { return N - 1; }
+  bool operator==(const char *s) const { return strcmp(_buf, s) == 0; }
+
+private:
+  char _buf[N];
+  size_t _len;
+};
+
+typedef TextBuf<16> LabelBuf; // scale labels, numbers with unit
+
+#endif // TEXTFORMAT_H
@@ -0,0 +1,150 @@
+#ifndef TFTDMA_H
+#define TFTDMA_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// DMA transfers of the display SPI for bulk operations: page clears, large
+// fills (meter face, bargraph frame, plot areas) and pushing saved screen
+// areas back (dialog save-under).
+//
+// TFT_eSPI fillRect() and pushRect() feed the SPI FIFO from the CPU and poll
+// until the last word is out, so the loop task keeps the core busy for the
+// whole transfer. Here the area is sent in bands of up to TFT_DMA_CHUNK_PIXELS
+// with pushImageDMA(). While a band is clocked out, the loop task blocks in
+// dmaWait() on a FreeRTOS semaphore and other tasks (web server, SD writer)
+// get the CPU.
+//  - fillRect(): one chunk buffer holds the colour, every band is sent from it
+//    without copying.
+//  - pushRect(): two chunk buffers. TFT_eSPI copies the next band from the
+//    source (which may be in PSRAM, not reachable by DMA) into one buffer while
+//    the other is being sent.
+// Areas below TFT_DMA_MIN_PIXELS and displays without ESP32_DMA use the normal
+// TFT_eSPI calls. All functions return after the last band is sent, so normal
+// drawing can follow immediately. Transfer time is limited by the SPI clock
+// either way.
+//
+// begin() calls initDMA() once; ImageBlitter uses it as well.
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include <esp_heap_caps.h>
+#include "profiler.h"
+
+#define TFT_DMA_CHUNK_PIXELS (320 * 8)  // Pixel pro DMA-Band, 5 KB pro Puffer
+#define TFT_DMA_MIN_PIXELS 2048         // kleinere Flächen ohne DMA
+
+class TftDma {
+public:
+  TftDma() { }
+
+  // Enable DMA on the display SPI and allocate chunk buffers, call after tft.init()
+  // and before any other function. Returns true if DMA transfers are available
+  bool begin(TFT_eSPI *tft) {
+    if (_tried) return _ready;
+    _tried = true;
+    _tft = tft;
+    #ifdef ESP32_DMA
+      if (!_tft->initDMA()) return false; // TFT CS still controlled by TFT_eSPI
+      for (int i = 0; i < 2; i++)
+        _buf[i] = (uint16_t *)heap_caps_malloc(TFT_DMA_CHUNK_PIXELS * sizeof(uint16_t), MALLOC_CAP_DMA);
+      _ready = _buf[0] && _buf[1];
+    #endif
+    return _ready;
+  }
+
+  bool ready() const { return _ready; }
+
+  void fillScreen(uint16_t color) {
+    fillRect(0, 0, _tft->width(), _tft->height(), color);
+  }
+
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) {
+    int32_t rows = _bandRows(x, y, w, h);
+    if (!rows) {
+      _tft->fillRect(x, y, w, h, color);
+      return;
+    }
+    #ifdef ESP32_DMA
+      PROF_PIXELS(w * h);
+      uint16_t c = (color >> 8) | (color << 8); // display byte order
+      int32_t n = rows * w;
+      if ((c != _fillColor) || (n > _fillPixels)) {
+        for (int32_t i = 0; i < n; i++)
+          _buf[0][i] = c;
+        _fillColor = c;
+        _fillPixels = n;
+      }
+      _begin();
+      for (int32_t r = 0; r < h; r += rows)
+        _tft->pushImageDMA(x, y + r, w, min(rows, h - r), _buf[0]); // waits for previous band
+      _end();
+    #endif
+  }
+
+  // Push pixels in display byte order as returned by readRect(), e.g. a save-under
+  void pushRect(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data) {
+    int32_t rows = _bandRows(x, y, w, h);
+    if (!rows) {
+      _tft->pushRect(x, y, w, h, (uint16_t *)data);
+      return;
+    }
+    #ifdef ESP32_DMA
+      PROF_PIXELS(w * h);
+      _fillPixels = 0; // buffer 0 overwritten
+      _begin();
+      int cur = 0;
+      for (int32_t r = 0; r < h; r += rows) {
+        // copies into _buf[cur] while the other buffer is sent
+        _tft->pushImageDMA(x, y + r, w, min(rows, h - r), (uint16_t *)data + r * w, _buf[cur]);
+        cur ^= 1;
+      }
+      _end();
+    #endif
+  }
+
+private:
+  TFT_eSPI *_tft = NULL;
+  uint16_t *_buf[2] = { NULL, NULL };
+  bool _tried = false;
+  bool _ready = false;
+  bool _swap = false;
+  uint16_t _fillColor = 0;
+  int32_t _fillPixels = 0;    // pixels of _buf[0] holding _fillColor
+
+  // Rows per band, 0 if area is too small or DMA not available
+  int32_t _bandRows(int32_t x, int32_t y, int32_t w, int32_t h) {
+    if (!_ready || (w <= 0) || (h <= 0) || (w * h < TFT_DMA_MIN_PIXELS)) return 0;
+    if ((x < 0) || (y < 0) || (x + w > _tft->width()) || (y + h > _tft->height())) return 0;
+    int32_t rows = TFT_DMA_CHUNK_PIXELS / w;
+    return (rows > h) ? h : rows;
+  }
+
+  void _begin() {
+    _swap = _tft->getSwapBytes();
+    _tft->setSwapBytes(false); // buffers are in display byte order
+    _tft->startWrite();
+  }
+
+  void _end() {
+    #ifdef ESP32_DMA
+      _tft->dmaWait();
+    #endif
+    _tft->endWrite();
+    _tft->setSwapBytes(_swap);
+  }
+};
+
+TftDma tftDma;
+
+#endif // TFTDMA_H
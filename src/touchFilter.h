@@ -0,0 +1,224 @@
+#ifndef TOUCHFILTER_H
+#define TOUCHFILTER_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Filter stage for resistive touch panels (XPT2046), from raw digitizer
+// samples to screen coordinates.
+//
+// TouchFilter, per raw sample (x, y, pressure z):
+//  1. Pressure gate with hysteresis: a touch starts after cfg.debounce
+//     samples with z >= cfg.zPress and ends after cfg.releaseCount samples
+//     with z < cfg.zRelease. Light and edge touches with low pressure, whose
+//     coordinates jump, never start a press. Samples below zPress during a
+//     press are not used for the position, so lifting the pen does not move it.
+//  2. Median of the last cfg.median samples per axis, removes single spikes.
+//  3. Adaptive IIR on the median: small moves (< cfg.slowDist) are smoothed
+//     with 1/2^cfg.iirSlow, fast drags (> cfg.fastDist) follow with
+//     1/2^cfg.iirFast, so a resting finger does not jitter and a drag has
+//     little lag. The first position of a touch is taken without filtering.
+// Integer only, state in 1/16 raw units, a few hundred cycles per sample,
+// so the touch panel can be sampled at 200 Hz (see TOUCH_SAMPLE_MS).
+//
+// TouchCal maps filtered raw coordinates to the screen with a fixed-point
+// (Q16) affine transform, including rotation and skew of the digitizer:
+//   sx = (a * x + b * y + c) >> 16,  sy = (d * x + e * y + f) >> 16
+// setPoints() solves it from three touched targets, setCorners() sets the
+// axis-parallel mapping of the older 2-corner calibration.
+//
+// Pure logic without hardware access, see tools/touch_sim for a simulation.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define TOUCH_MEDIAN_MAX 7      // max. Samples im Median
+#ifndef TOUCH_Z_PRESS
+  #define TOUCH_Z_PRESS 600     // Druck, ab dem eine Berührung beginnt
+#endif
+#ifndef TOUCH_Z_RELEASE
+  #define TOUCH_Z_RELEASE 400   // Druck, unter dem sie endet
+#endif
+
+struct touchFilterCfg_t {
+  uint8_t median = 5;           // samples, odd, 1 = off
+  uint16_t zPress = TOUCH_Z_PRESS;
+  uint16_t zRelease = TOUCH_Z_RELEASE;
+  uint8_t debounce = 2;         // samples >= zPress to start a touch
+  uint8_t releaseCount = 2;     // samples < zRelease to end it
+  uint8_t iirSlow = 3;          // shift for small moves, 1/8
+  uint8_t iirFast = 1;          // shift for drags, 1/2
+  uint16_t slowDist = 12;       // raw units, below: slow
+  uint16_t fastDist = 40;       // raw units, above: fast
+};
+
+class TouchFilter {
+public:
+  touchFilterCfg_t cfg;
+
+  TouchFilter() { reset(); }
+
+  void reset() {
+    _count = 0;
+    _head = 0;
+    _above = 0;
+    _below = 0;
+    _pressed = false;
+  }
+
+  // Next raw sample, z = 0 if not touched. Returns true while pressed
+  bool push(int32_t x, int32_t y, int32_t z) {
+    if (z >= cfg.zPress) {
+      _below = 0;
+      _addSample(x, y);
+      if (!_pressed) {
+        if (++_above < cfg.debounce) return false;
+        _pressed = true;
+        _fx = _median(_xs) << 4; // first position unfiltered
+        _fy = _median(_ys) << 4;
+        _presses++;
+        return true;
+      }
+      _iir(_fx, _median(_xs));
+      _iir(_fy, _median(_ys));
+      return true;
+    }
+    _above = 0;
+    if (!_pressed) {
+      _count = 0; // no stale samples in the next touch
+      if (z > 0) _rejected++;
+      return false;
+    }
+    if (z < cfg.zRelease) {
+      if (++_below >= cfg.releaseCount) {
+        _pressed = false;
+        _count = 0;
+      }
+    }
+    return _pressed; // position held while pressure is low
+  }
+
+  bool pressed() const { return _pressed; }
+  int32_t x() const { return (_fx + 8) >> 4; } // filtered raw coordinates
+  int32_t y() const { return (_fy + 8) >> 4; }
+  uint32_t presses() const { return _presses; }
+  uint32_t rejected() const { return _rejected; } // light touches never pressed
+
+private:
+  int32_t _xs[TOUCH_MEDIAN_MAX], _ys[TOUCH_MEDIAN_MAX];
+  uint8_t _count, _head, _above, _below;
+  bool _pressed;
+  int32_t _fx = 0, _fy = 0;
+  uint32_t _presses = 0, _rejected = 0;
+
+  int _window() const {
+    int n = cfg.median;
+    if (n < 1) n = 1;
+    if (n > TOUCH_MEDIAN_MAX) n = TOUCH_MEDIAN_MAX;
+    return n;
+  }
+
+  void _addSample(int32_t x, int32_t y) {
+    int n = _window();
+    if ((_count == 0) || (_head >= n)) _head = 0;
+    _xs[_head] = x;
+    _ys[_head] = y;
+    _head = (_head + 1) % n;
+    if (_count < n) _count++;
+  }
+
+  // Median of the samples in the window, insertion sort of max. 7 values
+  int32_t _median(const int32_t *v) const {
+    int32_t s[TOUCH_MEDIAN_MAX];
+    int n = _count;
+    if (n == 0) return 0;
+    for (int i = 0; i < n; i++) {
+      int32_t t = v[i];
+      int j = i;
+      while ((j > 0) && (s[j - 1] > t)) {
+        s[j] = s[j - 1];
+        j--;
+      }
+      s[j] = t;
+    }
+    return s[n / 2];
+  }
+
+  // Adaptive IIR step of f (1/16 units) towards m (raw units)
+  void _iir(int32_t &f, int32_t m) {
+    int32_t diff = (m << 4) - f;
+    int32_t dist = abs(diff) >> 4;
+    int shift;
+    if (dist <= cfg.slowDist)
+      shift = cfg.iirSlow;
+    else if (dist >= cfg.fastDist)
+      shift = cfg.iirFast;
+    else
+      shift = (cfg.iirSlow + cfg.iirFast + 1) / 2;
+    f += diff / (1 << shift);
+  }
+};
+
+// ##############################################################################
+
+class TouchCal {
+public:
+  int32_t coef[6] = { 1 << 16, 0, 0, 0, 1 << 16, 0 }; // a, b, c, d, e, f in Q16
+
+  // Axis-parallel mapping, raw (x0, y0) to screen (0, 0) and raw (x1, y1) to (w, h)
+  bool setCorners(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t w, int32_t h) {
+    if ((x1 == x0) || (y1 == y0)) return false;
+    int32_t a = (int32_t)(((int64_t)w << 16) / (x1 - x0));
+    int32_t e = (int32_t)(((int64_t)h << 16) / (y1 - y0));
+    int32_t c[6] = { a, 0, -a * x0, 0, e, -e * y0 };
+    return set(c);
+  }
+
+  // Solve from three raw points rx, ry touched at screen points sx, sy.
+  // false if the points are (nearly) on one line
+  bool setPoints(const int32_t rx[3], const int32_t ry[3], const int32_t sx[3], const int32_t sy[3]) {
+    double det = (double)rx[0] * (ry[1] - ry[2]) - (double)rx[1] * (ry[0] - ry[2]) + (double)rx[2] * (ry[0] - ry[1]);
+    if ((det > -1000.0) && (det < 1000.0)) return false;
+    int32_t c[6];
+    const int32_t *s[2] = { sx, sy };
+    for (int k = 0; k < 2; k++) {
+      const int32_t *t = s[k];
+      double a = ((double)t[0] * (ry[1] - ry[2]) - (double)t[1] * (ry[0] - ry[2]) + (double)t[2] * (ry[0] - ry[1])) / det;
+      double b = ((double)rx[0] * (t[1] - t[2]) - (double)rx[1] * (t[0] - t[2]) + (double)rx[2] * (t[0] - t[1])) / det;
+      double o = ((double)rx[0] * ((double)ry[1] * t[2] - (double)ry[2] * t[1])
+                - (double)rx[1] * ((double)ry[0] * t[2] - (double)ry[2] * t[0])
+                + (double)rx[2] * ((double)ry[0] * t[1] - (double)ry[1] * t[0])) / det;
+      c[k * 3] = (int32_t)(a * 65536.0 + ((a < 0) ? -0.5 : 0.5));
+      c[k * 3 + 1] = (int32_t)(b * 65536.0 + ((b < 0) ? -0.5 : 0.5));
+      c[k * 3 + 2] = (int32_t)(o * 65536.0 + ((o < 0) ? -0.5 : 0.5));
+    }
+    return set(c);
+  }
+
+  // Take coefficients, false if a scale is out of range (> 1 screen pixel per raw unit)
+  bool set(const int32_t c[6]) {
+    for (int i = 0; i < 6; i++)
+      if (((i % 3) != 2) && ((c[i] > (1 << 16)) || (c[i] < -(1 << 16)))) return false;
+    for (int i = 0; i < 6; i++)
+      coef[i] = c[i];
+    return true;
+  }
+
+  // Raw 0..4095 to screen, rounded, not clamped. Products stay below 2^28
+  void map(int32_t x, int32_t y, int32_t *sx, int32_t *sy) const {
+    *sx = (coef[0] * x + coef[1] * y + coef[2] + (1 << 15)) >> 16;
+    *sy = (coef[3] * x + coef[4] * y + coef[5] + (1 << 15)) >> 16;
+  }
+};
+
+#endif // TOUCHFILTER_H
@@ -4,15 +4,21 @@
 
 #include <Arduino.h>
 #include <TFT_eSPI.h>
+#include "touchFilter.h"
 
 #ifdef BOARD_CYD
   #include <XPT2046_Touchscreen.h>
+  #include "spiBusArbiter.h"
+  #define TOUCH_BUS_WAIT_MS 5  // max. Wartezeit auf SPI-Bus, wenn SD-Karte schreibt
   // #define DEBUG_TOUCH   // Enable touch debug messages
 #endif
 
 #define DISPLAY_W 320     // Anzeigebereich Breite
 #define DISPLAY_H 240     // Anzeigebereich Höhe
-#define TOUCH_OFFSET 5    // Offset for touch area to compensate edge touches on CYD board
+#define TOUCH_SAMPLE_MS 5 // Touch-Abtastung mit 200 Hz, siehe touchFilter.h
+#define TOUCH_PEN_DEADLINE_MS 120 // Pen-Job darf so spät kommen, länger als jeder Seitenaufbau
+#define TOUCH_CAL_SAMPLES 40 // Samples pro Kalibrierpunkt nach Berührung
+#define TOUCH_CAL_AFFINE 0x55A2 // settings.touchCalDataOK: 3-Punkt-Kalibrierung gültig
 
 // #####################################################################################
 // Addittion by cm 7/25:
@@ -36,160 +42,174 @@
 // This allows the widgets to access touch events through a shared TouchProvider instance
 // since tft->getTouch(&tx, &ty) is time-consuming and no longer used directly
 
+typedef void (*touchReadHook_t)(bool reading); // true before, false after a touch controller access
+
 class TouchProvider : public TFT_eSPI {
 public:
 	uint16_t tx, ty; // Touch coordinates
 	bool pressed; // Touch pressed state
+  TouchFilter filter; // median, pressure gate and IIR of raw samples, settings in filter.cfg
 
   // Must be initialized with a pointer to a TFT_eSPI object
 	// This allows the TouchProvider to access the TFT_eSPI methods
 
 #ifdef BOARD_CYD
-  // Initialise with example calibration values so processor does not crash if setTouch() not called in setup()
-  uint16_t tcal_x0 = XPT2046_XMIN, tcal_y0 = XPT2046_YMIN;
-  float tcal_w = XPT2046_XMAX - XPT2046_XMIN, tcal_h = XPT2046_YMAX - XPT2046_YMIN;
+  TouchCal cal; // raw to screen, affine in fixed point
 
-  TouchProvider(TFT_eSPI* tft) : _xpt(XPT2046_CS), _xpt_spi(VSPI) {
+  TouchProvider(TFT_eSPI* tft) : _xpt(XPT2046_CS) {
     _tft = tft;
     tx = 0;
     ty = 0;
     pressed = false;
-    _xpt_spi.begin(XPT2046_CLK, XPT2046_MISO, XPT2046_MOSI, XPT2046_CS); // defined in platformio.ini
-    _xpt.begin(_xpt_spi);
-    _xpt.setRotation(1); // landscape, USB ports right bottom
+    // example calibration values, used until setTouchCYD() or setTouchAffine()
+    cal.setCorners(XPT2046_XMIN, XPT2046_YMIN, XPT2046_XMAX, XPT2046_YMAX, DISPLAY_W, DISPLAY_H);
   }
 
-  void reInit() {
-    _xpt_spi.begin(XPT2046_CLK, XPT2046_MISO, XPT2046_MOSI, XPT2046_CS); // defined in platformio.ini
-    _xpt.begin(_xpt_spi);
+  // Attach XPT2046 to the VSPI bus shared with the SD card, call after arbiter->begin()
+  void begin(SpiBusArbiter *arbiter) {
+    _arbiter = arbiter;
+    _xpt.begin(*arbiter->spi()); // SPI already started by arbiter, pins defined in platformio.ini
     _xpt.setRotation(1); // landscape, USB ports right bottom
   }
 
-  void end() {
-    _xpt_spi.end(); // free the SPI bus
-  }
-
 	// Check if the touch is pressed and get the coordinates
 	// Must be called regularly in the main loop to check for touch events
   // read position of XPT digitizer and corresponding TFT position
   // https://github.com/PaulStoffregen/XPT2046_Touchscreen/
+  // One raw sample with pressure per call, also by the pen job every TOUCH_SAMPLE_MS,
+  // filtered and mapped by filter and cal, see touchFilter.h
   bool checkTouch() {
-    uint16_t x, y; uint8_t z;  // XPT
-    pressed = _xpt.touched();
+    if ((_arbiter == NULL) || !_arbiter->acquire(spi_dev_touch, pdMS_TO_TICKS(TOUCH_BUS_WAIT_MS)))
+      return pressed; // bus busy with SD card, keep last state
+    _readHook(true);
+    TS_Point p = _xpt.getPoint(); // z = 0 if not touched
+    _readHook(false);
+    _arbiter->release();
+    pressed = filter.push(p.x, p.y, p.z);
     if (pressed) {
-      _xpt.readData(&x, &y, &z);
+      int32_t x, y;
+      cal.map(filter.x(), filter.y(), &x, &y);
+      _setPosition(x, y);
       #ifdef DEBUG_TOUCH
-        Serial.print("Touch raw: x=" + String(x) + ", y=" + String(y));
-      #endif
-      if (x < tcal_x0) x = tcal_x0; // avoid invalid values
-      if (y < tcal_y0) y = tcal_y0; // avoid invalid values
-      // calc position for TFT display from digitizer position
-      tx = DISPLAY_W * (float(x - tcal_x0)/tcal_w);    // TFT_HEIGHT=320
-      ty = DISPLAY_H * (float(y - tcal_y0)/tcal_h);    // TFT_WIDTH=240
-
-      // avoid invalid values
-      if (tx >= DISPLAY_W) tx = DISPLAY_W-1;
-      if (ty >= DISPLAY_H) ty = DISPLAY_H-1;
-      #ifdef DEBUG_TOUCH
-        Serial.println(" mapped: tx=" + String(tx) + ", ty=" + String(ty));
+        Serial.printf("Touch raw: x=%d, y=%d, z=%d mapped: tx=%u, ty=%u\n", p.x, p.y, p.z, tx, ty);
       #endif
     }
     return pressed;
   }
 
-  // Touch calibration for CYD board with XPT2046 touch screen
-  // parameters: Array of 7 uint16_t values to store the calibration parameters
-  void calibrateTouchCYD(uint16_t *parameters, uint32_t color_fg, uint32_t color_bg, uint8_t size){
-    int16_t values[] = {0,0,0,0,0,0,0,0};
-    uint16_t x, y; uint8_t z;  // XPT raw data
+  // Touch calibration for CYD board with XPT2046 touch screen, three targets
+  // coef: array of 6 int32_t for the affine transform, see TouchCal in touchFilter.h
+  // Returns false if the targets were not touched properly (on one line), repeat then
+  bool calibrateTouchCYD(int32_t *coef, uint32_t color_fg, uint32_t color_bg, uint8_t size){
+    static const int32_t px[3] = { DISPLAY_W / 10, DISPLAY_W * 9 / 10, DISPLAY_W / 2 };
+    static const int32_t py[3] = { DISPLAY_H / 10, DISPLAY_H / 2, DISPLAY_H * 9 / 10 };
+    int32_t rx[3], ry[3];
     #ifdef DEBUG_TOUCH
       Serial.println("Touch calibration");
     #endif
-    for(uint8_t i = 0; i<4; i++){
-      _tft->fillRect(0, 0, size+1, size+1, color_bg);
-      _tft->fillRect(0, DISPLAY_H-size-1, size+1, size+1, color_bg);
-      _tft->fillRect(DISPLAY_W-size-1, 0, size+1, size+1, color_bg);
-      _tft->fillRect(DISPLAY_W-size-1, DISPLAY_H-size-1, size+1, size+1, color_bg);
-      while(_xpt.touched()) delay(10); // wait for press release
-      switch (i) {
-        case 0: // up left
-          _tft->drawLine(0, 0, 0, size, color_fg);
-          _tft->drawLine(0, 0, size, 0, color_fg);
-          _tft->drawLine(0, 0, size , size, color_fg);
-          break;
-        case 1: // bot left
-          _tft->drawLine(0, DISPLAY_H-size-1, 0, DISPLAY_H-1, color_fg);
-          _tft->drawLine(0, DISPLAY_H-1, size, DISPLAY_H-1, color_fg);
-          _tft->drawLine(size, DISPLAY_H-size-1, 0, DISPLAY_H-1 , color_fg);
-          break;
-        case 2: // up right
-          _tft->drawLine(DISPLAY_W-size-1, 0, DISPLAY_W-1, 0, color_fg);
-          _tft->drawLine(DISPLAY_W-size-1, size, DISPLAY_W-1, 0, color_fg);
-          _tft->drawLine(DISPLAY_W-1, size, DISPLAY_W-1, 0, color_fg);
-          break;
-        case 3: // bot right
-          _tft->drawLine(DISPLAY_W-size-1, DISPLAY_H-size-1, DISPLAY_W-1, DISPLAY_H-1, color_fg);
-          _tft->drawLine(DISPLAY_W-1, DISPLAY_H-1-size, DISPLAY_W-1, DISPLAY_H-1, color_fg);
-          _tft->drawLine(DISPLAY_W-1-size, DISPLAY_H-1, DISPLAY_W-1, DISPLAY_H-1, color_fg);
-          break;
-      }
-
-      // user has to get the chance to release
-      if(i>0) {
-        delay(200);
+    for (int i = 0; i < 3; i++) {
+      _drawTarget(px[i], py[i], size, color_fg);
+      while (_xptTouched()) delay(10); // wait for press release
+      filter.reset();
+      int n = 0;
+      while (n < TOUCH_CAL_SAMPLES) {
+        TS_Point p = _xptPoint();
+        if (filter.push(p.x, p.y, p.z)) n++; // settled position of a firm touch
+        delay(TOUCH_SAMPLE_MS);
       }
-
-      for(uint8_t j= 0; j<4; j++){
-        delay(10);
-        while(!_xpt.touched()); // wait for press
-        _xpt.readData(&x, &y, &z);
-        values[i*2  ] += x;
-        values[i*2+1] += y;
-      }
-      values[i*2  ] /= 4;
-      values[i*2+1] /= 4;
+      rx[i] = filter.x();
+      ry[i] = filter.y();
+      _drawTarget(px[i], py[i], size, color_bg);
       #ifdef DEBUG_TOUCH
-        Serial.println("Touch calibration: x=" + String(values[i*2]) + ", y=" + String(values[i*2+1]));
+        Serial.printf("Touch calibration: x=%d, y=%d\n", (int)rx[i], (int)ry[i]);
       #endif
     }
-    _tft->fillRect(DISPLAY_W-size-1, DISPLAY_H-size-1, size+1, size+1, color_bg);
-    // export parameters, if pointer valid
-    if(parameters != NULL){
-      parameters[0] = (values[0] + values[2]) / 2 + TOUCH_OFFSET; // x0
-      parameters[1] = (values[1] + values[5]) / 2 + TOUCH_OFFSET; // y0
-      parameters[2] = (values[4] + values[6]) / 2 - TOUCH_OFFSET; // x1
-      parameters[3] = (values[3] + values[7]) / 2 - TOUCH_OFFSET; // y1
-    }
+    while (_xptTouched()) delay(10);
+    filter.reset();
+    TouchCal c;
+    if (!c.setPoints(rx, ry, px, py)) return false;
+    if (coef != NULL)
+      for (int i = 0; i < 6; i++)
+        coef[i] = c.coef[i];
+    return true;
   }
 
-  // Set the touch calibration values for CYD board with XPT2046 touch screen
-  // parameters: Array of 5 uint16_t values with the calibration parameters
+  // Set the 2-corner calibration of older firmware for CYD board with XPT2046 touch screen
+  // parameters: x0, y0, x1, y1 raw values at the display corners
   void setTouchCYD(uint16_t *parameters){
-    tcal_x0 = parameters[0];
-    tcal_y0 = parameters[1];
-    tcal_w = float(parameters[2] - parameters[0]); // touch width area
-    tcal_h = float(parameters[3] - parameters[1]); // touch height area
+    cal.setCorners(parameters[0], parameters[1], parameters[2], parameters[3], DISPLAY_W, DISPLAY_H);
     #ifdef DEBUG_TOUCH
-      Serial.println("Touch calibration: x0=" + String(tcal_x0) + ", y0=" + String(tcal_y0) + ", w=" + String(tcal_w) + ", h=" + String(tcal_h));
+      Serial.printf("Touch calibration: x0=%d, y0=%d, x1=%d, y1=%d\n", parameters[0], parameters[1], parameters[2], parameters[3]);
     #endif
   }
 
+  // Called with true before and false after each XPT2046 access. Reading the
+  // controller toggles PENIRQ, the touch interrupt is masked meanwhile, see powerManager.h
+  void setReadHook(touchReadHook_t hook) {
+    _readHook = hook ? hook : _noHook;
+  }
+
+  // Set the 3-point calibration from calibrateTouchCYD(), false if invalid
+  bool setTouchAffine(const int32_t *coef) {
+    return cal.set(coef);
+  }
+
+private:
+  // Blocking XPT2046 access with SPI bus claimed, used by calibration
+  bool _xptTouched() {
+    if (_arbiter == NULL) return false;
+    _arbiter->acquire(spi_dev_touch);
+    _readHook(true);
+    bool touched = _xpt.touched();
+    _readHook(false);
+    _arbiter->release();
+    return touched;
+  }
+
+  TS_Point _xptPoint() {
+    if (_arbiter == NULL) return TS_Point(0, 0, 0);
+    _arbiter->acquire(spi_dev_touch);
+    _readHook(true);
+    TS_Point p = _xpt.getPoint();
+    _readHook(false);
+    _arbiter->release();
+    return p;
+  }
+
+  static void _noHook(bool reading) { (void)reading; }
+
+  // Calibration target: circle with cross
+  void _drawTarget(int32_t x, int32_t y, uint8_t size, uint32_t color) {
+    _tft->drawCircle(x, y, size / 2, color);
+    _tft->drawFastHLine(x - size, y, 2 * size + 1, color);
+    _tft->drawFastVLine(x, y - size, 2 * size + 1, color);
+  }
+
+public:
 #else
   TouchProvider(TFT_eSPI* tft) { _tft = tft; tx = 0; ty = 0; pressed = false; }
 
 	// Check if the touch is pressed and get the coordinates
 	// Must be called regularly in the main loop to check for touch events
+  // Takes one raw sample with pressure, filters it and maps it with the
+  // TFT_eSPI calibration. Called by the pen job every TOUCH_SAMPLE_MS and by handleGUI()
   bool checkTouch() {
-    pressed = _tft->getTouch(&tx, &ty); // Get touch coordinates from the TFT display
+    uint16_t x = 0, y = 0;
+    uint16_t z = _tft->getTouchRawZ();
+    if (z >= filter.cfg.zRelease)
+      _tft->getTouchRaw(&x, &y);
+    else
+      z = 0;
+    pressed = filter.push(x, y, z);
+    if (pressed) {
+      x = filter.x();
+      y = filter.y();
+      _tft->convertRawXY(&x, &y);
+      _setPosition(x, y);
+    }
     return pressed;
   }
 
-  void reInit() {
-  }
-
-  void end() {
-  }
-
 #endif
 
   // Wait for Touch release
@@ -274,12 +294,19 @@ public:
   }
 
 private:
+  void _setPosition(int32_t x, int32_t y) {
+    // avoid invalid values
+    tx = (x < 0) ? 0 : ((x >= DISPLAY_W) ? DISPLAY_W - 1 : x);
+    ty = (y < 0) ? 0 : ((y >= DISPLAY_H) ? DISPLAY_H - 1 : y);
+  }
+
   uint8_t _enc_a_old, _enc_b_old, _enc_ready, _enc_armed;
   uint32_t _enc_accel_timer; // für Encoder-Beschleunigung
   int _enc_delta = 0; // Änderung des Dreh-Encoders
   TFT_eSPI* _tft;
   #ifdef BOARD_CYD
-    SPIClass _xpt_spi;      // SPI-Interface for XPT2046_Touchscreen
+    SpiBusArbiter *_arbiter = NULL; // VSPI shared with SD card
+    touchReadHook_t _readHook = _noHook;
     XPT2046_Touchscreen _xpt;    // polling
     // XPT2046_Touchscreen xpt(XPT2046_CS, XPT2046_IRQ); // using IRQ
   #endif
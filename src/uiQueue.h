@@ -0,0 +1,123 @@
+#ifndef UIQUEUE_H
+#define UIQUEUE_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Command queue to the render task.
+//
+// The display and all widgets belong to one task, the render task. This is
+// the Arduino loop task, which draws the pages and modal dialogs anyway;
+// begin() records it as owner. Other tasks must not call TFT_eSPI or widget
+// methods: the AsyncWebServer and WiFi callbacks run in their own tasks, and
+// a draw from there would interleave SPI transfers with the loop task.
+//
+// Instead they post a command with post(), which copies it into a FreeRTOS
+// queue and never blocks. loop() takes the commands with receive() and
+// executes them between frames. If the queue is full, the command is dropped
+// and counted, the producer gets false. Commands carry an int argument;
+// repeated commands of one kind may be merged by the consumer.
+//
+// UI_CHECK_RENDER_TASK() at the start of drawing code that could be reached
+// from another task reports a violation on Serial (DEBUG builds only).
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#define UI_QUEUE_LEN 16         // Anzahl wartender Kommandos
+#define UI_LEVEL_SCALE 10000    // Festkomma für Level-Argumente (Fullscale)
+
+enum uiCmd_e {
+  ui_cmd_none = 0,
+  ui_cmd_sdlog,         // arg 1 = start, 0 = stop SD logging
+  ui_cmd_stats_reset,   // restart running statistics
+  ui_cmd_trig_rearm,    // re-init scope page, new capture
+  ui_cmd_trig_mode,     // arg trigMode_e, re-arms like all trigger settings
+  ui_cmd_trig_edge,     // arg trigEdge_e
+  ui_cmd_trig_source,   // arg channel, amps or volts
+  ui_cmd_trig_level,    // arg level in 1/UI_LEVEL_SCALE of full scale
+  ui_cmd_trig_pre,      // arg pre-trigger history in percent
+  ui_cmd_trig_holdoff,  // arg holdoff in ms
+  ui_cmd_redraw,        // redraw current page, e.g. after HUD was switched off
+  ui_cmd_prof,          // arg uiProf_e, profiler control (PROFILER)
+  ui_cmd_bench,         // run widget benchmark (PROFILER)
+  ui_cmd_golden         // golden image run, arg 1 = save new reference (PROFILER)
+};
+
+enum uiProf_e {
+  ui_prof_off = 0,      // HUD off
+  ui_prof_hud,          // HUD on
+  ui_prof_reset,        // clear profiler statistics
+  ui_prof_serial        // print report on Serial
+};
+
+struct uiCmd_t {
+  uiCmd_e cmd;
+  int32_t arg;
+};
+
+class UiQueue {
+public:
+  UiQueue() { }
+
+  // Create queue and make calling task the render task, call in hardwareInit()
+  void begin() {
+    if (_queue) return;
+    _queue = xQueueCreate(UI_QUEUE_LEN, sizeof(uiCmd_t));
+    _owner = xTaskGetCurrentTaskHandle();
+  }
+
+  // Post command from any task, false if queue is full or not created
+  bool post(uiCmd_e cmd, int32_t arg = 0) {
+    uiCmd_t c = { cmd, arg };
+    if (_queue && (xQueueSend(_queue, &c, 0) == pdTRUE)) return true;
+    _dropped++;
+    return false;
+  }
+
+  // Next command for the render task, false if none waiting
+  bool receive(uiCmd_t *cmd) {
+    return _queue && (xQueueReceive(_queue, cmd, 0) == pdTRUE);
+  }
+
+  bool isRenderTask() const { return !_owner || (xTaskGetCurrentTaskHandle() == _owner); }
+
+  // Report drawing from a foreign task on Serial, false if not render task
+  bool checkRenderTask(const char *where) {
+    if (isRenderTask()) return true;
+    _violations++;
+    Serial.printf("UI access from task %s in %s\n", pcTaskGetTaskName(NULL), where);
+    return false;
+  }
+
+  uint32_t dropped() const { return _dropped; }
+  uint32_t violations() const { return _violations; }
+
+private:
+  QueueHandle_t _queue = NULL;
+  TaskHandle_t _owner = NULL;
+  volatile uint32_t _dropped = 0;
+  uint32_t _violations = 0;
+};
+
+UiQueue uiQueue;
+
+#ifdef DEBUG
+  #define UI_CHECK_RENDER_TASK() uiQueue.checkRenderTask(__func__)
+#else
+  #define UI_CHECK_RENDER_TASK()
+#endif
+
+#endif // UIQUEUE_H
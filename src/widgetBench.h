@@ -0,0 +1,215 @@
+#ifndef WIDGETBENCH_H
+#define WIDGETBENCH_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Widget benchmark, available with #define PROFILER (see profiler.h).
+//
+// Creates its own instance of each widget, drives it with a fixed sequence of
+// levels, states or key presses and records per operation the number of calls,
+// pixels, drawing primitives and bytes counted by ProfTFT, and the wall time.
+// Draw paths are called directly, as the touch handlers of the widgets contain
+// debounce delays and wait for release. The input sequences are fixed, so
+// pixel and primitive counts can be compared between firmware versions; wall
+// times include SPI transfers and vary slightly.
+//
+// run() draws all over the screen, the caller must redraw the current page.
+// The result is kept as JSON, see report(). With a ScreenCapture given, the
+// screen is captured after each widget sequence as golden image "w_<widget>".
+
+#ifdef PROFILER
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "profiler.h"
+#include "screenCapture.h"
+
+#define BENCH_REPORT_SIZE 6144
+#define BENCH_STEPS 20          // Schritte für Pegel-Sequenzen
+
+class WidgetBench {
+public:
+  WidgetBench(TFT_eSPI *tft, TouchProvider *touchProvider) :
+    _tft(tft), _button(tft, touchProvider), _switch(tft, touchProvider), _checkbox(tft, touchProvider),
+    _sliderHor(tft, touchProvider), _sliderVert(tft, touchProvider), _meter(tft),
+    _barHor(tft, touchProvider), _barVert(tft, touchProvider), _scope(tft),
+    _numeric(tft, touchProvider), _clock(tft, touchProvider), _tabs(tft, touchProvider),
+    _keypad(tft, touchProvider) { }
+
+  // Run all widget sequences, returns JSON report
+  // capture: optional, capture golden images of widget states
+  const char *run(ScreenCapture *capture = NULL) {
+    _capture = capture;
+    _len = 0;
+    _first = true;
+    _out("{\"bench\":[");
+    uint32_t start = millis();
+
+    _tft->fillScreen(TFT_BLACK);
+    _button.init(20, 20, 90, 28, TFT_WHITE, TFT_BTNGREY, TFT_RED, 2, FF21);
+    _button.setLabel("BENCH");
+    _measure("PushButton", "redraw", 10, [this](int) { _button.redraw(true); });
+    _measure("PushButton", "press_release", 10, [this](int) { _button.draw(true); _button.draw(false); });
+
+    _switch.initCenter(60, 100, 70, 34, TFT_WHITE, TFT_GREEN, TFT_WHITE, 2, 2);
+    _switch.setLabel("Switch");
+    _measure("SlideSwitch", "toggle", 10, [this](int i) { _switch.setState(i & 1, true); });
+
+    _checkbox.init(140, 20, 30, TFT_WHITE, TFT_WINDOWGREY, TFT_YELLOW, 2, 4);
+    _checkbox.setLabel("Checkbox");
+    _measure("Checkbox", "toggle", 10, [this](int i) { _checkbox.setState(i & 1, true); });
+
+    _sliderHor.init(10, 160, 300, 30, TFT_WHITE, TFT_CYAN, TFT_RED, 2, 2);
+    _measure("SliderHor", "set_level", BENCH_STEPS, [this](int i) { _sliderHor.setLevel(_ramp(i), true); });
+    _sliderVert.init(250, 10, 30, 140, TFT_WHITE, TFT_YELLOW, TFT_RED, 2, 2);
+    _measure("SliderVert", "set_level", BENCH_STEPS, [this](int i) { _sliderVert.setLevel(_ramp(i), true); });
+    _snap("w_controls");
+
+    _tft->fillScreen(TFT_BLACK);
+    _measure("AnalogMeter", "init", 1, [this](int) {
+      _meter.init(0, 0, MAINWINDOW_W, MAINWINDOW_H);
+      _meter.setRangeIdxColor(2);
+    });
+    _measure("AnalogMeter", "set_level", BENCH_STEPS * 2, [this](int i) { _meter.setLevel(_ramp(i)); });
+    _snap("w_meter");
+
+    _tft->fillScreen(TFT_BLACK);
+    _measure("HorizontalBargraph", "init", 1, [this](int) {
+      _barHor.init(0, 30, MAINWINDOW_W, 55);
+      _barHor.setRangeIdxColor(2, TFT_GREEN, true);
+      _barHor.update(0, 0.5, true);
+    });
+    _measure("HorizontalBargraph", "update", BENCH_STEPS * 2, [this](int i) { _barHor.update(_ramp(i), 0.5); });
+    _snap("w_hbargraph");
+
+    _tft->fillScreen(TFT_BLACK);
+    _measure("ScrollingScope", "init", 1, [this](int) {
+      _scope.init(5, 0, 240, MAINWINDOW_H);
+      _scope.newTrace(TFT_GREEN, 2, 0, true);
+      _scope.newTrace(TFT_CYAN, 3, 1, false);
+    });
+    _measure("ScrollingScope", "sample_trace", 100, [this](int i) {
+      _scope.newSample(_ramp(i), 0);
+      _scope.newSample(1.0 - _ramp(i), 1);
+      _scope.grid();
+      _scope.trace(0);
+      _scope.trace(1);
+    });
+    _measure("VerticalBargraph", "init", 1, [this](int) {
+      _barVert.init(250, 0, 70, MAINWINDOW_H);
+      _barVert.setRangeIdxColor(2, TFT_GREEN, true);
+      _barVert.update(0, 0.5, true);
+    });
+    _measure("VerticalBargraph", "update", BENCH_STEPS * 2, [this](int i) { _barVert.update(_ramp(i), 0.5); });
+
+    _measure("NumericDisplay", "init", 1, [this](int) {
+      _numeric.init(NUM_POS_X, NUM_POS_Y, TFT_DARKGREEN, true);
+      _numeric.setRangeIdxColor(2, TFT_BLUE);
+      _numeric.setLevel(-0.1, true);
+    });
+    _measure("NumericDisplay", "set_level", BENCH_STEPS, [this](int i) { _numeric.setLevel(_ramp(i)); });
+    _snap("w_scope_vbar_num");
+
+    _tft->fillScreen(TFT_BLACK);
+    _clock.init(65, 40, 120, TFT_WHITE, TFT_ORANGE, TFT_BLACK, TFT_BLUE, TFT_DIALOGGREY);
+    _measure("AnalogClock", "redraw", 1, [this](int) { _clock.update(10, 9, 0, true); });
+    _measure("AnalogClock", "second_tick", 120, [this](int i) { _clock.update(10, 9 + (i + 1) / 60, (i + 1) % 60, false); });
+
+    _tabs.init(0, 200, 320, 40, 3, TFT_WHITE, TFT_WINDOWGREY, TFT_YELLOW, 4);
+    _tabs.setLabelArray(&_tabLabels);
+    _measure("BottomTabs", "select", 9, [this](int i) { _tabs.setSelectedItem(i % 3, true); });
+    _snap("w_clock_tabs");
+
+    _tft->fillScreen(TFT_BLACK);
+    _keypad.init(30, 10, 260, 220, TFT_WINDOWGREY);
+    _keypad.setEntryValue(12.5);
+    _measure("NumericKeypad", "draw", 1, [this](int) { _keypad.draw("Benchmark", 1, true); });
+    _measure("NumericKeypad", "key_press", 12, [this](int i) {
+      _keypad.drawKey(i / 3, i % 3, true); // digit keys
+      _keypad.drawKey(i / 3, i % 3, false);
+    });
+    _snap("w_keypad");
+
+    if (_len < sizeof(_report))
+      _len += snprintf(_report + _len, sizeof(_report) - _len, "],\"total_ms\":%lu}\n", (unsigned long)(millis() - start));
+    return _report;
+  }
+
+  // JSON report of last run, empty if never run
+  const char *report() const { return _report; }
+
+private:
+  TFT_eSPI *_tft;
+  PushButton _button;
+  SlideSwitch _switch;
+  Checkbox _checkbox;
+  SliderHor _sliderHor;
+  SliderVert _sliderVert;
+  AnalogMeter _meter;
+  HorizontalBargraph _barHor;
+  VerticalBargraph _barVert;
+  ScrollingScope _scope;
+  NumericDisplay _numeric;
+  AnalogClock _clock;
+  BottomTabs _tabs;
+  NumericKeypad _keypad;
+  labelArray_t _tabLabels = {"One", "Two", "Three"};
+  char _report[BENCH_REPORT_SIZE] = "";
+  size_t _len = 0;
+  bool _first = true;
+  ScreenCapture *_capture = NULL;
+
+  // Triangle 0..1..0 over 2 * BENCH_STEPS calls
+  static float _ramp(int i) {
+    i %= 2 * BENCH_STEPS;
+    return (float)((i < BENCH_STEPS) ? i : 2 * BENCH_STEPS - i) / BENCH_STEPS;
+  }
+
+  // Capture golden image, not counted by profiler
+  void _snap(const char *name) {
+    if (!_capture) return;
+    profiler.pause(true);
+    _capture->capture(name);
+    profiler.pause(false);
+  }
+
+  void _out(const char *text) {
+    if (_len < sizeof(_report))
+      _len += snprintf(_report + _len, sizeof(_report) - _len, "%s", text);
+  }
+
+  // Call op(0..calls-1) and append one result entry
+  template <typename F>
+  void _measure(const char *widget, const char *op, int calls, F fn) {
+    uint32_t pixels = profiler.pixels(), prims = profiler.primitives(), bytes = profiler.bytes();
+    uint32_t start = micros();
+    for (int i = 0; i < calls; i++)
+      fn(i);
+    uint32_t us = micros() - start;
+    pixels = profiler.pixels() - pixels;
+    prims = profiler.primitives() - prims;
+    bytes = profiler.bytes() - bytes;
+    if (_len < sizeof(_report))
+      _len += snprintf(_report + _len, sizeof(_report) - _len,
+        "%s\n{\"widget\":\"%s\",\"op\":\"%s\",\"calls\":%d,\"pixels\":%lu,\"primitives\":%lu,\"bytes\":%lu,\"us\":%lu}",
+        _first ? "" : ",", widget, op, calls, (unsigned long)pixels, (unsigned long)prims,
+        (unsigned long)bytes, (unsigned long)us);
+    _first = false;
+    yield();
+  }
+};
+
+#endif // PROFILER
+
+#endif // WIDGETBENCH_H
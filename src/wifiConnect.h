@@ -9,18 +9,18 @@
 // using the settings stored in the settings struct
 
 
+#include "wifiManager.h"
+
+// Connection state machine, see wifiManager.h. Connect functions below only start
+// the connection, wifiManager.update() in loop() does the rest
+WifiManager wifiManager;
+
  bool wifi_connected() {
-  bool is_ok = (WiFi.status() == WL_CONNECTED || (settings.wifiAPenabled && settings.wifiEnabled));
+  bool is_ok = wifiManager.isConnected();
   timeOK &= is_ok;
   return is_ok;
  }
 
-// Default WPS configuration
-static esp_wps_config_t config = WPS_CONFIG_INIT_DEFAULT(WPS_TYPE_PBC);
-
-bool use_wps = false;
-volatile bool wps_in_progress = false;
-
 /*
 String wpspin2string(uint8_t a[]) {
   char wps_pin[9];
@@ -32,56 +32,40 @@ String wpspin2string(uint8_t a[]) {
 }
 */
 
+// Runs in WiFi task context: only post events, all actions are done by wifiManager.update()
 void wifi_event(WiFiEvent_t event){
-  int i = 0;
   DEBUG_PRINT("WIFI Event: ");
   switch(event) {
   case SYSTEM_EVENT_STA_START:
+    DEBUG_PRINT("STA started");
+    break;
   case SYSTEM_EVENT_AP_START:
-    DEBUG_PRINT("STA or AP started");
+    DEBUG_PRINT("AP started");
+    wifiManager.postEvent(wifi_ev_ap_start);
     break;
   case SYSTEM_EVENT_STA_GOT_IP:
-    DEBUG_PRINT("STA connected to: " + String(WiFi.SSID()));
-    DEBUG_PRINT(" with own IP: ");
-    DEBUG_PRINT(WiFi.localIP());
+    DEBUG_PRINT("STA got IP");
+    wifiManager.postEvent(wifi_ev_got_ip);
     break;
   case SYSTEM_EVENT_STA_DISCONNECTED:
     DEBUG_PRINT("STA Disconnected");
-    if (use_wps) {
-      DEBUG_PRINT(", try to reconnect");
-      WiFi.reconnect();
-    }
+    wifiManager.postEvent(wifi_ev_disconnected);
     break;
   case SYSTEM_EVENT_STA_WPS_ER_SUCCESS:
-    if (use_wps) {
-      DEBUG_PRINT("WPS ok, stop WPS and connect to: " + String(WiFi.SSID()));
-      esp_wifi_wps_disable();
-      delay(10);
-      WiFi.begin();
-    } else {
-      DEBUG_PRINT("Success, WPS not used");
-    }
-    wps_in_progress = false;
+    DEBUG_PRINT("WPS ok");
+    wifiManager.postEvent(wifi_ev_wps_success);
     break;
   case SYSTEM_EVENT_STA_WPS_ER_FAILED:
-    if (use_wps) {
-      DEBUG_PRINT("WPS failed, retry");
-      esp_wifi_wps_disable();
-      esp_wifi_wps_enable(&config);
-      esp_wifi_wps_start(0);
-    }
+    DEBUG_PRINT("WPS failed");
+    wifiManager.postEvent(wifi_ev_wps_failed);
     break;
   case SYSTEM_EVENT_STA_WPS_ER_TIMEOUT:
-    if (use_wps) {
-      DEBUG_PRINT("WPS timeout, retry");
-      esp_wifi_wps_disable();
-      esp_wifi_wps_enable(&config);
-      esp_wifi_wps_start(0);
-    }
+    DEBUG_PRINT("WPS timeout");
+    wifiManager.postEvent(wifi_ev_wps_failed);
     break;
   case SYSTEM_EVENT_STA_STOP:
   case SYSTEM_EVENT_AP_STOP:
-    DEBUG_PRINT("STA orAP stopped");
+    DEBUG_PRINT("STA or AP stopped");
     break;
   case SYSTEM_EVENT_STA_CONNECTED:
     DEBUG_PRINT("STA connected");
@@ -99,145 +83,145 @@ void wifi_event(WiFiEvent_t event){
   DEBUG_PRINTLN("");
 }
 
+// Start time sync, does not wait. timeOK is set in loop() when time is valid
 void config_time() {
-  // Zeitanzeige initialisieren
-  dialogBox.draw(F("Get time from server"), MY_NTP_SERVER, DB_INFO);
+  timeOK = false;
   configTzTime(MY_TIMEZONE, MY_NTP_SERVER); // --> Here is the IMPORTANT ONE LINER needed in your sketch!
-  // timeinfo should be valid here, assigned in setup()
-  if(getLocalTime(timeinfo, 5000)) {
-    timeOK = true;
-  } else {
-    dialogBox.message(F("Failed to obtain time from"), MY_NTP_SERVER, 2000, DB_ERROR);
+}
+
+// Non-modal WiFi status on main page: status LED color and blinking
+void wifi_show_state(bool force_redraw) {
+  UI_CHECK_RENDER_TASK(); // events of the WiFi task arrive here via wifiManager.update()
+  switch (wifiManager.state()) {
+  case wifi_st_connecting:
+  case wifi_st_wps:
+    statusLED.setColor(TFT_YELLOW);
+    statusLED.setState(true, true, force_redraw);   // yellow blinking: connecting
+    break;
+  case wifi_st_connected:
+    statusLED.setColor(TFT_GREEN);
+    statusLED.setState(true, true, force_redraw);   // green blinking: connected
+    break;
+  case wifi_st_ap:
+    statusLED.setColor(TFT_BLUE);
+    statusLED.setState(true, true, force_redraw);   // blue blinking: access point
+    break;
+  case wifi_st_failed:
+    statusLED.setColor(TFT_RED);
+    statusLED.setState(true, false, force_redraw);  // red: failed
+    break;
+  default:
+    statusLED.setColor(TFT_GREEN);
+    statusLED.setState(false, false, force_redraw); // off
+    break;
   }
 }
 
+// Register routes and start web server and OTA on the first connection only,
+// AsyncWebServer keeps them over reconnects and a second init_server() would add all handlers again
+void start_server_once() {
+  static bool serverStarted = false;
+  if (serverStarted) return;
+  init_server();
+  serverStarted = true;
+}
 
-// Start WPS connection
+// State action of wifiManager, called from loop() context
+void wifi_state_changed(wifiState_e state) {
+  switch (state) {
+  case wifi_st_connected:
+    spkrOKbeep();
+    DEBUG_PRINT(F("Connected to: "));
+    DEBUG_PRINT(WiFi.SSID());
+    DEBUG_PRINT(F(", IP for Browser Config: "));
+    DEBUG_PRINTLN(WiFi.localIP());
+    if (wifiManager.usesKnownNetwork())
+      settings.wifiWPSused = true;
+    start_server_once();
+    config_time();
+    break;
+  case wifi_st_ap:
+    spkrBeep(25);
+    DEBUG_PRINT(F("Created Access Point with IP "));
+    DEBUG_PRINTLN(WiFi.softAPIP());
+    start_server_once();
+    break;
+  case wifi_st_failed:
+    DEBUG_PRINTLN(F("WIFI not available"));
+    if (!wifiManager.willRetry()) {
+      // first connect failed, as before: WiFi off until enabled again
+      settings.wifiEnabled = false;
+      if (wifiManager.usesKnownNetwork())
+        settings.wifiWPSused = false;
+      wifiEnaCheckbox.setState(false, true);
+    }
+    break;
+  default:
+    break;
+  }
+  wifi_show_state(true);
+}
+
+// Install WiFi event handler and state action once
+void wifi_begin() {
+  static bool installed = false;
+  if (installed) return;
+  WiFi.onEvent(wifi_event);
+  wifiManager.setStateAction(wifi_state_changed);
+  installed = true;
+}
+
+// Start WPS connection, returns immediately
 void wps_connect() {
   timeOK = false;
-  use_wps = true;
-  char ssid[32];     // Router SSID
   spkrBeep(25);
-  dialogBox.draw(F("WPS config started"), F("Please wait"), DB_INFO);
   DEBUG_PRINTLN("WPS config started");
-  wps_in_progress = true;
-  WiFi.onEvent(wifi_event);
-  WiFi.begin(); // Start WiFi in STA mode
-  WiFi.mode(WIFI_STA);
-  esp_wifi_wps_enable(&config);
-  esp_wifi_wps_start(0);
-  while (wps_in_progress) {
-    delay(50);
-  }
-  use_wps = false;
-  if (WiFi.status() == WL_CONNECTED) {
-    WiFi.SSID().toCharArray(ssid, WiFi.SSID().length() + 1);
-    spkrBeep(50);
-    dialogBox.draw(F("Connected to"), ssid, DB_INFO);
-    DEBUG_PRINTLN("WPS successful");
-    delay(1000);
-    settings.wifiWPSused = true;
-    init_server();
-    // Zeitanzeige initialisieren
-    config_time();
-  } else {
-    dialogBox.modalDlg(F("WPS failed"), "", DB_ERROR);
-    DEBUG_PRINTLN("WPS failed");
-    WiFi.disconnect();
-    settings.wifiWPSused = false;
-  }
-  esp_wifi_wps_disable();
+  wifi_begin();
+  wifiManager.startWps();
 }
 
-// Connect to WiFi in Access Point mode
-wl_status_t wifi_connect_ap() {
+// Start Access Point mode, returns immediately
+void wifi_connect_ap() {
   timeOK = false;
-  use_wps = false;
-  WiFi.softAP("KBP PanelMeter", "");	// access point, kein PW
-  delay(500);
-  WiFi.softAPConfig(IPAddress(192, 168, 4, 1), IPAddress(192, 168, 4, 1), IPAddress(255, 255, 255, 0));
-  WiFi.onEvent(wifi_event); // for debugging
-
-  spkrBeep(25);
-  dialogBox.draw(F("Access Point IP:"), WiFi.softAPIP().toString(), DB_INFO);
-  delay(2000);
-  DEBUG_PRINT(F("Created Access Point with IP "));
-  DEBUG_PRINTLN(WiFi.softAPIP());
-  init_server();
-  return WL_CONNECTED; // Return true to indicate AP mode is active
+  wifi_begin();
+  wifiManager.startAp("KBP PanelMeter");
 }
 
-// Connect to WiFi in Station mode, start server if connected
-// Returns the WiFi status
-wl_status_t wifi_connect_sta() {
+// Start connection in Station mode, returns immediately.
+// Web server is started by wifi_state_changed() on the first connection
+void wifi_connect_sta() {
   timeOK = false;
-  use_wps = false; // Use WPS if enabled in settings
-  WiFi.mode(WIFI_STA);
-  WiFi.onEvent((WiFiEventCb)wifi_event); // defined in wps.h
-  int i;
-  wl_status_t status;
-  char ssid[32];     // Router SSID
-  String password = settings.password;
-  i = 0;
   spkrBeep(25);
+  wifi_begin();
   if (settings.wifiWPSused) {
-    WiFi.begin();
-    dialogBox.draw(F("Connecting to"), F("known network"), DB_INFO);
-    DEBUG_PRINT(F("Connected to known network"));
-    delay(1000);
-    while ((WiFi.status() != WL_CONNECTED) && (i < 25)) {
-      digitalWrite(LED_PIN, i & 1);
-      delay(250);
-      i++;
-    }
-    WiFi.SSID().toCharArray(ssid, WiFi.SSID().length() + 1);
-    dialogBox.draw(F("Connected to"), ssid, DB_INFO);
-    delay(1000);
-    DEBUG_PRINT(F("Connected to: "));
-    DEBUG_PRINTLN(WiFi.SSID());
+    DEBUG_PRINTLN(F("Connect to known network"));
+    wifiManager.connectSta(NULL, NULL);
   } else {
-    WiFi.begin(settings.ssid, settings.password);
-    dialogBox.draw(F("Connecting to"), settings.ssid, DB_INFO);
-    delay(1000);
-    while ((WiFi.status() != WL_CONNECTED) && (i < 25)) {
-      digitalWrite(LED_PIN, i & 1);
-      delay(250);
-      i++;
-    }
     DEBUG_PRINT(F("Connect to network in settings: "));
     DEBUG_PRINTLN(settings.ssid);
+    wifiManager.connectSta(settings.ssid, settings.password);
   }
-  status = WiFi.status();
-  if (status == WL_CONNECTED) {
-    spkrOKbeep();
-    dialogBox.draw(F("IP for Browser Config:"), WiFi.localIP().toString(), DB_INFO);
-    delay(2000);
-    init_server();
-    // Zeitanzeige initialisieren
-    config_time();
-  } else {
-    dialogBox.modalDlg(F("WIFI not available"), F(""), DB_ERROR);
-  }
-  return status;
+}
+
+// Stop WiFi and web server
+void wifi_disconnect() {
+  stop_server();
+  wifiManager.stop();
 }
 
 // WiFi.scanNetworks will return the number of networks found.
-int wifi_scanNetworks(menuArr_t wifiArr) {
+// The scan result is kept for wifi_menuItem(), free it with WiFi.scanDelete().
+int wifi_scanNetworks() {
     int n = WiFi.scanNetworks();
     DEBUG_PRINT(F("Scan done, "));
-    if (n == 0) {
+    if (n <= 0) {
       DEBUG_PRINTLN(F("no networks found"));
-      strcpy(wifiArr[0], "No networks found");
-      n = 1;
+      n = 0;
     } else {
-      if (n > 15) {
-        n = 15;
-      }
       DEBUG_PRINTLN(F(" networks found"));
       DEBUG_PRINTLN(F("Nr | SSID                             | RSSI | CH | Encryption"));
       for (int i = 0; i < n; ++i) {
         // Print SSID and RSSI for each network found
-        strcpy(wifiArr[i], WiFi.SSID(i).c_str());
         DEBUG_PRINTF("%2d",i + 1);
         DEBUG_PRINT(F(" | "));
         DEBUG_PRINTF("%-32.32s", WiFi.SSID(i).c_str());
@@ -281,11 +265,17 @@ int wifi_scanNetworks(menuArr_t wifiArr) {
       }
     }
     DEBUG_PRINTLN("");
-    // Delete the scan result to free memory for code below.
-    WiFi.scanDelete();
     return n; // Return the number of networks found
   }
 
+// SSID of scanned network idx for ModalMenu::select()
+const char *wifi_menuItem(int idx, void *ctx) {
+  static char ssid[33];
+  strncpy(ssid, WiFi.SSID(idx).c_str(), sizeof(ssid) - 1);
+  ssid[sizeof(ssid) - 1] = '\0';
+  return ssid;
+}
+
 // ##############################################################################
 
 #endif // WIFI_CONNECT_H
\ No newline at end of file
@@ -0,0 +1,293 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Non-blocking WiFi connection manager.
+//
+// connectSta(), startWps() and startAp() only start the connection and return
+// immediately. Events from the WiFi task (wifi_event() in wifiConnect.h) are
+// posted with postEvent() into a small queue; update(), called every loop(),
+// processes them, checks timeouts and changes state. The state action callback
+// is always called from update() or the start functions, so it may safely draw
+// on the display or start the web server.
+//
+//  off --connectSta()--> connecting --got IP--> connected --disconnected--> connecting
+//  off --startWps()----> wps --success--> connecting (known network)
+//  off --startAp()-----> ap
+//  connecting/wps --timeout--> failed
+//  failed --WIFI_RETRY_MS--> connecting, only if we were connected before
+//
+// Without ARDUINO defined, the hardware calls are replaced by a stand-in that
+// only logs them, and time is taken from hostMillis. Events are injected with
+// postEvent(), see tools/wifi_sim.
+
+#ifdef ARDUINO
+  #include <Arduino.h>
+  #include <WiFi.h>
+  #include <esp_wps.h>
+#else
+  #include <cstdint>
+  #include <cstdio>
+  #include <cstring>
+#endif
+
+#define WIFI_CONNECT_TIMEOUT_MS 8000    // STA-Verbindungsaufbau
+#define WIFI_WPS_TIMEOUT_MS 120000UL    // WPS-Taste am Router drücken
+#define WIFI_RETRY_MS 30000             // Wiederholung nach Verbindungsverlust
+#define WIFI_EVENT_QUEUE 8              // Zweierpotenz
+
+enum wifiState_e {
+  wifi_st_off = 0,
+  wifi_st_connecting,  // STA connect running
+  wifi_st_wps,         // WPS push button configuration running
+  wifi_st_connected,   // STA got IP
+  wifi_st_ap,          // access point running
+  wifi_st_failed       // connect timed out
+};
+
+enum wifiEvent_e {
+  wifi_ev_none = 0,
+  wifi_ev_got_ip,
+  wifi_ev_disconnected,
+  wifi_ev_wps_success,
+  wifi_ev_wps_failed,     // WPS failed or timed out, retried until WIFI_WPS_TIMEOUT_MS
+  wifi_ev_ap_start
+};
+
+class WifiManager {
+public:
+  typedef void (*stateCallback)(wifiState_e state);
+
+  WifiManager() { }
+
+  // Called on every state change, from loop() context
+  void setStateAction(stateCallback action) { _stateAction = action; }
+
+  // Connect to network with credentials, ssid NULL or empty: network stored by WPS
+  void connectSta(const char *ssid, const char *password) {
+    _wasConnected = false;
+    _setCredentials(ssid, password);
+    _hwStop();
+    _hwBeginSta();
+    _setState(wifi_st_connecting);
+  }
+
+  // Start WPS push button configuration
+  void startWps() {
+    _wasConnected = false;
+    _setCredentials(NULL, NULL);
+    _hwStop();
+    _hwWpsStart();
+    _setState(wifi_st_wps);
+  }
+
+  // Start access point, no password
+  void startAp(const char *ssid) {
+    _wasConnected = false;
+    _hwStop();
+    _hwBeginAp(ssid);
+    _setState(wifi_st_ap);
+  }
+
+  // Disconnect STA or stop AP/WPS
+  void stop() {
+    _wasConnected = false;
+    _hwStop();
+    _setState(wifi_st_off);
+  }
+
+  // Post event from WiFi task, processed by next update()
+  void postEvent(wifiEvent_e event) {
+    uint8_t next = (_head + 1) & (WIFI_EVENT_QUEUE - 1);
+    if (next == _tail) return; // queue full, update() not called for a long time
+    _queue[_head] = event;
+    _head = next;
+  }
+
+  // Process events and timeouts, must be called regularly in loop(), never blocks
+  void update() {
+    while (_tail != _head) {
+      wifiEvent_e event = (wifiEvent_e)_queue[_tail];
+      _tail = (_tail + 1) & (WIFI_EVENT_QUEUE - 1);
+      _handleEvent(event);
+    }
+    uint32_t elapsed = stateMillis();
+    switch (_state) {
+    case wifi_st_connecting:
+      if (elapsed >= WIFI_CONNECT_TIMEOUT_MS) {
+        _hwStop();
+        _setState(wifi_st_failed);
+      }
+      break;
+    case wifi_st_wps:
+      if (elapsed >= WIFI_WPS_TIMEOUT_MS) {
+        _hwStop();
+        _setState(wifi_st_failed);
+      }
+      break;
+    case wifi_st_failed:
+      if (_wasConnected && (elapsed >= WIFI_RETRY_MS)) {
+        _hwBeginSta();
+        _setState(wifi_st_connecting);
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  wifiState_e state() const { return _state; }
+  bool isConnected() const { return (_state == wifi_st_connected) || (_state == wifi_st_ap); }
+  bool isBusy() const { return (_state == wifi_st_connecting) || (_state == wifi_st_wps); }
+  // Connection will be retried after failure, lost connection
+  bool willRetry() const { return _wasConnected; }
+  // Connected by WPS, network stored in WiFi NVS
+  bool usesKnownNetwork() const { return _ssid[0] == '\0'; }
+  uint32_t stateMillis() const { return _millis() - _stateStart; }
+
+  const char *stateText() const {
+    static const char *texts[] = { "off", "connecting", "WPS", "connected", "AP", "failed" };
+    return texts[_state];
+  }
+
+#ifndef ARDUINO
+  static uint32_t hostMillis;   // host stand-in clock, set by the simulation
+#endif
+
+private:
+  volatile wifiState_e _state = wifi_st_off;
+  uint32_t _stateStart = 0;
+  bool _wasConnected = false;   // connection was established, retry if lost
+  char _ssid[33] = "";
+  char _password[65] = "";
+  stateCallback _stateAction = NULL;
+  volatile uint8_t _queue[WIFI_EVENT_QUEUE];
+  volatile uint8_t _head = 0, _tail = 0;
+
+  void _setState(wifiState_e state) {
+    _stateStart = _millis();
+    if (state == _state) return;
+    _state = state;
+    _log("WiFi state: ", stateText());
+    if (_stateAction)
+      _stateAction(state);
+  }
+
+  void _setCredentials(const char *ssid, const char *password) {
+    _ssid[0] = '\0';
+    _password[0] = '\0';
+    if (ssid) {
+      strncpy(_ssid, ssid, sizeof(_ssid) - 1);
+      _ssid[sizeof(_ssid) - 1] = '\0';
+    }
+    if (password) {
+      strncpy(_password, password, sizeof(_password) - 1);
+      _password[sizeof(_password) - 1] = '\0';
+    }
+  }
+
+  void _handleEvent(wifiEvent_e event) {
+    switch (event) {
+    case wifi_ev_got_ip:
+      if ((_state == wifi_st_connecting) || (_state == wifi_st_failed) || (_state == wifi_st_wps)) {
+        _wasConnected = true;
+        _setState(wifi_st_connected);
+      }
+      break;
+    case wifi_ev_disconnected:
+      if (_state == wifi_st_connected) {
+        _hwReconnect();
+        _setState(wifi_st_connecting);
+      }
+      break;
+    case wifi_ev_wps_success:
+      if (_state == wifi_st_wps) {
+        _hwWpsStop();
+        _hwBeginSta(); // credentials from WPS
+        _setState(wifi_st_connecting);
+      }
+      break;
+    case wifi_ev_wps_failed:
+      if (_state == wifi_st_wps)
+        _hwWpsRestart();
+      break;
+    default:
+      break;
+    }
+  }
+
+#ifdef ARDUINO
+  // Default WPS configuration
+  esp_wps_config_t _wpsConfig = WPS_CONFIG_INIT_DEFAULT(WPS_TYPE_PBC);
+
+  static uint32_t _millis() { return millis(); }
+  static void _log(const char *text, const char *value) {
+    DEBUG_PRINT(text);
+    DEBUG_PRINTLN(value);
+  }
+
+  void _hwBeginSta() {
+    WiFi.mode(WIFI_STA);
+    if (_ssid[0])
+      WiFi.begin(_ssid, _password);
+    else
+      WiFi.begin(); // known network
+  }
+  void _hwReconnect() { WiFi.reconnect(); }
+  void _hwBeginAp(const char *ssid) {
+    WiFi.softAP(ssid, "");  // access point, kein PW
+    WiFi.softAPConfig(IPAddress(192, 168, 4, 1), IPAddress(192, 168, 4, 1), IPAddress(255, 255, 255, 0));
+  }
+  void _hwWpsStart() {
+    WiFi.mode(WIFI_STA);
+    esp_wifi_wps_enable(&_wpsConfig);
+    esp_wifi_wps_start(0);
+  }
+  void _hwWpsStop() { esp_wifi_wps_disable(); }
+  void _hwWpsRestart() {
+    esp_wifi_wps_disable();
+    esp_wifi_wps_enable(&_wpsConfig);
+    esp_wifi_wps_start(0);
+  }
+  void _hwStop() {
+    if (_state == wifi_st_wps)
+      esp_wifi_wps_disable();
+    if (_state == wifi_st_ap)
+      WiFi.softAPdisconnect(true);
+    else if (_state != wifi_st_off)
+      WiFi.disconnect();
+  }
+#else
+  static uint32_t _millis() { return hostMillis; }
+  static void _log(const char *text, const char *value) { printf("%8u  %s%s\n", hostMillis, text, value); }
+
+  void _hwBeginSta() { _log("  hw: WiFi.begin ", _ssid[0] ? _ssid : "(known network)"); }
+  void _hwReconnect() { _log("  hw: WiFi.reconnect", ""); }
+  void _hwBeginAp(const char *ssid) { _log("  hw: WiFi.softAP ", ssid); }
+  void _hwWpsStart() { _log("  hw: WPS start", ""); }
+  void _hwWpsStop() { _log("  hw: WPS disable", ""); }
+  void _hwWpsRestart() { _log("  hw: WPS restart", ""); }
+  void _hwStop() {
+    if (_state != wifi_st_off)
+      _log("  hw: stop ", stateText());
+  }
+#endif
+};
+
+#ifndef ARDUINO
+  uint32_t WifiManager::hostMillis = 0;
+#endif
+
+#endif // WIFI_MANAGER_H
@@ -0,0 +1,95 @@
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Host simulation of AutoRanger (src/autoRange.h) with a scripted input signal.
+// Build and run on the PC:
+//   g++ -O2 -std=c++17 -Wall -Wextra -I../../src autorange_sim.cpp -o autorange_sim
+//   ./autorange_sim amps hold:0.005:1000 ramp:0.005:0.9:2000 hold:0.9:500 step:0.02 hold:0.02:2000
+//   ./autorange_sim volts hold:2:1000 noise:2.9:0.2:3000
+// Commands: amps, volts                   range block, current 30mA..3A or voltage 1V..100V
+//           hold:<value>:<ms>             constant value
+//           step:<value>                  jump to value, hold for one update
+//           ramp:<from>:<to>:<ms>         linear ramp
+//           noise:<value>:<pp>:<ms>       value with uniform noise, pp peak-to-peak
+// Values in A or V. update() runs every UPDATE_MS like the main loop; the ADC
+// clips at ADC_CLIP_FS of the reference range. Prints every range change with
+// deflection before and after, and a summary of clipped updates and updates below 10% with a lower range available.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "autoRange.h"
+
+#define UPDATE_MS 35         // UPDATETIMER_MS in global_vars.h
+#define ADC_CLIP_FS 1.215f   // ADC_OVERLOAD_DC / ADC_DIV_HIRANGE, in full scale of reference range
+
+static AutoRanger *ranger;
+static int refIdx, firstIdx;
+static uint32_t now = 0;
+static long updates = 0, clipped = 0, low = 0, changes = 0;
+
+static void sample(float value) {
+  float clip = ADC_CLIP_FS * meterRangeFullScale(refIdx);
+  bool overload = value > clip;
+  float measured = overload ? clip : value;
+  int old_idx = ranger->getRangeIdx();
+  if (ranger->update(measured, overload, now)) {
+    int idx = ranger->getRangeIdx();
+    changes++;
+    printf("%8u  %8.4f  range #%d %g%s (%5.1f%%) -> #%d %g%s (%5.1f%%)\n", now, value,
+      old_idx, meterRanges[old_idx].maxVal, meterRanges[old_idx].unit, 100 * measured / meterRangeFullScale(old_idx),
+      idx, meterRanges[idx].maxVal, meterRanges[idx].unit, 100 * measured / meterRangeFullScale(idx));
+  }
+  float defl = measured / meterRangeFullScale(ranger->getRangeIdx());
+  updates++;
+  if (defl > 1.05f) clipped++; // needle at end stop
+  if ((defl < 0.1f) && (ranger->getRangeIdx() > firstIdx)) low++; // lower range was available
+  now += UPDATE_MS;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s amps|volts hold:<v>:<ms>|step:<v>|ramp:<v0>:<v1>:<ms>|noise:<v>:<pp>:<ms> ...\n", argv[0]);
+    return 1;
+  }
+  static AutoRanger ampRanger(0, 4), voltRanger(5, 9);
+  if (strcmp(argv[1], "volts") == 0) {
+    ranger = &voltRanger;
+    refIdx = 7;
+    firstIdx = 5;
+  } else {
+    ranger = &ampRanger;
+    refIdx = 3;
+    firstIdx = 0;
+  }
+  ranger->setRangeIdx(refIdx);
+  ranger->setEnabled(true);
+  srand(1);
+  for (int i = 2; i < argc; i++) {
+    float a = 0, b = 0, c = 0;
+    if (sscanf(argv[i], "hold:%f:%f", &a, &b) == 2) {
+      for (float t = 0; t < b; t += UPDATE_MS) sample(a);
+    } else if (sscanf(argv[i], "step:%f", &a) == 1) {
+      sample(a);
+    } else if (sscanf(argv[i], "ramp:%f:%f:%f", &a, &b, &c) == 3) {
+      for (float t = 0; t < c; t += UPDATE_MS) sample(a + (b - a) * t / c);
+    } else if (sscanf(argv[i], "noise:%f:%f:%f", &a, &b, &c) == 3) {
+      for (float t = 0; t < c; t += UPDATE_MS) sample(a + b * ((float)rand() / RAND_MAX - 0.5f));
+    } else {
+      fprintf(stderr, "unknown command %s\n", argv[i]);
+      return 1;
+    }
+  }
+  printf("%ld updates, %ld range changes, %ld clipped, %ld below 10%% deflection\n", updates, changes, clipped, low);
+  return 0;
+}
@@ -0,0 +1,77 @@
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Convert a 24 bit BMP into a RGB565 raw file for ImageBlitter (src/imageBlit.h).
+// Uses the same conversion kernel as the panel, so the result is pixel-identical.
+// Build and run on the PC:
+//   g++ -O2 -std=c++17 -I../../src bmp2raw.cpp -o bmp2raw
+//   ./bmp2raw ../../data/splash.bmp ../../data/splash.565
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "imageBlit.h"
+
+static uint16_t get16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t get32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s in.bmp out.565\n", argv[0]);
+    return 1;
+  }
+  FILE *in = fopen(argv[1], "rb");
+  if (!in) {
+    fprintf(stderr, "Can not open %s\n", argv[1]);
+    return 1;
+  }
+  uint8_t hdr[54];
+  if ((fread(hdr, 1, sizeof(hdr), in) != sizeof(hdr)) || (get16(hdr) != IMG_BMP_MAGIC)
+      || (get16(hdr + 26) != 1) || (get16(hdr + 28) != 24) || (get32(hdr + 30) != 0)) {
+    fprintf(stderr, "%s is not an uncompressed 24 bit BMP\n", argv[1]);
+    return 1;
+  }
+  int32_t w = (int32_t)get32(hdr + 18);
+  int32_t h = (int32_t)get32(hdr + 22);
+  bool bottomUp = (h > 0);
+  if (!bottomUp) h = -h;
+  if ((w <= 0) || (w > 0xFFFF) || (h > 0xFFFF)) {
+    fprintf(stderr, "Invalid image size %d x %d\n", w, h);
+    return 1;
+  }
+  size_t stride = (w * 3 + 3) & ~3;
+  std::vector<uint32_t> row((stride + 3) / 4); // word aligned for the kernel
+  std::vector<uint16_t> pixels((size_t)w * h);
+  fseek(in, get32(hdr + 10), SEEK_SET);
+  for (int32_t r = 0; r < h; r++) {
+    if (fread(row.data(), 1, stride, in) != stride) {
+      fprintf(stderr, "%s truncated\n", argv[1]);
+      return 1;
+    }
+    int32_t dst_row = bottomUp ? (h - 1 - r) : r;
+    imgConvertBGR888((const uint8_t *)row.data(), &pixels[(size_t)dst_row * w], w);
+  }
+  fclose(in);
+
+  FILE *out = fopen(argv[2], "wb");
+  if (!out) {
+    fprintf(stderr, "Can not create %s\n", argv[2]);
+    return 1;
+  }
+  imgRawHeader_t raw = { IMG_RAW_MAGIC, (uint16_t)w, (uint16_t)h };
+  fwrite(&raw, sizeof(raw), 1, out);
+  fwrite(pixels.data(), 2, pixels.size(), out);
+  fclose(out);
+  printf("%s: %d x %d, %zu bytes\n", argv[2], w, h, sizeof(raw) + pixels.size() * 2);
+  return 0;
+}
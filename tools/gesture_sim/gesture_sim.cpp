@@ -0,0 +1,176 @@
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Host simulation of GestureRecognizer (src/gestures.h).
+// Build and run on the PC:
+//   g++ -O2 -std=c++17 -Wall -Wextra -I../../src gesture_sim.cpp -o gesture_sim
+//   ./gesture_sim [sample_ms] [jitter_px]
+// Feeds scripted touches at the given sample period (default 5 ms, the pen
+// job; 35 ms is the touch job alone) with +-jitter_px (default 2) on every
+// sample, like the output of TouchFilter. Subscriptions as on the panel:
+// page swipe over the main window, tap and long press on the scope plot, a
+// drag handle. Checks tap, double tap, long press, swipes, slow drags that
+// are no swipe, drag capture and the cancel on gaps in the touch stream.
+
+#include <cstdio>
+#include <cstdlib>
+#include "gestures.h"
+#include "../sim_check.h"
+
+static uint32_t rng = 12345;
+static int rnd(int range) { // -range..range
+  if (range <= 0) return 0;
+  rng = rng * 1664525u + 1013904223u;
+  return (int)((rng >> 8) % (2 * range + 1)) - range;
+}
+
+static int sample_ms = 5, jitter = 2;
+static uint32_t now = 1000;
+static GestureRecognizer gestures;
+
+static int counts[3][gesture_count];
+static gesture_t last[3];
+
+static void record(int sub, const gesture_t &g) {
+  counts[sub][g.type]++;
+  last[sub] = g;
+}
+static void pageHandler(const gesture_t &g) { record(0, g); }
+static void plotHandler(const gesture_t &g) { record(1, g); }
+static void handleHandler(const gesture_t &g) { record(2, g); }
+
+static void clear() {
+  for (int s = 0; s < 3; s++)
+    for (int t = 0; t < gesture_count; t++)
+      counts[s][t] = 0;
+}
+
+static int total() {
+  int n = 0;
+  for (int s = 0; s < 3; s++)
+    for (int t = 0; t < gesture_count; t++)
+      n += counts[s][t];
+  return n;
+}
+
+// Finger moves straight from (x0, y0) to (x1, y1) in ms, then lifts
+static void stroke(int x0, int y0, int x1, int y1, uint32_t ms) {
+  for (uint32_t t = 0; t <= ms; t += sample_ms) {
+    int x = x0 + (int)((x1 - x0) * (int32_t)t / (int32_t)(ms ? ms : 1));
+    int y = y0 + (int)((y1 - y0) * (int32_t)t / (int32_t)(ms ? ms : 1));
+    gestures.update(true, x + rnd(jitter), y + rnd(jitter), now);
+    now += sample_ms;
+  }
+  gestures.update(false, 0, 0, now);
+  now += sample_ms;
+}
+
+static void pause(uint32_t ms) {
+  for (uint32_t t = 0; t < ms; t += sample_ms) {
+    gestures.update(false, 0, 0, now);
+    now += sample_ms;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) sample_ms = atoi(argv[1]);
+  if (argc > 2) jitter = atoi(argv[2]);
+  if (sample_ms < 1) sample_ms = 1;
+  printf("  sample period %d ms, jitter +-%d px\n", sample_ms, jitter);
+
+  int handle = gestures.subscribe(GESTURE_DRAG | GESTURE_SWIPES_H, 250, 0, 70, 240, handleHandler);
+  int plot = gestures.subscribe(GESTURE_MASK(gesture_tap) | GESTURE_MASK(gesture_long_press), 5, 0, 240, 200, plotHandler);
+  int page = gestures.subscribe(GESTURE_SWIPES_H, 0, 0, 320, 240, pageHandler);
+  check((handle == 0) && (plot == 1) && (page == 2), "subscriptions");
+
+  clear();
+  stroke(100, 100, 100, 100, 80);
+  check((counts[1][gesture_tap] == 1) && (total() == 1), "tap on plot");
+  check((abs(last[1].x0 - 100) <= jitter) && (abs(last[1].y0 - 100) <= jitter), "tap position");
+
+  pause(150);
+  stroke(103, 98, 103, 98, 80);
+  check(counts[1][gesture_tap] == 2 && (total() == 2), "double tap as second tap (no double in mask)");
+
+  pause(150);
+  clear();
+  int dbl = gestures.subscribe(GESTURE_MASK(gesture_double_tap), 0, 200, 320, 40, pageHandler);
+  stroke(60, 220, 60, 220, 60);
+  pause(150);
+  stroke(64, 218, 64, 218, 60);
+  check((counts[0][gesture_double_tap] == 1) && (total() == 1), "double tap (tap not subscribed there)");
+  pause(400);
+  stroke(60, 220, 60, 220, 60);
+  pause(GESTURE_DOUBLE_MS + 50);
+  stroke(60, 220, 60, 220, 60);
+  check(counts[0][gesture_double_tap] == 1, "slow second tap is no double tap");
+  gestures.setEnabled(dbl, false);
+
+  pause(400);
+  clear();
+  stroke(120, 80, 122, 82, GESTURE_LONG_MS + 200);
+  check((counts[1][gesture_long_press] == 1) && (counts[1][gesture_tap] == 0), "long press, no tap after it");
+  check((last[1].ms >= GESTURE_LONG_MS) && (last[1].ms < GESTURE_LONG_MS + 2 * (uint32_t)sample_ms),
+    "long press reported while held");
+
+  pause(400);
+  clear();
+  stroke(200, 120, 60, 125, 250);
+  check((counts[0][gesture_swipe_left] == 1) && (total() == 1), "swipe left 140 px in 250 ms to page");
+  printf("  swipe velocity %ld px/s\n", (long)last[0].vx);
+  stroke(60, 120, 220, 110, 300);
+  check(counts[0][gesture_swipe_right] == 1, "swipe right");
+  stroke(200, 120, 60, 125, 1200);
+  check((counts[0][gesture_swipe_left] == 1) && (total() == 2), "slow drag over the page is no swipe");
+  stroke(150, 40, 160, 180, 200);
+  check(total() == 2, "vertical swipe not subscribed, ignored");
+  stroke(150, 60, 230, 120, 200);
+  check(total() == 2, "diagonal move is no swipe");
+  stroke(150, 100, 185, 100, 100);
+  check(total() == 2, "short move is no swipe");
+
+  clear();
+  stroke(280, 100, 280, 30, 400);
+  check((counts[2][gesture_drag_start] == 1) && (counts[2][gesture_drag_end] == 1)
+    && (counts[2][gesture_drag_move] > 0), "drag on handle");
+  check(abs(last[2].dy + 70) <= 2 * jitter, "drag end position");
+  clear();
+  stroke(280, 100, 60, 100, 250);
+  check((counts[2][gesture_swipe_left] == 1) && (counts[0][gesture_swipe_left] == 0),
+    "drag capture: swipe from handle stays with it");
+  check(counts[2][gesture_drag_move] > 0, "drag moves outside of the handle area");
+
+  clear();
+  gestures.setEnabled(handle, false);
+  stroke(280, 100, 60, 100, 250);
+  check((counts[0][gesture_swipe_left] == 1) && (counts[2][gesture_drag_start] == 0), "disabled handle, swipe to page");
+  gestures.setEnabled(handle, true);
+
+  // touch stream interrupted by a modal widget loop
+  clear();
+  gestures.update(true, 280, 100, now);
+  now += sample_ms;
+  gestures.update(true, 280, 130, now);
+  now += 500;
+  uint32_t cancelled = gestures.cancelled();
+  gestures.update(false, 0, 0, now);
+  now += sample_ms;
+  check((gestures.cancelled() == cancelled + 1) && (counts[2][gesture_drag_end] == 1) && (total() == 2),
+    "gap in touch stream cancels, drag end sent");
+  gestures.update(true, 100, 100, now);
+  now += 400;
+  gestures.update(false, 0, 0, now);
+  check(total() == 2, "tap around a gap is no tap");
+
+  return checkSummary();
+}
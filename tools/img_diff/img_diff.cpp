@@ -0,0 +1,124 @@
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Compare two RGB565 raw screen captures (golden images, see src/screenCapture.h).
+// Prints CRC32 of both images (same as in /golden/ref.txt and the /golden report),
+// number of differing pixels, their bounding box and the largest channel delta.
+// Optionally writes a diff image: differing pixels red, others dimmed from the
+// reference, view it on the panel or convert with any RGB565 viewer.
+// Exit code 0 if identical, 1 if different, 2 on error.
+// Build and run on the PC:
+//   g++ -O2 -std=c++17 -I../../src img_diff.cpp -o img_diff
+//   ./img_diff golden_ref/p_meter.565 golden/p_meter.565 p_meter_diff.565
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "imageBlit.h"
+
+struct rawImage_t {
+  imgRawHeader_t hdr;
+  std::vector<uint16_t> pixels;   // big endian, as in file
+};
+
+static bool loadRaw(const char *path, rawImage_t &img) {
+  FILE *in = fopen(path, "rb");
+  if (!in) {
+    fprintf(stderr, "Can not open %s\n", path);
+    return false;
+  }
+  bool ok = (fread(&img.hdr, sizeof(img.hdr), 1, in) == 1) && (img.hdr.magic == IMG_RAW_MAGIC);
+  if (ok) {
+    img.pixels.resize((size_t)img.hdr.w * img.hdr.h);
+    ok = fread(img.pixels.data(), 2, img.pixels.size(), in) == img.pixels.size();
+  }
+  fclose(in);
+  if (!ok)
+    fprintf(stderr, "%s is not a complete RGB565 raw file\n", path);
+  return ok;
+}
+
+// zlib CRC32, same as crc32_le() in ESP32 ROM
+static uint32_t crc32(const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  uint32_t crc = 0xFFFFFFFF;
+  while (len--) {
+    crc ^= *p++;
+    for (int i = 0; i < 8; i++)
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+static uint16_t swap16(uint16_t c) { return (c >> 8) | (c << 8); }
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s reference.565 capture.565 [diff.565]\n", argv[0]);
+    return 2;
+  }
+  rawImage_t ref, cap;
+  if (!loadRaw(argv[1], ref) || !loadRaw(argv[2], cap))
+    return 2;
+  printf("reference %s: %u x %u, crc %08x\n", argv[1], ref.hdr.w, ref.hdr.h,
+    crc32(ref.pixels.data(), ref.pixels.size() * 2));
+  printf("capture   %s: %u x %u, crc %08x\n", argv[2], cap.hdr.w, cap.hdr.h,
+    crc32(cap.pixels.data(), cap.pixels.size() * 2));
+  if ((ref.hdr.w != cap.hdr.w) || (ref.hdr.h != cap.hdr.h)) {
+    printf("image size differs\n");
+    return 1;
+  }
+  int w = ref.hdr.w, h = ref.hdr.h;
+  int x0 = w, y0 = h, x1 = -1, y1 = -1, maxDelta = 0;
+  long count = 0;
+  std::vector<uint16_t> diff(ref.pixels.size());
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      size_t i = (size_t)y * w + x;
+      uint16_t a = swap16(ref.pixels[i]), b = swap16(cap.pixels[i]);
+      if (a == b) {
+        diff[i] = swap16((a >> 2) & 0x39E7); // dimmed to 1/4 per channel
+        continue;
+      }
+      diff[i] = swap16(0xF800);
+      count++;
+      if (x < x0) x0 = x;
+      if (x > x1) x1 = x;
+      if (y < y0) y0 = y;
+      if (y > y1) y1 = y;
+      // channel deltas scaled to 8 bit
+      int dr = abs((a >> 11) - (b >> 11)) << 3;
+      int dg = abs(((a >> 5) & 0x3F) - ((b >> 5) & 0x3F)) << 2;
+      int db = abs((a & 0x1F) - (b & 0x1F)) << 3;
+      if (dr > maxDelta) maxDelta = dr;
+      if (dg > maxDelta) maxDelta = dg;
+      if (db > maxDelta) maxDelta = db;
+    }
+  }
+  if (count)
+    printf("%ld pixels differ (%.2f%%), box x=%d..%d y=%d..%d, max channel delta %d\n",
+      count, 100.0 * count / ((long)w * h), x0, x1, y0, y1, maxDelta);
+  else
+    printf("images identical\n");
+  if (argc > 3) {
+    FILE *out = fopen(argv[3], "wb");
+    if (!out) {
+      fprintf(stderr, "Can not create %s\n", argv[3]);
+      return 2;
+    }
+    fwrite(&ref.hdr, sizeof(ref.hdr), 1, out);
+    fwrite(diff.data(), 2, diff.size(), out);
+    fclose(out);
+  }
+  return count ? 1 : 0;
+}
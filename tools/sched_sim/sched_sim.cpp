@@ -0,0 +1,109 @@
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Host simulation of JobScheduler (src/jobScheduler.h) with the jobs of loop().
+// Build and run on the PC:
+//   g++ -O2 -std=c++17 -Wall -Wextra -I../../src sched_sim.cpp -o sched_sim
+//   ./sched_sim [render_ms_heavy]
+// Simulated time in 100 us steps, each job takes a fixed run time. After 3 s
+// of normal load, page rendering becomes expensive (default 30 ms per frame,
+// e.g. a full redraw every frame) for 5 s, then normal again for 5 s.
+// Prints load, shed level and effective render period once per second, and
+// checks that acquisition never skips a period while rendering slows down
+// under load and recovers afterwards. Jobs are not preempted: a single frame
+// longer than the acquisition period (try 60) makes acquisition skip periods
+// no matter how often frames are drawn.
+// The 200 Hz pen job has a deadline far above a frame, so frames longer than
+// its period do not count as critical overruns and do not shed at normal load.
+
+#include <cstdio>
+#include <cstdlib>
+#include "jobScheduler.h"
+#include "../sim_check.h"
+
+enum { job_acquire = 0, job_touch, job_scope, job_render, job_blink, job_clock, job_power, job_pen, job_count };
+
+int main(int argc, char *argv[]) {
+  uint32_t heavy_us = (argc > 1) ? (uint32_t)(atof(argv[1]) * 1000) : 30000;
+  // run time per job in us
+  uint32_t cost[job_count] = { 1500, 300, 2500, 6000, 200, 4000, 300, 150 };
+
+  JobScheduler sched;
+  sched.add(job_acquire, "acquire", 35, 0);
+  sched.add(job_touch, "touch", 35, 1);
+  sched.add(job_scope, "scope", 70, 1);
+  sched.add(job_render, "render", 35, 2);
+  sched.add(job_blink, "blink", 100, 3);
+  sched.add(job_clock, "clock", 1000, 1);
+  sched.add(job_power, "power", 250, 3);
+  sched.add(job_pen, "pen", 5, 1, 120);
+
+  uint64_t t_us = 0;
+  int max_shed = 0, max_shed_normal = 0;
+  uint32_t skipped_heavy = 0, render_runs_normal = 0, render_runs_heavy = 0;
+  printf("   s  load%%  shed  render ms  phase\n");
+  for (int second = 0; second < 13; second++) {
+    bool heavy = (second >= 3) && (second < 8);
+    cost[job_render] = heavy ? heavy_us : 6000;
+    uint32_t acq_skipped = sched.skipped(job_acquire);
+    uint32_t render_runs = sched.runs(job_render);
+    uint64_t end_us = (uint64_t)(second + 1) * 1000000;
+    while (t_us < end_us) {
+      uint32_t now = (uint32_t)(t_us / 1000);
+      int job = sched.next(now);
+      if (job < 0) {
+        t_us += 100;
+        continue;
+      }
+      t_us += cost[job];
+      sched.done(job, now, cost[job]);
+    }
+    if (heavy) {
+      skipped_heavy += sched.skipped(job_acquire) - acq_skipped;
+      if (second >= 6) render_runs_heavy += sched.runs(job_render) - render_runs;
+    } else if (second < 3) {
+      render_runs_normal += sched.runs(job_render) - render_runs;
+    }
+    if (sched.shedLevel() > max_shed) max_shed = sched.shedLevel();
+    if ((second < 3) && (sched.shedLevel() > max_shed_normal)) max_shed_normal = sched.shedLevel();
+    printf("  %2d  %5d  %4d  %9lu  %s\n", second + 1, sched.load(), sched.shedLevel(),
+      (unsigned long)sched.effectivePeriod(job_render), heavy ? "heavy" : "normal");
+  }
+
+  static char report[SCHED_JSON_SIZE];
+  sched.report(report, sizeof(report));
+  printf("%s", report);
+
+  check(max_shed_normal == 0, "no shedding at normal load with pen job");
+  check(sched.overruns(job_pen) == 0, "frames longer than pen period no overrun");
+  check(sched.skipped(job_acquire) == 0, "acquisition never skipped");
+  check(skipped_heavy == 0, "no acquisition skipped under heavy render load");
+  check(max_shed > 0, "render period stretched under load");
+  check(render_runs_heavy < render_runs_normal, "fewer frames per second under load");
+  check(sched.shedLevel() == 0, "back to full rate after load");
+  check(sched.runs(job_clock) >= 12, "clock keeps its rate under load");
+  check(sched.runs(job_power) >= 13 * 1000 / 250 / 2, "power job runs under load");
+
+  // idle floor as set by PowerManager with stable values
+  uint32_t now = (uint32_t)(t_us / 1000);
+  sched.setMinShed(2);
+  check(sched.effectivePeriod(job_render) == 4 * 35, "idle floor stretches render period");
+  check(sched.effectivePeriod(job_acquire) == 35, "idle floor keeps acquisition period");
+  sched.setMinShed(0);
+  check(sched.shedLevel() == 0, "full rate at once after idle floor");
+  uint32_t wait = sched.msUntilNext(now, 1000);
+  check(wait <= 35, "sleep time limited by next release");
+  sched.trigger(job_touch, now);
+  check(sched.msUntilNext(now, 1000) == 0, "triggered job is due at once");
+  return checkSummary();
+}
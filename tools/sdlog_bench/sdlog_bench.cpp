@@ -0,0 +1,50 @@
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Host benchmark for SdLogger (src/sdLogger.h), using the regular file stand-in.
+// Build and run on the PC:
+//   g++ -O2 -std=c++17 -I../../src sdlog_bench.cpp -o sdlog_bench
+//   ./sdlog_bench [samples] [channels] [file]
+// Prints samples per second, bytes per sample, buffer write times and dropped samples.
+// Check the resulting file with tools/sdlog_reader.
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include "sdLogger.h"
+
+int main(int argc, char *argv[]) {
+  uint32_t samples = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+  int channels = (argc > 2) ? atoi(argv[2]) : 2;
+  const char *filename = (argc > 3) ? argv[3] : "sdlog_bench.kbl";
+
+  static SdLogger logger;
+  if (!logger.begin(filename, channels)) {
+    fprintf(stderr, "Can not create %s\n", filename);
+    return 1;
+  }
+  int16_t values[LOG_MAX_CHANNELS];
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < samples; i++) {
+    for (int ch = 0; ch < channels; ch++)
+      values[ch] = (int16_t)(2048 + ((i * (ch + 1)) % 64) + (rand() % 9) - 4); // 12 bit ADC, ramp + noise
+    logger.log((uint64_t)i * 1000, values); // 1 kHz timestamps
+  }
+  logger.end();
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("%u samples, %d channels in %.3f s = %.0f samples/s\n", samples, channels, secs, samples / secs);
+  printf("%u blocks written, %.2f bytes/sample, max. buffer write %u us, %u dropped\n",
+    logger.blocksWritten(), (double)logger.blocksWritten() * LOG_BLOCK_SIZE / samples,
+    logger.maxWriteMicros(), logger.droppedSamples());
+  return 0;
+}
@@ -0,0 +1,250 @@
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Host reader/exporter for SdLogger files (src/sdLogger.h, format version 2).
+// Build and run on the PC:
+//   g++ -O2 -std=c++17 -I../../src sdlog_reader.cpp -o sdlog_reader
+//   ./sdlog_reader file.kbl info
+//   ./sdlog_reader file.kbl csv [from_s] [to_s] [points] > out.csv
+// Times are seconds relative to the first sample.
+// The file is mmap'ed, a time window is found by binary search over the block
+// headers. With "points", the window is downsampled to min/max per bucket:
+// index entries and blocks lying completely in one bucket are taken from their
+// min/max summary without decoding, so even multi-day logs export quickly.
+// Files without trailer (power loss while logging) are read up to the last
+// valid block, without index.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sdLogger.h"
+
+struct LogFile {
+  const uint8_t *data = NULL;
+  size_t size = 0;
+  uint32_t blocks = 0;                    // valid data blocks
+  uint8_t channels = 0;
+  const logTrailer_t *trailer = NULL;     // NULL if log was not closed properly
+  const logIndexEntry_t *index = NULL;
+  uint32_t entries = 0;
+
+  const logBlockHeader_t *block(uint32_t i) const {
+    return (const logBlockHeader_t *)(data + (size_t)i * LOG_BLOCK_SIZE);
+  }
+};
+
+static bool blockValid(const LogFile &log, uint32_t i) {
+  if ((size_t)(i + 1) * LOG_BLOCK_SIZE > log.size) return false;
+  const logBlockHeader_t *hdr = log.block(i);
+  return (hdr->magic == LOG_MAGIC) && (hdr->seq == i) && (hdr->version == LOG_FORMAT_VERSION)
+    && (hdr->channels > 0) && (hdr->channels <= LOG_MAX_CHANNELS) && (hdr->used <= LOG_PAYLOAD_SIZE);
+}
+
+static bool openLog(const char *filename, LogFile &log) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if ((fstat(fd, &st) < 0) || (st.st_size < LOG_BLOCK_SIZE)) {
+    close(fd);
+    return false;
+  }
+  log.size = st.st_size;
+  void *map = mmap(NULL, log.size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return false;
+  log.data = (const uint8_t *)map;
+  madvise(map, log.size, MADV_RANDOM);
+
+  const logTrailer_t *tr = (const logTrailer_t *)(log.data + (log.size / LOG_BLOCK_SIZE - 1) * LOG_BLOCK_SIZE);
+  if ((tr->magic == LOG_INDEX_MAGIC) && (tr->version == LOG_FORMAT_VERSION)
+      && (tr->entrySize == sizeof(logIndexEntry_t))
+      && ((size_t)tr->dataBlocks * LOG_BLOCK_SIZE + tr->indexEntries * sizeof(logIndexEntry_t) < log.size)) {
+    log.trailer = tr;
+    log.blocks = tr->dataBlocks;
+    log.index = (const logIndexEntry_t *)(log.data + (size_t)tr->dataBlocks * LOG_BLOCK_SIZE);
+    log.entries = tr->indexEntries;
+  } else {
+    // no trailer: scan block headers up to the first invalid block
+    while (blockValid(log, log.blocks))
+      log.blocks++;
+  }
+  if (log.blocks == 0) return false;
+  log.channels = log.block(0)->channels;
+  return true;
+}
+
+// Decode all samples of a block, calls fn(time_us, values) for each
+template <typename F>
+static bool decodeBlock(const logBlockHeader_t *hdr, F fn) {
+  const uint8_t *p = (const uint8_t *)hdr + sizeof(logBlockHeader_t);
+  const uint8_t *end = p + hdr->used;
+  uint64_t t = hdr->t_first;
+  int32_t values[LOG_MAX_CHANNELS] = {0};
+  for (int i = 0; i < hdr->count; i++) {
+    uint64_t v;
+    if (!(p = logGetVarint(p, end, &v))) return false;
+    t += v;
+    for (int ch = 0; ch < hdr->channels; ch++) {
+      if (!(p = logGetVarint(p, end, &v))) return false;
+      values[ch] += logUnzigzag((uint32_t)v);
+    }
+    fn(t, values);
+  }
+  return true;
+}
+
+// First block with t_last >= t, log.blocks if none
+static uint32_t findBlock(const LogFile &log, uint64_t t) {
+  uint32_t lo = 0, hi = log.blocks;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (log.block(mid)->t_last < t)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static void printInfo(const LogFile &log) {
+  uint64_t t0 = log.block(0)->t_first;
+  uint64_t t1 = log.block(log.blocks - 1)->t_last;
+  printf("channels:     %u\n", log.channels);
+  printf("data blocks:  %u\n", log.blocks);
+  printf("duration:     %.3f s\n", (t1 - t0) / 1e6);
+  if (log.trailer) {
+    printf("samples:      %llu (%.2f bytes/sample)\n", (unsigned long long)log.trailer->samples,
+      log.trailer->samples ? (double)log.blocks * LOG_BLOCK_SIZE / log.trailer->samples : 0.0);
+    printf("dropped:      %u\n", log.trailer->dropped);
+    printf("index:        %u entries, %u blocks each\n", log.entries, log.trailer->groupBlocks);
+    for (uint32_t i = 0; i < log.entries; i++) {
+      const logIndexEntry_t *e = &log.index[i];
+      printf("  %10.3f .. %10.3f s", (e->t_first - t0) / 1e6, (e->t_last - t0) / 1e6);
+      for (int ch = 0; ch < log.channels; ch++)
+        printf("  ch%d %6d..%-6d", ch, e->vmin[ch], e->vmax[ch]);
+      printf("\n");
+    }
+  } else {
+    printf("no trailer, log was not closed properly\n");
+  }
+}
+
+// Raw export of all samples in [from, to]
+static void exportRaw(const LogFile &log, uint64_t from, uint64_t to, uint64_t t0) {
+  for (uint32_t i = findBlock(log, from); i < log.blocks; i++) {
+    const logBlockHeader_t *hdr = log.block(i);
+    if (hdr->t_first > to) break;
+    decodeBlock(hdr, [&](uint64_t t, const int32_t *values) {
+      if ((t < from) || (t > to)) return;
+      printf("%.6f", (t - t0) / 1e6);
+      for (int ch = 0; ch < hdr->channels; ch++)
+        printf(",%d", values[ch]);
+      printf("\n");
+    });
+  }
+}
+
+struct Bucket {
+  bool valid = false;
+  int32_t vmin[LOG_MAX_CHANNELS];
+  int32_t vmax[LOG_MAX_CHANNELS];
+
+  template <typename T>
+  void merge(const T *lo, const T *hi, int channels) {
+    for (int ch = 0; ch < channels; ch++) {
+      if (!valid || lo[ch] < vmin[ch]) vmin[ch] = lo[ch];
+      if (!valid || hi[ch] > vmax[ch]) vmax[ch] = hi[ch];
+    }
+    valid = true;
+  }
+};
+
+// Downsampled export: min/max per channel for "points" buckets in [from, to]
+static void exportDownsampled(const LogFile &log, uint64_t from, uint64_t to, uint64_t t0, uint32_t points) {
+  uint64_t width = (to - from) / points + 1;
+  std::vector<Bucket> buckets(points);
+  auto bucketOf = [&](uint64_t t) { return (size_t)((t - from) / width); };
+  uint32_t entry = 0;
+  uint32_t i = findBlock(log, from);
+  while (i < log.blocks) {
+    // whole index entry in one bucket: use its summary and skip its blocks
+    while ((entry < log.entries) && (log.index[entry].first_block + log.index[entry].blocks <= i))
+      entry++;
+    if (entry < log.entries) {
+      const logIndexEntry_t *e = &log.index[entry];
+      if ((e->first_block == i) && (e->t_first >= from) && (e->t_last <= to)
+          && (bucketOf(e->t_first) == bucketOf(e->t_last))) {
+        buckets[bucketOf(e->t_first)].merge(e->vmin, e->vmax, log.channels);
+        i += e->blocks;
+        continue;
+      }
+    }
+    const logBlockHeader_t *hdr = log.block(i);
+    if (hdr->t_first > to) break;
+    if ((hdr->t_first >= from) && (hdr->t_last <= to) && (bucketOf(hdr->t_first) == bucketOf(hdr->t_last))) {
+      buckets[bucketOf(hdr->t_first)].merge(hdr->vmin, hdr->vmax, hdr->channels);
+    } else {
+      decodeBlock(hdr, [&](uint64_t t, const int32_t *values) {
+        if ((t >= from) && (t <= to))
+          buckets[bucketOf(t)].merge(values, values, hdr->channels);
+      });
+    }
+    i++;
+  }
+  for (uint32_t b = 0; b < points; b++) {
+    if (!buckets[b].valid) continue;
+    printf("%.6f", (from + b * width - t0) / 1e6);
+    for (int ch = 0; ch < log.channels; ch++)
+      printf(",%d,%d", buckets[b].vmin[ch], buckets[b].vmax[ch]);
+    printf("\n");
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s file.kbl info|csv [from_s] [to_s] [points]\n", argv[0]);
+    return 1;
+  }
+  LogFile log;
+  if (!openLog(argv[1], log)) {
+    fprintf(stderr, "Can not read %s\n", argv[1]);
+    return 1;
+  }
+  if (strcmp(argv[2], "info") == 0) {
+    printInfo(log);
+    return 0;
+  }
+  uint64_t t0 = log.block(0)->t_first;
+  uint64_t from = t0, to = log.block(log.blocks - 1)->t_last;
+  if (argc > 3) from = t0 + (uint64_t)(atof(argv[3]) * 1e6);
+  if (argc > 4) to = t0 + (uint64_t)(atof(argv[4]) * 1e6);
+  uint32_t points = (argc > 5) ? strtoul(argv[5], NULL, 10) : 0;
+  if (to < from) return 0;
+  if (points > 0) {
+    printf("time_s");
+    for (int ch = 0; ch < log.channels; ch++)
+      printf(",ch%d_min,ch%d_max", ch, ch);
+    printf("\n");
+    exportDownsampled(log, from, to, t0, points);
+  } else {
+    printf("time_s");
+    for (int ch = 0; ch < log.channels; ch++)
+      printf(",ch%d", ch);
+    printf("\n");
+    exportRaw(log, from, to, t0);
+  }
+  return 0;
+}
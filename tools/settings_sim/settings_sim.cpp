@@ -0,0 +1,231 @@
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Host simulation of SettingsStore (src/settingsStore.h) with the file backend.
+// Build and run on the PC:
+//   g++ -O2 -std=c++17 -Wall -Wextra -I../../src settings_sim.cpp -o settings_sim
+//   ./settings_sim [file]
+// Runs through the life of a settings struct and prints the records written
+// per step: first boot, a single changed field, several changes within the
+// commit delay, reboot, a firmware with a longer array and a new field
+// (version 2 with migration), a corrupted record and a torn write at the end
+// of the log. Finally the log is filled until it is compacted.
+
+#include <cstdio>
+#include <cstring>
+#include "settingsStore.h"
+#include "../sim_check.h"
+
+// Layout of "old firmware"
+struct settings_v1_t {
+  char ssid[32] = "default";
+  uint16_t spkrBeep = 1;
+  int ampRangeIdx = 2;
+  float adcScalings[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  float markerVolts = 0.5f;   // fraction of full scale
+};
+
+const settingsField_t fields_v1[] = {
+  SETTINGS_FIELD(settings_v1_t, 1, ssid, SF_PREFIX),
+  SETTINGS_FIELD(settings_v1_t, 2, spkrBeep, SF_DEFAULT),
+  SETTINGS_FIELD(settings_v1_t, 3, ampRangeIdx, SF_DEFAULT),
+  SETTINGS_FIELD(settings_v1_t, 4, adcScalings, SF_PREFIX),
+  SETTINGS_FIELD(settings_v1_t, 5, markerVolts, SF_DEFAULT),
+};
+
+// Layout of "new firmware": more ranges, new field, marker in volts
+struct settings_v2_t {
+  char ssid[32] = "default";
+  uint16_t spkrBeep = 1;
+  int ampRangeIdx = 2;
+  float adcScalings[6] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+  float markerVolts = 5.0f;   // volts
+  bool autoRangeOn = false;
+};
+
+// Field by field, padding of the structs is undefined
+static bool sameSettings(const settings_v2_t &a, const settings_v2_t &b) {
+  if (strcmp(a.ssid, b.ssid) || (a.spkrBeep != b.spkrBeep) || (a.ampRangeIdx != b.ampRangeIdx))
+    return false;
+  for (int i = 0; i < 6; i++)
+    if (a.adcScalings[i] != b.adcScalings[i]) return false;
+  return (a.markerVolts == b.markerVolts) && (a.autoRangeOn == b.autoRangeOn);
+}
+
+const settingsField_t fields_v2[] = {
+  SETTINGS_FIELD(settings_v2_t, 1, ssid, SF_PREFIX),
+  SETTINGS_FIELD(settings_v2_t, 2, spkrBeep, SF_DEFAULT),
+  SETTINGS_FIELD(settings_v2_t, 3, ampRangeIdx, SF_DEFAULT),
+  SETTINGS_FIELD(settings_v2_t, 4, adcScalings, SF_PREFIX),
+  SETTINGS_FIELD(settings_v2_t, 5, markerVolts, SF_DEFAULT),
+  SETTINGS_FIELD(settings_v2_t, 6, autoRangeOn, SF_DEFAULT),
+};
+
+#define FIELDS(f) f, (int)(sizeof(f) / sizeof(f[0]))
+
+static void migrate(uint16_t from_version, void *data) {
+  settings_v2_t *s = (settings_v2_t *)data;
+  if (from_version < 2)
+    s->markerVolts *= 10.0f; // was fraction of 10 V range
+}
+
+static long fileSize(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return 0;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fclose(f);
+  return size;
+}
+
+int main(int argc, char *argv[]) {
+  const char *path = (argc > 1) ? argv[1] : "settings_sim.log";
+  remove(path);
+  FileSettingsBackend backend(path);
+  int n;
+
+  printf("first boot, empty store\n");
+  {
+    settings_v1_t s;
+    SettingsStore store(&s, sizeof(s), FIELDS(fields_v1), 1);
+    n = store.load(&backend);
+    check(n == 0, "nothing loaded");
+    n = store.commit();
+    printf("  %d records written, log %ld bytes\n", n, fileSize(path));
+    check(n == 5, "all fields written");
+    check(store.commit() == 0, "second commit writes nothing");
+  }
+
+  printf("one field changed\n");
+  {
+    settings_v1_t s;
+    SettingsStore store(&s, sizeof(s), FIELDS(fields_v1), 1);
+    store.load(&backend);
+    s.spkrBeep = 0;
+    n = store.commit();
+    check(n == 1, "one record written");
+  }
+
+  printf("several changes within commit delay\n");
+  {
+    settings_v1_t s;
+    SettingsStore store(&s, sizeof(s), FIELDS(fields_v1), 1);
+    store.load(&backend);
+    uint32_t now = 1000;
+    strcpy(s.ssid, "MyRouter");
+    store.markDirty(now);
+    now += 500;
+    s.adcScalings[2] = 1.007f;
+    store.markDirty(now);
+    now += 500;
+    s.ampRangeIdx = 3;
+    store.markDirty(now);
+    n = store.update(now + SETTINGS_COMMIT_DELAY_MS - 1);
+    check(n == 0, "nothing written before delay");
+    n = store.update(now + SETTINGS_COMMIT_DELAY_MS);
+    check((n == 3) && (store.commits == 1), "3 records in one commit after delay");
+    check(!store.isDirty(), "clean after commit");
+  }
+
+  printf("reboot\n");
+  {
+    settings_v1_t s;
+    SettingsStore store(&s, sizeof(s), FIELDS(fields_v1), 1);
+    n = store.load(&backend);
+    check(n == 5, "all fields loaded");
+    check((strcmp(s.ssid, "MyRouter") == 0) && (s.spkrBeep == 0) && (s.ampRangeIdx == 3)
+      && (s.adcScalings[2] == 1.007f), "values restored");
+  }
+
+  printf("new firmware, version 2\n");
+  {
+    settings_v2_t s;
+    SettingsStore store(&s, sizeof(s), FIELDS(fields_v2), 2);
+    store.setMigration(migrate);
+    n = store.load(&backend);
+    printf("  %d loaded, %d with changed size\n", n, store.migrated());
+    check((s.adcScalings[2] == 1.007f) && (s.adcScalings[5] == 1.0f), "array prefix kept, new entries default");
+    check(s.markerVolts == 5.0f, "marker migrated to volts");
+    check(strcmp(s.ssid, "MyRouter") == 0, "unchanged fields kept");
+    n = store.commit();
+    printf("  %d records written\n", n);
+    check(n == 3, "grown array, migrated and new field written");
+  }
+
+  printf("corrupted record\n");
+  {
+    // flip one byte of the last ssid record value
+    FILE *f = fopen(path, "r+b");
+    long pos = -1, off = 0;
+    char k[SETTINGS_KEY_LEN + 1];
+    uint8_t klen, vlen[2];
+    while ((fread(&klen, 1, 1, f) == 1) && (fread(k, 1, klen, f) == klen) && (fread(vlen, 1, 2, f) == 2)) {
+      k[klen] = '\0';
+      int len = vlen[0] | (vlen[1] << 8);
+      if (strcmp(k, "f1") == 0) pos = off + 1 + klen + 2 + 4;
+      fseek(f, len, SEEK_CUR);
+      off = ftell(f);
+    }
+    fseek(f, pos, SEEK_SET);
+    fputc('X', f);
+    fclose(f);
+    settings_v2_t s;
+    SettingsStore store(&s, sizeof(s), FIELDS(fields_v2), 2);
+    n = store.load(&backend);
+    check((store.crcErrors == 1) && (strcmp(s.ssid, "default") == 0), "CRC error, field keeps default");
+    check((n == 5) && (s.ampRangeIdx == 3), "other fields loaded");
+    check(store.commit() == 1, "default rewritten");
+  }
+
+  printf("torn write at end of log\n");
+  {
+    FILE *f = fopen(path, "ab");
+    fwrite("\x02" "f3" "\x0a", 1, 4, f); // record cut after length byte
+    fclose(f);
+    settings_v2_t s;
+    SettingsStore store(&s, sizeof(s), FIELDS(fields_v2), 2);
+    n = store.load(&backend);
+    check((n == 6) && (s.ampRangeIdx == 3), "torn record ignored");
+    s.ampRangeIdx = 4;
+    store.commit();
+    settings_v2_t r;
+    SettingsStore reload(&r, sizeof(r), FIELDS(fields_v2), 2);
+    reload.load(&backend);
+    check(r.ampRangeIdx == 4, "next write readable");
+  }
+
+  printf("log compaction\n");
+  {
+    settings_v2_t s;
+    SettingsStore store(&s, sizeof(s), FIELDS(fields_v2), 2);
+    store.load(&backend);
+    long max_size = 0;
+    for (int i = 0; i < 500; i++) {
+      s.ampRangeIdx = i % 10;
+      s.adcScalings[i % 6] += 0.001f;
+      store.commit();
+      long size = fileSize(path);
+      if (size > max_size) max_size = size;
+    }
+    printf("  %u commits, %u records, %d compactions, log max %ld bytes, now %ld bytes\n",
+      store.commits, store.fieldWrites, backend.compactions, max_size, fileSize(path));
+    check((backend.compactions > 0) && (max_size < SETTINGS_FILE_COMPACT + 256), "log size bounded");
+    settings_v2_t r;
+    SettingsStore reload(&r, sizeof(r), FIELDS(fields_v2), 2);
+    reload.load(&backend);
+    check(sameSettings(r, s), "values after compaction");
+  }
+
+  remove(path);
+  return checkSummary();
+}
@@ -0,0 +1,36 @@
+#ifndef SIM_CHECK_H
+#define SIM_CHECK_H
+
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Check harness shared by the host simulations in tools/, included as
+// "../sim_check.h". Each check prints one line, main() ends with
+//   return checkSummary();
+// which prints "all ok" or "FAILED" and gives the exit code.
+
+#include <cstdio>
+
+static int failed = 0;
+
+static void check(bool ok, const char *what) {
+  printf("  %-52s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok) failed++;
+}
+
+static int checkSummary() {
+  printf("%s\n", failed ? "FAILED" : "all ok");
+  return failed ? 1 : 0;
+}
+
+#endif // SIM_CHECK_H
@@ -0,0 +1,186 @@
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Host simulation of TouchFilter and TouchCal (src/touchFilter.h).
+// Build and run on the PC:
+//   g++ -O2 -std=c++17 -Wall -Wextra -I../../src touch_sim.cpp -o touch_sim
+//   ./touch_sim [noise_raw] [spike_pct]
+// A digitizer model maps screen points to raw values with scale, offset, a
+// slight rotation and skew, and adds noise (default +-8 raw), spikes of up
+// to +-400 raw (default 3% of samples) and a pressure ramp when pressing and
+// lifting. Samples at 200 Hz. Checks the 3-point calibration, jitter of a
+// resting finger, light touches, lifting, drag lag and the old 2-corner
+// mapping, and prints the time per sample on this machine.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "touchFilter.h"
+#include "../sim_check.h"
+
+static uint32_t rng = 12345;
+static int rnd(int range) { // -range..range
+  rng = rng * 1664525u + 1013904223u;
+  return (int)((rng >> 8) % (2 * range + 1)) - range;
+}
+
+static int noise = 8, spike_pct = 3;
+
+// Digitizer: screen pixel to raw, rotated by about 1 degree and skewed
+static void toRaw(double px, double py, int32_t *rx, int32_t *ry) {
+  *rx = (int32_t)lround(290 + px * 10.55 + py * 0.25);
+  *ry = (int32_t)lround(230 + py * 15.05 - px * 0.18);
+}
+
+// One noisy sample at pressure z
+static bool sample(TouchFilter &f, double px, double py, int z) {
+  int32_t rx, ry;
+  toRaw(px, py, &rx, &ry);
+  rx += rnd(noise);
+  ry += rnd(noise);
+  if (rnd(50) + 50 < spike_pct) { // 0..100
+    rx += rnd(400);
+    ry += rnd(400);
+  }
+  return f.push(rx, ry, z);
+}
+
+static double dist(const TouchCal &cal, const TouchFilter &f, double px, double py) {
+  int32_t sx, sy;
+  cal.map(f.x(), f.y(), &sx, &sy);
+  return hypot(sx - px, sy - py);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) noise = atoi(argv[1]);
+  if (argc > 2) spike_pct = atoi(argv[2]);
+  TouchFilter f;
+  TouchCal cal;
+
+  // 3-point calibration, position of each target after 40 samples (200 ms)
+  const int32_t tx[3] = { 32, 288, 160 }, ty[3] = { 24, 120, 216 };
+  int32_t rx[3], ry[3];
+  for (int i = 0; i < 3; i++) {
+    f.reset();
+    for (int n = 0; n < 40; n++)
+      sample(f, tx[i], ty[i], 1500);
+    rx[i] = f.x();
+    ry[i] = f.y();
+  }
+  check(cal.setPoints(rx, ry, tx, ty), "calibration solved");
+  double max_err = 0;
+  for (int py = 0; py < 240; py += 8) {
+    for (int px = 0; px < 320; px += 8) {
+      int32_t r_x, r_y, sx, sy;
+      toRaw(px, py, &r_x, &r_y);
+      cal.map(r_x, r_y, &sx, &sy);
+      double e = hypot(sx - px, sy - py);
+      if (e > max_err) max_err = e;
+    }
+  }
+  printf("  calibration: max error %.2f px over the screen\n", max_err);
+  check(max_err <= 2.5, "rotated/skewed panel mapped within 2.5 px");
+  const int32_t line_x[3] = { 100, 200, 300 }, line_y[3] = { 100, 200, 300 };
+  TouchCal bad;
+  check(!bad.setPoints(line_x, line_y, tx, ty), "collinear targets rejected");
+
+  // resting finger at 200 Hz for 1 s
+  f.reset();
+  double worst = 0, worst_raw = 0;
+  for (int n = 0; n < 200; n++) {
+    sample(f, 150, 100, 1200);
+    int32_t r_x, r_y, sx, sy;
+    toRaw(150, 100, &r_x, &r_y);
+    cal.map(r_x + rnd(noise) + ((rnd(50) + 50 < spike_pct) ? rnd(400) : 0), r_y + rnd(noise), &sx, &sy);
+    if (n >= 10) {
+      double e = dist(cal, f, 150, 100);
+      if (e > worst) worst = e;
+      double er = hypot(sx - 150, sy - 100);
+      if (er > worst_raw) worst_raw = er;
+    }
+  }
+  printf("  resting finger: max error %.1f px filtered, %.1f px single samples\n", worst, worst_raw);
+  check(worst <= 2.0, "resting finger within 2 px");
+
+  // light touch never registers
+  f.reset();
+  uint32_t rejected = f.rejected();
+  bool any = false;
+  for (int n = 0; n < 40; n++)
+    any |= sample(f, 300, 230, 450);
+  check(!any && (f.rejected() > rejected), "light edge touch rejected");
+
+  // single strong sample does not press (debounce)
+  f.reset();
+  bool p1 = sample(f, 100, 100, 1500);
+  bool p2 = sample(f, 100, 100, 0);
+  check(!p1 && !p2, "single sample does not press");
+
+  // lifting: pressure falls and coordinates wander, position must stay
+  f.reset();
+  for (int n = 0; n < 30; n++)
+    sample(f, 200, 60, 1500);
+  double before = dist(cal, f, 200, 60);
+  bool held = true;
+  for (int n = 0; n < 6; n++)
+    held &= sample(f, 200 + n * 15, 60 + n * 10, 550 - n * 20); // between release and press level
+  double after = dist(cal, f, 200, 60);
+  check(held && (after - before < 1.0), "position held while lifting");
+  sample(f, 260, 120, 100);
+  bool still = sample(f, 260, 120, 0);
+  check(!still, "released after low pressure samples");
+
+  // drag at 400 px/s
+  f.reset();
+  double lag = 0;
+  for (int n = 0; n < 100; n++) {
+    double px = 40 + n * 2.0;
+    sample(f, px, 120, 1300);
+    if (n >= 20) {
+      int32_t sx, sy;
+      cal.map(f.x(), f.y(), &sx, &sy);
+      if (px - sx > lag) lag = px - sx;
+    }
+  }
+  printf("  drag 400 px/s: lag %.1f px (%.0f ms)\n", lag, lag / 0.4);
+  check(lag <= 10.0, "drag lag within 10 px");
+
+  // old 2-corner calibration, same mapping as the former float formula
+  TouchCal corners;
+  check(corners.setCorners(295, 235, 3665, 3855, 320, 240), "2-corner calibration set");
+  bool same = true;
+  for (int r = 295; r < 3665; r += 37) {
+    int32_t sx, sy;
+    corners.map(r, 1000, &sx, &sy);
+    int old_x = (int)(320 * (float(r - 295) / 3370.0f));
+    if (abs(sx - old_x) > 1) same = false;
+  }
+  check(same, "2-corner mapping matches former formula");
+
+  // cost per sample: filter and mapping
+  const int N = 2000000;
+  volatile int32_t sink = 0;
+  f.reset();
+  auto t0 = std::chrono::steady_clock::now();
+  for (int n = 0; n < N; n++) {
+    int32_t sx, sy;
+    f.push(2000 + (n & 15), 2000 - (n & 7), 1200);
+    cal.map(f.x(), f.y(), &sx, &sy);
+    sink = sink + sx + sy;
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+  printf("  %.0f ns per sample on this machine (%.3f%% CPU at 200 Hz)\n", ns, ns * 200 / 1e7);
+
+  return checkSummary();
+}
@@ -0,0 +1,87 @@
+/*
+// ############################################################################
+//       __ ________  _____  ____  ___   ___  ___
+//      / //_/ __/\ \/ / _ )/ __ \/ _ | / _ \/ _ \
+//     / ,< / _/   \  / _  / /_/ / __ |/ , _/ // /
+//    /_/|_/___/_  /_/____/\____/_/_|_/_/|_/____/
+//      / _ \/ _ | / _ \/_  __/ |/ / __/ _ \
+//     / ___/ __ |/ , _/ / / /    / _// , _/
+//    /_/  /_/ |_/_/|_| /_/ /_/|_/___/_/|_|
+//
+// ############################################################################
+*/
+
+// Host simulation of WifiManager (src/wifiManager.h) with a scripted event sequence.
+// Build and run on the PC:
+//   g++ -O2 -std=c++17 -Wall -Wextra -I../../src wifi_sim.cpp -o wifi_sim
+//   ./wifi_sim sta t+2000 got_ip t+5000 disconnected t+10000
+//   ./wifi_sim wps t+30000 wps_failed t+5000 wps_success t+1000 got_ip
+//   ./wifi_sim known t+40000
+// Commands: sta, known, wps, ap, stop        start functions
+//           got_ip, disconnected, wps_success, wps_failed, ap_start   events
+//           t+<ms>                            let time pass, update() every 10 ms
+// Prints all hardware calls and state changes with their time stamps.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "wifiManager.h"
+
+static WifiManager manager;
+
+static void stateChanged(wifiState_e state) {
+  (void)state;
+  printf("%8u  -> state action: %s, connected %d, busy %d, retry %d\n", WifiManager::hostMillis,
+    manager.stateText(), manager.isConnected(), manager.isBusy(), manager.willRetry());
+}
+
+// Advance the clock in loop() sized steps
+static void runFor(uint32_t ms) {
+  uint32_t end = WifiManager::hostMillis + ms;
+  while (WifiManager::hostMillis < end) {
+    WifiManager::hostMillis += 10;
+    manager.update();
+  }
+}
+
+int main(int argc, char *argv[]) {
+  static const struct { const char *name; wifiEvent_e event; } events[] = {
+    { "got_ip", wifi_ev_got_ip }, { "disconnected", wifi_ev_disconnected },
+    { "wps_success", wifi_ev_wps_success }, { "wps_failed", wifi_ev_wps_failed },
+    { "ap_start", wifi_ev_ap_start }
+  };
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s sta|known|wps|ap|stop|<event>|t+<ms> ...\n", argv[0]);
+    return 1;
+  }
+  manager.setStateAction(stateChanged);
+  for (int i = 1; i < argc; i++) {
+    const char *cmd = argv[i];
+    if (strncmp(cmd, "t+", 2) == 0) {
+      runFor(strtoul(cmd + 2, NULL, 10));
+    } else if (strcmp(cmd, "sta") == 0) {
+      manager.connectSta("MyNetwork", "secret");
+    } else if (strcmp(cmd, "known") == 0) {
+      manager.connectSta(NULL, NULL);
+    } else if (strcmp(cmd, "wps") == 0) {
+      manager.startWps();
+    } else if (strcmp(cmd, "ap") == 0) {
+      manager.startAp("KBP PanelMeter");
+    } else if (strcmp(cmd, "stop") == 0) {
+      manager.stop();
+    } else {
+      size_t e = 0;
+      while ((e < sizeof(events) / sizeof(events[0])) && strcmp(cmd, events[e].name))
+        e++;
+      if (e == sizeof(events) / sizeof(events[0])) {
+        fprintf(stderr, "Unknown command %s\n", cmd);
+        return 1;
+      }
+      printf("%8u  event %s\n", WifiManager::hostMillis, cmd);
+      manager.postEvent(events[e].event);
+      runFor(10); // processed by next loop()
+    }
+  }
+  printf("%8u  final state: %s\n", WifiManager::hostMillis, manager.stateText());
+  return 0;
+}